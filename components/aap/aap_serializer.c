@@ -48,7 +48,7 @@ size_t aap_get_serialized_size(const struct aap_message *msg)
 	return result;
 }
 
-void aap_serialize(const struct aap_message *msg,
+void aap_serialize_header(const struct aap_message *msg,
 	void (*write)(void *param, const void *data, const size_t length),
 	void *param)
 {
@@ -75,8 +75,6 @@ void aap_serialize(const struct aap_message *msg,
 	    msg->type == AAP_MESSAGE_RECVBUNDLE) {
 		put_uint64(buffer, msg->payload_length);
 		write(param, buffer, 8);
-		if (msg->payload_length)
-			write(param, msg->payload, msg->payload_length);
 	}
 
 	// Bundle ID
@@ -87,6 +85,18 @@ void aap_serialize(const struct aap_message *msg,
 	}
 }
 
+void aap_serialize(const struct aap_message *msg,
+	void (*write)(void *param, const void *data, const size_t length),
+	void *param)
+{
+	aap_serialize_header(msg, write, param);
+
+	// The payload is the last field of all messages containing one
+	if ((msg->type == AAP_MESSAGE_SENDBUNDLE ||
+	     msg->type == AAP_MESSAGE_RECVBUNDLE) && msg->payload_length)
+		write(param, msg->payload, msg->payload_length);
+}
+
 struct write_context {
 	uint8_t *buffer;
 	size_t position;
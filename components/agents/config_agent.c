@@ -1,9 +1,11 @@
 #include "agents/config_agent.h"
 #include "agents/config_parser.h"
+#include "agents/plan_parser.h"
 
 #include "upcn/agent_manager.h"
 #include "upcn/common.h"
 
+#include "platform/hal_io.h"
 #include "platform/hal_queue.h"
 #include "platform/hal_types.h"
 
@@ -28,9 +30,32 @@ static void router_command_send(struct router_command *cmd, void *param)
 	hal_queue_push_to_back(router_signaling_queue, &signal);
 }
 
+static void plan_send(struct router_plan *plan, void *param)
+{
+	struct router_signal signal = {
+		.type = ROUTER_SIGNAL_PROCESS_PLAN,
+		.data = plan
+	};
+
+	QueueIdentifier_t router_signaling_queue = param;
+
+	hal_queue_push_to_back(router_signaling_queue, &signal);
+}
+
 static void callback(struct bundle_adu data, void *param)
 {
+	struct router_plan *plan;
+
 	(void)param;
+	if (plan_parser_is_plan(data.payload, data.length)) {
+		plan = plan_parser_parse(data.payload, data.length);
+		if (plan != NULL)
+			plan_send(plan, parser.send_param);
+		else
+			LOG("ConfigAgent: Received invalid contact plan");
+		bundle_adu_free_members(data);
+		return;
+	}
 	config_parser_reset(&parser);
 	config_parser_read(
 		&parser,
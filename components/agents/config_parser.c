@@ -2,6 +2,8 @@
 
 #include "platform/hal_io.h"
 
+#include "upcn/config.h"
+#include "upcn/nbf.h"
 #include "upcn/node.h"
 
 #include <stdbool.h>
@@ -23,6 +25,7 @@ static char const OBJECT_START_DELIMITER = '{';
 static char const OBJECT_END_DELIMITER = '}';
 static char const OBJECT_ELEMENT_SEPARATOR = ',';
 static char const NODES_CONTACTS_SEPARATOR = ':';
+static char const CONTACTS_NBF_SEPARATOR = ':';
 
 static uint8_t const COMMAND_END_MARKER = ';';
 
@@ -181,6 +184,29 @@ static void end_read_uint16(struct config_parser *parser, uint16_t *out)
 	parser->current_int_data = NULL;
 }
 
+static bool read_nbf_data(struct config_parser *parser, const char byte)
+{
+	struct nbf *const nbf = parser->router_command->data->nbf;
+	uint8_t nibble;
+
+	if (byte >= '0' && byte <= '9')
+		nibble = byte - '0';
+	else if (byte >= 'a' && byte <= 'f')
+		nibble = byte - 'a' + 10;
+	else if (byte >= 'A' && byte <= 'F')
+		nibble = byte - 'A' + 10;
+	else
+		return false;
+	if ((uint32_t)parser->current_index >=
+			2 * NBF_BYTE_COUNT(nbf->bit_count))
+		return false;
+	/* The first digit of a byte is the more significant one */
+	if (parser->current_index % 2 == 0)
+		nibble <<= 4;
+	nbf->bits[parser->current_index++ / 2] |= nibble;
+	return true;
+}
+
 static void read_command(struct config_parser *parser, const uint8_t byte)
 {
 	uint16_t tmp;
@@ -334,7 +360,7 @@ static void read_command(struct config_parser *parser, const uint8_t byte)
 			begin_read_integer(parser);
 			parser->stage = RP_EXPECT_CONTACT_START_TIME;
 		} else if (byte == LIST_END_DELIMITER) {
-			parser->stage = RP_EXPECT_COMMAND_END_MARKER;
+			parser->stage = RP_EXPECT_CONTACTS_NBF_SEPARATOR;
 		} else {
 			parser->basedata->status = PARSER_STATUS_ERROR;
 		}
@@ -426,10 +452,73 @@ static void read_command(struct config_parser *parser, const uint8_t byte)
 		if (byte == LIST_ELEMENT_SEPARATOR)
 			parser->stage = RP_EXPECT_CONTACT_START_DELIMITER;
 		else if (byte == LIST_END_DELIMITER)
-			parser->stage = RP_EXPECT_COMMAND_END_MARKER;
+			parser->stage = RP_EXPECT_CONTACTS_NBF_SEPARATOR;
 		else
 			parser->basedata->status = PARSER_STATUS_ERROR;
 		break;
+	case RP_EXPECT_CONTACTS_NBF_SEPARATOR:
+		if (byte == CONTACTS_NBF_SEPARATOR)
+			parser->stage = RP_EXPECT_NBF_START_DELIMITER;
+		else if (byte == COMMAND_END_MARKER)
+			parser->basedata->status = PARSER_STATUS_DONE;
+		else
+			parser->basedata->status = PARSER_STATUS_ERROR;
+		break;
+	case RP_EXPECT_NBF_START_DELIMITER:
+		if (byte == OBJECT_START_DELIMITER) {
+			begin_read_integer(parser);
+			parser->stage = RP_EXPECT_NBF_BIT_COUNT;
+		} else if (byte == COMMAND_END_MARKER) {
+			parser->basedata->status = PARSER_STATUS_DONE;
+		} else {
+			parser->basedata->status = PARSER_STATUS_ERROR;
+		}
+		break;
+	case RP_EXPECT_NBF_BIT_COUNT:
+		if (byte == OBJECT_ELEMENT_SEPARATOR) {
+			end_read_uint32(parser, &parser->nbf_bit_count);
+			if (parser->nbf_bit_count == 0 ||
+				parser->nbf_bit_count > ROUTER_NBF_MAX_BIT_COUNT
+			) {
+				parser->basedata->status = PARSER_STATUS_ERROR;
+				break;
+			}
+			begin_read_integer(parser);
+			parser->stage = RP_EXPECT_NBF_HASH_COUNT;
+		} else if (!read_integer(parser, byte)) {
+			parser->basedata->status = PARSER_STATUS_ERROR;
+		}
+		break;
+	case RP_EXPECT_NBF_HASH_COUNT:
+		if (byte == OBJECT_ELEMENT_SEPARATOR) {
+			end_read_uint16(parser, &tmp);
+			if (tmp == 0 || tmp > ROUTER_NBF_MAX_HASH_COUNT) {
+				parser->basedata->status = PARSER_STATUS_ERROR;
+				break;
+			}
+			cur_gs->nbf = nbf_create(parser->nbf_bit_count, tmp);
+			if (cur_gs->nbf == NULL) {
+				parser->basedata->status = PARSER_STATUS_ERROR;
+				break;
+			}
+			parser->current_index = 0;
+			parser->stage = RP_EXPECT_NBF_DATA;
+		} else if (!read_integer(parser, byte)) {
+			parser->basedata->status = PARSER_STATUS_ERROR;
+		}
+		break;
+	case RP_EXPECT_NBF_DATA:
+		if (byte == OBJECT_END_DELIMITER) {
+			/* The filter has to be transmitted completely */
+			if ((uint32_t)parser->current_index
+				!= 2 * NBF_BYTE_COUNT(cur_gs->nbf->bit_count))
+				parser->basedata->status = PARSER_STATUS_ERROR;
+			else
+				parser->stage = RP_EXPECT_COMMAND_END_MARKER;
+		} else if (!read_nbf_data(parser, byte)) {
+			parser->basedata->status = PARSER_STATUS_ERROR;
+		}
+		break;
 	case RP_EXPECT_COMMAND_END_MARKER:
 		if (byte == COMMAND_END_MARKER)
 			parser->basedata->status = PARSER_STATUS_DONE;
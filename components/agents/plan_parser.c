@@ -0,0 +1,247 @@
+#include "agents/plan_parser.h"
+
+#include "platform/hal_time.h"
+
+#include "upcn/config.h"
+#include "upcn/nbf.h"
+#include "upcn/node.h"
+#include "upcn/router_task.h"
+
+#include "cbor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Binary commands are numbered like their ASCII counterparts */
+#define PLAN_COMMAND_OFFSET (ROUTER_COMMAND_ADD - 1)
+#define PLAN_INITIAL_COMMAND_CAPACITY 16
+
+bool plan_parser_is_plan(const uint8_t *buffer, size_t length)
+{
+	/* Text commands start with an ASCII digit, plans with a CBOR array */
+	return length != 0 && (buffer[0] & 0xE0) == CborArrayType;
+}
+
+static bool read_uint(CborValue *it, uint64_t *out)
+{
+	return cbor_value_is_unsigned_integer(it) &&
+		cbor_value_get_uint64(it, out) == CborNoError &&
+		cbor_value_advance_fixed(it) == CborNoError;
+}
+
+static char *read_text(CborValue *it)
+{
+	char *text;
+	size_t length;
+
+	if (!cbor_value_is_text_string(it) ||
+			cbor_value_dup_text_string(it, &text, &length, it)
+				!= CborNoError)
+		return NULL;
+	/* Embedded null characters would truncate the EID */
+	if (strlen(text) != length) {
+		free(text);
+		return NULL;
+	}
+	return text;
+}
+
+static bool read_eid_list(CborValue *it, struct endpoint_list **list)
+{
+	struct endpoint_list *entry;
+	CborValue eid;
+
+	if (!cbor_value_is_array(it) ||
+			cbor_value_enter_container(it, &eid) != CborNoError)
+		return false;
+	while (!cbor_value_at_end(&eid)) {
+		entry = malloc(sizeof(struct endpoint_list));
+		if (entry == NULL)
+			return false;
+		entry->eid = read_text(&eid);
+		if (entry->eid == NULL || entry->eid[0] == '\0') {
+			free(entry->eid);
+			free(entry);
+			return false;
+		}
+		/* The order does not matter as the list is sorted later */
+		entry->next = *list;
+		*list = entry;
+	}
+	return cbor_value_leave_container(it, &eid) == CborNoError;
+}
+
+static bool read_contact(CborValue *it, struct node *node)
+{
+	struct contact_list *entry;
+	struct contact *contact;
+	CborValue field;
+	uint64_t bitrate;
+
+	if (!cbor_value_is_array(it) ||
+			cbor_value_enter_container(it, &field) != CborNoError)
+		return false;
+	entry = malloc(sizeof(struct contact_list));
+	if (entry == NULL)
+		return false;
+	contact = contact_create(node);
+	if (contact == NULL) {
+		free(entry);
+		return false;
+	}
+	entry->data = contact;
+	entry->next = node->contacts;
+	node->contacts = entry;
+	if (!read_uint(&field, &contact->from) ||
+			!read_uint(&field, &contact->to) ||
+			!read_uint(&field, &bitrate) || bitrate > UINT32_MAX ||
+			!read_eid_list(&field, &contact->contact_endpoints) ||
+			!cbor_value_at_end(&field))
+		return false;
+	contact->bitrate = (uint32_t)bitrate;
+	if (contact->to <= contact->from ||
+			contact->to <= hal_time_get_timestamp_s())
+		return false;
+	return cbor_value_leave_container(it, &field) == CborNoError;
+}
+
+static bool read_nbf(CborValue *it, struct node *node)
+{
+	CborValue field;
+	uint64_t bit_count, hash_count;
+	size_t length;
+
+	if (!cbor_value_is_array(it) ||
+			cbor_value_enter_container(it, &field) != CborNoError)
+		return false;
+	if (!read_uint(&field, &bit_count) || bit_count == 0 ||
+			bit_count > ROUTER_NBF_MAX_BIT_COUNT ||
+			!read_uint(&field, &hash_count) || hash_count == 0 ||
+			hash_count > ROUTER_NBF_MAX_HASH_COUNT ||
+			!cbor_value_is_byte_string(&field) ||
+			cbor_value_get_string_length(&field, &length)
+				!= CborNoError ||
+			length != NBF_BYTE_COUNT(bit_count))
+		return false;
+	node->nbf = nbf_create((uint32_t)bit_count, (uint8_t)hash_count);
+	if (node->nbf == NULL ||
+			cbor_value_copy_byte_string(&field, node->nbf->bits,
+						    &length, &field)
+				!= CborNoError ||
+			!cbor_value_at_end(&field))
+		return false;
+	return cbor_value_leave_container(it, &field) == CborNoError;
+}
+
+static bool read_node(CborValue *it, struct router_command *command)
+{
+	struct node *node;
+	CborValue field, contact;
+	uint64_t type, reliability;
+
+	if (!cbor_value_is_array(it) ||
+			cbor_value_enter_container(it, &field) != CborNoError ||
+			!read_uint(&field, &type) ||
+			type < ROUTER_COMMAND_ADD - PLAN_COMMAND_OFFSET ||
+			type > ROUTER_COMMAND_DELETE - PLAN_COMMAND_OFFSET)
+		return false;
+	node = node_create(NULL);
+	if (node == NULL)
+		return false;
+	command->type = (enum router_command_type)(type + PLAN_COMMAND_OFFSET);
+	command->data = node;
+	node->eid = read_text(&field);
+	if (node->eid == NULL || node->eid[0] == '\0' ||
+			!read_uint(&field, &reliability))
+		return false;
+	if (reliability != 0) {
+		if (reliability < 100 || reliability > 1000)
+			return false;
+		node->reliability = (float)reliability / 1000.0f;
+	}
+	node->cla_addr = read_text(&field);
+	if (node->cla_addr == NULL ||
+			!read_eid_list(&field, &node->endpoints) ||
+			!cbor_value_is_array(&field) ||
+			cbor_value_enter_container(&field, &contact)
+				!= CborNoError)
+		return false;
+	while (!cbor_value_at_end(&contact)) {
+		if (!read_contact(&contact, node))
+			return false;
+	}
+	if (cbor_value_leave_container(&field, &contact) != CborNoError)
+		return false;
+	/* The NBF is optional */
+	if (!cbor_value_at_end(&field) && !read_nbf(&field, node))
+		return false;
+	return cbor_value_at_end(&field) &&
+		cbor_value_leave_container(it, &field) == CborNoError;
+}
+
+static bool add_command(struct router_plan *plan, uint32_t *capacity)
+{
+	struct router_command *new_commands;
+	uint32_t new_capacity;
+
+	if (plan->command_count == *capacity) {
+		new_capacity = *capacity ? *capacity * 2
+			: PLAN_INITIAL_COMMAND_CAPACITY;
+		new_commands = realloc(
+			plan->commands,
+			new_capacity * sizeof(struct router_command)
+		);
+		if (new_commands == NULL)
+			return false;
+		plan->commands = new_commands;
+		*capacity = new_capacity;
+	}
+	plan->commands[plan->command_count++] = (struct router_command){
+		.type = ROUTER_COMMAND_UNDEFINED,
+		.data = NULL,
+	};
+	return true;
+}
+
+struct router_plan *plan_parser_parse(const uint8_t *buffer, size_t length)
+{
+	struct router_plan *plan;
+	CborParser parser;
+	CborValue it, field, node;
+	uint64_t flags;
+	uint32_t capacity = 0;
+
+	plan = malloc(sizeof(struct router_plan));
+	if (plan == NULL)
+		return NULL;
+	plan->full = false;
+	plan->commands = NULL;
+	plan->command_count = 0;
+	if (cbor_parser_init(buffer, length, 0, &parser, &it) != CborNoError ||
+			!cbor_value_is_array(&it) ||
+			cbor_value_enter_container(&it, &field) != CborNoError ||
+			!read_uint(&field, &flags) ||
+			!cbor_value_is_array(&field) ||
+			cbor_value_enter_container(&field, &node) != CborNoError)
+		goto fail;
+	plan->full = (flags & PLAN_FLAG_FULL) != 0;
+	while (!cbor_value_at_end(&node)) {
+		if (!add_command(plan, &capacity) ||
+				!read_node(&node, &plan->commands[
+					plan->command_count - 1]))
+			goto fail;
+	}
+	if (cbor_value_leave_container(&field, &node) != CborNoError ||
+			!cbor_value_at_end(&field) ||
+			cbor_value_leave_container(&it, &field) != CborNoError ||
+			cbor_value_get_next_byte(&it) != buffer + length)
+		goto fail;
+	return plan;
+
+fail:
+	router_plan_free(plan);
+	return NULL;
+}
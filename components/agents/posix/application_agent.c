@@ -286,7 +286,8 @@ static int16_t process_aap_message(
 		if (msg.eid == NULL || msg.eid_length == 0) {
 			// zero-length EID, only de-registering
 			response.type = AAP_MESSAGE_ACK;
-		} else if (agent_register(msg.eid, &agent_msg_recv, config)) {
+		} else if (agent_register_chunked(msg.eid, &agent_msg_recv,
+						  config)) {
 			response.type = AAP_MESSAGE_NACK;
 		} else {
 			config->registered_agent_id = msg.eid;
@@ -408,13 +409,22 @@ static int send_bundle(const int socket_fd, struct bundle_adu data)
 		.type = AAP_MESSAGE_RECVBUNDLE,
 		.eid = data.source,
 		.eid_length = strlen(data.source),
-		.payload = data.payload,
+		.payload = NULL,
 		.payload_length = data.length,
 	};
-	const int send_result = send_message(socket_fd, &bundle_msg);
+	struct write_socket_param wsp = {
+		.socket_fd = socket_fd,
+		.errno_ = 0,
+	};
+
+	// Send the (possibly chunked) payload without copying it
+	aap_serialize_header(&bundle_msg, write_to_socket, &wsp);
+	bundle_adu_iterate(&data, write_to_socket, &wsp);
+	if (wsp.errno_)
+		LOGF("send(): %s", strerror(wsp.errno_));
 
 	bundle_adu_free_members(data);
-	return send_result;
+	return -wsp.errno_;
 }
 
 static void application_agent_comm_task(void *const param)
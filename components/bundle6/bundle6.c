@@ -10,6 +10,30 @@
 #include <string.h>
 
 
+/* Only RFC 5050 flags are serialized */
+static const uint32_t BUNDLE_V6_FLAG_MASK = BUNDLE_FLAG_IS_FRAGMENT
+	| BUNDLE_FLAG_ADMINISTRATIVE_RECORD
+	| BUNDLE_FLAG_MUST_NOT_BE_FRAGMENTED
+	| BUNDLE_V6_FLAG_CUSTODY_TRANSFER_REQUESTED
+	| BUNDLE_V6_FLAG_SINGLETON_ENDPOINT
+	| BUNDLE_FLAG_ACKNOWLEDGEMENT_REQUESTED
+	| BUNDLE_V6_FLAG_NORMAL_PRIORITY
+	| BUNDLE_V6_FLAG_EXPEDITED_PRIORITY
+	| BUNDLE_FLAG_REPORT_RECEPTION
+	| BUNDLE_V6_FLAG_REPORT_CUSTODY_ACCEPTANCE
+	| BUNDLE_FLAG_REPORT_FORWARDING
+	| BUNDLE_FLAG_REPORT_DELIVERY
+	| BUNDLE_FLAG_REPORT_DELETION;
+
+/*
+ * Upper bound for the primary block without the dictionary: version,
+ * flags and length, eight EID offsets, timestamp, sequence number and
+ * lifetime, dictionary length and the two fragment fields.
+ */
+#define PRIMARY_BLOCK_MAX_FIXED_SIZE \
+	(1 + 2 * 5 + 8 * 3 + 3 * MAX_SDNV_SIZE + 3 + 2 * 5)
+
+
 static size_t write_scheme(char *dst, const char *eid)
 {
 	if (eid == NULL) {
@@ -194,6 +218,8 @@ struct bundle6_dict_descriptor *bundle6_calculate_dict(struct bundle *bundle)
 		sizeof(struct bundle6_eid_info) * eid_reference_count
 	);
 
+	if (result == NULL)
+		return NULL;
 	result->eid_reference_count = eid_reference_count;
 	result->dict_length_bytes = 0;
 	result->destination_eid_info = calculate_eid_info(
@@ -214,7 +240,9 @@ struct bundle6_dict_descriptor *bundle6_calculate_dict(struct bundle *bundle)
 
 	cur_block = bundle->blocks;
 	while (cur_block) {
-		cur_eid = cur_block->data->eid_refs;
+		cur_eid = HAS_FLAG(cur_block->data->flags,
+				   BUNDLE_V6_BLOCK_FLAG_HAS_EID_REF_FIELD)
+			? cur_block->data->eid_refs : NULL;
 		while (cur_eid) {
 			result->eid_references[i++] = calculate_eid_info(
 				cur_eid->eid, &result->dict_length_bytes
@@ -232,6 +260,8 @@ struct bundle6_dict_descriptor *bundle6_recalculate_header_length_internal(
 {
 	struct bundle6_dict_descriptor *ddesc = bundle6_calculate_dict(bundle);
 
+	if (ddesc == NULL)
+		return NULL;
 	bundle->primary_block_length
 		= 1
 		+ sdnv_get_size_u32(bundle->proc_flags)
@@ -273,20 +303,100 @@ struct bundle6_dict_descriptor *bundle6_recalculate_header_length_internal(
 	return ddesc;
 }
 
+static uint8_t *write_eid_offsets(uint8_t *cur,
+	const struct bundle6_eid_info *info)
+{
+	cur += sdnv_write_u16(cur, info->dict_scheme_offset);
+	return cur + sdnv_write_u16(cur, info->dict_ssp_offset);
+}
+
+static struct bundle6_header_cache *build_header_cache(struct bundle *bundle)
+{
+	struct bundle6_dict_descriptor *ddesc =
+		bundle6_recalculate_header_length_internal(bundle);
+	struct bundle6_header_cache *cache;
+	uint8_t *cur;
+	size_t i;
+
+	if (ddesc == NULL)
+		return NULL;
+	cache = malloc(
+		sizeof(struct bundle6_header_cache)
+		+ sizeof(struct bundle6_eid_reference)
+			* ddesc->eid_reference_count
+		+ PRIMARY_BLOCK_MAX_FIXED_SIZE
+		+ ddesc->dict_length_bytes
+	);
+	if (cache == NULL) {
+		free(ddesc);
+		return NULL;
+	}
+
+	cache->eid_reference_count = ddesc->eid_reference_count;
+	for (i = 0; i < ddesc->eid_reference_count; i++) {
+		cache->eid_references[i].scheme_offset =
+			ddesc->eid_references[i].dict_scheme_offset;
+		cache->eid_references[i].ssp_offset =
+			ddesc->eid_references[i].dict_ssp_offset;
+	}
+
+	// The primary block is stored behind the EID references
+	cache->primary_block = (uint8_t *)&cache->eid_references[
+		cache->eid_reference_count];
+	cur = cache->primary_block;
+	*cur++ = bundle->protocol_version;
+	cur += sdnv_write_u32(cur, bundle->proc_flags & BUNDLE_V6_FLAG_MASK);
+	cur += sdnv_write_u32(cur, bundle->primary_block_length);
+	cur = write_eid_offsets(cur, &ddesc->destination_eid_info);
+	cur = write_eid_offsets(cur, &ddesc->source_eid_info);
+	cur = write_eid_offsets(cur, &ddesc->report_to_eid_info);
+	cur = write_eid_offsets(cur, &ddesc->custodian_eid_info);
+	cur += sdnv_write_u64(cur, bundle->creation_timestamp);
+	cur += sdnv_write_u64(cur, bundle->sequence_number);
+	cur += sdnv_write_u64(cur, bundle->lifetime / 1000000); // us -> s
+	cur += sdnv_write_u16(cur, ddesc->dict_length_bytes);
+	bundle6_serialize_dictionary((char *)cur, ddesc);
+	cur += ddesc->dict_length_bytes;
+	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_IS_FRAGMENT)) {
+		cur += sdnv_write_u32(cur, bundle->fragment_offset);
+		cur += sdnv_write_u32(cur, bundle->total_adu_length);
+	}
+	cache->primary_block_size = cur - cache->primary_block;
+
+	free(ddesc);
+	return cache;
+}
+
 void bundle6_recalculate_header_length(struct bundle *bundle)
 {
+	// Rebuilt on next use, bundles are often completed after creation
+	free(bundle->v6_header_cache);
+	bundle->v6_header_cache = NULL;
 	free(bundle6_recalculate_header_length_internal(bundle));
 }
 
+const struct bundle6_header_cache *bundle6_get_header_cache(
+	struct bundle *bundle)
+{
+	if (bundle->v6_header_cache == NULL)
+		bundle->v6_header_cache = build_header_cache(bundle);
+	return bundle->v6_header_cache;
+}
+
 static size_t get_serialized_size(struct bundle *bundle, bool exclude_payload,
 				  bool first_fragment, bool last_fragment)
 {
-	struct bundle6_dict_descriptor *ddesc =
-		bundle6_recalculate_header_length_internal(bundle);
-	size_t result = bundle->primary_block_length;
+	const struct bundle6_header_cache *cache =
+		bundle6_get_header_cache(bundle);
 	const struct bundle_block_list *cur = bundle->blocks;
 	bool payload_reached = false;
-	int eid_ref_offset = 0;
+	size_t eid_ref_offset = 0;
+	size_t result;
+
+	if (cache == NULL)
+		return 0;
+	// The fragment fields are part of the cached primary block
+	result = cache->primary_block_size;
 
 	while (cur != NULL) {
 		const struct bundle_block *block = cur->data;
@@ -313,14 +423,14 @@ static size_t get_serialized_size(struct bundle *bundle, bool exclude_payload,
 			const struct endpoint_list *cur_eid_ref =
 				block->eid_refs;
 			while (cur_eid_ref) {
-				const struct bundle6_eid_info eid_info =
-					ddesc->eid_references[eid_ref_offset];
+				const struct bundle6_eid_reference eid_ref =
+					cache->eid_references[eid_ref_offset];
 
 				eid_ref_size += sdnv_get_size_u16(
-					eid_info.dict_scheme_offset
+					eid_ref.scheme_offset
 				);
 				eid_ref_size += sdnv_get_size_u16(
-					eid_info.dict_ssp_offset
+					eid_ref.ssp_offset
 				);
 
 				eid_ref_offset++;
@@ -347,14 +457,6 @@ static size_t get_serialized_size(struct bundle *bundle, bool exclude_payload,
 		cur = cur->next;
 	}
 
-	// If fragment, add sizes of the additional headers
-	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_IS_FRAGMENT) &&
-			bundle->payload_block != NULL) {
-		result += sdnv_get_size_u32(bundle->total_adu_length);
-		result += sdnv_get_size_u32(bundle->fragment_offset);
-	}
-
-	free(ddesc);
 	return result;
 }
 
@@ -0,0 +1,88 @@
+#include "bundle6/cteb.h"
+#include "bundle6/sdnv.h"
+
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct bundle_block *find_cteb(const struct bundle *bundle)
+{
+	struct bundle_block_list *cur;
+
+	for (cur = bundle->blocks; cur != NULL; cur = cur->next) {
+		if (cur->data->type == BUNDLE_V6_BLOCK_TYPE_CTEB)
+			return cur->data;
+	}
+	return NULL;
+}
+
+bool bundle6_cteb_get_custody_id(const struct bundle *bundle,
+				 uint64_t *custody_id)
+{
+	const struct bundle_block *block;
+	struct sdnv_state state;
+	size_t custodian_length;
+	uint32_t i = 0;
+
+	if (bundle->protocol_version != 6 || !bundle->current_custodian)
+		return false;
+	block = find_cteb(bundle);
+	if (!block)
+		return false;
+
+	sdnv_reset(&state);
+	while (i < block->length && state.status == SDNV_IN_PROGRESS)
+		sdnv_read_u64(&state, custody_id, block->data[i++]);
+	if (state.status != SDNV_DONE)
+		return false;
+
+	// The CTEB is only valid if it was added by the current custodian
+	custodian_length = strlen(bundle->current_custodian);
+	return (
+		block->length - i == custodian_length &&
+		memcmp(&block->data[i], bundle->current_custodian,
+		       custodian_length) == 0
+	);
+}
+
+enum upcn_result bundle6_cteb_set(struct bundle *bundle, uint64_t custody_id,
+				  const char *custodian)
+{
+	const size_t custodian_length = strlen(custodian);
+	struct bundle_block *block = find_cteb(bundle);
+	struct bundle_block_list *entry;
+	uint8_t *data;
+	int_fast8_t id_length;
+
+	data = malloc(MAX_SDNV_SIZE + custodian_length);
+	if (!data)
+		return UPCN_FAIL;
+	id_length = sdnv_write_u64(data, custody_id);
+	memcpy(&data[id_length], custodian, custodian_length);
+
+	if (!block) {
+		block = bundle_block_create(BUNDLE_V6_BLOCK_TYPE_CTEB);
+		entry = bundle_block_entry_create(block);
+		if (!entry) {
+			bundle_block_free(block);
+			free(data);
+			return UPCN_FAIL;
+		}
+		// Every fragment has to contain the CTEB
+		block->flags = BUNDLE_BLOCK_FLAG_MUST_BE_REPLICATED;
+		// Insert as first block, the last block does not change
+		entry->next = bundle->blocks;
+		bundle->blocks = entry;
+	}
+
+	free(block->data);
+	block->data = data;
+	block->length = id_length + custodian_length;
+	return UPCN_OK;
+}
@@ -35,6 +35,7 @@ enum upcn_result bundle6_parser_reset(struct bundle6_parser *state)
 
 	state->basedata->status = PARSER_STATUS_GOOD;
 	state->basedata->flags = PARSER_FLAG_NONE;
+	state->basedata->next_crc = NULL;
 	state->error = PARSER_ERROR_NONE;
 
 	state->current_stage = PARSER_STAGE_VERSION;
@@ -150,6 +151,37 @@ fail:
 	return NULL;
 }
 
+/* Allocates the primary block EIDs from the completely read dictionary */
+static bool bundle6_parser_read_eids(struct bundle6_parser *state)
+{
+	// source
+	state->bundle->source = bundle6_read_eid(
+		state->dict, state->dict_length,
+		state->source_eidref
+	);
+	// destination
+	state->bundle->destination = bundle6_read_eid(
+		state->dict, state->dict_length,
+		state->destination_eidref
+	);
+	// report-to
+	state->bundle->report_to = bundle6_read_eid(
+		state->dict, state->dict_length,
+		state->report_to_eidref
+	);
+	// custodian
+	state->bundle->current_custodian = bundle6_read_eid(
+		state->dict, state->dict_length,
+		state->custodian_eidref
+	);
+	return (
+		state->bundle->source != NULL &&
+		state->bundle->destination != NULL &&
+		state->bundle->report_to != NULL &&
+		state->bundle->current_custodian != NULL
+	);
+}
+
 static bool bundle_is_valid(struct bundle *const bundle)
 {
 	return bundle->payload_block != NULL;
@@ -433,33 +465,7 @@ static void bundle6_parser_read_byte(struct bundle6_parser *state,
 		if (bundle6_parser_data_done(state)) {
 			((uint8_t *)state->dict)[state->current_index++] = 0;
 
-			// Allocate EID references
-			//
-			// source
-			state->bundle->source = bundle6_read_eid(
-				state->dict, state->dict_length,
-				state->source_eidref
-			);
-			// destination
-			state->bundle->destination = bundle6_read_eid(
-				state->dict, state->dict_length,
-				state->destination_eidref
-			);
-			// report-to
-			state->bundle->report_to = bundle6_read_eid(
-				state->dict, state->dict_length,
-				state->report_to_eidref
-			);
-			// custodian
-			state->bundle->current_custodian = bundle6_read_eid(
-				state->dict, state->dict_length,
-				state->custodian_eidref
-			);
-			if (state->bundle->source == NULL ||
-					state->bundle->destination == NULL ||
-					state->bundle->report_to == NULL ||
-					state->bundle->current_custodian == NULL
-			) {
+			if (!bundle6_parser_read_eids(state)) {
 				state->basedata->status = PARSER_STATUS_ERROR;
 				break;
 			}
@@ -592,6 +598,188 @@ static void bundle6_parser_read_byte(struct bundle6_parser *state,
 		bundle6_parser_next(state);
 }
 
+/*
+ * Bulk parsing
+ *
+ * Primary blocks and block headers that are completely contained in the
+ * input buffer are decoded in one go using word-wise SDNV decoding. The
+ * byte-wise state machine above is only used for data split across input
+ * buffers, blocks with EID references and for reporting malformed SDNVs.
+ */
+
+struct bundle6_bulk_range {
+	const uint8_t *pos;
+	const uint8_t *end;
+};
+
+static inline void bundle6_parser_transition(
+	struct bundle6_parser *state, enum bundle6_parser_stage stage)
+{
+	state->next_stage = stage;
+	bundle6_parser_next(state);
+}
+
+/* Advances over a decoded SDNV or puts the parser into the error state */
+static bool bundle6_bulk_advance(struct bundle6_parser *state,
+	struct bundle6_bulk_range *range, int_fast8_t size)
+{
+	if (size > 0) {
+		range->pos += size;
+		return true;
+	}
+	state->basedata->status = PARSER_STATUS_ERROR;
+	state->error = (size == 0)
+		? PARSER_ERROR_BLOCK_LENGTH_EXHAUSTED
+		: PARSER_ERROR_SDNV_FAILURE;
+	return false;
+}
+
+#define bundle6_bulk_sdnv(state, range, bits, value) \
+	bundle6_bulk_advance(state, range, sdnv_decode_u##bits( \
+		(range)->pos, (range)->end - (range)->pos, value))
+
+static size_t bundle6_parser_read_primary_block(
+	struct bundle6_parser *state, const uint8_t *buffer, size_t length)
+{
+	struct bundle6_bulk_range range = { buffer + 1, buffer + length };
+	struct bundle *const bundle = state->bundle;
+	uint32_t proc_flags;
+	uint16_t block_length;
+	int_fast8_t size;
+
+	if (length < 3)
+		return 0;
+	size = sdnv_decode_u32(range.pos, range.end - range.pos, &proc_flags);
+	if (size <= 0)
+		return 0;
+	range.pos += size;
+	size = sdnv_decode_u16(range.pos, range.end - range.pos,
+			       &block_length);
+	if (size <= 0)
+		return 0;
+	range.pos += size;
+
+	/* Parse byte-wise if the block is split across input buffers */
+	if ((size_t)(range.end - range.pos) < block_length)
+		return 0;
+	range.end = range.pos + block_length;
+
+	bundle->protocol_version = buffer[0];
+	bundle->proc_flags = proc_flags;
+	bundle->primary_block_length = block_length;
+
+	if (!bundle6_bulk_sdnv(state, &range, 16,
+			&state->destination_eidref.scheme_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->destination_eidref.ssp_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->source_eidref.scheme_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->source_eidref.ssp_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->report_to_eidref.scheme_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->report_to_eidref.ssp_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->custodian_eidref.scheme_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 16,
+			&state->custodian_eidref.ssp_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 64,
+			&bundle->creation_timestamp) ||
+		!bundle6_bulk_sdnv(state, &range, 64,
+			&bundle->sequence_number) ||
+		!bundle6_bulk_sdnv(state, &range, 64, &bundle->lifetime) ||
+		!bundle6_bulk_sdnv(state, &range, 16, &state->dict_length))
+		return range.pos - buffer;
+
+	/* Shares lifetime conversion, quota check and dict allocation */
+	bundle6_parser_transition(state, PARSER_STAGE_DICT_LENGTH);
+	bundle6_parser_transition(state, PARSER_STAGE_DICTIONARY);
+	if (state->basedata->status != PARSER_STATUS_GOOD)
+		return range.pos - buffer;
+
+	if ((size_t)(range.end - range.pos) < state->dict_length) {
+		state->basedata->status = PARSER_STATUS_ERROR;
+		state->error = PARSER_ERROR_BLOCK_LENGTH_EXHAUSTED;
+		return range.pos - buffer;
+	}
+	memcpy(state->dict, range.pos, state->dict_length);
+	range.pos += state->dict_length;
+	state->cur_bytes_remaining = 0;
+
+	if (!bundle6_parser_read_eids(state)) {
+		state->basedata->status = PARSER_STATUS_ERROR;
+		return range.pos - buffer;
+	}
+
+	if (bundle_is_fragmented(bundle) && (
+		!bundle6_bulk_sdnv(state, &range, 32,
+			&bundle->fragment_offset) ||
+		!bundle6_bulk_sdnv(state, &range, 32,
+			&bundle->total_adu_length)))
+		return range.pos - buffer;
+
+	bundle6_parser_transition(state, PARSER_STAGE_BLOCK_TYPE);
+	return range.pos - buffer;
+}
+
+static size_t bundle6_parser_read_block_header(
+	struct bundle6_parser *state, const uint8_t *buffer, size_t length)
+{
+	const uint8_t *pos = buffer + 1;
+	const uint8_t *const end = buffer + length;
+	struct bundle_block *block;
+	uint8_t flags;
+	uint32_t data_length;
+	int_fast8_t size;
+
+	if (length < 3)
+		return 0;
+	size = sdnv_decode_u8(pos, end - pos, &flags);
+	if (size <= 0)
+		return 0;
+	pos += size;
+	/* EID references are rare, leave them to the byte-wise parser */
+	if (HAS_FLAG(flags, BUNDLE_V6_BLOCK_FLAG_HAS_EID_REF_FIELD))
+		return 0;
+	size = sdnv_decode_u32(pos, end - pos, &data_length);
+	if (size <= 0)
+		return 0;
+	pos += size;
+
+	bundle6_parser_begin_block(state, buffer[0]);
+	if (state->basedata->status != PARSER_STATUS_GOOD)
+		return pos - buffer;
+
+	block = (*state->current_block_entry)->data;
+	block->flags = flags;
+	block->length = data_length;
+	state->last_block = HAS_FLAG(flags, BUNDLE_V6_BLOCK_FLAG_LAST_BLOCK);
+
+	/* Requests the bulk read of the block data */
+	bundle6_parser_transition(state, PARSER_STAGE_BLOCK_DATA);
+	return pos - buffer;
+}
+
+/**
+ * Tries to parse the upcoming primary block or block header at once.
+ *
+ * @return The number of consumed bytes, zero if the byte-wise parser has to
+ *         be used.
+ */
+static size_t bundle6_parser_read_bulk(struct bundle6_parser *state,
+	const uint8_t *buffer, size_t length)
+{
+	switch (state->current_stage) {
+	case PARSER_STAGE_VERSION:
+		return bundle6_parser_read_primary_block(state, buffer, length);
+	case PARSER_STAGE_BLOCK_TYPE:
+		return bundle6_parser_read_block_header(state, buffer, length);
+	default:
+		return 0;
+	}
+}
+
 size_t bundle6_parser_read(struct bundle6_parser *parser,
 	const uint8_t *buffer, size_t length)
 {
@@ -607,6 +795,7 @@ size_t bundle6_parser_read(struct bundle6_parser *parser,
 	}
 
 	size_t i = 0;
+	size_t consumed;
 
 	while (i < length && parser->basedata->status == PARSER_STATUS_GOOD) {
 		if (HAS_FLAG(parser->basedata->flags, PARSER_FLAG_BULK_READ)) {
@@ -631,6 +820,12 @@ size_t bundle6_parser_read(struct bundle6_parser *parser,
 
 			i += parser->basedata->next_bytes;
 		} else {
+			consumed = bundle6_parser_read_bulk(parser, buffer + i,
+							    length - i);
+			if (consumed != 0) {
+				i += consumed;
+				continue;
+			}
 			bundle6_parser_read_byte(parser, buffer[i]);
 			i++;
 		}
@@ -65,7 +65,7 @@ static struct bundle *encapsulate_record(
 
 static struct bundle *generate_record(
 		const struct bundle * const bundle, const char *source_eid,
-		const char *dest_eid, const bool is_custody_signal,
+		const char *dest_eid, const bool is_status_report,
 		const uint8_t prefix_1, const uint8_t prefix_2)
 {
 	uint8_t *buffer = (uint8_t *)malloc(ADMINISTRATVE_RECORD_MAX_SIZE);
@@ -80,9 +80,9 @@ static struct bundle *generate_record(
 
 	/* Write record type, flags, prefixes (status flags, reason, ...) */
 	fragment = bundle_is_fragmented(bundle);
-	(*cur++) = (is_custody_signal ? 0x20 : 0x10) | (fragment ? 0x01 : 0x00);
+	(*cur++) = (is_status_report ? 0x10 : 0x20) | (fragment ? 0x01 : 0x00);
 	(*cur++) = prefix_1;
-	if (is_custody_signal)
+	if (is_status_report)
 		(*cur++) = prefix_2;
 	/* Write fragment info if present */
 	if (fragment) {
@@ -153,6 +153,41 @@ struct bundle *bundle6_generate_custody_signal(
 }
 
 
+struct bundle *bundle6_generate_aggregate_custody_signal(
+	const char *custodian, const struct bundle_custody_signal *signal,
+	const struct bundle_acs_fill *fills, const uint32_t fill_count,
+	const char *local_eid, const uint64_t lifetime)
+{
+	uint8_t *buffer, *cur;
+	uint64_t prev_end = 0;
+	uint32_t i;
+	struct bundle *ret;
+
+	buffer = malloc(2 + (size_t)fill_count * 2 * MAX_SDNV_SIZE);
+	if (buffer == NULL)
+		return NULL;
+	cur = buffer;
+	(*cur++) = BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL << 4;
+	(*cur++) = ((uint8_t)(signal->reason) & 0x7F)
+		| ((signal->type == BUNDLE_CS_TYPE_ACCEPTANCE) ? 0x80 : 0x00);
+	/* The start of a fill is relative to the end of the previous one */
+	for (i = 0; i < fill_count; i++) {
+		cur += sdnv_write_u64(cur, fills[i].start - prev_end);
+		cur += sdnv_write_u64(cur, fills[i].length);
+		prev_end = fills[i].start + fills[i].length;
+	}
+	ret = bundle6_create_local(
+		buffer, cur - buffer,
+		local_eid, custodian,
+		hal_time_get_timestamp_s(),
+		lifetime, BUNDLE_FLAG_ADMINISTRATIVE_RECORD);
+	/* NOTE: payload is freed by the create function */
+	if (ret != NULL)
+		ret->ret_constraints = BUNDLE_RET_CONSTRAINT_FLAG_OWN;
+	return ret;
+}
+
+
 // ---------------------------------------
 // Administrative Record Parser (RFC 5050)
 // ---------------------------------------
@@ -195,6 +230,8 @@ static enum upcn_result record_parser_init(struct record_parser *parser)
 	parser->record->bundle_sequence_number = 0;
 	parser->record->bundle_source_eid_length = 0;
 	parser->record->bundle_source_eid = NULL;
+	parser->record->acs_fills = NULL;
+	parser->record->acs_fill_count = 0;
 	return UPCN_OK;
 }
 
@@ -341,13 +378,74 @@ static void record_parser_read_byte(struct record_parser *parser, uint8_t byte)
 			[parser->current_index] = '\0';
 			parser->status = PARSER_STATUS_DONE;
 		}
-		fallthrough;
+		break;
 	default:
 		parser->status = PARSER_STATUS_ERROR;
 		break;
 	}
 }
 
+// Reads a SDNV from the buffer, returns the count of bytes or 0 on error
+static size_t read_sdnv_u64(const uint8_t *const data, const size_t length,
+			    uint64_t *value)
+{
+	struct sdnv_state state;
+	size_t i = 0;
+
+	sdnv_reset(&state);
+	while (i < length && state.status == SDNV_IN_PROGRESS)
+		sdnv_read_u64(&state, value, data[i++]);
+	return (state.status == SDNV_DONE) ? i : 0;
+}
+
+static struct bundle_administrative_record *parse_aggregate_custody_signal(
+	struct record_parser *parser,
+	const uint8_t *const data, const size_t length)
+{
+	struct bundle_administrative_record *const record = parser->record;
+	uint64_t prev_end = 0, delta, fill_length;
+	size_t pos = 2, count;
+
+	record->type = BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL;
+	record->flags = data[0] & 0x0F;
+	record->custody_signal = malloc(sizeof(struct bundle_custody_signal));
+	/* Every fill needs at least two bytes */
+	record->acs_fills = malloc(
+		sizeof(struct bundle_acs_fill) * ((length - 2) / 2 + 1));
+	if (!record->custody_signal || !record->acs_fills)
+		goto fail;
+	record->custody_signal->type = (data[1] >> 7)
+		? BUNDLE_CS_TYPE_ACCEPTANCE
+		: BUNDLE_CS_TYPE_REFUSAL;
+	record->custody_signal->reason = data[1] & 0x7F;
+
+	while (pos < length) {
+		count = read_sdnv_u64(&data[pos], length - pos, &delta);
+		if (!count)
+			goto fail;
+		pos += count;
+		count = read_sdnv_u64(&data[pos], length - pos, &fill_length);
+		if (!count)
+			goto fail;
+		pos += count;
+		/* Fills have to be non-empty and must not wrap around */
+		if (fill_length == 0 || delta > UINT64_MAX - prev_end ||
+				fill_length > UINT64_MAX - prev_end - delta)
+			goto fail;
+		record->acs_fills[record->acs_fill_count++] =
+			(struct bundle_acs_fill){
+				.start = prev_end + delta,
+				.length = fill_length,
+			};
+		prev_end += delta + fill_length;
+	}
+	return record;
+
+fail:
+	free_administrative_record(record);
+	return NULL;
+}
+
 struct bundle_administrative_record *bundle6_parse_administrative_record(
 	const uint8_t *const data, const size_t length)
 {
@@ -358,6 +456,9 @@ struct bundle_administrative_record *bundle6_parse_administrative_record(
 	ASSERT(data != NULL);
 	if (record_parser_init(&parser) != UPCN_OK)
 		return NULL;
+	if (length >= 2 &&
+			(data[0] >> 4) == BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL)
+		return parse_aggregate_custody_signal(&parser, data, length);
 	cur_byte = data;
 	while (parser.status == PARSER_STATUS_GOOD && i < length) {
 		record_parser_read_byte(&parser, *cur_byte);
@@ -1,5 +1,7 @@
 #include "bundle6/sdnv.h"
 
+#include <string.h>
+
 /* 0b01111111 */
 #define SDNV_VALUE_MASK  0x7F
 /* 0b10000000 */
@@ -91,6 +93,107 @@ void sdnv_read_u64(struct sdnv_state *state, uint64_t *value, uint8_t byte)
 	sdnv_read_generic(state, value, byte, sdnv_validate_byte_u64);
 }
 
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+	__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/* Decodes SDNVs of up to eight bytes without branching per byte. */
+static inline int_fast8_t sdnv_decode_word(const uint8_t *buffer,
+	uint64_t *value)
+{
+	uint64_t word, last;
+	int_fast8_t size;
+
+	memcpy(&word, buffer, sizeof(word));
+	/* The first byte without marker bit terminates the SDNV */
+	last = ~word & 0x8080808080808080;
+	if (last == 0)
+		return 0;
+	size = (__builtin_ctzll(last) >> 3) + 1;
+	/* Last SDNV byte to the least significant position, drop the rest */
+	word = __builtin_bswap64(word) >> (64 - 8 * size);
+	/* Pack the 7-bit groups by merging pairs, quads and octets */
+	word &= 0x7F7F7F7F7F7F7F7F;
+	word = (word & 0x007F007F007F007F) |
+		((word & 0x7F007F007F007F00) >> 1);
+	word = (word & 0x00003FFF00003FFF) |
+		((word & 0x3FFF00003FFF0000) >> 2);
+	word = (word & 0x000000000FFFFFFF) |
+		((word & 0x0FFFFFFF00000000) >> 4);
+	*value = word;
+	return size;
+}
+
+#define SDNV_DECODE_WORDWISE
+
+#endif
+
+static int_fast8_t sdnv_decode(const uint8_t *buffer, size_t length,
+	uint64_t *value, int_fast8_t max_size, uint64_t max_value)
+{
+	uint64_t result = 0;
+	int_fast8_t size = 0;
+
+#ifdef SDNV_DECODE_WORDWISE
+	if (length >= sizeof(uint64_t)) {
+		size = sdnv_decode_word(buffer, &result);
+		if (size != 0) {
+			if (size > max_size || result > max_value)
+				return -1;
+			*value = result;
+			return size;
+		}
+	}
+#endif /* SDNV_DECODE_WORDWISE */
+
+	/* Short buffers and SDNVs longer than eight bytes */
+	while ((size_t)size < length) {
+		if (size == max_size || result > (max_value >> 7))
+			return -1;
+		result = (result << 7) | (buffer[size] & SDNV_VALUE_MASK);
+		if (!(buffer[size++] & SDNV_MARKER_MASK)) {
+			if (result > max_value)
+				return -1;
+			*value = result;
+			return size;
+		}
+	}
+	return 0;
+}
+
+#define sdnv_decode_generic(buffer, length, value, max_size, max_value) \
+do { \
+	uint64_t result; \
+	int_fast8_t size = sdnv_decode(buffer, length, &result, \
+		max_size, max_value); \
+	if (size > 0) \
+		*value = result; \
+	return size; \
+} while (0)
+
+int_fast8_t sdnv_decode_u8(const uint8_t *buffer, size_t length,
+	uint8_t *value)
+{
+	sdnv_decode_generic(buffer, length, value, 2, UINT8_MAX);
+}
+
+int_fast8_t sdnv_decode_u16(const uint8_t *buffer, size_t length,
+	uint16_t *value)
+{
+	sdnv_decode_generic(buffer, length, value, 3, UINT16_MAX);
+}
+
+int_fast8_t sdnv_decode_u32(const uint8_t *buffer, size_t length,
+	uint32_t *value)
+{
+	sdnv_decode_generic(buffer, length, value, 5, UINT32_MAX);
+}
+
+int_fast8_t sdnv_decode_u64(const uint8_t *buffer, size_t length,
+	uint64_t *value)
+{
+	sdnv_decode_generic(buffer, length, value, MAX_SDNV_SIZE, UINT64_MAX);
+}
+
 int_fast8_t sdnv_get_size_u8(uint8_t value)
 {
 	if ((value & 0x80) == 0)
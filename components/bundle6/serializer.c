@@ -4,7 +4,6 @@
 
 #include <stddef.h>
 #include <stdint.h>
-#include <stdlib.h>
 
 #define write_bytes(bytes, data) \
 	write(cla_obj, data, bytes)
@@ -12,13 +11,6 @@
 	write_bytes(sdnv_write_u16(buffer, value), buffer)
 #define serialize_u32(buffer, value) \
 	write_bytes(sdnv_write_u32(buffer, value), buffer)
-#define serialize_u64(buffer, value) \
-	write_bytes(sdnv_write_u64(buffer, value), buffer)
-
-struct eid_reference {
-	uint16_t scheme_offset;
-	uint16_t ssp_offset;
-};
 
 enum upcn_result bundle6_serialize(
 	struct bundle *bundle,
@@ -26,70 +18,19 @@ enum upcn_result bundle6_serialize(
 	void *cla_obj)
 {
 	uint8_t buffer[MAX_SDNV_SIZE];
+	const struct bundle6_header_cache *cache =
+		bundle6_get_header_cache(bundle);
 
-	// Serialize dict
-	struct bundle6_dict_descriptor *dict_desc = bundle6_calculate_dict(
-		bundle
-	);
-	char *dict = malloc(dict_desc->dict_length_bytes);
-
-	if (dict == NULL)
+	if (cache == NULL)
 		return UPCN_FAIL;
 
-	bundle6_serialize_dictionary(dict, dict_desc);
-
-	/* Write version field */
-	write_bytes(1, &(bundle->protocol_version));
-	/* Write SDNV values up to dictionary length */
-	serialize_u32(buffer, bundle->proc_flags & (
-		/* Only RFC 5050 flags */
-		BUNDLE_FLAG_IS_FRAGMENT
-		| BUNDLE_FLAG_ADMINISTRATIVE_RECORD
-		| BUNDLE_FLAG_MUST_NOT_BE_FRAGMENTED
-		| BUNDLE_V6_FLAG_CUSTODY_TRANSFER_REQUESTED
-		| BUNDLE_V6_FLAG_SINGLETON_ENDPOINT
-		| BUNDLE_FLAG_ACKNOWLEDGEMENT_REQUESTED
-		| BUNDLE_V6_FLAG_NORMAL_PRIORITY
-		| BUNDLE_V6_FLAG_EXPEDITED_PRIORITY
-		| BUNDLE_FLAG_REPORT_RECEPTION
-		| BUNDLE_V6_FLAG_REPORT_CUSTODY_ACCEPTANCE
-		| BUNDLE_FLAG_REPORT_FORWARDING
-		| BUNDLE_FLAG_REPORT_DELIVERY
-		| BUNDLE_FLAG_REPORT_DELETION
-	));
-	serialize_u32(buffer, bundle->primary_block_length);
-	serialize_u16(buffer,
-		      dict_desc->destination_eid_info.dict_scheme_offset);
-	serialize_u16(buffer,
-		      dict_desc->destination_eid_info.dict_ssp_offset);
-	serialize_u16(buffer,
-		      dict_desc->source_eid_info.dict_scheme_offset);
-	serialize_u16(buffer,
-		      dict_desc->source_eid_info.dict_ssp_offset);
-	serialize_u16(buffer,
-		      dict_desc->report_to_eid_info.dict_scheme_offset);
-	serialize_u16(buffer,
-		      dict_desc->report_to_eid_info.dict_ssp_offset);
-	serialize_u16(buffer,
-		      dict_desc->custodian_eid_info.dict_scheme_offset);
-	serialize_u16(buffer,
-		      dict_desc->custodian_eid_info.dict_ssp_offset);
-	serialize_u64(buffer, bundle->creation_timestamp);
-	serialize_u64(buffer, bundle->sequence_number);
-	serialize_u64(buffer, bundle->lifetime / 1000000); // us -> s
-	serialize_u16(buffer, dict_desc->dict_length_bytes);
-	/* Write dictionary byte array */
-	write_bytes(dict_desc->dict_length_bytes, dict);
-	/* Write remaining SDNV values */
-	if (HAS_FLAG(bundle->proc_flags, BUNDLE_FLAG_IS_FRAGMENT)) {
-		serialize_u32(buffer, bundle->fragment_offset);
-		serialize_u32(buffer, bundle->total_adu_length);
-	}
+	/* Write the cached primary block including the dictionary */
+	write_bytes(cache->primary_block_size, cache->primary_block);
 
 	/* Serialize bundle blocks */
 	struct bundle_block_list *cur_entry = bundle->blocks;
 	struct endpoint_list *cur_ref;
-	int eid_idx = 0;
+	size_t eid_idx = 0;
 
 	while (cur_entry != NULL) {
 		write_bytes(1, &cur_entry->data->type);
@@ -106,12 +47,12 @@ enum upcn_result bundle6_serialize(
 			serialize_u16(buffer, eid_ref_cnt);
 			// Write out the refs
 			for (int c = 0; c < eid_ref_cnt; c++, eid_idx++) {
-				struct bundle6_eid_info eid_info =
-					dict_desc->eid_references[c];
+				struct bundle6_eid_reference eid_ref =
+					cache->eid_references[eid_idx];
 				serialize_u16(buffer,
-					      eid_info.dict_scheme_offset);
+					      eid_ref.scheme_offset);
 				serialize_u16(buffer,
-					      eid_info.dict_ssp_offset);
+					      eid_ref.ssp_offset);
 			}
 		}
 		serialize_u32(buffer, cur_entry->data->length);
@@ -119,8 +60,5 @@ enum upcn_result bundle6_serialize(
 		cur_entry = cur_entry->next;
 	}
 
-	free(dict);
-	free(dict_desc);
-
 	return UPCN_OK;
 }
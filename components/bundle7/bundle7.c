@@ -51,6 +51,11 @@ size_t bundle7_eid_sizeof(const char *eid)
 	if (eid == NULL || strcmp(eid, "dtn:none") == 0)
 		return 3;
 
+	const int cached = bundle7_eid_serialize_cached(eid, NULL, 0);
+
+	if (cached > 0)
+		return cached;
+
 	// dtn:
 	if (eid[0] == 'd') {
 		// length without "dtn:" prefix
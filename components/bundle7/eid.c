@@ -2,6 +2,11 @@
 #include "bundle7/eid.h"
 
 #include "upcn/bundle.h"
+#include "upcn/config.h"
+
+#include "platform/hal_semaphore.h"
+
+#include "util/htab_hash.h"
 
 #include "cbor.h"
 
@@ -409,3 +414,105 @@ int bundle7_eid_serialize(const char *eid, uint8_t *buffer, size_t buffer_size)
 
 	return cbor_encoder_get_buffer_size(&encoder, buffer);
 }
+
+
+// ------------------------------------------
+// Endpoint Identifier (EID) Serializer Cache
+// ------------------------------------------
+
+/*
+ * A bundle node sends the same few EIDs over and over again, so their
+ * encodings are kept in a direct-mapped cache instead of being parsed from
+ * the string representation and re-encoded for every bundle.
+ */
+struct eid_cache_entry {
+	uint32_t hash;
+	size_t length;
+	char *eid;
+	uint8_t cbor[];
+};
+
+static struct eid_cache_entry *eid_cache[BUNDLE7_EID_CACHE_SIZE];
+static Semaphore_t eid_cache_semaphore;
+
+enum upcn_result bundle7_eid_cache_init(void)
+{
+	if (eid_cache_semaphore != NULL)
+		return UPCN_OK;
+	eid_cache_semaphore = hal_semaphore_init_binary();
+	if (eid_cache_semaphore == NULL)
+		return UPCN_FAIL;
+	hal_semaphore_release(eid_cache_semaphore);
+	return UPCN_OK;
+}
+
+static void lock_eid_cache(void)
+{
+	hal_semaphore_take_blocking(eid_cache_semaphore);
+}
+
+static void unlock_eid_cache(void)
+{
+	hal_semaphore_release(eid_cache_semaphore);
+}
+
+static struct eid_cache_entry *eid_cache_entry_create(
+	const char *eid, const size_t eid_length, const uint32_t hash)
+{
+	const size_t max_length = bundle7_eid_get_max_serialized_size(eid);
+	struct eid_cache_entry *entry = malloc(
+		sizeof(struct eid_cache_entry) + max_length + eid_length + 1);
+	int written;
+
+	if (entry == NULL)
+		return NULL;
+	written = bundle7_eid_serialize(eid, entry->cbor, max_length);
+	if (written <= 0) {
+		free(entry);
+		return NULL;
+	}
+	entry->hash = hash;
+	entry->length = (size_t)written;
+	// The EID string is stored behind the (maximum) encoding
+	entry->eid = (char *)&entry->cbor[max_length];
+	memcpy(entry->eid, eid, eid_length + 1);
+	return entry;
+}
+
+int bundle7_eid_serialize_cached(const char *eid, uint8_t *buffer,
+	size_t buffer_size)
+{
+	const size_t eid_length = strlen(eid);
+	const uint32_t hash = hashlittle(eid, eid_length, 0);
+	struct eid_cache_entry **const slot = &eid_cache[
+		hash & (BUNDLE7_EID_CACHE_SIZE - 1)
+	];
+	int result;
+
+	lock_eid_cache();
+	if (*slot == NULL || (*slot)->hash != hash ||
+			strcmp((*slot)->eid, eid) != 0) {
+		struct eid_cache_entry *entry = eid_cache_entry_create(
+			eid, eid_length, hash);
+
+		if (entry == NULL) {
+			unlock_eid_cache();
+			// Invalid EID or out of memory, encode it uncached
+			if (buffer == NULL)
+				return -1;
+			return bundle7_eid_serialize(eid, buffer, buffer_size);
+		}
+		free(*slot);
+		*slot = entry;
+	}
+	result = (int)(*slot)->length;
+	if (buffer != NULL) {
+		// The entry may be replaced as soon as the lock is released
+		if ((*slot)->length > buffer_size)
+			result = 0;
+		else
+			memcpy(buffer, (*slot)->cbor, (*slot)->length);
+	}
+	unlock_eid_cache();
+	return result;
+}
@@ -5,8 +5,10 @@
 
 #include "compilersupport_p.h"  // Private TinyCBOR header, used for endianess
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * Shortcut access to current bundle block
@@ -27,7 +29,8 @@
 static void crc_verify(struct bundle7_parser *state, uint32_t checksum,
 	uint32_t expected)
 {
-	if (checksum != expected)
+	// The data of discarded blocks was skipped and cannot be verified
+	if (checksum != expected && !(state->flags & BUNDLE_V7_PARSER_DISCARD))
 		state->basedata->flags |= PARSER_FLAG_CRC_INVALID;
 }
 
@@ -101,10 +104,11 @@ CborError bundle_end(struct bundle7_parser *state, CborValue *it)
 	bundle = state->bundle;
 	state->bundle = NULL;
 
-	// Call "send" callback if set and all CRCs passed, otherwise discard
-	// parsed bundle silently
+	// Call "send" callback if set, all CRCs passed and the bundle was not
+	// dropped, otherwise discard parsed bundle silently
 	if (state->send_callback == NULL
-		|| state->basedata->flags & PARSER_FLAG_CRC_INVALID)
+		|| state->basedata->flags & PARSER_FLAG_CRC_INVALID
+		|| state->flags & BUNDLE_V7_PARSER_DISCARD)
 		bundle_free(bundle);
 	else
 		state->send_callback(bundle, state->send_param);
@@ -506,9 +510,12 @@ CborError block_crc(struct bundle7_parser *state, CborValue *it)
 		if (len != 2)
 			return CborErrorIllegalType;
 
-		crc_feed_bytes(&state->crc16,
-			BLOCK(state)->data,
-			BLOCK(state)->length);
+		// Block data not fed by the "bulk read" operation
+		if (state->basedata->next_crc != NULL)
+			crc_feed_bytes(&state->crc16,
+				BLOCK(state)->data,
+				BLOCK(state)->length);
+		state->basedata->next_crc = NULL;
 
 		// CRC field is populated with zero
 		state->crc16.feed(&state->crc16, 0x42); // CBOR byte string(2)
@@ -528,9 +535,12 @@ CborError block_crc(struct bundle7_parser *state, CborValue *it)
 		if (len != 4)
 			return CborErrorIllegalType;
 
-		crc_feed_bytes(&state->crc32,
-			BLOCK(state)->data,
-			BLOCK(state)->length);
+		// Block data not fed by the "bulk read" operation
+		if (state->basedata->next_crc != NULL)
+			crc_feed_bytes(&state->crc32,
+				BLOCK(state)->data,
+				BLOCK(state)->length);
+		state->basedata->next_crc = NULL;
 
 		// CRC field is populated with zero
 		state->crc32.feed(&state->crc32, 0x44); // CBOR byte string(4)
@@ -553,6 +563,23 @@ CborError block_crc(struct bundle7_parser *state, CborValue *it)
 }
 
 
+/**
+ * Checks whether the data of the current block should be read. Bundles
+ * exceeding the quota or refused by the admission callback are dropped.
+ */
+static bool block_data_admitted(struct bundle7_parser *state, size_t length)
+{
+	if (state->flags & BUNDLE_V7_PARSER_DISCARD)
+		return false;
+	if (state->bundle_size + length > state->bundle_quota)
+		return false;
+	if (BLOCK(state)->type != BUNDLE_BLOCK_TYPE_PAYLOAD
+		|| state->admit_callback == NULL)
+		return true;
+	return state->admit_callback(state->bundle, length, state->send_param);
+}
+
+
 CborError block_data(struct bundle7_parser *state, CborValue *it)
 {
 	size_t length;
@@ -571,18 +598,34 @@ CborError block_data(struct bundle7_parser *state, CborValue *it)
 
 	BLOCK(state)->length = length;
 
+	// Drop the bundle before allocating memory for the block data
+	if (!block_data_admitted(state, length))
+		state->flags |= BUNDLE_V7_PARSER_DISCARD;
+
 	// Block-specific data
 	// -------------------
 	//
-	BLOCK(state)->data = malloc(length);
-	if (BLOCK(state)->data == NULL)
-		return CborErrorOutOfMemory;
+	if (state->flags & BUNDLE_V7_PARSER_DISCARD) {
+		// "Discard read": The block data is skipped
+		BLOCK(state)->data = NULL;
+	} else {
+		BLOCK(state)->data = malloc(length);
+		if (BLOCK(state)->data == NULL)
+			return CborErrorOutOfMemory;
+		state->bundle_size += length;
+
+		// Let the "bulk read" operation feed the block CRC while
+		// copying
+		if (BLOCK(state)->crc_type == BUNDLE_CRC_TYPE_16)
+			state->basedata->next_crc = &state->crc16;
+		else if (BLOCK(state)->crc_type == BUNDLE_CRC_TYPE_32)
+			state->basedata->next_crc = &state->crc32;
+	}
 
 	// Enable "bulk read" mode
 	state->basedata->next_buffer = BLOCK(state)->data;
 	state->basedata->next_bytes = length;
 	state->basedata->flags |= PARSER_FLAG_BULK_READ;
-	state->bundle_size += length;
 
 	if (BLOCK(state)->crc_type != BUNDLE_CRC_TYPE_NONE)
 		state->next = block_crc;
@@ -652,6 +695,7 @@ struct parser *bundle7_parser_init(struct bundle7_parser *state,
 	state->bundle_quota = BUNDLE7_DEFAULT_BUNDLE_QUOTA;
 	state->send_callback = send_callback;
 	state->send_param = param;
+	state->admit_callback = NULL;
 	state->bundle = NULL;
 	state->next = NULL;  // force reset to do its job
 
@@ -675,6 +719,7 @@ enum upcn_result bundle7_parser_reset(struct bundle7_parser *state)
 
 	state->basedata->status = PARSER_STATUS_GOOD;
 	state->basedata->flags = PARSER_FLAG_NONE;
+	state->basedata->next_crc = NULL;
 
 	state->parse = bundle_start;
 	state->flags = 0;
@@ -766,11 +811,23 @@ size_t bundle7_parser_read(struct bundle7_parser *state,
 				break;
 			}
 
-			memcpy(
-				state->basedata->next_buffer,
-				buffer + parsed,
-				state->basedata->next_bytes
-			);
+			// Without a buffer, the data is skipped ("discard
+			// read").
+			if (state->basedata->next_crc != NULL) {
+				crc_copy_bytes(
+					state->basedata->next_crc,
+					state->basedata->next_buffer,
+					buffer + parsed,
+					state->basedata->next_bytes
+				);
+				state->basedata->next_crc = NULL;
+			} else if (state->basedata->next_buffer != NULL) {
+				memcpy(
+					state->basedata->next_buffer,
+					buffer + parsed,
+					state->basedata->next_bytes
+				);
+			}
 
 			parsed += state->basedata->next_bytes;
 
@@ -832,3 +889,325 @@ size_t bundle7_parser_read(struct bundle7_parser *state,
 
 	return parsed;
 }
+
+
+// ---------------
+// One-shot Parser
+// ---------------
+
+static CborError read_uint(CborValue *it, uint64_t *value)
+{
+	if (!cbor_value_is_unsigned_integer(it))
+		return CborErrorIllegalType;
+
+	cbor_value_get_uint64(it, value);
+	return cbor_value_advance_fixed(it);
+}
+
+
+static CborError read_eid(CborValue *it, char **eid)
+{
+	char *parsed;
+	CborError err = bundle7_eid_parse_cbor(it, &parsed);
+
+	if (err)
+		return err;
+
+	*eid = strdup(parsed);
+	free(parsed);
+	return *eid == NULL ? CborErrorOutOfMemory : CborNoError;
+}
+
+
+/**
+ * Reads the CRC field of a block starting at "start" and checks the CRC over
+ * all block bytes with the CRC value itself populated with zero.
+ */
+static CborError read_crc(CborValue *it, const uint8_t *start,
+	enum bundle_crc_type type, union crc *crc, bool *crc_valid)
+{
+	const uint8_t *const field = cbor_value_get_next_byte(it);
+	const size_t expected = (type == BUNDLE_CRC_TYPE_16) ? 2 : 4;
+	struct crc_stream stream;
+	size_t len = sizeof(crc->bytes);
+	size_t i;
+	CborError err;
+
+	if (!cbor_value_is_byte_string(it))
+		return CborErrorIllegalType;
+
+	crc->checksum = 0;
+	err = cbor_value_copy_byte_string(it, crc->bytes, &len, it);
+	if (err)
+		return err;
+	if (len != expected)
+		return CborErrorIllegalType;
+
+	crc_init(&stream, type == BUNDLE_CRC_TYPE_16 ? CRC16_X25 : CRC32);
+	crc_feed_bytes(&stream, start, field - start);
+
+	// CBOR byte string header followed by the zeroed CRC field
+	stream.feed(&stream, (uint8_t)(0x40 | expected));
+	for (i = 0; i < expected; i++)
+		stream.feed(&stream, 0x00);
+	stream.feed_eof(&stream);
+
+	// Swap from network byte order to native order
+	if (type == BUNDLE_CRC_TYPE_16)
+		crc->checksum = cbor_ntohs(crc->checksum) & 0xffff;
+	else
+		crc->checksum = cbor_ntohl(crc->checksum);
+
+	if (stream.checksum != crc->checksum)
+		*crc_valid = false;
+
+	return CborNoError;
+}
+
+
+static CborError read_primary_block(CborValue *it, struct bundle *bundle,
+	bool *crc_valid)
+{
+	const uint8_t *const start = cbor_value_get_next_byte(it);
+	CborValue field;
+	CborError err;
+	uint64_t value;
+
+	if (!cbor_value_is_array(it) || !cbor_value_is_length_known(it))
+		return CborErrorIllegalType;
+
+	err = cbor_value_enter_container(it, &field);
+	if (err)
+		return err;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	bundle->protocol_version = value;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	bundle->proc_flags = (uint32_t) value & BP_V7_FLAGS;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	if (value > BUNDLE_CRC_TYPE_32)
+		return CborErrorIllegalType;
+	bundle->crc_type = value;
+
+	err = read_eid(&field, &bundle->destination);
+	if (err)
+		return err;
+	err = read_eid(&field, &bundle->source);
+	if (err)
+		return err;
+	err = read_eid(&field, &bundle->report_to);
+	if (err)
+		return err;
+
+	err = bundle7_timestamp_parse(&field,
+		&bundle->creation_timestamp,
+		&bundle->sequence_number);
+	if (err)
+		return err;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	bundle->lifetime = value;
+
+	if (bundle_is_fragmented(bundle)) {
+		err = read_uint(&field, &value);
+		if (err)
+			return err;
+		bundle->fragment_offset = value;
+
+		err = read_uint(&field, &value);
+		if (err)
+			return err;
+		bundle->total_adu_length = value;
+	}
+
+	if (bundle->crc_type != BUNDLE_CRC_TYPE_NONE) {
+		err = read_crc(&field, start, bundle->crc_type,
+			&bundle->crc, crc_valid);
+		if (err)
+			return err;
+	}
+
+	if (!cbor_value_at_end(&field))
+		return CborErrorIllegalType;
+
+	err = cbor_value_leave_container(it, &field);
+	if (err)
+		return err;
+
+	bundle->primary_block_length = cbor_value_get_next_byte(it) - start;
+	return CborNoError;
+}
+
+
+/**
+ * Reads an extension or payload block. The block is returned as soon as it
+ * has been created, even if parsing fails afterwards, so that the caller can
+ * release it together with the bundle. If the admission callback refuses the
+ * payload, parsing stops before its data is copied and "admitted" is cleared.
+ */
+static CborError read_block(CborValue *it, struct bundle_block **block,
+	bool *crc_valid, const struct bundle *bundle,
+	bool (*admit_callback)(const struct bundle *, size_t, void *),
+	void *param, bool *admitted)
+{
+	const uint8_t *const start = cbor_value_get_next_byte(it);
+	CborValue field;
+	CborError err;
+	uint64_t value;
+	size_t length;
+
+	if (!cbor_value_is_array(it))
+		return CborErrorIllegalType;
+
+	err = cbor_value_enter_container(it, &field);
+	if (err)
+		return err;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+
+	*block = bundle_block_create(value);
+	if (*block == NULL)
+		return CborErrorOutOfMemory;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	(*block)->number = value;
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	(*block)->flags = (((uint8_t) value)
+			& (BUNDLE_BLOCK_FLAG_MUST_BE_REPLICATED
+			| BUNDLE_BLOCK_FLAG_DISCARD_IF_UNPROC
+			| BUNDLE_BLOCK_FLAG_REPORT_IF_UNPROC
+			| BUNDLE_BLOCK_FLAG_DELETE_BUNDLE_IF_UNPROC));
+
+	err = read_uint(&field, &value);
+	if (err)
+		return err;
+	if (value > BUNDLE_CRC_TYPE_32)
+		return CborErrorIllegalType;
+	(*block)->crc_type = value;
+
+	// Block-specific data, copied once as blocks own their data
+	if (!cbor_value_is_byte_string(&field))
+		return CborErrorIllegalType;
+
+	err = cbor_value_get_string_length(&field, &length);
+	if (err)
+		return err;
+
+	// Drop the bundle before allocating memory for the payload
+	if ((*block)->type == BUNDLE_BLOCK_TYPE_PAYLOAD
+		&& admit_callback != NULL
+		&& !admit_callback(bundle, length, param)) {
+		*admitted = false;
+		return CborNoError;
+	}
+
+	(*block)->data = malloc(length);
+	if ((*block)->data == NULL)
+		return CborErrorOutOfMemory;
+
+	err = cbor_value_copy_byte_string(&field, (*block)->data, &length,
+		&field);
+	if (err)
+		return err;
+	(*block)->length = length;
+
+	if ((*block)->crc_type != BUNDLE_CRC_TYPE_NONE) {
+		err = read_crc(&field, start, (*block)->crc_type,
+			&(*block)->crc, crc_valid);
+		if (err)
+			return err;
+	}
+
+	if (!cbor_value_at_end(&field))
+		return CborErrorIllegalType;
+
+	return cbor_value_leave_container(it, &field);
+}
+
+
+struct bundle *bundle7_parse_buffer(const uint8_t *buffer, size_t length,
+	size_t bundle_quota,
+	bool (*admit_callback)(const struct bundle *, size_t, void *),
+	void *param)
+{
+	struct bundle *bundle;
+	struct bundle_block *block;
+	struct bundle_block_list **entry;
+	CborParser parser;
+	CborValue it, blocks;
+	CborError err;
+	bool crc_valid = true;
+	bool admitted = true;
+
+	// Bundle is larger than allowed
+	if (length > bundle_quota)
+		return NULL;
+
+	bundle = bundle_init();
+	if (bundle == NULL)
+		return NULL;
+
+	if (cbor_parser_init(buffer, length, 0, &parser, &it) != CborNoError
+		|| !cbor_value_is_array(&it)
+		|| cbor_value_is_length_known(&it)
+		|| cbor_value_enter_container(&it, &blocks) != CborNoError
+		|| read_primary_block(&blocks, bundle, &crc_valid)
+			!= CborNoError)
+		goto fail;
+
+	entry = &bundle->blocks;
+	while (!cbor_value_at_end(&blocks)) {
+		// The payload block has to be the last block
+		if (bundle->payload_block != NULL)
+			goto fail;
+
+		block = NULL;
+		err = read_block(&blocks, &block, &crc_valid, bundle,
+			admit_callback, param, &admitted);
+
+		if (block != NULL) {
+			*entry = bundle_block_entry_create(block);
+			if (*entry == NULL) {
+				bundle_block_free(block);
+				goto fail;
+			}
+			entry = &(*entry)->next;
+		}
+		if (err || !admitted)
+			goto fail;
+
+		if (block->type == BUNDLE_BLOCK_TYPE_PAYLOAD)
+			bundle->payload_block = block;
+	}
+
+	// Discard bundles without payload, with trailing data or with invalid
+	// CRCs like the streaming parser does
+	if (bundle->payload_block == NULL
+		|| cbor_value_leave_container(&it, &blocks) != CborNoError
+		|| cbor_value_get_next_byte(&it) != buffer + length
+		|| !crc_valid)
+		goto fail;
+
+	return bundle;
+
+fail:
+	bundle_free(bundle);
+	return NULL;
+}
@@ -611,6 +611,8 @@ struct bundle_administrative_record *bundle7_parse_administrative_record(
 	record->event_nanoseconds = 0;
 	record->custody_signal = NULL;
 	record->status_report = NULL;
+	record->acs_fills = NULL;
+	record->acs_fill_count = 0;
 
 	struct record_parser state = {
 		.record = record,
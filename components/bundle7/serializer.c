@@ -11,11 +11,17 @@
 #include <string.h>
 #include "platform/hal_io.h"
 
-/* CBOR output buffer size. This buffer will be allocated during the
- * serialization process and released afterwards
+/* CBOR output buffer size. The buffer is located on the stack and collects
+ * small items to pass them to the CLA in larger chunks.
  */
 #define BUFFER_SIZE 128
 
+/* Upper bound for the encoded fixed-size fields written at once: block
+ * header items or the creation timestamp, lifetime and fragment fields
+ * followed by the CRC.
+ */
+#define MAX_FIELDS_SIZE 64
+
 
 static inline size_t primary_block_get_item_count(struct bundle *bundle)
 {
@@ -120,6 +126,70 @@ static uint32_t bundle7_filter_protocol_proc_flags(const struct bundle *bundle)
 	return flags;
 }
 
+struct serializer_output {
+	void (*write)(void *cla_obj, const void *, const size_t);
+	void *cla_obj;
+	size_t length;
+	uint8_t buffer[BUFFER_SIZE];
+};
+
+
+static void output_flush(struct serializer_output *out)
+{
+	if (out->length != 0) {
+		out->write(out->cla_obj, out->buffer, out->length);
+		out->length = 0;
+	}
+}
+
+
+/*
+ * Returns the position behind the buffered data, flushing the buffer
+ * beforehand if less than "size" bytes are available there.
+ */
+static uint8_t *output_reserve(struct serializer_output *out, size_t size)
+{
+	if (out->length + size > BUFFER_SIZE)
+		output_flush(out);
+	return &out->buffer[out->length];
+}
+
+
+static void output_bytes(struct serializer_output *out,
+	const void *data, size_t length)
+{
+	if (length == 0)
+		return;
+	if (out->length + length <= BUFFER_SIZE) {
+		memcpy(&out->buffer[out->length], data, length);
+		out->length += length;
+	} else {
+		// Large data (e.g. payload) is passed through without copying
+		output_flush(out);
+		out->write(out->cla_obj, data, length);
+	}
+}
+
+
+static enum upcn_result output_eid(struct serializer_output *out,
+	const char *eid, enum bundle_crc_type crc_type, struct crc_stream *crc)
+{
+	int written = bundle7_eid_serialize_cached(eid,
+		&out->buffer[out->length], BUFFER_SIZE - out->length);
+
+	if (written == 0 && out->length != 0) {
+		output_flush(out);
+		written = bundle7_eid_serialize_cached(eid,
+			out->buffer, BUFFER_SIZE);
+	}
+	if (written <= 0)
+		return UPCN_FAIL;
+	feed_crc(crc, crc_type, &out->buffer[out->length], written);
+	out->length += written;
+	return UPCN_OK;
+}
+
+
 enum upcn_result bundle7_serialize(struct bundle *bundle,
 	void (*write)(void *cla_obj, const void *, const size_t),
 	void *cla_obj)
@@ -128,63 +198,48 @@ enum upcn_result bundle7_serialize(struct bundle *bundle,
 	if (bundle->protocol_version != 7)
 		return UPCN_FAIL;
 
-	uint8_t *buffer;
+	struct serializer_output out = {
+		.write = write,
+		.cla_obj = cla_obj,
+		.length = 0,
+	};
 	CborEncoder encoder;
 	struct crc_stream crc;
-	int written;
-
-	buffer = malloc(BUFFER_SIZE);
-	if (buffer == NULL)
-		return UPCN_FAIL;
+	uint8_t *start;
 
 	// Bundle start (CBOR indefinite array)
-	buffer[0] = 0x9f;
+	out.buffer[out.length++] = 0x9f;
 
 	// -------------
 	// Primary Block
 	// -------------
 
-	buffer[1] = 0x80 + primary_block_get_item_count(bundle);
-
 	init_crc(&crc, bundle->crc_type);
 
-	cbor_encoder_init(&encoder, buffer + 2, BUFFER_SIZE - 2, 0);
+	start = output_reserve(&out, MAX_FIELDS_SIZE);
+	start[0] = 0x80 + primary_block_get_item_count(bundle);
+	cbor_encoder_init(&encoder, start + 1, MAX_FIELDS_SIZE - 1, 0);
 	cbor_encode_uint(&encoder, bundle->protocol_version);
 	cbor_encode_uint(&encoder,
 		bundle7_filter_protocol_proc_flags(bundle));
 	cbor_encode_uint(&encoder, bundle->crc_type);
-
-	write(cla_obj, buffer, cbor_encoder_get_buffer_size(&encoder, buffer));
-	feed_crc(&crc, bundle->crc_type, buffer + 1,
-		cbor_encoder_get_buffer_size(&encoder, buffer + 1));
-
-	// Destination EID
-	written = bundle7_eid_serialize(bundle->destination,
-		buffer, BUFFER_SIZE);
-	if (written <= 0)
-		return UPCN_FAIL;
-	write(cla_obj, buffer, written);
-	feed_crc(&crc, bundle->crc_type, buffer, written);
-
-	// Source EID
-	written = bundle7_eid_serialize(bundle->source,
-		buffer, BUFFER_SIZE);
-	if (written <= 0)
+	out.length += cbor_encoder_get_buffer_size(&encoder, start);
+	feed_crc(&crc, bundle->crc_type, start,
+		cbor_encoder_get_buffer_size(&encoder, start));
+
+	// Destination, Source and Report-To EIDs
+	if (output_eid(&out, bundle->destination, bundle->crc_type, &crc)
+			!= UPCN_OK ||
+		output_eid(&out, bundle->source, bundle->crc_type, &crc)
+			!= UPCN_OK ||
+		output_eid(&out, bundle->report_to, bundle->crc_type, &crc)
+			!= UPCN_OK)
 		return UPCN_FAIL;
-	write(cla_obj, buffer, written);
-	feed_crc(&crc, bundle->crc_type, buffer, written);
-
-	// Report-To EID
-	written = bundle7_eid_serialize(bundle->report_to,
-		buffer, BUFFER_SIZE);
-	if (written <= 0)
-		return UPCN_FAIL;
-	write(cla_obj, buffer, written);
-	feed_crc(&crc, bundle->crc_type, buffer, written);
 
 	// Creation Timestamp
-	buffer[0] = 0x82;
-	cbor_encoder_init(&encoder, buffer + 1, BUFFER_SIZE - 1, 0);
+	start = output_reserve(&out, MAX_FIELDS_SIZE);
+	start[0] = 0x82;
+	cbor_encoder_init(&encoder, start + 1, MAX_FIELDS_SIZE - 1, 0);
 	cbor_encode_uint(&encoder, bundle->creation_timestamp);
 	cbor_encode_uint(&encoder, bundle->sequence_number);
 	cbor_encode_uint(&encoder, bundle->lifetime);
@@ -196,14 +251,14 @@ enum upcn_result bundle7_serialize(struct bundle *bundle,
 
 	// CRC checksum for primary block
 	if (bundle->crc_type != BUNDLE_CRC_TYPE_NONE) {
-		feed_crc(&crc, bundle->crc_type, buffer,
-			cbor_encoder_get_buffer_size(&encoder, buffer));
+		feed_crc(&crc, bundle->crc_type, start,
+			cbor_encoder_get_buffer_size(&encoder, start));
 
 		// Calculate and encode CRC checksum for primary block.
 		write_crc(&encoder, bundle->crc_type, &crc);
 	}
 
-	write(cla_obj, buffer, cbor_encoder_get_buffer_size(&encoder, buffer));
+	out.length += cbor_encoder_get_buffer_size(&encoder, start);
 
 	// ----------------
 	// Extension Blocks
@@ -216,10 +271,12 @@ enum upcn_result bundle7_serialize(struct bundle *bundle,
 
 		init_crc(&crc, block->crc_type);
 
+		start = output_reserve(&out, MAX_FIELDS_SIZE);
+
 		// CBOR array header with embedded number of items
-		buffer[0] = 0x80 + block_get_item_count(block);
+		start[0] = 0x80 + block_get_item_count(block);
 
-		cbor_encoder_init(&encoder, buffer + 1, BUFFER_SIZE - 1, 0);
+		cbor_encoder_init(&encoder, start + 1, MAX_FIELDS_SIZE - 1, 0);
 		cbor_encode_uint(&encoder, block->type);
 		cbor_encode_uint(&encoder, block->number);
 		cbor_encode_uint(&encoder,
@@ -228,43 +285,40 @@ enum upcn_result bundle7_serialize(struct bundle *bundle,
 		cbor_encode_uint(&encoder, block->crc_type);
 
 		const size_t bytes_before_length = cbor_encoder_get_buffer_size(
-			&encoder, buffer
+			&encoder, start
 		);
 
 		// As the byte string length is represented in the same manner
 		// as a uint in CBOR, we can write it like that and afterwards
 		// change the type code to byte string.
 		cbor_encode_uint(&encoder, block->length);
-		buffer[bytes_before_length] |= 0x40; // uint -> bytestring
+		start[bytes_before_length] |= 0x40; // uint -> bytestring
 
-		write(cla_obj, buffer, cbor_encoder_get_buffer_size(&encoder,
-								    buffer));
-		feed_crc(&crc, block->crc_type, buffer,
-			 cbor_encoder_get_buffer_size(&encoder, buffer));
+		out.length += cbor_encoder_get_buffer_size(&encoder, start);
+		feed_crc(&crc, block->crc_type, start,
+			 cbor_encoder_get_buffer_size(&encoder, start));
 
-		write(cla_obj, block->data, block->length);
+		output_bytes(&out, block->data, block->length);
 		feed_crc(&crc, block->crc_type,
 			 block->data, block->length);
 
 		if (block->crc_type != BUNDLE_CRC_TYPE_NONE) {
-			// Reset CBOR encoder
-			cbor_encoder_init(&encoder, buffer, BUFFER_SIZE, 0);
+			start = output_reserve(&out, MAX_FIELDS_SIZE);
+			cbor_encoder_init(&encoder, start, MAX_FIELDS_SIZE, 0);
 
 			// Calculate and CRC checksum for extension block
 			write_crc(&encoder, block->crc_type, &crc);
-
-			write(cla_obj, buffer,
-			      cbor_encoder_get_buffer_size(&encoder, buffer));
+			out.length += cbor_encoder_get_buffer_size(&encoder,
+								   start);
 		}
 
 		cur_block = cur_block->next;
 	}
 
 	// CBOR "break"
-	buffer[0] = 0xff;
-	write(cla_obj, buffer, 1);
-
-	free(buffer);
+	output_reserve(&out, 1);
+	out.buffer[out.length++] = 0xff;
+	output_flush(&out);
 
 	return UPCN_OK;
 }
@@ -13,34 +13,73 @@
 #include "upcn/bundle_storage_manager.h"
 #include "upcn/common.h"
 #include "upcn/config.h"
+#include "upcn/crc.h"
 #include "upcn/task_tags.h"
 
 #include <signal.h>
 #include <errno.h>
 
 
+void rx_task_flush_bundles(struct rx_task_data *rx_data)
+{
+	struct cla_config *const config = rx_data->cla_config;
+	const uint16_t count = rx_data->batch.count;
+	struct bundle *bundle;
+	uint16_t i, stored = 0;
+
+	if (count == 0)
+		return;
+
+	bundle_storage_add_batch(rx_data->batch.bundles, rx_data->batch.ids,
+				 count);
+	for (i = 0; i < count; i++) {
+		bundle = rx_data->batch.bundles[i];
+		if (rx_data->batch.ids[i] == BUNDLE_INVALID_ID) {
+			LOGF("CLA: Dropping bundle from \"%s\" (OOM?)",
+			     bundle->source);
+			bundle_free(bundle);
+			continue;
+		}
+		LOGF("CLA: Received new bundle #%d from \"%s\" to \"%s\" via CLA %s",
+		     rx_data->batch.ids[i], bundle->source, bundle->destination,
+		     config->vtable->cla_name_get());
+		rx_data->batch.ids[stored++] = rx_data->batch.ids[i];
+	}
+	rx_data->batch.count = 0;
+
+	bundle_processor_inform_batch(
+		config->bundle_agent_interface->bundle_signaling_queue,
+		rx_data->batch.ids,
+		stored
+	);
+}
+
 static void bundle_send(struct bundle *bundle, void *param)
 {
-	struct cla_config *const config = param;
-	bundleid_t new_id;
+	struct rx_task_data *const rx_data = param;
 
 	ASSERT(bundle != NULL);
 
-	new_id = bundle_storage_add(bundle);
-	if (new_id != BUNDLE_INVALID_ID) {
-		LOGF("CLA: Received new bundle #%d from \"%s\" to \"%s\" via CLA %s",
-		     new_id, bundle->source, bundle->destination,
-		     config->vtable->cla_name_get());
-		bundle_processor_inform(
-			config->bundle_agent_interface->bundle_signaling_queue,
-			new_id,
-			BP_SIGNAL_BUNDLE_INCOMING,
-			BUNDLE_SR_REASON_NO_INFO
-		);
-	} else {
-		LOGF("CLA: Dropping bundle from \"%s\" (OOM?)", bundle->source);
-		bundle_free(bundle);
+	if (rx_data->batch.count == CLA_RX_BATCH_SIZE)
+		rx_task_flush_bundles(rx_data);
+	rx_data->batch.bundles[rx_data->batch.count++] = bundle;
+}
+
+/*
+ * Drops duplicates of delivered bundles before their payload is read. This
+ * keeps retransmitted bundles we would discard anyway from occupying memory.
+ */
+static bool bundle_admit(const struct bundle *bundle, size_t payload_length,
+			 void *param)
+{
+	(void)param;
+
+	if (bundle_processor_is_known(bundle, payload_length)) {
+		LOGF("RX: Dropping known bundle from \"%s\" before its payload",
+		     bundle->source);
+		return false;
 	}
+	return true;
 }
 
 enum upcn_result rx_task_data_init(struct rx_task_data *rx_data,
@@ -49,14 +88,17 @@ enum upcn_result rx_task_data_init(struct rx_task_data *rx_data,
 	rx_data->payload_type = PAYLOAD_UNKNOWN;
 	rx_data->timeout_occured = false;
 	rx_data->input_buffer.end = &rx_data->input_buffer.start[0];
+	rx_data->batch.count = 0;
+	rx_data->cla_config = cla_config;
 
 	if (!bundle6_parser_init(&rx_data->bundle6_parser,
-				 &bundle_send, cla_config))
+				 &bundle_send, rx_data))
 		return UPCN_FAIL;
 	if (!bundle7_parser_init(&rx_data->bundle7_parser,
-				 &bundle_send, cla_config))
+				 &bundle_send, rx_data))
 		return UPCN_FAIL;
 	rx_data->bundle7_parser.bundle_quota = BUNDLE_QUOTA;
+	rx_data->bundle7_parser.admit_callback = &bundle_admit;
 
 	return UPCN_OK;
 }
@@ -71,6 +113,7 @@ void rx_task_reset_parsers(struct rx_task_data *rx_data)
 
 void rx_task_data_deinit(struct rx_task_data *rx_data)
 {
+	rx_task_flush_bundles(rx_data);
 	rx_data->payload_type = PAYLOAD_UNKNOWN;
 
 	ASSERT(bundle6_parser_deinit(&rx_data->bundle6_parser) == UPCN_OK);
@@ -106,6 +149,44 @@ size_t select_bundle_parser_version(struct rx_task_data *rx_data,
 	}
 }
 
+size_t rx_task_parse_bundle_frame(struct rx_task_data *rx_data,
+				  const uint8_t *buffer,
+				  size_t length)
+{
+	struct bundle *bundle;
+
+	/* Only CBOR indefinite arrays can be BPv7 bundles */
+	if (length == 0 || buffer[0] != 0x9f)
+		return 0;
+
+	bundle = bundle7_parse_buffer(buffer, length,
+				      rx_data->bundle7_parser.bundle_quota,
+				      rx_data->bundle7_parser.admit_callback,
+				      rx_data->bundle7_parser.send_param);
+	if (bundle == NULL)
+		LOG("RX: Dropping invalid or refused bundle frame.");
+	else
+		bundle_send(bundle, rx_data);
+
+	return length;
+}
+
+/*
+ * Copies bulk read data, feeding the CRC stream requested by the parser (if
+ * any) in the same pass. Without a destination ("discard read"), the data is
+ * skipped.
+ */
+static void bulk_copy(struct crc_stream *crc, uint8_t *dst,
+		      const uint8_t *src, size_t length)
+{
+	if (dst == NULL)
+		return;
+	if (crc != NULL)
+		crc_copy_bytes(crc, dst, src, length);
+	else
+		memcpy(dst, src, length);
+}
+
 /**
  * If a "bulk read" operation is requested, this gets handled by the input
  * processor directly. A preallocated byte buffer and the requested length have
@@ -116,7 +197,8 @@ size_t select_bundle_parser_version(struct rx_task_data *rx_data,
  *
  * Bytes in the current input buffer are considered and copied appropriatly --
  * meaning that non-parsed input bytes are copied into the bulk read buffer and
- * the remaining bytes are read directly from the input stream.
+ * the remaining bytes are read directly from the input stream. If no bulk read
+ * buffer is passed, the bytes are skipped ("discard read").
  * @return Pointer to the position up to the input buffer is consumed after the
  *         operation.
  */
@@ -125,6 +207,10 @@ static uint8_t *bulk_read(struct cla_link *link)
 	struct rx_task_data *const rx_data = &link->rx_task_data;
 	uint8_t *parsed = rx_data->input_buffer.start +
 			  rx_data->cur_parser->next_bytes;
+	struct crc_stream *const crc = rx_data->cur_parser->next_crc;
+
+	/* We feed the CRC, the parser must not do it again. */
+	rx_data->cur_parser->next_crc = NULL;
 
 	/*
 	 * Bulk read operation requested that is smaller than the input buffer.
@@ -141,7 +227,8 @@ static uint8_t *bulk_read(struct cla_link *link)
 	 */
 	if (parsed <= rx_data->input_buffer.end) {
 		/* Fill bulk read buffer from input buffer. */
-		memcpy(
+		bulk_copy(
+			crc,
 			rx_data->cur_parser->next_buffer,
 			rx_data->input_buffer.start,
 			rx_data->cur_parser->next_bytes
@@ -172,23 +259,34 @@ static uint8_t *bulk_read(struct cla_link *link)
 
 		/* Copy the whole input buffer to bulk read buffer. */
 		if (filled)
-			memcpy(
+			bulk_copy(
+				crc,
 				rx_data->cur_parser->next_buffer,
 				rx_data->input_buffer.start,
 				filled
 			);
 
 		size_t to_read = rx_data->cur_parser->next_bytes - filled;
-		uint8_t *pos = rx_data->cur_parser->next_buffer + filled;
+		/*
+		 * On a "discard read", the bytes are read into the (already
+		 * consumed) input buffer and dropped.
+		 */
+		const bool discard = rx_data->cur_parser->next_buffer == NULL;
+		uint8_t *pos = discard
+			? rx_data->input_buffer.start
+			: rx_data->cur_parser->next_buffer + filled;
 		size_t read;
 
 		while (to_read) {
+			const size_t chunk = discard
+				? MIN(to_read, (size_t)CLA_RX_BUFFER_SIZE)
+				: to_read;
 			/* Read the remaining bytes directly from the HAL. */
 			enum upcn_result result =
 				link->config->vtable->cla_read(
 					link,
 					pos,
-					to_read,
+					chunk,
 					&read
 				);
 
@@ -200,9 +298,13 @@ static uint8_t *bulk_read(struct cla_link *link)
 				return rx_data->input_buffer.end;
 			}
 
-			ASSERT(read <= to_read);
+			ASSERT(read <= chunk);
+			/* Feed the CRC while the data is still in the cache. */
+			if (crc != NULL)
+				crc_feed_bytes(crc, pos, read);
 			to_read -= read;
-			pos += read;
+			if (!discard)
+				pos += read;
 		}
 
 		// We have read everything that was in the buffer (+ more,
@@ -318,6 +420,9 @@ static void cla_contact_rx_task(void *const param)
 		else
 			parsed = chunk_read(link);
 
+		/* Hand over all bundles parsed from the input buffer. */
+		rx_task_flush_bundles(rx_data);
+
 		/* The whole input buffer was consumed, reset it. */
 		if (parsed == rx_data->input_buffer.end) {
 			rx_data->input_buffer.end = rx_data->input_buffer.start;
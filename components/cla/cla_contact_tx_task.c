@@ -92,6 +92,8 @@ static void cla_contact_tx_task(void *param)
 			/* Free only the RB list, the RB is reported */
 			free(cur);
 		}
+		if (link->config->vtable->cla_flush != NULL)
+			link->config->vtable->cla_flush(link);
 	}
 
 	// Lock the queue before we start to free it
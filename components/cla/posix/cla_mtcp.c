@@ -301,7 +301,13 @@ size_t mtcp_forward_to_specific_parser(struct cla_link *link,
 
 	switch (rx_data->payload_type) {
 	case PAYLOAD_UNKNOWN:
-		result = select_bundle_parser_version(rx_data, buffer, length);
+		// Frames that are available as a whole are parsed in one pass
+		if (length == mtcp_link->mtcp_parser.next_bytes)
+			result = rx_task_parse_bundle_frame(rx_data, buffer,
+							    length);
+		if (result == 0)
+			result = select_bundle_parser_version(rx_data, buffer,
+							      length);
 		if (result == 0)
 			mtcp_reset_parsers(link);
 		break;
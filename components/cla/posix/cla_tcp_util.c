@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -250,7 +251,7 @@ ssize_t tcp_send_all(const int socket, const void *const buffer,
 	while (sent < length) {
 		const ssize_t r = send(
 			socket,
-			buffer,
+			(const uint8_t *)buffer + sent,
 			length - sent,
 			0
 		);
@@ -33,6 +33,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <netdb.h>
 #include <unistd.h>
@@ -239,7 +240,7 @@ static enum upcn_result handle_established_connection(
 	// Notify the router task of the newly established connection...
 	struct router_signal rt_signal = {
 		.type = ROUTER_SIGNAL_NEW_LINK_ESTABLISHED,
-		.data = NULL,
+		.data = param->eid ? strdup(param->eid) : NULL,
 	};
 	const struct bundle_agent_interface *const bundle_agent_interface =
 		param->config->base.base.bundle_agent_interface;
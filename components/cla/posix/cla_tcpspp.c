@@ -18,6 +18,7 @@
 #include "upcn/cmdline.h"
 #include "upcn/common.h"
 #include "upcn/config.h"
+#include "upcn/crc.h"
 #include "upcn/parser.h"
 #include "upcn/result.h"
 #include "upcn/task_tags.h"
@@ -28,6 +29,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 // Buffer size for serialization
@@ -62,6 +64,10 @@ struct tcpspp_config {
 	enum cla_tcpspp_payload_type tcpspp_payload_type;
 	struct spp_parser spp_parser;
 	struct crc16_parser crc_parser;
+
+	// Collects small packets to send multiple of them per TCP write
+	uint8_t tx_buffer[CLA_TCPSPP_TX_BUFFER_SIZE];
+	size_t tx_buffer_fill;
 };
 
 static void tcpspp_link_creation_task(void *param)
@@ -161,6 +167,50 @@ void tcpspp_reset_parsers(struct cla_link *link)
 	ASSERT(rx_data->cur_parser);
 }
 
+/*
+ * Handles a space packet that is completely contained in the input buffer:
+ * The CRC16 trailer is verified over the contiguous packet and BPv7 bundles
+ * are parsed in one pass.
+ *
+ * @return The packet size if the packet was consumed, zero if it has to be
+ *         handled by the streaming parsers.
+ */
+static size_t tcpspp_read_packet(struct cla_link *link,
+				 const uint8_t *buffer,
+				 size_t size)
+{
+	struct tcpspp_config *const config =
+		(struct tcpspp_config *)link->config;
+	struct spp_meta_t metadata;
+	const uint8_t *payload;
+	size_t payload_length;
+
+	if (spp_parse_packet(config->spp_ctx, buffer, size, &metadata,
+			     &payload, &payload_length) != 0)
+		return 0;
+
+	if (CLA_TCPSPP_USE_CRC) {
+		const uint8_t *const crc16 = &buffer[size - 2];
+
+		if (payload_length < 2) {
+			LOG("tcpspp: Dropping packet without CRC16.");
+			return size;
+		}
+		// Big Endian (Network Byte Order) is used
+		if (crc16_ccitt_false(buffer, size - 2) !=
+				((crc16[0] << 8) | crc16[1])) {
+			LOG("tcpspp: Dropping packet with invalid CRC16.");
+			return size;
+		}
+		payload_length -= 2;
+	}
+
+	if (rx_task_parse_bundle_frame(&link->rx_task_data, payload,
+				       payload_length) == 0)
+		return 0;
+	return size;
+}
+
 size_t tcpspp_forward_to_specific_parser(struct cla_link *link,
 					 const uint8_t *buffer,
 					 size_t length)
@@ -169,6 +219,22 @@ size_t tcpspp_forward_to_specific_parser(struct cla_link *link,
 		(struct tcpspp_config *)link->config;
 	struct rx_task_data *const rx_data = &link->rx_task_data;
 
+	/* Packets fitting into the input buffer are handled as a whole */
+	if (config->spp_parser.state == SPP_PARSER_STATE_PH_P1_MSB) {
+		const size_t size = spp_get_packet_size(buffer, length);
+		size_t result;
+
+		if (size == 0)
+			return 0;
+		if (size <= length) {
+			result = tcpspp_read_packet(link, buffer, size);
+			if (result != 0)
+				return result;
+		} else if (size <= CLA_RX_BUFFER_SIZE) {
+			return 0;
+		}
+	}
+
 	/* Current parser is input_parser */
 	if (config->spp_parser.state != SPP_PARSER_STATE_DATA_SUBPARSER)
 		return spp_parser_read(
@@ -247,12 +313,69 @@ size_t tcpspp_forward_to_specific_parser(struct cla_link *link,
  * TX
  */
 
-static void tcpspp_begin_packet(struct cla_link *link, size_t length)
+static void tcpspp_send_buffer(struct cla_link *link)
+{
+	struct cla_tcp_link *const tcp_link = (struct cla_tcp_link *)link;
+	struct tcpspp_config *const tcpspp_config_ =
+		(struct tcpspp_config *)link->config;
+	const size_t fill = tcpspp_config_->tx_buffer_fill;
+
+	tcpspp_config_->tx_buffer_fill = 0;
+	if (fill == 0)
+		return;
+
+	if (tcp_send_all(tcp_link->connection_socket,
+			 tcpspp_config_->tx_buffer, fill) == -1) {
+		LOG("tcpspp: Error during sending. Data discarded.");
+		link->config->vtable->cla_disconnect_handler(link);
+	}
+}
+
+/*
+ * Appends data to the TX buffer, feeding the CRC (if not NULL) while copying.
+ * Data not fitting into the buffer is sent after flushing it.
+ */
+static void tcpspp_send(struct cla_link *link, const void *data,
+			const size_t length, struct crc_stream *crc)
 {
 	struct cla_tcp_link *const tcp_link = (struct cla_tcp_link *)link;
 	struct tcpspp_config *const tcpspp_config_ =
 		(struct tcpspp_config *)link->config;
 
+	if (tcpspp_config_->tx_buffer_fill + length >
+			CLA_TCPSPP_TX_BUFFER_SIZE) {
+		tcpspp_send_buffer(link);
+		if (!link->active)
+			return;
+	}
+
+	if (length < CLA_TCPSPP_TX_BUFFER_SIZE) {
+		uint8_t *const dst = &tcpspp_config_->tx_buffer[
+			tcpspp_config_->tx_buffer_fill
+		];
+
+		if (crc != NULL)
+			crc_copy_bytes(crc, dst, data, length);
+		else
+			memcpy(dst, data, length);
+		tcpspp_config_->tx_buffer_fill += length;
+		return;
+	}
+
+	if (tcp_send_all(tcp_link->connection_socket, data, length) == -1) {
+		LOG("tcpspp: Error during sending. Data discarded.");
+		link->config->vtable->cla_disconnect_handler(link);
+	}
+
+	if (crc != NULL)
+		crc_feed_bytes(crc, data, length);
+}
+
+static void tcpspp_begin_packet(struct cla_link *link, size_t length)
+{
+	struct tcpspp_config *const tcpspp_config_ =
+		(struct tcpspp_config *)link->config;
+
 	// A previous operation may have canceled the sending process.
 	if (!link->active)
 		return;
@@ -282,25 +405,15 @@ static void tcpspp_begin_packet(struct cla_link *link, size_t length)
 		&header_end
 	);
 
-	if (CLA_TCPSPP_USE_CRC) {
+	if (CLA_TCPSPP_USE_CRC)
 		crc_init(&tcpspp_config_->crc16, CRC16_CCITT_FALSE);
-		crc_feed_bytes(
-			&tcpspp_config_->crc16,
-			&header_buf[0],
-			header_end - &header_buf[0]
-		);
-	}
 
-	if (tcp_send_all(tcp_link->connection_socket, header_buf,
-			 header_end - &header_buf[0]) == -1) {
-		LOG("tcpspp: Error during sending. Data discarded.");
-		link->config->vtable->cla_disconnect_handler(link);
-	}
+	tcpspp_send(link, header_buf, header_end - &header_buf[0],
+		    CLA_TCPSPP_USE_CRC ? &tcpspp_config_->crc16 : NULL);
 }
 
 static void tcpspp_end_packet(struct cla_link *link)
 {
-	struct cla_tcp_link *tcp_link = (struct cla_tcp_link *)link;
 	struct tcpspp_config *tcpspp_config_ =
 		(struct tcpspp_config *)link->config;
 
@@ -314,18 +427,13 @@ static void tcpspp_end_packet(struct cla_link *link)
 		// Big Endian (Network Byte Order) is necessary
 		const uint8_t crc16_be[2] = { crc16[1], crc16[0] };
 
-		if (tcp_send_all(tcp_link->connection_socket, crc16_be, 2)
-				== -1) {
-			LOG("tcpspp: Error during sending. Data discarded.");
-			link->config->vtable->cla_disconnect_handler(link);
-		}
+		tcpspp_send(link, crc16_be, 2, NULL);
 	}
 }
 
 static void tcpspp_send_packet_data(
 	struct cla_link *link, const void *data, const size_t length)
 {
-	struct cla_tcp_link *const tcp_link = (struct cla_tcp_link *)link;
 	struct tcpspp_config *tcpspp_config_
 		= (struct tcpspp_config *)link->config;
 
@@ -333,13 +441,22 @@ static void tcpspp_send_packet_data(
 	if (!link->active)
 		return;
 
-	if (tcp_send_all(tcp_link->connection_socket, data, length) == -1) {
-		LOG("tcpspp: Error during sending. Data discarded.");
-		link->config->vtable->cla_disconnect_handler(link);
+	tcpspp_send(link, data, length,
+		    CLA_TCPSPP_USE_CRC ? &tcpspp_config_->crc16 : NULL);
+}
+
+static void tcpspp_flush(struct cla_link *link)
+{
+	struct tcpspp_config *tcpspp_config_
+		= (struct tcpspp_config *)link->config;
+
+	// Data buffered for a canceled link is discarded.
+	if (!link->active) {
+		tcpspp_config_->tx_buffer_fill = 0;
+		return;
 	}
 
-	if (CLA_TCPSPP_USE_CRC)
-		crc_feed_bytes(&tcpspp_config_->crc16, data, length);
+	tcpspp_send_buffer(link);
 }
 
 // Public API for Initialization
@@ -356,6 +473,7 @@ const struct cla_vtable tcpspp_vtable = {
 	.cla_begin_packet = tcpspp_begin_packet,
 	.cla_end_packet = tcpspp_end_packet,
 	.cla_send_packet_data = tcpspp_send_packet_data,
+	.cla_flush = tcpspp_flush,
 
 	.cla_rx_task_reset_parsers = tcpspp_reset_parsers,
 	.cla_rx_task_forward_to_specific_parser =
@@ -379,6 +497,7 @@ static enum upcn_result tcpspp_init(
 
 	config->apid = apid;
 	config->base.tcp_active = tcp_active;
+	config->tx_buffer_fill = 0;
 
 	/* Set cla_config vtable */
 	config->base.base.base.vtable = &tcpspp_vtable;
@@ -13,78 +13,112 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <time.h>
-#include <math.h>
 #include <string.h>
 
-static uint64_t ref_timestamp;
+/* The coarse clock is a value cached by the kernel on every tick. */
+#ifdef CLOCK_MONOTONIC_COARSE
+#define COARSE_CLOCK CLOCK_MONOTONIC_COARSE
+#else // CLOCK_MONOTONIC_COARSE
+#define COARSE_CLOCK CLOCK_MONOTONIC
+#endif // CLOCK_MONOTONIC_COARSE
+
+/*
+ * All timestamps are derived from CLOCK_MONOTONIC plus an offset to the
+ * DTN epoch. Steps of the wall clock (e.g. by NTP or the administrator)
+ * thus do not influence the timing of contacts. The offset is initialized
+ * lazily from CLOCK_REALTIME and replaced by hal_time_init().
+ */
+static int64_t dtn_offset_us;
+/* The initial timestamp, which the coarse clock must not fall behind */
+static int64_t dtn_initial_us;
+static bool offset_valid;
 static bool mod_time;
-static struct timespec ref_timespec;
 
 static char *time_string;
 static Semaphore_t time_string_semph;
 
-void hal_time_init(const uint64_t initial_timestamp)
+static inline uint64_t monotonic_us(const clockid_t clock)
 {
-	/* get the current system time */
-	clock_gettime(CLOCK_REALTIME, &ref_timespec);
+	struct timespec ts;
 
-	/* calculate offset to required time */
-	ref_timestamp = ref_timespec.tv_sec - DTN_TIMESTAMP_OFFSET -
-			initial_timestamp;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL +
+		(uint64_t)ts.tv_nsec / 1000ULL;
+}
 
-	mod_time = (initial_timestamp != 0);
+static inline void set_offset_us(const int64_t initial_us)
+{
+	const uint64_t mono = monotonic_us(CLOCK_MONOTONIC);
+
+	__atomic_store_n(&dtn_initial_us, initial_us, __ATOMIC_RELAXED);
+	__atomic_store_n(&dtn_offset_us, initial_us - (int64_t)mono,
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&offset_valid, true, __ATOMIC_RELEASE);
 }
 
-uint64_t hal_time_get_timestamp_s(void)
+static void sync_with_realtime(void)
 {
-	struct timespec ts;
+	struct timespec rt;
 
-	/* returns the time relative to the unix epoch */
-	clock_gettime(CLOCK_REALTIME, &ts);
+	clock_gettime(CLOCK_REALTIME, &rt);
 
-	/* we want to use the DTN epoch -> subtract the offset */
-	return ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
+	set_offset_us(((int64_t)rt.tv_sec - DTN_TIMESTAMP_OFFSET) *
+		      1000000LL + rt.tv_nsec / 1000);
 }
 
-uint64_t hal_time_get_timestamp_ms(void)
+static inline int64_t get_offset_us(void)
 {
-	struct timespec ts;
-	long ms; /* Milliseconds */
-	time_t s;  /* Seconds */
+	if (!__atomic_load_n(&offset_valid, __ATOMIC_ACQUIRE))
+		sync_with_realtime();
+	return __atomic_load_n(&dtn_offset_us, __ATOMIC_RELAXED);
+}
 
-	/* Returns the time relative to the unix epoch */
-	clock_gettime(CLOCK_REALTIME, &ts);
+void hal_time_init(const uint64_t initial_timestamp)
+{
+	/* calculate offset from the monotonic clock to the required time */
+	set_offset_us((int64_t)(initial_timestamp * 1000000ULL));
 
-	/* We want to use the DTN epoch -> subtract the offset */
-	s = ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
-	/* Convert nanoseconds to milliseconds */
-	ms = round(ts.tv_nsec / 1.0e6);
+	mod_time = (initial_timestamp != 0);
+}
 
-	return (s*1.0e3)+ms;
+uint64_t hal_time_get_timestamp_s(void)
+{
+	return hal_time_get_timestamp_us() / 1000000ULL;
 }
 
+uint64_t hal_time_get_timestamp_ms(void)
+{
+	return hal_time_get_timestamp_us() / 1000ULL;
+}
 
 uint64_t hal_time_get_timestamp_us(void)
 {
-	struct timespec ts;
-	long us; /* Milliseconds */
-	time_t s;  /* Seconds */
-
-	/* Returns the time relative to the unix epoch */
-	clock_gettime(CLOCK_REALTIME, &ts);
+	const int64_t offset = get_offset_us();
 
-	/* We want to use the DTN epoch -> subtract the offset */
-	s = ts.tv_sec - DTN_TIMESTAMP_OFFSET - ref_timestamp;
-	/* Convert nanoseconds to microseconds */
-	us = round(ts.tv_nsec / 1.0e3);
-
-	return (s*1.0e6)+us;
+	return (uint64_t)((int64_t)monotonic_us(CLOCK_MONOTONIC) + offset);
 }
 
+/*
+ * NOTE: The offset is calculated based on the precise clock, so that the
+ * millisecond timestamps start exactly at the value requested via
+ * hal_time_init(). The coarse clock lags behind by up to one tick and thus
+ * is clamped to that value.
+ */
+uint64_t hal_time_get_timestamp_s_coarse(void)
+{
+	const int64_t offset = get_offset_us();
+	const int64_t initial = __atomic_load_n(&dtn_initial_us,
+						__ATOMIC_RELAXED);
+	int64_t timestamp = (int64_t)monotonic_us(COARSE_CLOCK) + offset;
+
+	if (timestamp < initial)
+		timestamp = initial;
+	return (uint64_t)timestamp / 1000000ULL;
+}
 
 uint64_t hal_time_get_system_time(void)
 {
-	return hal_time_get_timestamp_us();
+	return monotonic_us(CLOCK_MONOTONIC);
 }
 
 
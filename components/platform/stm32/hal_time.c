@@ -58,6 +58,13 @@ uint64_t hal_time_get_timestamp_us(void)
 }
 
 
+uint64_t hal_time_get_timestamp_s_coarse(void)
+{
+	/* Reading the timer is cheap, no cached value is needed. */
+	return hal_time_get_timestamp_s();
+}
+
+
 uint64_t hal_time_get_system_time(void)
 {
 	return timer_get_ticks();
@@ -46,6 +46,14 @@ void spp_parse_ph_len(const uint16_t word,
 }
 
 
+void spp_parse_ph(const uint8_t *buf, struct spp_primary_header_t *header)
+{
+	spp_parse_ph_p1(read_uint16(&buf[0]), header);
+	spp_parse_ph_p2(read_uint16(&buf[2]), header);
+	spp_parse_ph_len(read_uint16(&buf[4]), header);
+}
+
+
 int spp_parse_primary_header(
 		const uint8_t *buf,
 		const size_t length,
@@ -67,9 +75,7 @@ int spp_parse_primary_header(
 		*next = &buf[6];
 	}
 
-	spp_parse_ph_p1(read_uint16(&buf[0]), header);
-	spp_parse_ph_p2(read_uint16(&buf[2]), header);
-	spp_parse_ph_len(read_uint16(&buf[4]), header);
+	spp_parse_ph(buf, header);
 
 	if ((length - SPP_PRIMARY_HEADER_SIZE) < header->data_length) {
 		/* advertised data length is greater than the full buffer */
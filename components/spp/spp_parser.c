@@ -14,6 +14,50 @@ struct parser *spp_parser_init(struct spp_parser *parser,
 	return &parser->base;
 }
 
+/* Returns false if the parser continues with the data subparser */
+static bool spp_parser_timecode_done(struct spp_parser *parser)
+{
+	parser->dtn_timestamp = spp_tc_get_dtn_timestamp(&parser->tc_parser);
+
+	if (parser->ctx->ancillary_data_len > 0) {
+		// TODO: init subparser
+		parser->state = SPP_PARSER_STATE_SH_ANCILLARY_SUBPARSER;
+		return true;
+	}
+
+	parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
+	return false;
+}
+
+/* Returns false if the parser continues with the data subparser */
+static bool spp_parser_header_done(struct spp_parser *parser)
+{
+	parser->data_length = parser->header.data_length;
+	parser->data_length -= parser->ctx->ancillary_data_len;
+
+	if (!parser->header.has_secondary_header) {
+		// TODO: init subparser
+		parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
+		return false;
+	}
+
+	if (parser->ctx->timecode != NULL) {
+		parser->state = SPP_PARSER_STATE_SH_TIMECODE_SUBPARSER;
+		spp_tc_parser_init(parser->ctx->timecode,
+				   &parser->tc_parser);
+		return true;
+	}
+
+	if (parser->ctx->ancillary_data_len > 0) {
+		// TODO: init subparser
+		parser->state = SPP_PARSER_STATE_SH_ANCILLARY_SUBPARSER;
+		return true;
+	}
+
+	parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
+	return false;
+}
+
 bool spp_parse_byte(struct spp_parser *parser,
 		    const uint8_t byte)
 {
@@ -60,31 +104,7 @@ bool spp_parse_byte(struct spp_parser *parser,
 	{
 		parser->bufw |= byte;
 		spp_parse_ph_len(parser->bufw, &parser->header);
-
-		parser->data_length = parser->header.data_length;
-		parser->data_length -= parser->ctx->ancillary_data_len;
-
-		if (!parser->header.has_secondary_header) {
-			// TODO: init subparser
-			parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
-			return false;
-		}
-
-		if (parser->ctx->timecode != NULL) {
-			parser->state = SPP_PARSER_STATE_SH_TIMECODE_SUBPARSER;
-			spp_tc_parser_init(parser->ctx->timecode,
-					   &parser->tc_parser);
-			break;
-		}
-
-		if (parser->ctx->ancillary_data_len > 0) {
-			// TODO: init subparser
-			parser->state = SPP_PARSER_STATE_SH_ANCILLARY_SUBPARSER;
-			break;
-		}
-
-		parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
-		return false;
+		return spp_parser_header_done(parser);
 	}
 	case SPP_PARSER_STATE_SH_TIMECODE_SUBPARSER:
 	{
@@ -104,17 +124,7 @@ bool spp_parse_byte(struct spp_parser *parser,
 		}
 		}
 
-		parser->dtn_timestamp = spp_tc_get_dtn_timestamp(
-					&parser->tc_parser);
-
-		if (parser->ctx->ancillary_data_len > 0) {
-			// TODO: init subparser
-			parser->state = SPP_PARSER_STATE_SH_ANCILLARY_SUBPARSER;
-			break;
-		}
-
-		parser->state = SPP_PARSER_STATE_DATA_SUBPARSER;
-		return false;
+		return spp_parser_timecode_done(parser);
 	}
 	case SPP_PARSER_STATE_SH_ANCILLARY_SUBPARSER:
 	{
@@ -138,6 +148,36 @@ size_t spp_parser_read(struct spp_parser *parser,
 {
 	const uint8_t *const end = buffer + length;
 	const uint8_t *cur = buffer;
+	size_t consumed;
+
+	/* A primary header contained in the buffer is decoded in one go. */
+	if (parser->state == SPP_PARSER_STATE_PH_P1_MSB &&
+			length >= SPP_PRIMARY_HEADER_SIZE &&
+			spp_check_first_byte(buffer[0])) {
+		spp_parse_ph(buffer, &parser->header);
+		cur += SPP_PRIMARY_HEADER_SIZE;
+		if (!spp_parser_header_done(parser))
+			return cur - buffer;
+	}
+
+	/* The same applies to the timecode in the secondary header. */
+	if (parser->state == SPP_PARSER_STATE_SH_TIMECODE_SUBPARSER &&
+			cur != end) {
+		consumed = spp_tc_parser_read(&parser->tc_parser, cur,
+					      end - cur);
+		parser->data_length -= consumed;
+		cur += consumed;
+		switch (parser->tc_parser.status) {
+		case SPP_TC_PARSER_GOOD:
+		case SPP_TC_PARSER_ERROR:
+			/* all data consumed or stopped at the erroneous byte */
+			return cur - buffer;
+		case SPP_TC_PARSER_DONE:
+			if (!spp_parser_timecode_done(parser))
+				return cur - buffer;
+			break;
+		}
+	}
 
 	for (; cur != end; ++cur) {
 		if (!spp_parse_byte(parser, *cur)) {
@@ -152,6 +192,57 @@ size_t spp_parser_read(struct spp_parser *parser,
 	return cur - buffer;
 }
 
+size_t spp_get_packet_size(const uint8_t *buffer, size_t length)
+{
+	struct spp_primary_header_t header;
+
+	if (length < SPP_PRIMARY_HEADER_SIZE)
+		return 0;
+	spp_parse_ph(buffer, &header);
+	return SPP_PRIMARY_HEADER_SIZE + header.data_length;
+}
+
+int spp_parse_packet(const struct spp_context_t *ctx,
+		     const uint8_t *buffer, size_t length,
+		     struct spp_meta_t *meta,
+		     const uint8_t **data, size_t *data_length)
+{
+	struct spp_primary_header_t header;
+	struct spp_tc_parser_t tc_parser;
+	const uint8_t *cur = buffer + SPP_PRIMARY_HEADER_SIZE;
+	const uint8_t *const end = buffer + length;
+
+	if (length < SPP_PRIMARY_HEADER_SIZE || !spp_check_first_byte(*buffer))
+		return -1;
+	spp_parse_ph(buffer, &header);
+	if (header.data_length != length - SPP_PRIMARY_HEADER_SIZE)
+		return -1;
+
+	meta->apid = header.apid;
+	meta->is_request = header.is_request;
+	meta->segment_number = header.segment_number;
+	meta->segment_status = header.segment_status;
+	meta->dtn_timestamp = 0;
+	meta->dtn_counter = 0;
+
+	if (header.has_secondary_header && ctx->timecode != NULL) {
+		spp_tc_parser_init(ctx->timecode, &tc_parser);
+		cur += spp_tc_parser_read(&tc_parser, cur, end - cur);
+		if (tc_parser.status != SPP_TC_PARSER_DONE)
+			return -1;
+		meta->dtn_timestamp = spp_tc_get_dtn_timestamp(&tc_parser);
+	}
+	if (header.has_secondary_header) {
+		if ((size_t)(end - cur) < ctx->ancillary_data_len)
+			return -1;
+		cur += ctx->ancillary_data_len;
+	}
+
+	*data = cur;
+	*data_length = end - cur;
+	return 0;
+}
+
 void spp_parser_reset(struct spp_parser *parser)
 {
 	parser->base.status = PARSER_STATUS_GOOD;
@@ -232,6 +232,33 @@ int spp_tc_parser_feed(struct spp_tc_parser_t *parser,
 	return result;
 }
 
+size_t spp_tc_parser_read(struct spp_tc_parser_t *parser,
+			  const uint8_t *buffer, const size_t length)
+{
+	size_t i = 0, n;
+	uint64_t count;
+
+	while (i < length && parser->status == SPP_TC_PARSER_GOOD) {
+		if (parser->format.type != SPP_TC_UNSEGMENTED_CCSDS_EPOCH ||
+				parser->state.unsegmented.read_base_unit) {
+			spp_tc_parser_feed(parser, buffer[i++]);
+			continue;
+		}
+		/* accumulate the available base unit octets in one go */
+		n = parser->state.unsegmented.base_unit_remaining;
+		if (n > length - i)
+			n = length - i;
+		parser->state.unsegmented.base_unit_remaining -= n;
+		count = parser->state.unsegmented.base_unit_count;
+		while (n--)
+			count = (count << 8) | buffer[i++];
+		parser->state.unsegmented.base_unit_count = count;
+		parser->status = spp_tc_unsegmented_advance(parser);
+	}
+
+	return i;
+}
+
 uint64_t spp_tc_get_dtn_timestamp(const struct spp_tc_parser_t *parser)
 {
 	if (parser->status != SPP_TC_PARSER_DONE) {
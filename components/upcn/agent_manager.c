@@ -1,5 +1,6 @@
 #include "upcn/agent_manager.h"
 #include "upcn/bundle.h"
+#include "upcn/result.h"
 
 #include "agents/config_agent.h"
 #include "agents/application_agent.h"
@@ -18,9 +19,10 @@ static struct agent_list **agent_search_ptr(const char *sink_identifier);
 
 static struct agent_list *agent_entry_node;
 
-int agent_register(const char *sink_identifier,
-		   void (*callback)(struct bundle_adu data, void *param),
-		   void *param)
+static int agent_register_internal(
+	const char *sink_identifier,
+	void (*callback)(struct bundle_adu data, void *param),
+	void *param, const bool chunked)
 {
 	struct agent *ag_ptr;
 
@@ -37,6 +39,7 @@ int agent_register(const char *sink_identifier,
 	ag_ptr->sink_identifier = sink_identifier;
 	ag_ptr->callback = callback;
 	ag_ptr->param = param;
+	ag_ptr->chunked = chunked;
 
 	if (agent_list_add_entry(ag_ptr)) {
 		/* the adding process to the list failed */
@@ -50,6 +53,23 @@ int agent_register(const char *sink_identifier,
 	return 0;
 }
 
+int agent_register(const char *sink_identifier,
+		   void (*callback)(struct bundle_adu data, void *param),
+		   void *param)
+{
+	return agent_register_internal(sink_identifier, callback, param,
+				       false);
+}
+
+int agent_register_chunked(const char *sink_identifier,
+			   void (*callback)(struct bundle_adu data,
+					    void *param),
+			   void *param)
+{
+	return agent_register_internal(sink_identifier, callback, param,
+				       true);
+}
+
 int agent_deregister(char *sink_identifier)
 {
 	struct agent *ag_ptr;
@@ -92,6 +112,13 @@ int agent_forward(const char *sink_identifier, struct bundle_adu data)
 		bundle_adu_free_members(data);
 		return -1;
 	}
+
+	if (!ag_ptr->chunked && bundle_adu_make_contiguous(&data) != UPCN_OK) {
+		LOGF("AgentManager: Cannot allocate ADU for agent \"%s\"!",
+		     sink_identifier);
+		bundle_adu_free_members(data);
+		return -1;
+	}
 	ag_ptr->callback(data, ag_ptr->param);
 
 	return 0;
@@ -41,6 +41,7 @@ static inline void bundle_reset_internal(struct bundle *bundle)
 	bundle->fragment_offset = 0;
 	bundle->total_adu_length = 0;
 	bundle->primary_block_length = 0;
+	bundle->v6_header_cache = NULL;
 	bundle->blocks = NULL;
 	bundle->payload_block = NULL;
 }
@@ -63,6 +64,7 @@ inline void bundle_free_dynamic_parts(struct bundle *bundle)
 	free(bundle->source);
 	free(bundle->report_to);
 	free(bundle->current_custodian);
+	free(bundle->v6_header_cache);
 
 	while (bundle->blocks != NULL)
 		bundle->blocks = bundle_block_entry_free(bundle->blocks);
@@ -101,6 +103,7 @@ void bundle_copy_headers(struct bundle *to, const struct bundle *from)
 		to->report_to = strdup(to->report_to);
 	if (to->current_custodian != NULL)
 		to->current_custodian = strdup(to->current_custodian);
+	to->v6_header_cache = NULL;
 
 	// No extension blocks are copied
 	to->blocks = NULL;
@@ -145,6 +148,7 @@ struct bundle *bundle_dup(const struct bundle *bundle)
 		dup->report_to = strdup(dup->report_to);
 	if (dup->current_custodian)
 		dup->current_custodian = strdup(dup->current_custodian);
+	dup->v6_header_cache = NULL;
 
 	// Duplicate extension blocks
 	dup->blocks = bundle_block_list_dup(bundle->blocks);
@@ -354,16 +358,13 @@ enum upcn_result bundle_serialize(struct bundle *bundle,
 	switch (bundle->protocol_version) {
 	// RFC 5050
 	case 6:
-		bundle6_serialize(bundle, write, cla_obj);
-		break;
+		return bundle6_serialize(bundle, write, cla_obj);
 	// BPv7
 	case 7:
-		bundle7_serialize(bundle, write, cla_obj);
-		break;
+		return bundle7_serialize(bundle, write, cla_obj);
 	default:
 		return UPCN_FAIL;
 	}
-	return UPCN_OK;
 }
 
 size_t bundle_get_first_fragment_min_size(struct bundle *bundle)
@@ -419,7 +420,7 @@ uint64_t bundle_get_expiration_time(const struct bundle *bundle)
 		(
 			bundle->creation_timestamp
 				? bundle->creation_timestamp
-				: hal_time_get_timestamp_s()
+				: hal_time_get_timestamp_s_coarse()
 		) +
 		// Lifetime, rounded to the next integer
 		(bundle->lifetime + 500000) / 1000000
@@ -473,7 +474,9 @@ struct bundle_adu bundle_adu_init(const struct bundle *bundle)
 		.source = strdup(bundle->source),
 		.destination = strdup(bundle->destination),
 		.payload = NULL,
-		.length = 0
+		.length = 0,
+		.chunks = NULL,
+		.chunk_count = 0
 	};
 }
 
@@ -490,7 +493,71 @@ struct bundle_adu bundle_to_adu(struct bundle *bundle)
 
 void bundle_adu_free_members(struct bundle_adu adu)
 {
+	uint32_t i;
+
 	free(adu.source);
 	free(adu.destination);
 	free(adu.payload);
+	for (i = 0; i < adu.chunk_count; i++)
+		free(adu.chunks[i].data);
+	free(adu.chunks);
+}
+
+void bundle_adu_iterate(const struct bundle_adu *adu,
+	void (*write)(void *param, const void *data, const size_t length),
+	void *param)
+{
+	size_t position = 0;
+	uint32_t i;
+
+	if (adu->chunks == NULL) {
+		if (adu->length)
+			write(param, adu->payload, adu->length);
+		return;
+	}
+
+	for (i = 0; i < adu->chunk_count && position < adu->length; i++) {
+		const struct bundle_adu_chunk *c = &adu->chunks[i];
+		const size_t end = (size_t)c->offset + c->length;
+
+		// Skip chunks completely covered by the previous ones
+		if (end <= position)
+			continue;
+		ASSERT(c->offset <= position);
+		write(param, &c->data[position - c->offset], end - position);
+		position = end;
+	}
+}
+
+static void write_to_buffer(void *param, const void *data, const size_t length)
+{
+	uint8_t **position = (uint8_t **)param;
+
+	memcpy(*position, data, length);
+	*position += length;
+}
+
+enum upcn_result bundle_adu_make_contiguous(struct bundle_adu *adu)
+{
+	uint8_t *payload, *position;
+	uint32_t i;
+
+	if (adu->chunks == NULL)
+		return UPCN_OK;
+
+	// Allocate at least one byte to be able to detect failures
+	payload = malloc(MAX(adu->length, (size_t)1));
+	if (!payload)
+		return UPCN_FAIL;
+	position = payload;
+	bundle_adu_iterate(adu, write_to_buffer, &position);
+	ASSERT((size_t)(position - payload) == adu->length);
+
+	for (i = 0; i < adu->chunk_count; i++)
+		free(adu->chunks[i].data);
+	free(adu->chunks);
+	adu->chunks = NULL;
+	adu->chunk_count = 0;
+	adu->payload = payload;
+	return UPCN_OK;
 }
@@ -0,0 +1,248 @@
+#include "upcn/bundle.h"
+#include "upcn/bundle_backlog.h"
+#include "upcn/common.h"
+#include "upcn/result.h"
+
+#include "util/htab_hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of hash table slots for destination nodes (power of two)
+#define BACKLOG_SLOT_COUNT 32
+#define INITIAL_ENTRY_CAPACITY 4
+
+struct backlog_entry {
+	bundleid_t id;
+	uint64_t exp_time;
+};
+
+struct backlog_node {
+	char *eid;
+	size_t eid_length;
+	struct backlog_entry *entries;
+	uint32_t entry_count;
+	uint32_t entry_capacity;
+	struct backlog_node *next;
+};
+
+struct bundle_backlog {
+	struct backlog_node *slots[BACKLOG_SLOT_COUNT];
+	uint32_t bundle_count;
+	uint32_t max_bundles;
+};
+
+// Returns the length of the node part of the EID
+static size_t node_eid_length(const char *eid)
+{
+	const char *const DTN_SCHEME = "dtn://";
+	const size_t DTN_SCHEME_LENGTH = strlen(DTN_SCHEME);
+	const char *node_id_end;
+
+	if (strncmp(eid, DTN_SCHEME, DTN_SCHEME_LENGTH) == 0) {
+		node_id_end = strchr(eid + DTN_SCHEME_LENGTH, '/');
+		if (node_id_end)
+			return node_id_end - eid;
+	}
+	return strlen(eid);
+}
+
+static inline uint32_t node_slot(const char *eid, const size_t length)
+{
+	return hashlittle(eid, length, 0) & (BACKLOG_SLOT_COUNT - 1);
+}
+
+static struct backlog_node **find_node(struct bundle_backlog *backlog,
+				       const char *eid, const size_t length)
+{
+	struct backlog_node **n = &backlog->slots[node_slot(eid, length)];
+
+	while (*n != NULL) {
+		if ((*n)->eid_length == length &&
+				memcmp((*n)->eid, eid, length) == 0)
+			break;
+		n = &(*n)->next;
+	}
+	return n;
+}
+
+static struct backlog_node *backlog_node_create(const char *eid,
+						const size_t length)
+{
+	struct backlog_node *const node = malloc(sizeof(struct backlog_node));
+
+	if (!node)
+		return NULL;
+	node->eid = malloc(length + 1);
+	node->entries = malloc(
+		sizeof(struct backlog_entry) * INITIAL_ENTRY_CAPACITY
+	);
+	if (!node->eid || !node->entries) {
+		free(node->eid);
+		free(node->entries);
+		free(node);
+		return NULL;
+	}
+	memcpy(node->eid, eid, length);
+	node->eid[length] = '\0';
+	node->eid_length = length;
+	node->entry_count = 0;
+	node->entry_capacity = INITIAL_ENTRY_CAPACITY;
+	node->next = NULL;
+	return node;
+}
+
+static void backlog_node_free(struct backlog_node *node)
+{
+	free(node->eid);
+	free(node->entries);
+	free(node);
+}
+
+struct bundle_backlog *bundle_backlog_create(uint32_t max_bundles)
+{
+	struct bundle_backlog *const backlog = malloc(
+		sizeof(struct bundle_backlog)
+	);
+
+	if (!backlog)
+		return NULL;
+	memset(backlog->slots, 0, sizeof(backlog->slots));
+	backlog->bundle_count = 0;
+	backlog->max_bundles = max_bundles;
+	return backlog;
+}
+
+void bundle_backlog_free(struct bundle_backlog *backlog)
+{
+	struct backlog_node *node, *next;
+	uint32_t i;
+
+	if (!backlog)
+		return;
+	for (i = 0; i < BACKLOG_SLOT_COUNT; i++) {
+		for (node = backlog->slots[i]; node != NULL; node = next) {
+			next = node->next;
+			backlog_node_free(node);
+		}
+	}
+	free(backlog);
+}
+
+enum upcn_result bundle_backlog_add(
+	struct bundle_backlog *backlog, const char *destination,
+	bundleid_t id, uint64_t exp_time)
+{
+	const size_t length = node_eid_length(destination);
+	struct backlog_node **n;
+	struct backlog_node *node;
+
+	if (backlog->bundle_count >= backlog->max_bundles)
+		return UPCN_FAIL;
+	n = find_node(backlog, destination, length);
+	if (*n == NULL) {
+		*n = backlog_node_create(destination, length);
+		if (*n == NULL)
+			return UPCN_FAIL;
+	}
+	node = *n;
+	if (node->entry_count == node->entry_capacity) {
+		const uint32_t new_capacity = node->entry_capacity * 2;
+		struct backlog_entry *const new_entries = realloc(
+			node->entries,
+			sizeof(struct backlog_entry) * new_capacity
+		);
+
+		if (!new_entries)
+			return UPCN_FAIL;
+		node->entries = new_entries;
+		node->entry_capacity = new_capacity;
+	}
+	node->entries[node->entry_count++] = (struct backlog_entry){
+		.id = id,
+		.exp_time = exp_time,
+	};
+	backlog->bundle_count++;
+	return UPCN_OK;
+}
+
+void bundle_backlog_take(
+	struct bundle_backlog *backlog, const char *eid,
+	void (*callback)(bundleid_t id, uint64_t exp_time, void *param),
+	void *param)
+{
+	struct backlog_node *taken = NULL, *node, *next;
+	struct backlog_node **n;
+	uint32_t i;
+
+	// Detach the nodes first as the callback may modify the backlog
+	if (eid != NULL) {
+		n = find_node(backlog, eid, node_eid_length(eid));
+		if (*n != NULL) {
+			taken = *n;
+			*n = taken->next;
+			taken->next = NULL;
+			backlog->bundle_count -= taken->entry_count;
+		}
+	} else {
+		for (i = 0; i < BACKLOG_SLOT_COUNT; i++) {
+			for (node = backlog->slots[i]; node; node = next) {
+				next = node->next;
+				node->next = taken;
+				taken = node;
+			}
+			backlog->slots[i] = NULL;
+		}
+		backlog->bundle_count = 0;
+	}
+	for (node = taken; node != NULL; node = next) {
+		next = node->next;
+		for (i = 0; i < node->entry_count; i++)
+			callback(node->entries[i].id,
+				 node->entries[i].exp_time, param);
+		backlog_node_free(node);
+	}
+}
+
+uint32_t bundle_backlog_expire(
+	struct bundle_backlog *backlog, uint64_t now,
+	void (*callback)(bundleid_t id, uint64_t exp_time, void *param),
+	void *param)
+{
+	struct backlog_node **n, *node;
+	uint32_t i, j, k, expired = 0;
+
+	for (i = 0; i < BACKLOG_SLOT_COUNT; i++) {
+		n = &backlog->slots[i];
+		while (*n != NULL) {
+			node = *n;
+			// Compact the remaining entries, keeping their order
+			for (j = 0, k = 0; j < node->entry_count; j++) {
+				if (node->entries[j].exp_time <= now) {
+					callback(node->entries[j].id,
+						 node->entries[j].exp_time,
+						 param);
+					expired++;
+				} else {
+					node->entries[k++] = node->entries[j];
+				}
+			}
+			backlog->bundle_count -= node->entry_count - k;
+			node->entry_count = k;
+			if (k == 0) {
+				*n = node->next;
+				backlog_node_free(node);
+			} else {
+				n = &node->next;
+			}
+		}
+	}
+	return expired;
+}
+
+uint32_t bundle_backlog_count(const struct bundle_backlog *backlog)
+{
+	return backlog->bundle_count;
+}
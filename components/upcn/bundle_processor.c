@@ -1,20 +1,26 @@
 #include "upcn/agent_manager.h"
 #include "upcn/common.h"
 #include "upcn/config.h"
+#include "upcn/custody_aggregator.h"
 #include "upcn/custody_manager.h"
 #include "upcn/bundle_processor.h"
 #include "upcn/bundle_storage_manager.h"
+#include "upcn/known_bundle_set.h"
+#include "upcn/reassembly_table.h"
 #include "upcn/report_manager.h"
 #include "upcn/result.h"
 #include "upcn/router_task.h"
 #include "upcn/task_tags.h"
 
 #include "bundle6/bundle6.h"
+#include "bundle6/cteb.h"
 #include "bundle7/hopcount.h"
 
 #include "platform/hal_io.h"
 #include "platform/hal_queue.h"
+#include "platform/hal_semaphore.h"
 #include "platform/hal_task.h"
+#include "platform/hal_time.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -33,19 +39,13 @@ static QueueIdentifier_t out_queue;
 static const char *local_eid;
 static bool status_reporting;
 
-static struct reassembly_list {
-	struct reassembly_bundle_list {
-		struct bundle *bundle;
-		struct reassembly_bundle_list *next;
-	} *bundle_list;
-	struct reassembly_list *next;
-} *reassembly_list;
+static struct reassembly_table *reassembly_table;
 
-static struct known_bundle_list {
-	struct bundle_unique_identifier id;
-	uint64_t deadline;
-	struct known_bundle_list *next;
-} *known_bundle_list;
+static struct known_bundle_set *known_bundles;
+/* Protects the set against concurrent lookups by the CLA RX tasks */
+static Semaphore_t known_bundles_sem;
+
+static struct custody_aggregator *custody_aggregator;
 
 /* DECLARATIONS */
 
@@ -76,6 +76,8 @@ static void bundle_delete(
 static void bundle_discard(struct bundle *bundle);
 static void bundle_handle_custody_signal(
 	struct bundle_administrative_record *signal);
+static void bundle_handle_aggregate_custody_signal(
+	struct bundle_administrative_record *signal);
 static void bundle_dangling(struct bundle *bundle);
 static bool hop_count_validation(struct bundle *bundle);
 static const char *get_agent_id(const char *dest_eid);
@@ -90,6 +92,7 @@ static void send_status_report(
 static void send_custody_signal(struct bundle *bundle,
 	const enum bundle_custody_signal_type,
 	const enum bundle_custody_signal_reason reason);
+static void send_due_custody_signals(void);
 static enum upcn_result send_bundle(bundleid_t bundle, uint16_t timeout);
 static struct bundle_block *find_block_by_type(struct bundle_block_list *blocks,
 	enum bundle_block_type type);
@@ -118,9 +121,37 @@ void bundle_processor_inform(
 	struct bundle_processor_signal signal = {
 		.type = type,
 		.reason = reason,
-		.bundle = bundle
+		.bundle = bundle,
+		.batch = NULL
+	};
+
+	hal_queue_push_to_back(signaling_queue, &signal);
+}
+
+void bundle_processor_inform_batch(
+	QueueIdentifier_t signaling_queue, const bundleid_t ids[],
+	uint16_t count)
+{
+	struct bundle_processor_signal signal = {
+		.type = BP_SIGNAL_BUNDLES_INCOMING,
+		.reason = BUNDLE_SR_REASON_NO_INFO,
+		.bundle = BUNDLE_INVALID_ID
 	};
+	uint16_t i;
 
+	if (count == 0)
+		return;
+	signal.batch = malloc(sizeof(struct bundle_batch) +
+			      count * sizeof(bundleid_t));
+	if (signal.batch == NULL) {
+		for (i = 0; i < count; i++)
+			bundle_processor_inform(signaling_queue, ids[i],
+						BP_SIGNAL_BUNDLE_INCOMING,
+						BUNDLE_SR_REASON_NO_INFO);
+		return;
+	}
+	signal.batch->count = count;
+	memcpy(signal.batch->ids, ids, count * sizeof(bundleid_t));
 	hal_queue_push_to_back(signaling_queue, &signal);
 }
 
@@ -136,22 +167,72 @@ void bundle_processor_task(void * const param)
 
 	custody_manager_init(p->local_eid);
 
+	known_bundles_sem = hal_semaphore_init_binary();
+	ASSERT(known_bundles_sem != NULL);
+	hal_semaphore_release(known_bundles_sem);
+	known_bundles = known_bundle_set_create(
+		KNOWN_BUNDLE_MAX_EXACT_ENTRIES,
+		KNOWN_BUNDLE_MAX_RECORDS,
+		KNOWN_BUNDLE_BLOOM_COUNTERS
+	);
+	ASSERT(known_bundles != NULL);
+	reassembly_table = reassembly_table_create();
+	ASSERT(reassembly_table != NULL);
+	custody_aggregator = custody_aggregator_create(CUSTODY_ACS_MAX_FILLS);
+	ASSERT(custody_aggregator != NULL);
+
 	LOGF("BundleProcessor: BPA initialized for \"%s\", status reports %s",
 	     p->local_eid, p->status_reporting ? "enabled" : "disabled");
 
 	for (;;) {
+		const uint64_t deadline = custody_aggregator_next_deadline(
+			custody_aggregator
+		);
+		int timeout = -1;
+
+		/* Wake up when the next Aggregate Custody Signal is due */
+		if (deadline != UINT64_MAX) {
+			const uint64_t now = hal_time_get_timestamp_ms();
+
+			timeout = (deadline > now)
+				? (int)MIN(deadline - now, (uint64_t)INT32_MAX)
+				: 0;
+		}
 		if (hal_queue_receive(p->signaling_queue, &signal,
-			-1) == UPCN_OK
+			timeout) == UPCN_OK
 		) {
 			handle_signal(signal);
 		}
+		send_due_custody_signals();
 	}
 }
 
+static void handle_batch(struct bundle_batch *batch)
+{
+	struct bundle *b;
+	uint16_t i;
+
+	for (i = 0; i < batch->count; i++) {
+		b = bundle_storage_get(batch->ids[i]);
+		if (b == NULL)
+			LOGI("BundleProcessor: Bundle not found",
+			     batch->ids[i]);
+		else
+			bundle_receive(b);
+	}
+	free(batch);
+}
+
 static inline void handle_signal(const struct bundle_processor_signal signal)
 {
-	struct bundle *b = bundle_storage_get(signal.bundle);
+	struct bundle *b;
+
+	if (signal.type == BP_SIGNAL_BUNDLES_INCOMING) {
+		handle_batch(signal.batch);
+		return;
+	}
 
+	b = bundle_storage_get(signal.bundle);
 	if (b == NULL) {
 		LOGI("BundleProcessor: Could not process signal", signal.type);
 		LOGI("BundleProcessor: Bundle not found", signal.bundle);
@@ -329,7 +410,7 @@ static void bundle_receive(struct bundle *bundle)
 	/* Check lifetime - TODO: support Bundle Age block */
 	if (bundle->creation_timestamp != 0 &&
 			bundle_get_expiration_time(bundle) <
-			hal_time_get_timestamp_s()) {
+			hal_time_get_timestamp_s_coarse()) {
 		bundle_delete(bundle, BUNDLE_SR_REASON_LIFETIME_EXPIRED);
 		return;
 	}
@@ -442,124 +523,10 @@ static void bundle_deliver_local(struct bundle *bundle)
 	}
 }
 
-static bool may_reassemble(const struct bundle *b1, const struct bundle *b2)
-{
-	return (
-		b1->creation_timestamp == b2->creation_timestamp &&
-		b1->sequence_number == b2->sequence_number &&
-		strcmp(b1->source, b2->source) == 0 // XXX: '==' may be ok
-	);
-}
-
-static void add_to_reassembly_bundle_list(struct reassembly_list *item,
-					  struct bundle *bundle)
-{
-	struct reassembly_bundle_list **cur_entry = &item->bundle_list;
-
-	while (*cur_entry != NULL) {
-		struct reassembly_bundle_list *e = *cur_entry;
-
-		// Order by frag. offset
-		if (e->bundle->fragment_offset > bundle->fragment_offset)
-			break;
-		cur_entry = &(*cur_entry)->next;
-	}
-
-	struct reassembly_bundle_list *new_entry = malloc(
-		sizeof(struct reassembly_bundle_list)
-	);
-	if (!new_entry) {
-		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
-		return;
-	}
-	new_entry->bundle = bundle;
-	new_entry->next = *cur_entry;
-	*cur_entry = new_entry;
-}
-
-static void try_reassemble(struct reassembly_list **slot)
-{
-	struct reassembly_list *const e = *slot;
-	struct reassembly_bundle_list *eb;
-	struct bundle *b;
-
-	size_t pos_in_bundle = 0;
-
-	LOG("Attempting bundle reassembly!");
-
-	// Check if we can reassemble
-	for (eb = e->bundle_list; eb; eb = eb->next) {
-		b = eb->bundle;
-		if (b->fragment_offset > pos_in_bundle)
-			return; // cannot reassemble, has gaps
-		pos_in_bundle = b->fragment_offset + b->payload_block->length;
-		if (pos_in_bundle >= b->total_adu_length)
-			break; // can reassemble
-	}
-	if (!eb)
-		return;
-	LOG("Reassembling bundle!");
-
-	// Reassemble by memcpy
-	b = e->bundle_list->bundle;
-	const size_t adu_length = b->total_adu_length;
-	uint8_t *const payload = malloc(adu_length);
-	bool added_as_known = false;
-
-	if (!payload)
-		return; // currently not enough memory to reassemble
-
-	struct bundle_adu adu = bundle_adu_init(b);
-
-	adu.payload = payload;
-	adu.length = adu_length;
-
-	pos_in_bundle = 0;
-	for (eb = e->bundle_list; eb; eb = eb->next) {
-		b = eb->bundle;
-
-		if (!added_as_known) {
-			bundle_add_reassembled_as_known(b);
-			added_as_known = true;
-		}
-
-		const size_t offset_in_bundle = (
-			pos_in_bundle - b->fragment_offset
-		);
-		const size_t bytes_copied = MIN(
-			b->payload_block->length - offset_in_bundle,
-			adu_length - pos_in_bundle
-		);
-
-		if (offset_in_bundle < b->payload_block->length) {
-			memcpy(
-				&payload[pos_in_bundle],
-				&b->payload_block->data[offset_in_bundle],
-				bytes_copied
-			);
-			pos_in_bundle += bytes_copied;
-		}
-
-		bundle_rem_rc(b, BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING, 0);
-		bundle_discard(b);
-	}
-
-	// Delete slot
-	*slot = (*slot)->next;
-	while (e->bundle_list) {
-		eb = e->bundle_list;
-		e->bundle_list = e->bundle_list->next;
-		free(eb);
-	}
-	free(e);
-
-	// Deliver ADU
-	bundle_deliver_adu(adu);
-}
-
 static void bundle_attempt_reassembly(struct bundle *bundle)
 {
-	struct reassembly_list **r_list_e = &reassembly_list;
+	struct bundle_adu adu;
+	enum reassembly_result result;
 
 	if (bundle_reassembled_is_known(bundle)) {
 		LOGF("Original bundle for #%d was already delivered, dropping",
@@ -571,33 +538,27 @@ static void bundle_attempt_reassembly(struct bundle *bundle)
 			0
 		);
 		bundle_discard(bundle);
+		return;
 	}
 
-	// Find bundle
-	for (; *r_list_e; r_list_e = &(*r_list_e)->next) {
-		struct reassembly_list *const e = *r_list_e;
-
-		if (may_reassemble(e->bundle_list->bundle, bundle)) {
-			add_to_reassembly_bundle_list(e, bundle);
-			try_reassemble(r_list_e);
-			return;
-		}
-	}
-
-	// Not found, append
-	struct reassembly_list *new_list = malloc(
-		sizeof(struct reassembly_list)
-	);
-
-	if (!new_list) {
+	// Release the chunks of ADUs which cannot be completed anymore
+	reassembly_table_expire(reassembly_table,
+				hal_time_get_timestamp_s_coarse());
+	// The payload is moved into the table, the fragment is not needed
+	result = reassembly_table_add(reassembly_table, bundle, &adu);
+	if (result == REASSEMBLY_FAILED) {
 		bundle_delete(bundle, BUNDLE_SR_REASON_DEPLETED_STORAGE);
 		return;
 	}
-	new_list->bundle_list = NULL;
-	new_list->next = NULL;
-	add_to_reassembly_bundle_list(new_list, bundle);
-	*r_list_e = new_list;
-	try_reassemble(r_list_e);
+	if (result == REASSEMBLY_COMPLETE) {
+		LOG("Reassembled bundle!");
+		bundle_add_reassembled_as_known(bundle);
+	}
+	bundle_rem_rc(bundle, BUNDLE_RET_CONSTRAINT_REASSEMBLY_PENDING, 0);
+	bundle_discard(bundle);
+
+	if (result == REASSEMBLY_COMPLETE)
+		bundle_deliver_adu(adu);
 }
 
 static void bundle_deliver_adu(struct bundle_adu adu)
@@ -605,6 +566,10 @@ static void bundle_deliver_adu(struct bundle_adu adu)
 	struct bundle_administrative_record *record;
 
 	if (HAS_FLAG(adu.proc_flags, BUNDLE_FLAG_ADMINISTRATIVE_RECORD)) {
+		if (bundle_adu_make_contiguous(&adu) != UPCN_OK) {
+			bundle_adu_free_members(adu);
+			return;
+		}
 		record = parse_administrative_record(
 			adu.protocol_version,
 			adu.payload,
@@ -612,6 +577,9 @@ static void bundle_deliver_adu(struct bundle_adu adu)
 		);
 		if (record != NULL && record->type == BUNDLE_AR_CUSTODY_SIGNAL)
 			bundle_handle_custody_signal(record);
+		else if (record != NULL && record->type ==
+				BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL)
+			bundle_handle_aggregate_custody_signal(record);
 		free_administrative_record(record);
 		bundle_adu_free_members(adu);
 		return;
@@ -628,6 +596,17 @@ static void bundle_deliver_adu(struct bundle_adu adu)
 /* 5.10 */
 static void bundle_custody_accept(struct bundle *bundle)
 {
+	/* Other bundles may have been accepted since reception */
+	if (!custody_manager_storage_is_acceptable(bundle)) {
+		send_custody_signal(bundle, BUNDLE_CS_TYPE_REFUSAL,
+			BUNDLE_CS_REASON_DEPLETED_STORAGE);
+		return;
+	}
+
+	/* The signal is addressed to the previous custodian (and may refer */
+	/* to its CTEB), thus, it has to be sent before taking over custody */
+	send_custody_signal(bundle, BUNDLE_CS_TYPE_ACCEPTANCE,
+		BUNDLE_CS_REASON_NO_INFO);
 	if (custody_manager_accept(bundle) != UPCN_OK) {
 		/* TODO */
 		return;
@@ -645,8 +624,6 @@ static void bundle_custody_accept(struct bundle *bundle)
 		send_status_report(bundle, BUNDLE_SR_FLAG_CUSTODY_TRANSFER,
 			BUNDLE_SR_REASON_NO_INFO);
 	}
-	send_custody_signal(bundle, BUNDLE_CS_TYPE_ACCEPTANCE,
-		BUNDLE_CS_REASON_NO_INFO);
 }
 
 /* 5.11 */
@@ -719,6 +696,31 @@ static void bundle_handle_custody_signal(
 		bundle_custody_failure(bundle, signal->custody_signal->reason);
 }
 
+static void handle_aggregated_bundle(struct bundle *bundle, void *param)
+{
+	const struct bundle_custody_signal *signal =
+		(const struct bundle_custody_signal *)param;
+
+	if (signal->type == BUNDLE_CS_TYPE_ACCEPTANCE)
+		bundle_custody_success(bundle);
+	else
+		bundle_custody_failure(bundle, signal->reason);
+}
+
+/* CCSDS 734.2-B-1 */
+static void bundle_handle_aggregate_custody_signal(
+	struct bundle_administrative_record *signal)
+{
+	uint32_t i;
+
+	for (i = 0; i < signal->acs_fill_count; i++)
+		custody_manager_for_each_in_fill(
+			&signal->acs_fills[i],
+			handle_aggregated_bundle,
+			signal->custody_signal
+		);
+}
+
 /* RE-SCHEDULING */
 static void bundle_dangling(struct bundle *bundle)
 {
@@ -781,7 +783,23 @@ static void send_custody_signal(struct bundle *bundle,
 		.reason = reason,
 	};
 	struct bundle_list *next;
-	struct bundle_list *signals = generate_custody_signal(
+	struct bundle_list *signals;
+	uint64_t custody_id;
+
+	/* Aggregate the signal if the custodian provided a custody ID */
+	if (bundle6_cteb_get_custody_id(bundle, &custody_id) &&
+			custody_aggregator_add(
+				custody_aggregator,
+				bundle->current_custodian,
+				&signal,
+				custody_id,
+				hal_time_get_timestamp_ms() + CUSTODY_ACS_DELAY
+			) == UPCN_OK) {
+		send_due_custody_signals();
+		return;
+	}
+
+	signals = generate_custody_signal(
 		bundle,
 		&signal,
 		local_eid
@@ -801,6 +819,31 @@ static void send_custody_signal(struct bundle *bundle,
 	}
 }
 
+static void send_due_custody_signals(void)
+{
+	const uint64_t now = hal_time_get_timestamp_ms();
+	struct custody_aggregate *aggregate;
+	struct bundle *b;
+
+	while ((aggregate = custody_aggregator_pop_due(custody_aggregator,
+						       now)) != NULL) {
+		b = generate_aggregate_custody_signal(
+			aggregate->custodian,
+			&aggregate->signal,
+			aggregate->fills,
+			aggregate->fill_count,
+			local_eid
+		);
+		if (b != NULL) {
+			bundle_add_rc(b,
+				BUNDLE_RET_CONSTRAINT_DISPATCH_PENDING);
+			bundle_storage_add(b);
+			bundle_forward(b);
+		}
+		custody_aggregate_free(aggregate);
+	}
+}
+
 static enum upcn_result send_bundle(bundleid_t bundle, uint16_t timeout)
 {
 	struct router_signal signal = {
@@ -845,7 +888,13 @@ static struct bundle_block *find_block_by_type(struct bundle_block_list *blocks,
  */
 static bool hop_count_validation(struct bundle *bundle)
 {
-	struct bundle_block *block = find_block_by_type(bundle->blocks,
+	struct bundle_block *block;
+
+	/* RFC 5050 uses the same block type for the CTEB */
+	if (bundle->protocol_version != 7)
+		return true;
+
+	block = find_block_by_type(bundle->blocks,
 		BUNDLE_BLOCK_TYPE_HOP_COUNT);
 
 	/* No Hop Count block was found */
@@ -913,93 +962,89 @@ static const char *get_agent_id(const char *dest_eid)
 	return &dest_eid[local_len + 1];
 }
 
-// Checks whether we know the bundle. If not, adds it to the list.
+static struct bundle_unique_identifier get_identifier(
+	const struct bundle *bundle, size_t payload_length)
+{
+	// The source EID is not copied for the lookup
+	return (struct bundle_unique_identifier){
+		.protocol_version = bundle->protocol_version,
+		.source = bundle->source,
+		.creation_timestamp = bundle->creation_timestamp,
+		.sequence_number = bundle->sequence_number,
+		.fragment_offset = bundle->fragment_offset,
+		.payload_length = payload_length
+	};
+}
+
+// Checks whether we know the bundle. If not, adds it to the set.
 static bool bundle_record_add_and_check_known(const struct bundle *bundle)
 {
-	struct known_bundle_list **cur_entry = &known_bundle_list;
-	uint64_t cur_time = hal_time_get_timestamp_s();
+	const uint64_t cur_time = hal_time_get_timestamp_s_coarse();
 	const uint64_t bundle_deadline = bundle_get_expiration_time(bundle);
+	const struct bundle_unique_identifier id = get_identifier(
+		bundle, bundle->payload_block->length);
+	bool known;
 
 	if (bundle_deadline < cur_time)
 		return true; // We assume we "know" all expired bundles.
-	// 1. Cleanup and search
-	while (*cur_entry != NULL) {
-		struct known_bundle_list *e = *cur_entry;
-
-		if (bundle_is_equal(bundle, &e->id)) {
-			return true;
-		} else if (e->deadline < cur_time) {
-			*cur_entry = e->next;
-			bundle_free_unique_identifier(&e->id);
-			free(e);
-			continue;
-		} else if (e->deadline > bundle_deadline) {
-			// Won't find, insert here!
-			break;
-		}
-		cur_entry = &(*cur_entry)->next;
-	}
+	hal_semaphore_take_blocking(known_bundles_sem);
+	known_bundle_set_expire(known_bundles, cur_time);
+	known = known_bundle_set_contains(known_bundles, &id);
+	if (!known)
+		known_bundle_set_add(known_bundles, &id, bundle_deadline);
+	hal_semaphore_release(known_bundles_sem);
+	return known;
+}
 
-	// 2. If not found, add at current slot (ordered by deadline)
-	struct known_bundle_list *new_entry = malloc(
-		sizeof(struct known_bundle_list)
-	);
+bool bundle_processor_is_known(const struct bundle *bundle,
+	size_t payload_length)
+{
+	const struct bundle_unique_identifier id = get_identifier(
+		bundle, payload_length);
+	bool known;
 
-	if (!new_entry)
+	// The bundle processor task may not have been started yet
+	if (known_bundles == NULL)
 		return false;
-	new_entry->id = bundle_get_unique_identifier(bundle);
-	new_entry->deadline = bundle_deadline;
-	new_entry->next = *cur_entry;
-	*cur_entry = new_entry;
+	hal_semaphore_take_blocking(known_bundles_sem);
+	known = known_bundle_set_contains(known_bundles, &id);
+	hal_semaphore_release(known_bundles_sem);
+	return known;
+}
 
-	return false;
+// The reassembled bundle is recorded as one spanning the whole ADU.
+static struct bundle_unique_identifier get_reassembled_identifier(
+	const struct bundle *bundle)
+{
+	return (struct bundle_unique_identifier){
+		.protocol_version = bundle->protocol_version,
+		.source = bundle->source,
+		.creation_timestamp = bundle->creation_timestamp,
+		.sequence_number = bundle->sequence_number,
+		.fragment_offset = 0,
+		.payload_length = bundle->total_adu_length
+	};
 }
 
 static bool bundle_reassembled_is_known(const struct bundle *bundle)
 {
-	struct known_bundle_list **cur_entry = &known_bundle_list;
-	const uint64_t bundle_deadline = bundle_get_expiration_time(bundle);
-
-	while (*cur_entry != NULL) {
-		struct known_bundle_list *e = *cur_entry;
-
-		if (bundle_is_equal_parent(bundle, &e->id) &&
-				e->id.fragment_offset == 0 &&
-				e->id.payload_length ==
-					bundle->total_adu_length) {
-			return true;
-		} else if (e->deadline > bundle_deadline) {
-			// Won't find...
-			break;
-		}
-		cur_entry = &(*cur_entry)->next;
-	}
-	return false;
+	const struct bundle_unique_identifier id =
+		get_reassembled_identifier(bundle);
+	bool known;
+
+	hal_semaphore_take_blocking(known_bundles_sem);
+	known = known_bundle_set_contains(known_bundles, &id);
+	hal_semaphore_release(known_bundles_sem);
+	return known;
 }
 
 static void bundle_add_reassembled_as_known(const struct bundle *bundle)
 {
-	struct known_bundle_list **cur_entry = &known_bundle_list;
-	const uint64_t bundle_deadline = bundle_get_expiration_time(bundle);
-
-	while (*cur_entry != NULL) {
-		struct known_bundle_list *e = *cur_entry;
-
-		if (e->deadline > bundle_deadline)
-			break;
-		cur_entry = &(*cur_entry)->next;
-	}
-
-	struct known_bundle_list *new_entry = malloc(
-		sizeof(struct known_bundle_list)
-	);
+	const struct bundle_unique_identifier id =
+		get_reassembled_identifier(bundle);
 
-	if (!new_entry)
-		return;
-	new_entry->id = bundle_get_unique_identifier(bundle);
-	new_entry->id.fragment_offset = 0;
-	new_entry->id.payload_length = bundle->total_adu_length;
-	new_entry->deadline = bundle_deadline;
-	new_entry->next = *cur_entry;
-	*cur_entry = new_entry;
+	hal_semaphore_take_blocking(known_bundles_sem);
+	known_bundle_set_add(known_bundles, &id,
+			     bundle_get_expiration_time(bundle));
+	hal_semaphore_release(known_bundles_sem);
 }
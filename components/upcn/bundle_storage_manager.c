@@ -276,12 +276,11 @@ static uint8_t add_node(bundleid_t id, struct bundle *bundle)
 
 static uint32_t bundle_bytes;
 
-bundleid_t bundle_storage_add(struct bundle *bundle)
+static bundleid_t add_bundle(struct bundle *bundle)
 {
 	bundleid_t id = next_id++;
 
 	ASSERT(bundle->id == INV_ID);
-	lock_tree();
 	/* TODO: This is not very efficient; */
 	/* A precalculated list of free ids should be used */
 	while (id == INV_ID || find_nodeptr(id, 0) != NULL)
@@ -294,10 +293,34 @@ bundleid_t bundle_storage_add(struct bundle *bundle)
 	} else {
 		id = BUNDLE_INVALID_ID;
 	}
+	return id;
+}
+
+bundleid_t bundle_storage_add(struct bundle *bundle)
+{
+	bundleid_t id;
+
+	lock_tree();
+	id = add_bundle(bundle);
 	unlock_tree();
 	return id;
 }
 
+uint16_t bundle_storage_add_batch(struct bundle *const bundles[],
+	bundleid_t ids[], uint16_t count)
+{
+	uint16_t i, stored = 0;
+
+	lock_tree();
+	for (i = 0; i < count; i++) {
+		ids[i] = add_bundle(bundles[i]);
+		if (ids[i] != INV_ID)
+			stored++;
+	}
+	unlock_tree();
+	return stored;
+}
+
 int8_t bundle_storage_contains(bundleid_t id)
 {
 	struct node **node;
@@ -1,5 +1,6 @@
 #include "upcn/common.h"
 #include "upcn/contact_manager.h"
+#include "upcn/contact_schedule.h"
 #include "upcn/router_task.h"
 #include "upcn/node.h"
 #include "upcn/task_tags.h"
@@ -24,7 +25,6 @@ struct contact_manager_task_parameters {
 	Semaphore_t semaphore;
 	QueueIdentifier_t control_queue;
 	QueueIdentifier_t router_signaling_queue;
-	struct contact_list **contact_list_ptr;
 };
 
 struct contact_info {
@@ -38,17 +38,6 @@ static struct contact_info current_contacts[MAX_CONCURRENT_CONTACTS];
 static int8_t current_contact_count;
 static uint64_t next_contact_time = UINT64_MAX;
 
-static bool contact_active(const struct contact *contact)
-{
-	int8_t i;
-
-	for (i = 0; i < current_contact_count; i++) {
-		if (current_contacts[i].contact == contact)
-			return true;
-	}
-	return false;
-}
-
 static int8_t remove_expired_contacts(
 	const uint64_t current_timestamp, struct contact_info list[])
 {
@@ -79,16 +68,13 @@ static uint8_t check_upcoming(
 	struct contact *c, struct contact_info list[], const uint8_t index)
 {
 	// Contact is already active, do nothing
-	if (contact_active(c))
+	if (c->active)
 		return 0;
 
 	// Too many contacts are already active, cannot add another...
 	if (current_contact_count >= MAX_CONCURRENT_CONTACTS)
 		return 0;
 
-	/* Set "active" constraint, "blocking" the contact */
-	c->active = 1;
-
 	ASSERT(c->node->cla_addr != NULL);
 	// Try to obtain a handler
 	struct cla_config *cla_config = cla_config_get(
@@ -119,38 +105,31 @@ static uint8_t check_upcoming(
 		free(current_contacts[current_contact_count].eid);
 		return 0;
 	}
+	/* Set "active" constraint, "blocking" the contact */
+	c->active = 1;
 	list[index] = current_contacts[current_contact_count];
 	current_contact_count++;
 
 	return 1;
 }
 
-static int8_t process_upcoming_list(
-	struct contact_list *contact_list, const uint64_t current_timestamp,
-	struct contact_info list[])
+static int8_t process_started_contacts(
+	const uint64_t current_timestamp, struct contact_info list[])
 {
-	int8_t added = 0;
-	struct contact_list *cur_entry;
-
-	next_contact_time = UINT64_MAX;
-	cur_entry = contact_list;
-	while (cur_entry != NULL) {
-		if (cur_entry->data->from <= current_timestamp) {
-			if (cur_entry->data->to > current_timestamp) {
-				added += check_upcoming(
-					cur_entry->data, list, added);
-				if (cur_entry->data->to < next_contact_time)
-					next_contact_time = cur_entry->data->to;
-			}
-		} else {
-			if (cur_entry->data->from < next_contact_time)
-				next_contact_time = cur_entry->data->from;
-			/* As our contact_list is sorted ascending by */
-			/* from-time we can stop checking here */
-			break;
-		}
-		cur_entry = cur_entry->next;
-	}
+	int8_t added = 0, i;
+	struct contact *const *started;
+	uint32_t started_count, c;
+
+	contact_schedule_advance(current_timestamp);
+	/* Contacts which could not be activated yet are retried here */
+	started = contact_schedule_get_started(&started_count);
+	for (c = 0; c < started_count; c++)
+		added += check_upcoming(started[c], list, added);
+	next_contact_time = contact_schedule_next_event();
+	/* Active contacts may have been removed from the schedule */
+	for (i = 0; i < current_contact_count; i++)
+		next_contact_time = MIN(next_contact_time,
+					current_contacts[i].contact->to);
 	return added;
 }
 
@@ -163,7 +142,7 @@ static void hand_over_contact_bundles(struct contact_info c)
 	};
 
 	ASSERT(c.contact != NULL);
-	if (c.contact->contact_bundles == NULL)
+	if (c.contact->bundle_count == 0)
 		return;
 
 	struct cla_tx_queue tx_queue = c.cla_conf->vtable->cla_get_tx_queue(
@@ -182,8 +161,8 @@ static void hand_over_contact_bundles(struct contact_info c)
 
 	LOGF("ContactManager: Queuing bundles for contact with \"%s\".", c.eid);
 
-	command.bundles = c.contact->contact_bundles;
-	c.contact->contact_bundles = NULL;
+	/* The TX task receives the bundles in the order of their priority */
+	command.bundles = contact_take_bundles(c.contact);
 	hal_queue_push_to_back(tx_queue.tx_queue_handle, &command);
 	hal_semaphore_release(tx_queue.tx_queue_sem); // taken by get_tx_queue
 }
@@ -196,8 +175,7 @@ static void process_current_contacts(void)
 		hand_over_contact_bundles(current_contacts[i]);
 }
 
-static uint8_t check_for_contacts(struct contact_list *contact_list,
-	struct contact_info removed_contacts[])
+static uint8_t check_for_contacts(struct contact_info removed_contacts[])
 {
 	int8_t i;
 	static struct contact_info added_contacts[MAX_CONCURRENT_CONTACTS];
@@ -206,8 +184,7 @@ static uint8_t check_for_contacts(struct contact_list *contact_list,
 		current_timestamp,
 		removed_contacts
 	);
-	int8_t added_count = process_upcoming_list(
-		contact_list,
+	int8_t added_count = process_started_contacts(
 		current_timestamp,
 		added_contacts
 	);
@@ -251,10 +228,10 @@ static void inform_router(
 	hal_queue_push_to_back(queue, &signal);
 }
 
-/* We assume that contact_list will not change. */
+/* The contact schedule is only modified while holding the semaphore. */
 static void manage_contacts(
-	struct contact_list **contact_list, enum contact_manager_signal signal,
-	Semaphore_t semphr, QueueIdentifier_t queue)
+	enum contact_manager_signal signal, Semaphore_t semphr,
+	QueueIdentifier_t queue)
 {
 	static struct contact_info rem[MAX_CONCURRENT_CONTACTS];
 	int8_t removed, i;
@@ -269,7 +246,7 @@ static void manage_contacts(
 		hal_semaphore_release(semphr);
 		return;
 	}
-	removed = check_for_contacts(*contact_list, rem);
+	removed = check_for_contacts(rem);
 	hal_semaphore_release(semphr);
 	for (i = 0; i < removed; i++) {
 		/* The contact has to be deleted first... */
@@ -291,8 +268,7 @@ static void contact_manager_task(void *cm_parameters)
 		hal_platform_led_set((led_state = 1 - led_state) + 3);
 
 		if (signal != CM_SIGNAL_NONE) { /* TODO: end by query to BP */
-			manage_contacts(parameters->contact_list_ptr, signal,
-				parameters->semaphore,
+			manage_contacts(signal, parameters->semaphore,
 				parameters->router_signaling_queue);
 		}
 		signal = CM_SIGNAL_UNKNOWN;
@@ -313,8 +289,7 @@ static void contact_manager_task(void *cm_parameters)
 }
 
 struct contact_manager_params contact_manager_start(
-	QueueIdentifier_t router_signaling_queue,
-	struct contact_list **clistptr)
+	QueueIdentifier_t router_signaling_queue)
 {
 	struct contact_manager_params ret = {
 		.semaphore = NULL,
@@ -341,7 +316,6 @@ struct contact_manager_params contact_manager_start(
 	cmt_params->semaphore = semaphore;
 	cmt_params->control_queue = queue;
 	cmt_params->router_signaling_queue = router_signaling_queue;
-	cmt_params->contact_list_ptr = clistptr;
 	hal_task_create(contact_manager_task,
 			"cont_man_t",
 			CONTACT_MANAGER_TASK_PRIORITY,
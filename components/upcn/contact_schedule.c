@@ -0,0 +1,180 @@
+#include "upcn/common.h"
+#include "upcn/contact_schedule.h"
+#include "upcn/node.h"
+#include "upcn/result.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define INITIAL_HEAP_CAPACITY 16
+
+struct schedule_heap {
+	struct contact **items;
+	uint32_t count;
+	uint32_t capacity;
+	// The state of all contacts in the heap, determining the key
+	enum contact_schedule_state state;
+};
+
+static struct schedule_heap upcoming = { .state = CONTACT_UPCOMING };
+static struct schedule_heap started = { .state = CONTACT_STARTED };
+
+static inline uint64_t heap_key(const struct schedule_heap *heap,
+				const uint32_t i)
+{
+	if (heap->state == CONTACT_UPCOMING)
+		return heap->items[i]->from;
+	return heap->items[i]->to;
+}
+
+static inline void heap_set(struct schedule_heap *heap, const uint32_t i,
+			    struct contact *contact)
+{
+	heap->items[i] = contact;
+	contact->schedule_index = i;
+}
+
+static void heap_sift_up(struct schedule_heap *heap, uint32_t i)
+{
+	struct contact *const contact = heap->items[i];
+
+	while (i > 0) {
+		const uint32_t parent = (i - 1) / 2;
+
+		if (heap_key(heap, parent) <= heap_key(heap, i))
+			break;
+		heap_set(heap, i, heap->items[parent]);
+		heap_set(heap, parent, contact);
+		i = parent;
+	}
+}
+
+static void heap_sift_down(struct schedule_heap *heap, uint32_t i)
+{
+	struct contact *const contact = heap->items[i];
+
+	for (;;) {
+		const uint32_t l = 2 * i + 1, r = 2 * i + 2;
+		uint32_t min = i;
+
+		if (l < heap->count && heap_key(heap, l) < heap_key(heap, min))
+			min = l;
+		if (r < heap->count && heap_key(heap, r) < heap_key(heap, min))
+			min = r;
+		if (min == i)
+			break;
+		heap_set(heap, i, heap->items[min]);
+		heap_set(heap, min, contact);
+		i = min;
+	}
+}
+
+static enum upcn_result heap_push(struct schedule_heap *heap,
+				  struct contact *contact)
+{
+	if (heap->count == heap->capacity) {
+		const uint32_t new_capacity = heap->capacity
+			? heap->capacity * 2
+			: INITIAL_HEAP_CAPACITY;
+		struct contact **const new_items = realloc(
+			heap->items,
+			sizeof(struct contact *) * new_capacity
+		);
+
+		if (!new_items)
+			return UPCN_FAIL;
+		heap->items = new_items;
+		heap->capacity = new_capacity;
+	}
+	heap_set(heap, heap->count, contact);
+	contact->schedule_state = heap->state;
+	heap_sift_up(heap, heap->count++);
+	return UPCN_OK;
+}
+
+static void heap_remove(struct schedule_heap *heap, const uint32_t i)
+{
+	struct contact *moved;
+
+	ASSERT(i < heap->count);
+	heap->items[i]->schedule_state = CONTACT_UNSCHEDULED;
+	if (i == --heap->count)
+		return;
+	moved = heap->items[heap->count];
+	heap_set(heap, i, moved);
+	// The moved contact may belong either above or below the gap
+	heap_sift_up(heap, i);
+	if (moved->schedule_index == i)
+		heap_sift_down(heap, i);
+}
+
+static void heap_free(struct schedule_heap *heap)
+{
+	while (heap->count != 0)
+		heap_remove(heap, heap->count - 1);
+	free(heap->items);
+	heap->items = NULL;
+	heap->capacity = 0;
+}
+
+void contact_schedule_free(void)
+{
+	heap_free(&upcoming);
+	heap_free(&started);
+}
+
+enum upcn_result contact_schedule_add(struct contact *contact)
+{
+	ASSERT(contact != NULL);
+	if (contact->schedule_state != CONTACT_UNSCHEDULED)
+		return UPCN_OK;
+	return heap_push(&upcoming, contact);
+}
+
+void contact_schedule_remove(struct contact *contact)
+{
+	ASSERT(contact != NULL);
+	switch (contact->schedule_state) {
+	case CONTACT_UPCOMING:
+		heap_remove(&upcoming, contact->schedule_index);
+		break;
+	case CONTACT_STARTED:
+		heap_remove(&started, contact->schedule_index);
+		break;
+	default:
+		break;
+	}
+}
+
+void contact_schedule_advance(uint64_t time)
+{
+	struct contact *contact;
+
+	while (upcoming.count != 0 && upcoming.items[0]->from <= time) {
+		contact = upcoming.items[0];
+		heap_remove(&upcoming, 0);
+		// If the started set cannot grow, the contact is dropped
+		// from the schedule like an ended contact.
+		if (contact->to > time)
+			heap_push(&started, contact);
+	}
+	while (started.count != 0 && started.items[0]->to <= time)
+		heap_remove(&started, 0);
+}
+
+struct contact *const *contact_schedule_get_started(uint32_t *count)
+{
+	*count = started.count;
+	return started.items;
+}
+
+uint64_t contact_schedule_next_event(void)
+{
+	uint64_t next = UINT64_MAX;
+
+	if (upcoming.count != 0)
+		next = upcoming.items[0]->from;
+	if (started.count != 0)
+		next = MIN(next, started.items[0]->to);
+	return next;
+}
@@ -14,6 +14,11 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif // __SSE4_2__
 
 
 /**
@@ -288,17 +293,107 @@ uint32_t crc32(const uint8_t *data, size_t len)
 }
 
 
+/*
+ * Block kernels
+ *
+ * The following functions update a CRC remainder for a whole byte array and
+ * optionally copy the array to "dst" in the same pass. Keeping the remainder
+ * in a register avoids the indirect "feed()" call and the store to the stream
+ * for every byte. The "dst" check is loop-invariant and thus cheap.
+ */
+static uint32_t crc16_x25_update(uint32_t crc, uint8_t *dst,
+	const uint8_t *src, size_t len)
+{
+	uint8_t byte;
+
+	while (len--) {
+		byte = *src++;
+		if (dst != NULL)
+			*dst++ = byte;
+		crc = (crc >> 8) ^ crc16_x25_table[(crc ^ byte) & 0xff];
+	}
+	return crc;
+}
+
+static uint32_t crc16_ccitt_false_update(uint32_t crc, uint8_t *dst,
+	const uint8_t *src, size_t len)
+{
+	uint8_t byte;
+
+	while (len--) {
+		byte = *src++;
+		if (dst != NULL)
+			*dst++ = byte;
+		crc = ((crc << 8) & 0xff00)
+			^ crc16_ccitt_false_table[((crc >> 8) ^ byte) & 0xff];
+	}
+	return crc;
+}
+
+static uint32_t crc32_update(uint32_t crc, uint8_t *dst,
+	const uint8_t *src, size_t len)
+{
+	uint8_t byte;
+
+#ifdef __SSE4_2__
+	// The SSE 4.2 CRC32 instruction implements exactly the reflected
+	// CRC-32-C without initial value and final XOR.
+	uint64_t word;
+
+	while (len >= sizeof(word)) {
+		memcpy(&word, src, sizeof(word));
+		if (dst != NULL) {
+			memcpy(dst, &word, sizeof(word));
+			dst += sizeof(word);
+		}
+		crc = (uint32_t)_mm_crc32_u64(crc, word);
+		src += sizeof(word);
+		len -= sizeof(word);
+	}
+#endif // __SSE4_2__
+
+	while (len--) {
+		byte = *src++;
+		if (dst != NULL)
+			*dst++ = byte;
+		crc = (crc >> 8) ^ crc32_table[(crc ^ byte) & 0xff];
+	}
+	return crc;
+}
+
+static void crc_update(struct crc_stream *crc, uint8_t *dst,
+	const uint8_t *src, size_t len)
+{
+	switch (crc->version) {
+	case CRC16_X25:
+		crc->checksum = crc16_x25_update(crc->checksum, dst, src, len);
+		break;
+	case CRC16_CCITT_FALSE:
+		crc->checksum = crc16_ccitt_false_update(crc->checksum,
+			dst, src, len);
+		break;
+	default:
+		crc->checksum = crc32_update(crc->checksum, dst, src, len);
+		break;
+	}
+}
+
 void crc_feed_bytes(struct crc_stream *crc, const uint8_t *data, size_t len)
 {
-	const uint8_t *p = data;
+	crc_update(crc, NULL, data, len);
+}
 
-	while (len--)
-		crc->feed(crc, *p++);
+void crc_copy_bytes(struct crc_stream *crc, uint8_t *dst, const uint8_t *src,
+	size_t len)
+{
+	crc_update(crc, dst, src, len);
 }
 
 
 void crc_init(struct crc_stream *crc, enum crc_version version)
 {
+	crc->version = version;
+
 	// Set initial values and callback functions
 	switch (version) {
 	case CRC16_X25:
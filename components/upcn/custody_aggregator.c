@@ -0,0 +1,199 @@
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/custody_aggregator.h"
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_FILL_CAPACITY 8
+
+struct custody_aggregator {
+	struct custody_aggregate *aggregates;
+	uint32_t max_fills;
+};
+
+/* FILLS */
+
+// Returns the index of the first fill starting after the given ID
+static uint32_t fill_find(const struct custody_aggregate *a,
+			  const uint64_t custody_id)
+{
+	uint32_t lo = 0, hi = a->fill_count;
+
+	while (lo < hi) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+
+		if (a->fills[mid].start <= custody_id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static enum upcn_result fill_add(struct custody_aggregate *a,
+				 const uint64_t custody_id)
+{
+	const uint32_t i = fill_find(a, custody_id);
+	struct bundle_acs_fill *const prev = (i != 0) ? &a->fills[i - 1] : NULL;
+	struct bundle_acs_fill *const next = (i != a->fill_count)
+		? &a->fills[i] : NULL;
+	bool extends_prev, extends_next;
+
+	if (prev && custody_id - prev->start < prev->length)
+		return UPCN_OK; // already contained
+	extends_prev = prev && prev->start + prev->length == custody_id;
+	extends_next = next && next->start - 1 == custody_id;
+
+	if (extends_prev && extends_next) {
+		prev->length += 1 + next->length;
+		memmove(&a->fills[i], &a->fills[i + 1],
+			sizeof(struct bundle_acs_fill) * (a->fill_count - i - 1));
+		a->fill_count--;
+		return UPCN_OK;
+	} else if (extends_prev) {
+		prev->length++;
+		return UPCN_OK;
+	} else if (extends_next) {
+		next->start--;
+		next->length++;
+		return UPCN_OK;
+	}
+
+	if (a->fill_count == a->fill_capacity) {
+		const uint32_t new_capacity = a->fill_capacity * 2;
+		struct bundle_acs_fill *const new_fills = realloc(
+			a->fills,
+			sizeof(struct bundle_acs_fill) * new_capacity
+		);
+
+		if (!new_fills)
+			return UPCN_FAIL;
+		a->fills = new_fills;
+		a->fill_capacity = new_capacity;
+	}
+	memmove(&a->fills[i + 1], &a->fills[i],
+		sizeof(struct bundle_acs_fill) * (a->fill_count - i));
+	a->fills[i] = (struct bundle_acs_fill){
+		.start = custody_id,
+		.length = 1,
+	};
+	a->fill_count++;
+	return UPCN_OK;
+}
+
+/* AGGREGATES */
+
+static struct custody_aggregate *aggregate_create(
+	const char *custodian, const struct bundle_custody_signal *signal,
+	const uint64_t deadline)
+{
+	struct custody_aggregate *a = malloc(sizeof(struct custody_aggregate));
+
+	if (!a)
+		return NULL;
+	a->custodian = strdup(custodian);
+	a->signal = *signal;
+	a->deadline = deadline;
+	a->fill_count = 0;
+	a->fill_capacity = INITIAL_FILL_CAPACITY;
+	a->fills = malloc(sizeof(struct bundle_acs_fill) * a->fill_capacity);
+	a->next = NULL;
+	if (!a->custodian || !a->fills) {
+		custody_aggregate_free(a);
+		return NULL;
+	}
+	return a;
+}
+
+void custody_aggregate_free(struct custody_aggregate *aggregate)
+{
+	if (!aggregate)
+		return;
+	free(aggregate->custodian);
+	free(aggregate->fills);
+	free(aggregate);
+}
+
+struct custody_aggregator *custody_aggregator_create(uint32_t max_fills)
+{
+	struct custody_aggregator *aggregator =
+		malloc(sizeof(struct custody_aggregator));
+
+	if (!aggregator)
+		return NULL;
+	aggregator->aggregates = NULL;
+	aggregator->max_fills = max_fills;
+	return aggregator;
+}
+
+void custody_aggregator_free(struct custody_aggregator *aggregator)
+{
+	if (!aggregator)
+		return;
+	while (aggregator->aggregates != NULL) {
+		struct custody_aggregate *const a = aggregator->aggregates;
+
+		aggregator->aggregates = a->next;
+		custody_aggregate_free(a);
+	}
+	free(aggregator);
+}
+
+enum upcn_result custody_aggregator_add(
+	struct custody_aggregator *aggregator, const char *custodian,
+	const struct bundle_custody_signal *signal, uint64_t custody_id,
+	uint64_t deadline)
+{
+	struct custody_aggregate *a;
+
+	// Only few custodians are expected at a time
+	for (a = aggregator->aggregates; a != NULL; a = a->next) {
+		if (a->signal.type == signal->type &&
+				a->signal.reason == signal->reason &&
+				strcmp(a->custodian, custodian) == 0)
+			break;
+	}
+	if (a == NULL) {
+		a = aggregate_create(custodian, signal, deadline);
+		if (!a)
+			return UPCN_FAIL;
+		a->next = aggregator->aggregates;
+		aggregator->aggregates = a;
+	}
+	return fill_add(a, custody_id);
+}
+
+uint64_t custody_aggregator_next_deadline(
+	const struct custody_aggregator *aggregator)
+{
+	const struct custody_aggregate *a;
+	uint64_t result = UINT64_MAX;
+
+	for (a = aggregator->aggregates; a != NULL; a = a->next)
+		result = MIN(result, a->deadline);
+	return result;
+}
+
+struct custody_aggregate *custody_aggregator_pop_due(
+	struct custody_aggregator *aggregator, uint64_t cur_time)
+{
+	struct custody_aggregate **cur = &aggregator->aggregates;
+
+	while (*cur != NULL) {
+		struct custody_aggregate *const a = *cur;
+
+		if (a->deadline <= cur_time ||
+				a->fill_count >= aggregator->max_fills) {
+			*cur = a->next;
+			a->next = NULL;
+			return a;
+		}
+		cur = &a->next;
+	}
+	return NULL;
+}
@@ -5,55 +5,174 @@
 #include "upcn/custody_manager.h"
 
 #include "bundle6/bundle6.h"
+#include "bundle6/cteb.h"
 #include "bundle7/bundle7.h"
 
+#include "platform/hal_io.h"
+
+#include "util/htab_hash.h"
+
 #include <stdlib.h>
 #include <string.h>
 
+#define INITIAL_SLOT_COUNT 16
+
+struct custody_entry {
+	struct bundle *bundle;
+	uint64_t custody_id;
+	uint32_t hash;
+	// Serialized size at the time custody was accepted
+	size_t size;
 
-static struct bundle *accepted_bundles[CUSTODY_MAX_BUNDLE_COUNT];
-static int accepted_bundle_count;
+	struct custody_entry *next_by_bundle;
+	struct custody_entry *next_by_id;
+};
+
+/*
+ * All accepted bundles are indexed twice: By a hash over the bundle
+ * identifier (for duplicate detection and RFC 5050 custody signals) and
+ * by the custody ID we assigned (for Aggregate Custody Signals). Both tables
+ * have the same power-of-two slot count. As custody IDs are assigned
+ * sequentially, their lower bits are used as hash.
+ */
+static struct custody_entry **by_bundle;
+static struct custody_entry **by_id;
+static uint32_t slot_count;
+static uint32_t entry_count;
+static size_t stored_bytes;
+static uint64_t next_custody_id = 1;
 
 static const char *upcn_eid;
 
-static int get_index(struct bundle *bundle)
+static uint32_t identifier_hash(uint64_t creation_timestamp,
+	uint64_t sequence_number, const char *source_eid)
 {
-	int i;
+	const uint64_t fields[] = { creation_timestamp, sequence_number };
+	const uint32_t h = hashlittle(source_eid, strlen(source_eid), 0);
 
-	for (i = 0; i < accepted_bundle_count; i++) {
-		if (accepted_bundles[i] == bundle)
-			return i;
-	}
-	return -1;
+	return hashlittle(fields, sizeof(fields), h);
 }
 
-static int find(uint64_t creation_timestamp, uint16_t sequence_number,
-	char *source_eid, uint32_t fragment_offset, uint32_t fragment_length)
+static inline struct custody_entry **bundle_slot(uint32_t hash)
 {
-	int i;
+	return &by_bundle[hash & (slot_count - 1)];
+}
+
+static inline struct custody_entry **id_slot(uint64_t custody_id)
+{
+	return &by_id[custody_id & (slot_count - 1)];
+}
+
+static struct custody_entry *find(uint64_t creation_timestamp,
+	uint64_t sequence_number, char *source_eid, uint32_t fragment_offset,
+	uint32_t fragment_length)
+{
+	const uint32_t hash = identifier_hash(creation_timestamp,
+					      sequence_number, source_eid);
+	struct custody_entry *e;
 	struct bundle *b;
 
-	for (i = 0; i < accepted_bundle_count; i++) {
-		b = accepted_bundles[i];
+	for (e = *bundle_slot(hash); e != NULL; e = e->next_by_bundle) {
+		b = e->bundle;
 		if (
-			b->creation_timestamp == creation_timestamp
+			e->hash == hash
+			&& b->creation_timestamp == creation_timestamp
 			&& b->sequence_number == sequence_number
 			&& strcmp(b->source, source_eid) == 0
 			&& (!bundle_is_fragmented(b)
 				|| (b->fragment_offset == fragment_offset
 				&& b->payload_block->length == fragment_length))
 		) {
-			return i;
+			return e;
+		}
+	}
+	return NULL;
+}
+
+static struct custody_entry **find_by_pointer(struct bundle *bundle)
+{
+	struct custody_entry **cur = bundle_slot(identifier_hash(
+		bundle->creation_timestamp,
+		bundle->sequence_number,
+		bundle->source
+	));
+
+	while (*cur != NULL && (*cur)->bundle != bundle)
+		cur = &(*cur)->next_by_bundle;
+	return cur;
+}
+
+static struct custody_entry *find_by_custody_id(uint64_t custody_id)
+{
+	struct custody_entry *e;
+
+	for (e = *id_slot(custody_id); e != NULL; e = e->next_by_id) {
+		if (e->custody_id == custody_id)
+			return e;
+	}
+	return NULL;
+}
+
+static void insert(struct custody_entry *e)
+{
+	struct custody_entry **const bslot = bundle_slot(e->hash);
+	struct custody_entry **const islot = id_slot(e->custody_id);
+
+	e->next_by_bundle = *bslot;
+	*bslot = e;
+	e->next_by_id = *islot;
+	*islot = e;
+	entry_count++;
+}
+
+static void remove_by_id(struct custody_entry *e)
+{
+	struct custody_entry **cur = id_slot(e->custody_id);
+
+	while (*cur != e)
+		cur = &(*cur)->next_by_id;
+	*cur = e->next_by_id;
+}
+
+static void grow(void)
+{
+	const uint32_t old_count = slot_count;
+	struct custody_entry **const old_slots = by_bundle;
+	struct custody_entry **new_by_bundle, **new_by_id;
+	uint32_t i;
+
+	if (old_count > UINT32_MAX / 2)
+		return;
+	new_by_bundle = calloc(old_count * 2, sizeof(struct custody_entry *));
+	new_by_id = calloc(old_count * 2, sizeof(struct custody_entry *));
+	// Keep the old tables, the chains just get longer
+	if (!new_by_bundle || !new_by_id) {
+		free(new_by_bundle);
+		free(new_by_id);
+		return;
+	}
+
+	free(by_id);
+	by_bundle = new_by_bundle;
+	by_id = new_by_id;
+	slot_count = old_count * 2;
+	entry_count = 0;
+	for (i = 0; i < old_count; i++) {
+		while (old_slots[i] != NULL) {
+			struct custody_entry *const e = old_slots[i];
+
+			old_slots[i] = e->next_by_bundle;
+			insert(e);
 		}
 	}
-	return -1;
+	free(old_slots);
 }
 
 bool custody_manager_has_redundant_bundle(struct bundle *bundle)
 {
 	return find(bundle->creation_timestamp, bundle->sequence_number,
 		bundle->source, bundle->fragment_offset,
-		bundle->payload_block->length) != -1;
+		bundle->payload_block->length) != NULL;
 }
 
 bool custody_manager_storage_is_acceptable(struct bundle *bundle)
@@ -72,75 +191,122 @@ bool custody_manager_storage_is_acceptable(struct bundle *bundle)
 			BUNDLE_V6_FLAG_SINGLETON_ENDPOINT);
 
 	return !(
-		accepted_bundle_count >= CUSTODY_MAX_BUNDLE_COUNT
-		|| get_index(bundle) != -1
-		|| bundle_get_serialized_size(bundle) > CUSTODY_MAX_BUNDLE_SIZE
+		stored_bytes + bundle_get_serialized_size(bundle)
+			> CUSTODY_STORAGE_CAPACITY
+		|| custody_manager_has_accepted(bundle)
 		|| bpv6_se_check
 		);
 }
 
 bool custody_manager_has_accepted(struct bundle *bundle)
 {
-	return get_index(bundle) != -1;
+	return *find_by_pointer(bundle) != NULL;
 }
 
 struct bundle *custody_manager_get_by_record(
 	struct bundle_administrative_record *record)
 {
-	int index;
+	struct custody_entry *e;
 
-	index = find(
+	e = find(
 		record->bundle_creation_timestamp,
 		record->bundle_sequence_number,
 		record->bundle_source_eid,
 		record->fragment_offset,
 		record->fragment_length
 	);
-	if (index == -1)
+	if (e == NULL)
 		return NULL;
 	else
-		return accepted_bundles[index];
+		return e->bundle;
+}
+
+void custody_manager_for_each_in_fill(
+	const struct bundle_acs_fill *fill,
+	void (*fn)(struct bundle *bundle, void *param), void *param)
+{
+	// IDs we did not assign yet cannot be in custody
+	const uint64_t end = (fill->length > next_custody_id - fill->start)
+		? next_custody_id : fill->start + fill->length;
+	struct custody_entry *e, *next;
+	uint64_t id;
+	uint32_t i;
+
+	if (fill->start >= next_custody_id)
+		return;
+
+	// Look up every ID or scan the table, whatever is faster
+	if (end - fill->start <= slot_count) {
+		for (id = fill->start; id < end; id++) {
+			e = find_by_custody_id(id);
+			if (e)
+				fn(e->bundle, param);
+		}
+		return;
+	}
+	for (i = 0; i < slot_count; i++) {
+		for (e = by_id[i]; e != NULL; e = next) {
+			// The function may release the bundle
+			next = e->next_by_id;
+			if (e->custody_id >= fill->start && e->custody_id < end)
+				fn(e->bundle, param);
+		}
+	}
 }
 
 /* 5.10.1 */
 enum upcn_result custody_manager_accept(struct bundle *bundle)
 {
+	struct custody_entry *e;
+
 	/* Should be checked by bundle processor */
 	ASSERT(!custody_manager_has_redundant_bundle(bundle));
 	ASSERT(custody_manager_storage_is_acceptable(bundle));
-	/* Add to list */
-	accepted_bundles[accepted_bundle_count++] = bundle;
-	/* Add ret. constraint */
-	bundle->ret_constraints |= BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
-	/* Add own EID as custodian and to dict */
 
-	switch (bundle->protocol_version) {
-	case 6:
-		free(bundle->current_custodian);
-		bundle->current_custodian = strdup(upcn_eid);
-		return UPCN_OK;
-	default:
+	if (bundle->protocol_version != 6)
 		return UPCN_FAIL;
-	}
+
+	e = malloc(sizeof(struct custody_entry));
+	if (e == NULL)
+		return UPCN_FAIL;
+
+	/* Add own EID as custodian and to dict */
+	free(bundle->current_custodian);
+	bundle->current_custodian = strdup(upcn_eid);
+	bundle_recalculate_header_length(bundle);
+	/* Allow the next custodian to signal custody in aggregate */
+	e->custody_id = next_custody_id++;
+	if (bundle6_cteb_set(bundle, e->custody_id, upcn_eid) != UPCN_OK)
+		LOGI("CustodyManager: Could not add CTEB", bundle->id);
+
+	e->bundle = bundle;
+	e->hash = identifier_hash(bundle->creation_timestamp,
+				  bundle->sequence_number, bundle->source);
+	e->size = bundle_get_serialized_size(bundle);
+	if (entry_count >= slot_count)
+		grow();
+	insert(e);
+	stored_bytes += e->size;
+
+	/* Add ret. constraint */
+	bundle->ret_constraints |= BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
+	return UPCN_OK;
 }
 
 /* 5.10.2 */
 void custody_manager_release(struct bundle *bundle)
 {
-	size_t num;
-	int index = get_index(bundle);
+	struct custody_entry **slot = find_by_pointer(bundle);
+	struct custody_entry *e = *slot;
 
-	if (index == -1)
+	if (e == NULL)
 		return;
-	if (index != (accepted_bundle_count - 1)) {
-		num = accepted_bundle_count - index - 1;
-		memmove(
-			accepted_bundles + index,
-			accepted_bundles + index + 1,
-			num
-		);
-	}
-	accepted_bundle_count--;
+	*slot = e->next_by_bundle;
+	remove_by_id(e);
+	entry_count--;
+	stored_bytes -= e->size;
+	free(e);
+
 	bundle->ret_constraints &= ~BUNDLE_RET_CONSTRAINT_CUSTODY_ACCEPTED;
 	if (bundle->ret_constraints == BUNDLE_RET_CONSTRAINT_NONE) {
 		bundle_storage_delete(bundle->id);
@@ -151,4 +317,8 @@ void custody_manager_release(struct bundle *bundle)
 void custody_manager_init(const char *local_eid)
 {
 	upcn_eid = local_eid;
+	slot_count = INITIAL_SLOT_COUNT;
+	by_bundle = calloc(slot_count, sizeof(struct custody_entry *));
+	by_id = calloc(slot_count, sizeof(struct custody_entry *));
+	ASSERT(by_bundle != NULL && by_id != NULL);
 }
@@ -0,0 +1,615 @@
+#include "upcn/common.h"
+#include "upcn/eid_index.h"
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_IPN_CAPACITY 8
+
+enum eid_key_type {
+	EID_KEY_STRING,
+	EID_KEY_PREFIX,
+	EID_KEY_IPN,
+	EID_KEY_IPN_RANGE,
+};
+
+struct eid_key {
+	enum eid_key_type type;
+	// The relevant part of string keys, i.e. without a trailing '*'
+	const char *str;
+	size_t length;
+	// Node number (range) and service number of ipn keys
+	uint64_t first;
+	uint64_t last;
+	uint64_t service;
+};
+
+struct trie_node {
+	// Label of the edge from the parent, not NUL-terminated
+	char *label;
+	size_t label_length;
+	void *exact;
+	void *prefix;
+	// Children are ordered by the first byte of their label
+	struct trie_node *child;
+	struct trie_node *sibling;
+};
+
+struct ipn_entry {
+	uint64_t node;
+	uint64_t service;
+	void *value;
+};
+
+struct ipn_range {
+	uint64_t first;
+	uint64_t last;
+	void *value;
+};
+
+struct eid_index {
+	struct trie_node root;
+
+	// Sorted by node and service number
+	struct ipn_entry *ipn_entries;
+	uint32_t ipn_entry_count;
+	uint32_t ipn_entry_capacity;
+
+	// Sorted by width, so the most specific range comes first
+	struct ipn_range *ipn_ranges;
+	uint32_t ipn_range_count;
+	uint32_t ipn_range_capacity;
+};
+
+/* KEYS */
+
+static bool parse_number(const char **cur, uint64_t *result)
+{
+	const char *s = *cur;
+	uint64_t value = 0;
+	unsigned int digit;
+
+	if (*s < '0' || *s > '9')
+		return false;
+	while (*s >= '0' && *s <= '9') {
+		digit = *s - '0';
+		if (value > (UINT64_MAX - digit) / 10)
+			return false;
+		value = value * 10 + digit;
+		s++;
+	}
+	*cur = s;
+	*result = value;
+	return true;
+}
+
+static bool parse_ipn(const char *eid, const bool pattern,
+		      struct eid_key *key)
+{
+	const char *cur = eid + 4;
+
+	if (strncmp(eid, "ipn:", 4) != 0 || !parse_number(&cur, &key->first))
+		return false;
+	key->last = key->first;
+	if (pattern && *cur == '-') {
+		cur++;
+		if (!parse_number(&cur, &key->last) || key->last < key->first)
+			return false;
+	}
+	if (*cur++ != '.')
+		return false;
+	if (pattern && cur[0] == '*' && cur[1] == '\0') {
+		key->type = EID_KEY_IPN_RANGE;
+		return true;
+	}
+	if (key->last != key->first || !parse_number(&cur, &key->service) ||
+			*cur != '\0')
+		return false;
+	key->type = EID_KEY_IPN;
+	return true;
+}
+
+static struct eid_key parse_key(const char *eid, const bool pattern)
+{
+	struct eid_key key = {
+		.type = EID_KEY_STRING,
+		.str = eid,
+		.length = strlen(eid),
+	};
+
+	if (parse_ipn(eid, pattern, &key))
+		return key;
+	key.type = EID_KEY_STRING;
+	if (pattern && key.length != 0 && eid[key.length - 1] == '*') {
+		key.type = EID_KEY_PREFIX;
+		key.length--;
+	}
+	return key;
+}
+
+bool eid_is_pattern(const char *key)
+{
+	const enum eid_key_type type = parse_key(key, true).type;
+
+	return type == EID_KEY_PREFIX || type == EID_KEY_IPN_RANGE;
+}
+
+bool eid_matches(const char *key, const char *eid)
+{
+	const struct eid_key k = parse_key(key, true);
+	const struct eid_key e = parse_key(eid, false);
+
+	switch (k.type) {
+	case EID_KEY_IPN:
+		return e.type == EID_KEY_IPN && e.first == k.first &&
+			e.service == k.service;
+	case EID_KEY_IPN_RANGE:
+		return e.type == EID_KEY_IPN && e.first >= k.first &&
+			e.first <= k.last;
+	case EID_KEY_PREFIX:
+		if (strncmp(eid, key, k.length) == 0)
+			return true;
+		// "N/*" also covers the node EID "N"
+		return (
+			k.length != 0 && key[k.length - 1] == '/' &&
+			e.length == k.length - 1 &&
+			strncmp(eid, key, e.length) == 0
+		);
+	default:
+		return strcmp(key, eid) == 0;
+	}
+}
+
+/* TRIE */
+
+static struct trie_node *trie_node_create(const char *label,
+					  const size_t length)
+{
+	struct trie_node *const node = malloc(sizeof(struct trie_node));
+
+	if (!node)
+		return NULL;
+	node->label = malloc(length);
+	if (!node->label) {
+		free(node);
+		return NULL;
+	}
+	memcpy(node->label, label, length);
+	node->label_length = length;
+	node->exact = NULL;
+	node->prefix = NULL;
+	node->child = NULL;
+	node->sibling = NULL;
+	return node;
+}
+
+static void trie_free_children(struct trie_node *node)
+{
+	struct trie_node *child, *next;
+
+	for (child = node->child; child != NULL; child = next) {
+		next = child->sibling;
+		trie_free_children(child);
+		free(child->label);
+		free(child);
+	}
+	node->child = NULL;
+}
+
+static struct trie_node **trie_child_link(struct trie_node *node,
+					  const char c)
+{
+	struct trie_node **link = &node->child;
+
+	while (*link != NULL && (uint8_t)(*link)->label[0] < (uint8_t)c)
+		link = &(*link)->sibling;
+	return link;
+}
+
+static const struct trie_node *trie_child(const struct trie_node *node,
+					  const char *str, const size_t length)
+{
+	const struct trie_node *child = node->child;
+
+	while (child != NULL && (uint8_t)child->label[0] < (uint8_t)str[0])
+		child = child->sibling;
+	if (child == NULL || child->label_length > length ||
+			memcmp(child->label, str, child->label_length) != 0)
+		return NULL;
+	return child;
+}
+
+// Returns the node for exactly the given string, creating it if necessary
+static struct trie_node *trie_insert(struct trie_node *node, const char *str,
+				     size_t length)
+{
+	struct trie_node **link, *child, *split;
+	size_t common;
+
+	while (length != 0) {
+		link = trie_child_link(node, str[0]);
+		child = *link;
+		if (child == NULL || child->label[0] != str[0]) {
+			child = trie_node_create(str, length);
+			if (!child)
+				return NULL;
+			child->sibling = *link;
+			*link = child;
+			return child;
+		}
+		common = 1;
+		while (common < child->label_length && common < length &&
+				child->label[common] == str[common])
+			common++;
+		// Split the edge if the string diverges within the label
+		if (common < child->label_length) {
+			split = trie_node_create(str, common);
+			if (!split)
+				return NULL;
+			memmove(child->label, child->label + common,
+				child->label_length - common);
+			child->label_length -= common;
+			split->child = child;
+			split->sibling = child->sibling;
+			child->sibling = NULL;
+			*link = split;
+			child = split;
+		}
+		node = child;
+		str += common;
+		length -= common;
+	}
+	return node;
+}
+
+static struct trie_node *trie_find(const struct trie_node *node,
+				   const char *str, size_t length)
+{
+	while (node != NULL && length != 0) {
+		node = trie_child(node, str, length);
+		if (node != NULL) {
+			str += node->label_length;
+			length -= node->label_length;
+		}
+	}
+	return (struct trie_node *)node;
+}
+
+// Removes a node without values or merges it with its only child
+static void trie_compact(struct trie_node **link)
+{
+	struct trie_node *const node = *link;
+	struct trie_node *const child = node->child;
+	char *label;
+
+	if (node->exact != NULL || node->prefix != NULL)
+		return;
+	if (child == NULL) {
+		*link = node->sibling;
+	} else if (child->sibling == NULL) {
+		label = malloc(node->label_length + child->label_length);
+		// Keeping the node does not affect lookups
+		if (!label)
+			return;
+		memcpy(label, node->label, node->label_length);
+		memcpy(label + node->label_length, child->label,
+		       child->label_length);
+		free(child->label);
+		child->label = label;
+		child->label_length += node->label_length;
+		child->sibling = node->sibling;
+		*link = child;
+	} else {
+		return;
+	}
+	free(node->label);
+	free(node);
+}
+
+static void *trie_remove(struct trie_node *parent, const char *str,
+			 size_t length, const bool prefix)
+{
+	struct trie_node **const link = trie_child_link(parent, str[0]);
+	struct trie_node *const node = *link;
+	void *value;
+
+	if (node == NULL || node->label_length > length ||
+			memcmp(node->label, str, node->label_length) != 0)
+		return NULL;
+	str += node->label_length;
+	length -= node->label_length;
+	if (length != 0) {
+		value = trie_remove(node, str, length, prefix);
+	} else if (prefix) {
+		value = node->prefix;
+		node->prefix = NULL;
+	} else {
+		value = node->exact;
+		node->exact = NULL;
+	}
+	if (value != NULL)
+		trie_compact(link);
+	return value;
+}
+
+static inline void add_match(void *value, void **values, uint8_t *count,
+			     const uint8_t max)
+{
+	if (value != NULL && *count < max)
+		values[(*count)++] = value;
+}
+
+// Collects the matches below the node, deeper nodes first
+static void trie_lookup(const struct trie_node *node, const char *str,
+			const size_t length, void **values, uint8_t *count,
+			const uint8_t max)
+{
+	const char c = (length != 0) ? str[0] : '/';
+	const struct trie_node *child = node->child;
+
+	if (length == 0)
+		add_match(node->exact, values, count, max);
+	while (child != NULL && (uint8_t)child->label[0] < (uint8_t)c)
+		child = child->sibling;
+	if (child != NULL && child->label_length <= length &&
+			memcmp(child->label, str, child->label_length) == 0) {
+		trie_lookup(child, str + child->label_length,
+			    length - child->label_length, values, count, max);
+	} else if (child != NULL && child->label_length == length + 1 &&
+			child->label[length] == '/' &&
+			memcmp(child->label, str, length) == 0) {
+		// "N/*" also covers the node EID "N"
+		add_match(child->prefix, values, count, max);
+	}
+	add_match(node->prefix, values, count, max);
+}
+
+/* IPN */
+
+// Returns the idx of the first entry not less than the given one
+static uint32_t ipn_entry_find(const struct eid_index *idx,
+			       const uint64_t node, const uint64_t service)
+{
+	uint32_t lo = 0, hi = idx->ipn_entry_count;
+
+	while (lo < hi) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+		const struct ipn_entry *const e = &idx->ipn_entries[mid];
+
+		if (e->node < node || (e->node == node && e->service < service))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static inline bool ipn_entry_equals(const struct eid_index *idx,
+				    const uint32_t i, const uint64_t node,
+				    const uint64_t service)
+{
+	return (
+		i < idx->ipn_entry_count &&
+		idx->ipn_entries[i].node == node &&
+		idx->ipn_entries[i].service == service
+	);
+}
+
+static uint32_t ipn_range_find(const struct eid_index *idx,
+			       const uint64_t first, const uint64_t last)
+{
+	uint32_t i;
+
+	for (i = 0; i < idx->ipn_range_count; i++) {
+		if (idx->ipn_ranges[i].first == first &&
+				idx->ipn_ranges[i].last == last)
+			break;
+	}
+	return i;
+}
+
+static enum upcn_result ensure_capacity(void **items, uint32_t *capacity,
+					const uint32_t count,
+					const size_t item_size)
+{
+	uint32_t new_capacity;
+	void *new_items;
+
+	if (count < *capacity)
+		return UPCN_OK;
+	new_capacity = *capacity ? *capacity * 2 : INITIAL_IPN_CAPACITY;
+	new_items = realloc(*items, item_size * new_capacity);
+	if (!new_items)
+		return UPCN_FAIL;
+	*items = new_items;
+	*capacity = new_capacity;
+	return UPCN_OK;
+}
+
+static enum upcn_result ipn_entry_add(struct eid_index *idx,
+				      const struct eid_key *key, void *value)
+{
+	const uint32_t i = ipn_entry_find(idx, key->first, key->service);
+
+	if (ipn_entry_equals(idx, i, key->first, key->service))
+		return UPCN_FAIL;
+	if (ensure_capacity((void **)&idx->ipn_entries,
+			    &idx->ipn_entry_capacity,
+			    idx->ipn_entry_count,
+			    sizeof(struct ipn_entry)) != UPCN_OK)
+		return UPCN_FAIL;
+	memmove(&idx->ipn_entries[i + 1], &idx->ipn_entries[i],
+		sizeof(struct ipn_entry) * (idx->ipn_entry_count - i));
+	idx->ipn_entries[i] = (struct ipn_entry){
+		key->first, key->service, value
+	};
+	idx->ipn_entry_count++;
+	return UPCN_OK;
+}
+
+static enum upcn_result ipn_range_add(struct eid_index *idx,
+				      const struct eid_key *key, void *value)
+{
+	const uint64_t width = key->last - key->first;
+	uint32_t i;
+
+	if (ipn_range_find(idx, key->first, key->last) !=
+			idx->ipn_range_count)
+		return UPCN_FAIL;
+	if (ensure_capacity((void **)&idx->ipn_ranges,
+			    &idx->ipn_range_capacity,
+			    idx->ipn_range_count,
+			    sizeof(struct ipn_range)) != UPCN_OK)
+		return UPCN_FAIL;
+	for (i = 0; i < idx->ipn_range_count; i++) {
+		if (idx->ipn_ranges[i].last - idx->ipn_ranges[i].first >
+				width)
+			break;
+	}
+	memmove(&idx->ipn_ranges[i + 1], &idx->ipn_ranges[i],
+		sizeof(struct ipn_range) * (idx->ipn_range_count - i));
+	idx->ipn_ranges[i] = (struct ipn_range){
+		key->first, key->last, value
+	};
+	idx->ipn_range_count++;
+	return UPCN_OK;
+}
+
+/* INDEX */
+
+struct eid_index *eid_index_create(void)
+{
+	return calloc(1, sizeof(struct eid_index));
+}
+
+void eid_index_free(struct eid_index *idx)
+{
+	if (!idx)
+		return;
+	trie_free_children(&idx->root);
+	free(idx->ipn_entries);
+	free(idx->ipn_ranges);
+	free(idx);
+}
+
+enum upcn_result eid_index_add(struct eid_index *idx, const char *key,
+			       void *value)
+{
+	const struct eid_key k = parse_key(key, true);
+	struct trie_node *node;
+	void **slot;
+
+	ASSERT(value != NULL);
+	switch (k.type) {
+	case EID_KEY_IPN:
+		return ipn_entry_add(idx, &k, value);
+	case EID_KEY_IPN_RANGE:
+		return ipn_range_add(idx, &k, value);
+	default:
+		break;
+	}
+	node = trie_insert(&idx->root, k.str, k.length);
+	if (!node)
+		return UPCN_FAIL;
+	slot = (k.type == EID_KEY_PREFIX) ? &node->prefix : &node->exact;
+	if (*slot != NULL)
+		return UPCN_FAIL;
+	*slot = value;
+	return UPCN_OK;
+}
+
+void *eid_index_get(const struct eid_index *idx, const char *key)
+{
+	const struct eid_key k = parse_key(key, true);
+	const struct trie_node *node;
+	uint32_t i;
+
+	switch (k.type) {
+	case EID_KEY_IPN:
+		i = ipn_entry_find(idx, k.first, k.service);
+		if (!ipn_entry_equals(idx, i, k.first, k.service))
+			return NULL;
+		return idx->ipn_entries[i].value;
+	case EID_KEY_IPN_RANGE:
+		i = ipn_range_find(idx, k.first, k.last);
+		if (i == idx->ipn_range_count)
+			return NULL;
+		return idx->ipn_ranges[i].value;
+	default:
+		node = trie_find(&idx->root, k.str, k.length);
+		if (!node)
+			return NULL;
+		return (k.type == EID_KEY_PREFIX) ? node->prefix : node->exact;
+	}
+}
+
+void *eid_index_remove(struct eid_index *idx, const char *key)
+{
+	const struct eid_key k = parse_key(key, true);
+	void *value;
+	uint32_t i;
+
+	switch (k.type) {
+	case EID_KEY_IPN:
+		i = ipn_entry_find(idx, k.first, k.service);
+		if (!ipn_entry_equals(idx, i, k.first, k.service))
+			return NULL;
+		value = idx->ipn_entries[i].value;
+		idx->ipn_entry_count--;
+		memmove(&idx->ipn_entries[i], &idx->ipn_entries[i + 1],
+			sizeof(struct ipn_entry) *
+				(idx->ipn_entry_count - i));
+		return value;
+	case EID_KEY_IPN_RANGE:
+		i = ipn_range_find(idx, k.first, k.last);
+		if (i == idx->ipn_range_count)
+			return NULL;
+		value = idx->ipn_ranges[i].value;
+		idx->ipn_range_count--;
+		memmove(&idx->ipn_ranges[i], &idx->ipn_ranges[i + 1],
+			sizeof(struct ipn_range) *
+				(idx->ipn_range_count - i));
+		return value;
+	default:
+		break;
+	}
+	if (k.length == 0) {
+		if (k.type == EID_KEY_PREFIX) {
+			value = idx->root.prefix;
+			idx->root.prefix = NULL;
+		} else {
+			value = idx->root.exact;
+			idx->root.exact = NULL;
+		}
+		return value;
+	}
+	return trie_remove(&idx->root, k.str, k.length,
+			   k.type == EID_KEY_PREFIX);
+}
+
+uint8_t eid_index_lookup(const struct eid_index *idx, const char *eid,
+			 void **values, uint8_t max)
+{
+	const struct eid_key e = parse_key(eid, false);
+	uint8_t count = 0;
+	uint32_t i;
+
+	if (e.type == EID_KEY_IPN) {
+		i = ipn_entry_find(idx, e.first, e.service);
+		if (ipn_entry_equals(idx, i, e.first, e.service))
+			add_match(idx->ipn_entries[i].value,
+				  values, &count, max);
+		for (i = 0; i < idx->ipn_range_count; i++) {
+			if (idx->ipn_ranges[i].first <= e.first &&
+					idx->ipn_ranges[i].last >= e.first)
+				add_match(idx->ipn_ranges[i].value,
+					  values, &count, max);
+		}
+	}
+	trie_lookup(&idx->root, e.str, e.length, values, &count, max);
+	return count;
+}
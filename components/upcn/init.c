@@ -11,6 +11,8 @@
 #include "agents/config_agent.h"
 #include "agents/management_agent.h"
 
+#include "bundle7/eid.h"
+
 #include "cla/cla.h"
 
 #include "platform/hal_config.h"
@@ -28,6 +30,7 @@ static struct bundle_agent_interface bundle_agent_interface;
 void init(int argc, char *argv[])
 {
 	hal_platform_init(argc, argv);
+	ASSERT(bundle7_eid_cache_init() == UPCN_OK);
 	hal_io_message_printf("\n");
 	hal_io_message_printf("############################################\n");
 	hal_io_message_printf("This is uPCN, compiled %s %s\n",
@@ -0,0 +1,380 @@
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/known_bundle_set.h"
+#include "upcn/result.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SLOT_COUNT 64
+#define INITIAL_HEAP_CAPACITY 64
+#define BLOOM_HASH_COUNT 4
+#define BLOOM_COUNTER_MAX UINT8_MAX
+
+struct known_bundle_entry {
+	struct bundle_unique_identifier id;
+	uint32_t hash;
+	struct known_bundle_entry *next;
+};
+
+struct known_bundle_record {
+	uint64_t deadline;
+	uint32_t hash;
+	// NULL if the identifier is only recorded in the Bloom filter
+	struct known_bundle_entry *entry;
+};
+
+struct known_bundle_set {
+	// Hash table, slot_count is always a power of two
+	struct known_bundle_entry **slots;
+	uint32_t slot_count;
+	uint32_t entry_count;
+
+	// Min-heap of all records, ordered by deadline
+	struct known_bundle_record *heap;
+	uint32_t heap_count;
+	uint32_t heap_capacity;
+
+	// Counting Bloom filter for identifiers not stored exactly
+	uint8_t *bloom;
+	uint32_t bloom_size;
+	uint32_t bloom_count;
+
+	uint32_t max_exact_entries;
+	uint32_t max_records;
+};
+
+/* HASHING */
+
+static uint32_t id_hash(const struct bundle_unique_identifier *id)
+{
+	const uint64_t fields[] = {
+		id->protocol_version,
+		id->creation_timestamp,
+		id->sequence_number,
+		id->fragment_offset,
+		id->payload_length,
+	};
+	const uint32_t h = hashlittle(id->source, strlen(id->source), 0);
+
+	return hashlittle(fields, sizeof(fields), h);
+}
+
+static bool id_equal(const struct bundle_unique_identifier *a,
+		     const struct bundle_unique_identifier *b)
+{
+	return (
+		a->creation_timestamp == b->creation_timestamp &&
+		a->sequence_number == b->sequence_number &&
+		a->fragment_offset == b->fragment_offset &&
+		a->payload_length == b->payload_length &&
+		a->protocol_version == b->protocol_version &&
+		strcmp(a->source, b->source) == 0
+	);
+}
+
+/* BLOOM FILTER */
+
+// Kirsch-Mitzenmacher double hashing, derived from a single 32 bit hash
+#define BLOOM_INDEX(set, hash, i) \
+	(((hash) + (i) * ((((hash) >> 17) | ((hash) << 15)) | 1)) % \
+	 (set)->bloom_size)
+
+static void bloom_add(struct known_bundle_set *set, const uint32_t hash)
+{
+	uint32_t i;
+
+	for (i = 0; i < BLOOM_HASH_COUNT; i++) {
+		uint8_t *const c = &set->bloom[BLOOM_INDEX(set, hash, i)];
+
+		if (*c != BLOOM_COUNTER_MAX)
+			(*c)++;
+	}
+	set->bloom_count++;
+}
+
+static void bloom_remove(struct known_bundle_set *set, const uint32_t hash)
+{
+	uint32_t i;
+
+	for (i = 0; i < BLOOM_HASH_COUNT; i++) {
+		uint8_t *const c = &set->bloom[BLOOM_INDEX(set, hash, i)];
+
+		// Saturated counters are "sticky" as we lost the count
+		if (*c != 0 && *c != BLOOM_COUNTER_MAX)
+			(*c)--;
+	}
+	set->bloom_count--;
+}
+
+static bool bloom_contains(const struct known_bundle_set *set,
+			   const uint32_t hash)
+{
+	uint32_t i;
+
+	for (i = 0; i < BLOOM_HASH_COUNT; i++) {
+		if (set->bloom[BLOOM_INDEX(set, hash, i)] == 0)
+			return false;
+	}
+	return true;
+}
+
+/* HASH TABLE */
+
+static void table_insert(struct known_bundle_set *set,
+			 struct known_bundle_entry *entry)
+{
+	struct known_bundle_entry **slot =
+		&set->slots[entry->hash & (set->slot_count - 1)];
+
+	entry->next = *slot;
+	*slot = entry;
+	set->entry_count++;
+}
+
+static void table_remove(struct known_bundle_set *set,
+			 struct known_bundle_entry *entry)
+{
+	struct known_bundle_entry **cur =
+		&set->slots[entry->hash & (set->slot_count - 1)];
+
+	while (*cur != NULL) {
+		if (*cur == entry) {
+			*cur = entry->next;
+			set->entry_count--;
+			return;
+		}
+		cur = &(*cur)->next;
+	}
+	ASSERT(false);
+}
+
+static void table_grow(struct known_bundle_set *set)
+{
+	const uint32_t old_count = set->slot_count;
+	struct known_bundle_entry **const old_slots = set->slots;
+	struct known_bundle_entry **new_slots;
+	uint32_t i;
+
+	if (old_count > UINT32_MAX / 2)
+		return;
+	new_slots = calloc(old_count * 2, sizeof(struct known_bundle_entry *));
+	// Keep the old table, the chains just get longer
+	if (!new_slots)
+		return;
+
+	set->slots = new_slots;
+	set->slot_count = old_count * 2;
+	set->entry_count = 0;
+	for (i = 0; i < old_count; i++) {
+		while (old_slots[i] != NULL) {
+			struct known_bundle_entry *const e = old_slots[i];
+
+			old_slots[i] = e->next;
+			table_insert(set, e);
+		}
+	}
+	free(old_slots);
+}
+
+/* HEAP */
+
+static void heap_swap(struct known_bundle_record *heap,
+		      const uint32_t a, const uint32_t b)
+{
+	const struct known_bundle_record tmp = heap[a];
+
+	heap[a] = heap[b];
+	heap[b] = tmp;
+}
+
+static void heap_sift_up(struct known_bundle_set *set, uint32_t i)
+{
+	while (i > 0) {
+		const uint32_t parent = (i - 1) / 2;
+
+		if (set->heap[parent].deadline <= set->heap[i].deadline)
+			break;
+		heap_swap(set->heap, parent, i);
+		i = parent;
+	}
+}
+
+static void heap_sift_down(struct known_bundle_set *set, uint32_t i)
+{
+	for (;;) {
+		const uint32_t l = 2 * i + 1, r = 2 * i + 2;
+		uint32_t min = i;
+
+		if (l < set->heap_count &&
+				set->heap[l].deadline < set->heap[min].deadline)
+			min = l;
+		if (r < set->heap_count &&
+				set->heap[r].deadline < set->heap[min].deadline)
+			min = r;
+		if (min == i)
+			break;
+		heap_swap(set->heap, min, i);
+		i = min;
+	}
+}
+
+static void heap_drop_first(struct known_bundle_set *set)
+{
+	struct known_bundle_record *const first = &set->heap[0];
+
+	ASSERT(set->heap_count != 0);
+	if (first->entry != NULL) {
+		table_remove(set, first->entry);
+		bundle_free_unique_identifier(&first->entry->id);
+		free(first->entry);
+	} else {
+		bloom_remove(set, first->hash);
+	}
+	set->heap[0] = set->heap[--set->heap_count];
+	heap_sift_down(set, 0);
+}
+
+static enum upcn_result heap_push(struct known_bundle_set *set,
+				  const struct known_bundle_record record)
+{
+	if (set->heap_count == set->heap_capacity) {
+		const uint32_t new_capacity = set->heap_capacity * 2;
+		struct known_bundle_record *const new_heap = realloc(
+			set->heap,
+			sizeof(struct known_bundle_record) * new_capacity
+		);
+
+		if (!new_heap)
+			return UPCN_FAIL;
+		set->heap = new_heap;
+		set->heap_capacity = new_capacity;
+	}
+	set->heap[set->heap_count] = record;
+	heap_sift_up(set, set->heap_count++);
+	return UPCN_OK;
+}
+
+/* PUBLIC INTERFACE */
+
+struct known_bundle_set *known_bundle_set_create(
+	uint32_t max_exact_entries, uint32_t max_records,
+	uint32_t bloom_counters)
+{
+	struct known_bundle_set *set = malloc(sizeof(struct known_bundle_set));
+
+	if (!set)
+		return NULL;
+	set->slot_count = INITIAL_SLOT_COUNT;
+	set->entry_count = 0;
+	set->slots = calloc(set->slot_count,
+			    sizeof(struct known_bundle_entry *));
+	set->heap_count = 0;
+	set->heap_capacity = INITIAL_HEAP_CAPACITY;
+	set->heap = malloc(sizeof(struct known_bundle_record) *
+			   set->heap_capacity);
+	set->bloom_size = bloom_counters;
+	set->bloom_count = 0;
+	set->bloom = bloom_counters ? calloc(bloom_counters, 1) : NULL;
+	set->max_exact_entries = max_exact_entries;
+	set->max_records = max_records;
+
+	if (!set->slots || !set->heap || (bloom_counters && !set->bloom)) {
+		free(set->slots);
+		free(set->heap);
+		free(set->bloom);
+		free(set);
+		return NULL;
+	}
+	return set;
+}
+
+void known_bundle_set_free(struct known_bundle_set *set)
+{
+	if (!set)
+		return;
+	while (set->heap_count != 0)
+		heap_drop_first(set);
+	free(set->slots);
+	free(set->heap);
+	free(set->bloom);
+	free(set);
+}
+
+bool known_bundle_set_contains(
+	const struct known_bundle_set *set,
+	const struct bundle_unique_identifier *id)
+{
+	const uint32_t hash = id_hash(id);
+	const struct known_bundle_entry *e =
+		set->slots[hash & (set->slot_count - 1)];
+
+	for (; e; e = e->next) {
+		if (e->hash == hash && id_equal(&e->id, id))
+			return true;
+	}
+	return set->bloom_count != 0 && bloom_contains(set, hash);
+}
+
+enum upcn_result known_bundle_set_add(
+	struct known_bundle_set *set,
+	const struct bundle_unique_identifier *id, uint64_t deadline)
+{
+	struct known_bundle_record record = {
+		.deadline = deadline,
+		.hash = id_hash(id),
+		.entry = NULL,
+	};
+
+	if (set->max_records != 0 && set->heap_count >= set->max_records)
+		heap_drop_first(set);
+
+	if (set->max_exact_entries == 0 ||
+			set->entry_count < set->max_exact_entries) {
+		record.entry = malloc(sizeof(struct known_bundle_entry));
+		if (!record.entry)
+			return UPCN_FAIL;
+		record.entry->id = *id;
+		record.entry->id.source = strdup(id->source);
+		record.entry->hash = record.hash;
+		if (!record.entry->id.source) {
+			free(record.entry);
+			return UPCN_FAIL;
+		}
+	} else if (set->bloom == NULL) {
+		return UPCN_FAIL;
+	}
+
+	if (heap_push(set, record) != UPCN_OK) {
+		if (record.entry) {
+			bundle_free_unique_identifier(&record.entry->id);
+			free(record.entry);
+		}
+		return UPCN_FAIL;
+	}
+
+	if (record.entry) {
+		if (set->entry_count >= set->slot_count)
+			table_grow(set);
+		table_insert(set, record.entry);
+	} else {
+		bloom_add(set, record.hash);
+	}
+	return UPCN_OK;
+}
+
+void known_bundle_set_expire(struct known_bundle_set *set, uint64_t cur_time)
+{
+	while (set->heap_count != 0 && set->heap[0].deadline < cur_time)
+		heap_drop_first(set);
+}
+
+uint32_t known_bundle_set_count(const struct known_bundle_set *set)
+{
+	return set->heap_count;
+}
@@ -0,0 +1,86 @@
+#include "upcn/nbf.h"
+#include "upcn/result.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct nbf *nbf_create(uint32_t bit_count, uint8_t hash_count)
+{
+	struct nbf *nbf;
+
+	if (bit_count == 0 || hash_count == 0)
+		return NULL;
+	nbf = malloc(sizeof(struct nbf));
+	if (!nbf)
+		return NULL;
+	nbf->bits = calloc(NBF_BYTE_COUNT(bit_count), 1);
+	if (!nbf->bits) {
+		free(nbf);
+		return NULL;
+	}
+	nbf->bit_count = bit_count;
+	nbf->hash_count = hash_count;
+	return nbf;
+}
+
+void nbf_free(struct nbf *nbf)
+{
+	if (!nbf)
+		return;
+	free(nbf->bits);
+	free(nbf);
+}
+
+static inline void nbf_hash(const struct nbf *nbf, const char *eid,
+			    uint32_t *h1, uint32_t *h2)
+{
+	const size_t length = strlen(eid);
+
+	*h1 = hashlittle(eid, length, 0);
+	*h2 = hashlittle(eid, length, *h1) | 1;
+	*h1 %= nbf->bit_count;
+	*h2 %= nbf->bit_count;
+}
+
+void nbf_add(struct nbf *nbf, const char *eid)
+{
+	uint32_t h1, h2, bit;
+	uint8_t i;
+
+	nbf_hash(nbf, eid, &h1, &h2);
+	for (i = 0, bit = h1; i < nbf->hash_count; i++) {
+		nbf->bits[bit / 8] |= 1 << (bit % 8);
+		bit = (uint32_t)(((uint64_t)bit + h2) % nbf->bit_count);
+	}
+}
+
+bool nbf_contains(const struct nbf *nbf, const char *eid)
+{
+	uint32_t h1, h2, bit;
+	uint8_t i;
+
+	nbf_hash(nbf, eid, &h1, &h2);
+	for (i = 0, bit = h1; i < nbf->hash_count; i++) {
+		if (!(nbf->bits[bit / 8] & (1 << (bit % 8))))
+			return false;
+		bit = (uint32_t)(((uint64_t)bit + h2) % nbf->bit_count);
+	}
+	return true;
+}
+
+enum upcn_result nbf_merge(struct nbf *target, const struct nbf *source)
+{
+	uint32_t i;
+
+	if (target->bit_count != source->bit_count ||
+			target->hash_count != source->hash_count)
+		return UPCN_FAIL;
+	for (i = 0; i < NBF_BYTE_COUNT(target->bit_count); i++)
+		target->bits[i] |= source->bits[i];
+	return UPCN_OK;
+}
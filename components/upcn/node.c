@@ -1,4 +1,5 @@
 #include "upcn/common.h"
+#include "upcn/contact_schedule.h"
 #include "upcn/node.h"
 #include "upcn/result.h"
 
@@ -6,6 +7,7 @@
 
 #include "util/llsort.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
@@ -23,6 +25,7 @@ struct node *node_create(char *eid)
 	ret->reliability = 1.0f;
 	ret->endpoints = NULL;
 	ret->contacts = NULL;
+	ret->nbf = NULL;
 	if (eid == NULL)
 		ret->eid = NULL;
 	else
@@ -33,6 +36,7 @@ struct node *node_create(char *eid)
 struct contact *contact_create(struct node *node)
 {
 	struct contact *ret = malloc(sizeof(struct contact));
+	int prio;
 
 	if (ret == NULL)
 		return NULL;
@@ -45,9 +49,16 @@ struct contact *contact_create(struct node *node)
 	ret->remaining_capacity_p1 = 0;
 	ret->remaining_capacity_p2 = 0;
 	ret->contact_endpoints = NULL;
-	ret->contact_bundles = NULL;
+	for (prio = 0; prio < BUNDLE_RPRIO_MAX; prio++) {
+		ret->contact_bundles[prio].head = NULL;
+		ret->contact_bundles[prio].tail = NULL;
+	}
 	ret->bundle_count = 0;
 	ret->active = 0;
+	ret->schedule_index = 0;
+	ret->schedule_state = CONTACT_UNSCHEDULED;
+	ret->optimizer_index = 0;
+	ret->optimizer_dirty = 0;
 	return ret;
 }
 
@@ -60,13 +71,15 @@ static void free_contact_internal(
 	if (contact == NULL)
 		return;
 	ASSERT(contact->active == 0);
+	ASSERT(contact->schedule_state == CONTACT_UNSCHEDULED);
+	ASSERT(!contact->optimizer_dirty);
 	if (free_eid_list) {
 		cur_eid = contact->contact_endpoints;
 		while (cur_eid != NULL)
 			cur_eid = endpoint_list_free(cur_eid);
 	}
 	/* Free associated bundle list (not bundles themselves) */
-	cur_bundle = contact->contact_bundles;
+	cur_bundle = contact_take_bundles(contact);
 	while (cur_bundle != NULL) {
 		next = cur_bundle->next;
 		free(cur_bundle);
@@ -96,6 +109,7 @@ void free_node(struct node *node)
 	cur_contact = node->contacts;
 	while (cur_contact != NULL)
 		cur_contact = contact_list_free_internal(cur_contact, 1);
+	nbf_free(node->nbf);
 	free(node->cla_addr);
 	free(node->eid);
 	free(node);
@@ -439,7 +453,8 @@ int node_prepare_and_verify(struct node *node)
 		cl->data->contact_endpoints = endpoint_list_strip_and_sort(
 			cl->data->contact_endpoints);
 		i = cl->next;
-		while (i != NULL) {
+		// Sorted by start time, no later contact can overlap
+		while (i != NULL && i->data->from <= cl->data->to) {
 			if (contacts_overlap(cl->data, i->data))
 				return 0;
 			i = i->next;
@@ -452,45 +467,48 @@ int node_prepare_and_verify(struct node *node)
 void recalculate_contact_capacity(struct contact *contact)
 {
 	uint64_t duration, new_capacity;
-	int32_t capacity_difference;
+	int64_t capacity_difference;
 
 	ASSERT(contact != NULL);
 	duration = contact->to - contact->from;
 	// NOTE: We don't support contacts longer than 4 M. s
 	if (duration > UINT32_MAX)
 		duration = UINT32_MAX;
+	// Cannot overflow as both factors are limited to 32 bits
 	new_capacity = duration * contact->bitrate;
-	// NOTE: We don't support transferring > 2.147 GB during a contact
-	if (new_capacity > INT32_MAX)
-		new_capacity = INT32_MAX;
-	capacity_difference = new_capacity - (int32_t)contact->total_capacity;
-	contact->total_capacity = (uint32_t)new_capacity;
+	capacity_difference = (int64_t)new_capacity
+		- (int64_t)contact->total_capacity;
+	contact->total_capacity = new_capacity;
 	contact->remaining_capacity_p0 += capacity_difference;
 	contact->remaining_capacity_p1 += capacity_difference;
 	contact->remaining_capacity_p2 += capacity_difference;
 }
 
-int32_t contact_get_cur_remaining_capacity(
+int64_t contact_get_cur_remaining_capacity(
 	struct contact *contact, enum bundle_routing_priority prio)
 {
-	uint64_t time;
-	uint64_t cap_left;
-	int32_t cap_result;
+	uint64_t time_ms, from_ms, to_ms, cap_left, duration, remaining;
 
 	ASSERT(contact != NULL);
-	time = hal_time_get_timestamp_s();
-	if (time >= contact->to)
+	// The capacity decreases continuously during the contact
+	time_ms = hal_time_get_timestamp_ms();
+	from_ms = contact->from * 1000;
+	to_ms = contact->to * 1000;
+	if (time_ms >= to_ms)
 		return 0;
-	if (time <= contact->from)
+	if (time_ms <= from_ms)
 		return CONTACT_CAPACITY(contact, prio);
-	cap_left = contact->total_capacity
-		* (uint64_t)(contact->to - time)
-		/ (uint64_t)(contact->to - contact->from);
-	// NOTE: We don't support transferring > 2.147 GB during a contact
-	if (cap_left > INT32_MAX)
-		cap_left = INT32_MAX;
-	cap_result = cap_left;
-	return MIN(cap_result, CONTACT_CAPACITY(contact, prio));
+	duration = to_ms - from_ms;
+	remaining = to_ms - time_ms;
+	// Both terms have to fit into 32 bits for the product below
+	while (duration > UINT32_MAX) {
+		duration >>= 1;
+		remaining >>= 1;
+	}
+	// Split the product to prevent an overflow for large capacities
+	cap_left = contact->total_capacity / duration * remaining
+		+ contact->total_capacity % duration * remaining / duration;
+	return MIN((int64_t)cap_left, CONTACT_CAPACITY(contact, prio));
 }
 
 int add_contact_to_ordered_list(
@@ -596,3 +614,178 @@ int remove_contact_from_assoc_list(
 	}
 	return 0;
 }
+
+/* ROUTED BUNDLE QUEUES */
+
+#define RB_INDEX_INITIAL_SLOT_COUNT 64
+
+static struct routed_bundle_list **rb_index_slots;
+static uint32_t rb_index_slot_count;
+static uint32_t rb_index_entry_count;
+
+static inline uint32_t rb_index_slot(
+	const struct contact *contact, const bundleid_t id,
+	const uint32_t slot_count)
+{
+	uint64_t key = ((uint64_t)(uintptr_t)contact << 16) ^ id;
+
+	/* Fibonacci hashing, the upper bits are mixed best */
+	key *= UINT64_C(0x9E3779B97F4A7C15);
+	return (uint32_t)(key >> 32) & (slot_count - 1);
+}
+
+static void rb_index_grow(void)
+{
+	const uint32_t new_slot_count = rb_index_slot_count
+		? rb_index_slot_count * 2
+		: RB_INDEX_INITIAL_SLOT_COUNT;
+	struct routed_bundle_list **new_slots = calloc(
+		new_slot_count, sizeof(struct routed_bundle_list *));
+	struct routed_bundle_list *e, *next;
+	uint32_t i, slot;
+
+	/* On failure, the chains just become longer */
+	if (!new_slots)
+		return;
+	for (i = 0; i < rb_index_slot_count; i++) {
+		for (e = rb_index_slots[i]; e; e = next) {
+			next = e->index_next;
+			slot = rb_index_slot(e->contact, e->data->id,
+					     new_slot_count);
+			e->index_next = new_slots[slot];
+			new_slots[slot] = e;
+		}
+	}
+	free(rb_index_slots);
+	rb_index_slots = new_slots;
+	rb_index_slot_count = new_slot_count;
+}
+
+static enum upcn_result rb_index_insert(struct routed_bundle_list *e)
+{
+	uint32_t slot;
+
+	if (rb_index_entry_count >= rb_index_slot_count)
+		rb_index_grow();
+	if (rb_index_slot_count == 0)
+		return UPCN_FAIL;
+	slot = rb_index_slot(e->contact, e->data->id, rb_index_slot_count);
+	e->index_next = rb_index_slots[slot];
+	rb_index_slots[slot] = e;
+	rb_index_entry_count++;
+	return UPCN_OK;
+}
+
+static struct routed_bundle_list **rb_index_find(
+	const struct contact *contact, const bundleid_t id)
+{
+	struct routed_bundle_list **cur;
+
+	if (rb_index_slot_count == 0)
+		return NULL;
+	cur = &rb_index_slots[rb_index_slot(contact, id, rb_index_slot_count)];
+	for (; *cur; cur = &(*cur)->index_next) {
+		if ((*cur)->contact == contact && (*cur)->data->id == id)
+			return cur;
+	}
+	return NULL;
+}
+
+static void rb_index_remove(struct routed_bundle_list *e)
+{
+	struct routed_bundle_list **const ptr =
+		rb_index_find(e->contact, e->data->id);
+
+	ASSERT(ptr != NULL && *ptr == e);
+	*ptr = e->index_next;
+	rb_index_entry_count--;
+}
+
+enum upcn_result contact_enqueue_bundle(
+	struct contact *contact, struct routed_bundle *rb)
+{
+	struct routed_bundle_queue *queue;
+	struct routed_bundle_list *e;
+
+	ASSERT(rb->prio < BUNDLE_RPRIO_MAX);
+	queue = &contact->contact_bundles[rb->prio];
+	e = malloc(sizeof(struct routed_bundle_list));
+	if (e == NULL)
+		return UPCN_FAIL;
+	e->data = rb;
+	e->contact = contact;
+	if (rb_index_insert(e) != UPCN_OK) {
+		free(e);
+		return UPCN_FAIL;
+	}
+	e->next = NULL;
+	e->prev = queue->tail;
+	if (queue->tail != NULL)
+		queue->tail->next = e;
+	else
+		queue->head = e;
+	queue->tail = e;
+	contact->bundle_count++;
+	return UPCN_OK;
+}
+
+struct routed_bundle *contact_dequeue_bundle(
+	struct contact *contact, bundleid_t id)
+{
+	struct routed_bundle_list **const ptr = rb_index_find(contact, id);
+	struct routed_bundle_queue *queue;
+	struct routed_bundle_list *e;
+	struct routed_bundle *rb;
+
+	if (ptr == NULL)
+		return NULL;
+	e = *ptr;
+	*ptr = e->index_next;
+	rb_index_entry_count--;
+	queue = &contact->contact_bundles[e->data->prio];
+	if (e->prev != NULL)
+		e->prev->next = e->next;
+	else
+		queue->head = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	else
+		queue->tail = e->prev;
+	contact->bundle_count--;
+	rb = e->data;
+	free(e);
+	return rb;
+}
+
+struct routed_bundle *contact_first_bundle(const struct contact *contact)
+{
+	int prio;
+
+	for (prio = BUNDLE_RPRIO_MAX - 1; prio >= 0; prio--) {
+		if (contact->contact_bundles[prio].head != NULL)
+			return contact->contact_bundles[prio].head->data;
+	}
+	return NULL;
+}
+
+struct routed_bundle_list *contact_take_bundles(struct contact *contact)
+{
+	struct routed_bundle_list *list = NULL, *e;
+	struct routed_bundle_queue *queue;
+	int prio;
+
+	/* Prepend the queues in ascending order of priority */
+	for (prio = 0; prio < BUNDLE_RPRIO_MAX; prio++) {
+		queue = &contact->contact_bundles[prio];
+		if (queue->head == NULL)
+			continue;
+		for (e = queue->head; e; e = e->next)
+			rb_index_remove(e);
+		queue->tail->next = list;
+		list = queue->head;
+		queue->head = NULL;
+		queue->tail = NULL;
+	}
+	contact->bundle_count = 0;
+	return list;
+}
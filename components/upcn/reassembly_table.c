@@ -0,0 +1,451 @@
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/config.h"
+#include "upcn/reassembly_table.h"
+#include "upcn/result.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SLOT_COUNT 16
+#define INITIAL_INTERVAL_CAPACITY 4
+#define INITIAL_CHUNK_CAPACITY 8
+
+// A range [start, end) of received bytes of the ADU
+struct reassembly_interval {
+	uint32_t start;
+	uint32_t end;
+};
+
+struct reassembly_entry {
+	// Identifier of the original bundle
+	uint8_t protocol_version;
+	uint64_t creation_timestamp;
+	uint64_t sequence_number;
+	uint32_t hash;
+	// Expiration time of the original bundle (in s)
+	uint64_t expiration_time;
+
+	// Contains the (owned) EIDs and the payload chunks sorted by offset
+	struct bundle_adu adu;
+	uint32_t chunk_capacity;
+	uint32_t received_bytes;
+	// Sum of the chunk lengths, including overlapping parts
+	uint32_t buffered_bytes;
+
+	// Sorted, disjoint and non-adjacent intervals
+	struct reassembly_interval *intervals;
+	uint32_t interval_count;
+	uint32_t interval_capacity;
+
+	struct reassembly_entry *next;
+};
+
+struct reassembly_table {
+	// slot_count is always a power of two
+	struct reassembly_entry **slots;
+	uint32_t slot_count;
+	uint32_t entry_count;
+	// Sum of the chunk lengths of all entries
+	uint32_t buffered_bytes;
+	// Lower bound for the expiration times of all entries
+	uint64_t next_expiration;
+};
+
+static uint32_t parent_hash(const struct bundle *b)
+{
+	const uint64_t fields[] = {
+		b->protocol_version,
+		b->creation_timestamp,
+		b->sequence_number,
+	};
+	const uint32_t h = hashlittle(b->source, strlen(b->source), 0);
+
+	return hashlittle(fields, sizeof(fields), h);
+}
+
+static bool is_parent_of(const struct reassembly_entry *e,
+			 const struct bundle *b, const uint32_t hash)
+{
+	return (
+		e->hash == hash &&
+		e->creation_timestamp == b->creation_timestamp &&
+		e->sequence_number == b->sequence_number &&
+		e->protocol_version == b->protocol_version &&
+		strcmp(e->adu.source, b->source) == 0
+	);
+}
+
+/* INTERVAL SET */
+
+// Returns the index of the first interval ending at or after pos
+static uint32_t interval_find(const struct reassembly_entry *e,
+			      const uint32_t pos)
+{
+	uint32_t lo = 0, hi = e->interval_count;
+
+	while (lo < hi) {
+		const uint32_t mid = lo + (hi - lo) / 2;
+
+		if (e->intervals[mid].end < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// Adds [start, end) to the set, returns the count of newly covered bytes
+static int64_t interval_add(struct reassembly_entry *e,
+			    const uint32_t start, const uint32_t end)
+{
+	const uint32_t first = interval_find(e, start);
+	uint32_t last = first;
+	uint32_t new_start = start, new_end = end;
+	uint32_t already_covered = 0;
+
+	// Merge all intervals overlapping or adjacent to [start, end)
+	while (last < e->interval_count && e->intervals[last].start <= end) {
+		const struct reassembly_interval *iv = &e->intervals[last];
+
+		already_covered += MIN(iv->end, end) - MAX(iv->start, start);
+		new_start = MIN(new_start, iv->start);
+		new_end = MAX(new_end, iv->end);
+		last++;
+	}
+
+	if (first == last) {
+		// No merge possible, insert a new interval
+		if (e->interval_count == e->interval_capacity) {
+			const uint32_t new_capacity =
+				e->interval_capacity * 2;
+			struct reassembly_interval *const new_intervals =
+				realloc(e->intervals,
+					sizeof(struct reassembly_interval) *
+					new_capacity);
+
+			if (!new_intervals)
+				return -1;
+			e->intervals = new_intervals;
+			e->interval_capacity = new_capacity;
+		}
+		memmove(&e->intervals[first + 1], &e->intervals[first],
+			sizeof(struct reassembly_interval) *
+			(e->interval_count - first));
+		e->interval_count++;
+	} else if (last - first > 1) {
+		// Collapse [first, last) into a single interval
+		memmove(&e->intervals[first + 1], &e->intervals[last],
+			sizeof(struct reassembly_interval) *
+			(e->interval_count - last));
+		e->interval_count -= last - first - 1;
+	}
+	e->intervals[first].start = new_start;
+	e->intervals[first].end = new_end;
+
+	return (int64_t)(end - start) - already_covered;
+}
+
+/* CHUNKS */
+
+static enum upcn_result chunk_reserve(struct reassembly_entry *e)
+{
+	const uint32_t new_capacity = e->chunk_capacity * 2;
+	struct bundle_adu_chunk *new_chunks;
+
+	if (e->adu.chunk_count < e->chunk_capacity)
+		return UPCN_OK;
+	new_chunks = realloc(e->adu.chunks,
+			     sizeof(struct bundle_adu_chunk) * new_capacity);
+	if (!new_chunks)
+		return UPCN_FAIL;
+	e->adu.chunks = new_chunks;
+	e->chunk_capacity = new_capacity;
+	return UPCN_OK;
+}
+
+// Requires a prior successful call to chunk_reserve()
+static void chunk_insert(struct reassembly_entry *e, const uint32_t offset,
+			 const uint32_t length, uint8_t *data)
+{
+	uint32_t i = e->adu.chunk_count;
+
+	// Fragments usually arrive in order, search from the end
+	while (i > 0 && e->adu.chunks[i - 1].offset > offset)
+		i--;
+	memmove(&e->adu.chunks[i + 1], &e->adu.chunks[i],
+		sizeof(struct bundle_adu_chunk) * (e->adu.chunk_count - i));
+	e->adu.chunks[i] = (struct bundle_adu_chunk){
+		.offset = offset,
+		.length = length,
+		.data = data,
+	};
+	e->adu.chunk_count++;
+}
+
+/* TABLE */
+
+static struct reassembly_entry **find_slot(
+	struct reassembly_table *table, const struct bundle *b,
+	const uint32_t hash)
+{
+	struct reassembly_entry **cur =
+		&table->slots[hash & (table->slot_count - 1)];
+
+	while (*cur != NULL && !is_parent_of(*cur, b, hash))
+		cur = &(*cur)->next;
+	return cur;
+}
+
+static void table_grow(struct reassembly_table *table)
+{
+	const uint32_t old_count = table->slot_count;
+	struct reassembly_entry **const old_slots = table->slots;
+	struct reassembly_entry **new_slots;
+	uint32_t i;
+
+	if (old_count > UINT32_MAX / 2)
+		return;
+	new_slots = calloc(old_count * 2, sizeof(struct reassembly_entry *));
+	if (!new_slots)
+		return;
+	table->slots = new_slots;
+	table->slot_count = old_count * 2;
+	for (i = 0; i < old_count; i++) {
+		while (old_slots[i] != NULL) {
+			struct reassembly_entry *const e = old_slots[i];
+			struct reassembly_entry **const slot = &new_slots[
+				e->hash & (table->slot_count - 1)
+			];
+
+			old_slots[i] = e->next;
+			e->next = *slot;
+			*slot = e;
+		}
+	}
+	free(old_slots);
+}
+
+static struct reassembly_entry *entry_create(const struct bundle *b,
+					     const uint32_t hash)
+{
+	struct reassembly_entry *e = malloc(sizeof(struct reassembly_entry));
+
+	if (!e)
+		return NULL;
+	e->protocol_version = b->protocol_version;
+	e->creation_timestamp = b->creation_timestamp;
+	e->sequence_number = b->sequence_number;
+	e->hash = hash;
+	e->expiration_time = bundle_get_expiration_time(b);
+	e->adu = bundle_adu_init(b);
+	e->adu.length = b->total_adu_length;
+	e->chunk_capacity = INITIAL_CHUNK_CAPACITY;
+	e->adu.chunks = malloc(sizeof(struct bundle_adu_chunk) *
+			       e->chunk_capacity);
+	e->received_bytes = 0;
+	e->buffered_bytes = 0;
+	e->interval_count = 0;
+	e->interval_capacity = INITIAL_INTERVAL_CAPACITY;
+	e->intervals = malloc(sizeof(struct reassembly_interval) *
+			      e->interval_capacity);
+	e->next = NULL;
+	if (!e->adu.source || !e->adu.destination || !e->adu.chunks ||
+			!e->intervals) {
+		bundle_adu_free_members(e->adu);
+		free(e->intervals);
+		free(e);
+		return NULL;
+	}
+	return e;
+}
+
+static void entry_free(struct reassembly_entry *e)
+{
+	bundle_adu_free_members(e->adu);
+	free(e->intervals);
+	free(e);
+}
+
+struct reassembly_table *reassembly_table_create(void)
+{
+	struct reassembly_table *table =
+		malloc(sizeof(struct reassembly_table));
+
+	if (!table)
+		return NULL;
+	table->slot_count = INITIAL_SLOT_COUNT;
+	table->entry_count = 0;
+	table->buffered_bytes = 0;
+	table->next_expiration = UINT64_MAX;
+	table->slots = calloc(table->slot_count,
+			      sizeof(struct reassembly_entry *));
+	if (!table->slots) {
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+void reassembly_table_free(struct reassembly_table *table)
+{
+	uint32_t i;
+
+	if (!table)
+		return;
+	for (i = 0; i < table->slot_count; i++) {
+		while (table->slots[i] != NULL) {
+			struct reassembly_entry *const e = table->slots[i];
+
+			table->slots[i] = e->next;
+			entry_free(e);
+		}
+	}
+	free(table->slots);
+	free(table);
+}
+
+static void entry_remove(struct reassembly_table *table,
+			 struct reassembly_entry **slot)
+{
+	struct reassembly_entry *const e = *slot;
+
+	*slot = e->next;
+	table->entry_count--;
+	table->buffered_bytes -= e->buffered_bytes;
+	entry_free(e);
+}
+
+uint32_t reassembly_table_expire(struct reassembly_table *table,
+				 const uint64_t now)
+{
+	struct reassembly_entry **cur;
+	uint64_t next_expiration = UINT64_MAX;
+	uint32_t i, expired = 0;
+
+	if (now < table->next_expiration)
+		return 0;
+	for (i = 0; i < table->slot_count; i++) {
+		cur = &table->slots[i];
+		while (*cur != NULL) {
+			if ((*cur)->expiration_time <= now) {
+				entry_remove(table, cur);
+				expired++;
+				continue;
+			}
+			next_expiration = MIN(next_expiration,
+					      (*cur)->expiration_time);
+			cur = &(*cur)->next;
+		}
+	}
+	table->next_expiration = next_expiration;
+	return expired;
+}
+
+// Drops the incomplete ADU expiring first, except for the given one
+static bool evict_entry(struct reassembly_table *table,
+			const struct reassembly_entry *keep)
+{
+	struct reassembly_entry **cur, **victim = NULL;
+	uint32_t i;
+
+	for (i = 0; i < table->slot_count; i++) {
+		for (cur = &table->slots[i]; *cur != NULL;
+				cur = &(*cur)->next) {
+			if (*cur != keep && (victim == NULL ||
+					(*cur)->expiration_time <
+					(*victim)->expiration_time))
+				victim = cur;
+		}
+	}
+	if (victim == NULL)
+		return false;
+	entry_remove(table, victim);
+	return true;
+}
+
+enum reassembly_result reassembly_table_add(
+	struct reassembly_table *table, struct bundle *fragment,
+	struct bundle_adu *adu)
+{
+	const uint32_t hash = parent_hash(fragment);
+	const uint32_t offset = fragment->fragment_offset;
+	const uint32_t length = fragment->payload_block->length;
+	struct reassembly_entry **slot = find_slot(table, fragment, hash);
+	struct reassembly_entry *e = *slot;
+	int64_t new_bytes;
+
+	// The fragment has to fit into the ADU
+	if (offset > fragment->total_adu_length ||
+			length > fragment->total_adu_length - offset)
+		return REASSEMBLY_FAILED;
+
+	// Limit the memory occupied by the buffered payload chunks
+	if (length > REASSEMBLY_BUFFER_QUOTA)
+		return REASSEMBLY_FAILED;
+	if (length > REASSEMBLY_BUFFER_QUOTA - table->buffered_bytes) {
+		while (length > REASSEMBLY_BUFFER_QUOTA -
+				table->buffered_bytes) {
+			if (!evict_entry(table, e))
+				return REASSEMBLY_FAILED;
+		}
+		slot = find_slot(table, fragment, hash);
+	}
+
+	if (e == NULL) {
+		if (table->entry_count >= table->slot_count) {
+			table_grow(table);
+			slot = find_slot(table, fragment, hash);
+		}
+		e = entry_create(fragment, hash);
+		if (!e)
+			return REASSEMBLY_FAILED;
+		*slot = e;
+		table->entry_count++;
+		table->next_expiration = MIN(table->next_expiration,
+					     e->expiration_time);
+	}
+
+	if (fragment->total_adu_length != e->adu.length)
+		return REASSEMBLY_FAILED;
+
+	if (length != 0) {
+		if (chunk_reserve(e) != UPCN_OK)
+			return REASSEMBLY_FAILED;
+		new_bytes = interval_add(e, offset, offset + length);
+		if (new_bytes < 0)
+			return REASSEMBLY_FAILED;
+		// Take over the payload if it contains anything new
+		if (new_bytes != 0) {
+			chunk_insert(e, offset, length,
+				     fragment->payload_block->data);
+			fragment->payload_block->data = NULL;
+			fragment->payload_block->length = 0;
+			e->buffered_bytes += length;
+			table->buffered_bytes += length;
+		}
+		e->received_bytes += (uint32_t)new_bytes;
+	}
+
+	if (e->received_bytes != e->adu.length)
+		return REASSEMBLY_PENDING;
+
+	// Complete, hand over the ADU and remove the entry
+	*slot = e->next;
+	table->entry_count--;
+	table->buffered_bytes -= e->buffered_bytes;
+	*adu = e->adu;
+	free(e->intervals);
+	free(e);
+	return REASSEMBLY_COMPLETE;
+}
+
+uint32_t reassembly_table_count(const struct reassembly_table *table)
+{
+	return table->entry_count;
+}
@@ -1,4 +1,5 @@
 #include "upcn/bundle.h"
+#include "upcn/config.h"
 #include "upcn/parser.h"
 #include "upcn/report_manager.h"
 
@@ -57,6 +58,22 @@ struct bundle_list *generate_custody_signal(
 }
 
 
+struct bundle *generate_aggregate_custody_signal(
+	const char *custodian, const struct bundle_custody_signal *signal,
+	const struct bundle_acs_fill *fills, const uint32_t fill_count,
+	const char *local_eid)
+{
+	return bundle6_generate_aggregate_custody_signal(
+		custodian,
+		signal,
+		fills,
+		fill_count,
+		local_eid,
+		CUSTODY_ACS_LIFETIME
+	);
+}
+
+
 struct bundle_administrative_record *parse_administrative_record(
 	uint8_t protocol_version,
 	const uint8_t *const data, const size_t length)
@@ -80,6 +97,7 @@ void free_administrative_record(struct bundle_administrative_record *record)
 		free(record->custody_signal);
 		free(record->status_report);
 		free(record->bundle_source_eid);
+		free(record->acs_fills);
 		free(record);
 	}
 }
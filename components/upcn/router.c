@@ -2,12 +2,17 @@
 #include "upcn/common.h"
 #include "upcn/node.h"
 #include "upcn/router.h"
+#include "upcn/router_cgr.h"
+#include "upcn/router_optimizer.h"
 #include "upcn/routing_table.h"
 
 #include "cla/cla.h"
 
 #include "platform/hal_io.h"
 
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -25,6 +30,8 @@ static struct router_config RC = {
 	.opt_max_pre_bundles = OPTIMIZATION_MAX_PRE_BUNDLES,
 	.opt_max_pre_bundles_contact = OPTIMIZATION_MAX_PRE_BUNDLES_CONTACT,
 	.router_min_contacts_htab = ROUTER_MIN_CONTACTS_HTAB,
+	.router_min_contacts_nbf = ROUTER_MIN_CONTACTS_NBF,
+	.router_nbf_base_reliability = ROUTER_NBF_BASE_RELIABILITY,
 	.router_def_base_reliability = ROUTER_DEF_BASE_RELIABILITY
 };
 
@@ -55,6 +62,8 @@ enum upcn_result router_update_config(struct router_config conf)
 		|| w > 1.0001f || w < 0.9999f
 		|| conf.opt_max_bundles < 1
 		|| conf.opt_max_pre_bundles_contact > conf.opt_max_pre_bundles
+		|| conf.router_nbf_base_reliability > 1.0f
+		|| conf.router_nbf_base_reliability <= 0
 		|| conf.router_def_base_reliability > 1.0f
 		|| conf.router_def_base_reliability <= 0
 	) {
@@ -65,77 +74,195 @@ enum upcn_result router_update_config(struct router_config conf)
 	return UPCN_OK;
 }
 
-struct associated_contact_list *router_lookup_destination(char *const dest)
+/*
+ * Destination EIDs are mapped to their candidate contacts via a
+ * direct-mapped cache. Entries are valid until the routing table changes
+ * or their first route expires.
+ */
+struct destination_cache_entry {
+	char *destination;
+	uint32_t hash;
+	uint32_t version;
+	uint64_t expiry;
+	struct router_candidate candidates[ROUTER_CGR_MAX_ROUTES];
+	uint8_t candidate_count;
+};
+
+static struct destination_cache_entry
+	destination_cache[ROUTER_DESTINATION_CACHE_SIZE];
+
+static bool has_candidate(
+	const struct destination_cache_entry *entry,
+	const struct contact *contact)
+{
+	uint8_t i;
+
+	for (i = 0; i < entry->candidate_count; i++) {
+		if (entry->candidates[i].contact == contact)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Adds the routes to all nodes whose NBF contains the EID as candidates,
+ * with the base reliability as they may not know the destination after all.
+ */
+static void add_nbf_candidates(
+	struct destination_cache_entry *entry, const char *eid,
+	const uint64_t time)
+{
+	struct node *nodes[ROUTER_CGR_MAX_ROUTES];
+	const struct router_cgr_route *routes;
+	uint8_t node_count, route_count, i, j;
+
+	node_count = routing_table_lookup_eid_in_nbf(
+		eid, nodes, ROUTER_CGR_MAX_ROUTES);
+	for (i = 0; i < node_count; i++) {
+		route_count = router_cgr_get_routes(
+			nodes[i]->eid, time, &routes);
+		for (j = 0; j < route_count &&
+				entry->candidate_count < ROUTER_CGR_MAX_ROUTES;
+				j++) {
+			if (has_candidate(entry, routes[j].first_hop))
+				continue;
+			entry->candidates[entry->candidate_count++] =
+				(struct router_candidate){
+					.contact = routes[j].first_hop,
+					.p = RC.router_nbf_base_reliability,
+					.arrival = routes[j].arrival,
+				};
+			entry->expiry = MIN(entry->expiry, routes[j].expiry);
+		}
+	}
+}
+
+static void sort_candidates(struct destination_cache_entry *entry)
+{
+	struct router_candidate cur;
+	uint8_t i, j;
+
+	for (i = 1; i < entry->candidate_count; i++) {
+		cur = entry->candidates[i];
+		for (j = i; j > 0 &&
+				entry->candidates[j - 1].arrival > cur.arrival;
+				j--)
+			entry->candidates[j] = entry->candidates[j - 1];
+		entry->candidates[j] = cur;
+	}
+}
+
+static enum upcn_result update_destination(
+	struct destination_cache_entry *entry, const char *dest,
+	const uint32_t hash, const uint64_t time)
 {
 	const char *const DTN_SCHEME = "dtn://";
 	const size_t DTN_SCHEME_LENGTH = strlen(DTN_SCHEME);
 
-	char *dest_node_eid = dest;
-	bool free_dest_node_eid = false;
-	char *const found = strstr(dest, DTN_SCHEME);
+	const char *dest_node_eid = dest;
+	char *node_id = NULL;
+	const struct router_cgr_route *routes;
+	uint8_t route_count, i;
+
+	if (!entry->destination || entry->hash != hash ||
+			strcmp(entry->destination, dest) != 0) {
+		free(entry->destination);
+		entry->destination = strdup(dest);
+		if (!entry->destination)
+			return UPCN_FAIL;
+		entry->hash = hash;
+	}
 
 	// We only support dtn://node_id/app_id decoding for dtn:// EIDs
-	if (found == dest) {
-		char *const node_id_end = strchr(
+	if (strncmp(dest, DTN_SCHEME, DTN_SCHEME_LENGTH) == 0) {
+		const char *const node_id_end = strchr(
 			dest + DTN_SCHEME_LENGTH, '/'
 		);
 
 		if (node_id_end) {
-			const size_t node_id_len = node_id_end - dest;
-			char *const node_id = malloc(node_id_len + 1);
-
-			strncpy(node_id, dest, node_id_len);
-			node_id[node_id_len] = 0;
+			node_id = strndup(dest, node_id_end - dest);
+			if (!node_id)
+				return UPCN_FAIL;
 			dest_node_eid = node_id;
-			free_dest_node_eid = true;
 		}
 	}
-
-	const struct node_table_entry *const e = routing_table_lookup_eid(
-		dest_node_eid
-	);
-	uint16_t results = 0;
-	struct associated_contact_list *result = NULL;
-
-	if (e != NULL) {
-		struct associated_contact_list *cur = e->contacts;
-
-		while (cur != NULL) {
-			add_contact_to_ordered_assoc_list(
-				&result, cur->data, cur->p, 0);
-			results++;
-			cur = cur->next;
-		}
+	route_count = router_cgr_get_routes(dest_node_eid, time, &routes);
+
+	entry->version = routing_table_get_version();
+	entry->expiry = UINT64_MAX;
+	for (i = 0; i < route_count; i++) {
+		entry->candidates[i] = (struct router_candidate){
+			.contact = routes[i].first_hop,
+			.p = 1.0f,
+			.arrival = routes[i].arrival,
+		};
+		entry->expiry = MIN(entry->expiry, routes[i].expiry);
+	}
+	entry->candidate_count = route_count;
+
+	// Too few known routes, try the nodes announcing the EID via NBFs
+	if (route_count < RC.router_min_contacts_htab) {
+		if (node_id)
+			add_nbf_candidates(entry, node_id, time);
+		add_nbf_candidates(entry, dest, time);
+		if (entry->candidate_count != route_count)
+			sort_candidates(entry);
 	}
+	free(node_id);
+	return UPCN_OK;
+}
 
-	if (free_dest_node_eid)
-		free(dest_node_eid);
+uint8_t router_lookup_destination(
+	const char *const dest, const uint64_t exp_time,
+	const struct router_candidate **candidates)
+{
+	const uint64_t time = hal_time_get_timestamp_s_coarse();
+	const uint32_t hash = hashlittle(dest, strlen(dest), 0);
+	struct destination_cache_entry *const entry = &destination_cache[
+		hash & (ROUTER_DESTINATION_CACHE_SIZE - 1)
+	];
+	uint8_t count = 0;
+
+	if (!entry->destination || entry->hash != hash ||
+			entry->version != routing_table_get_version() ||
+			entry->expiry <= time ||
+			strcmp(entry->destination, dest) != 0) {
+		if (update_destination(entry, dest, hash, time) != UPCN_OK)
+			return 0;
+	}
 
-	return result;
+	// Candidates are ordered by arrival, cut off all arriving too late
+	while (count < entry->candidate_count &&
+			MAX(entry->candidates[count].arrival, time) < exp_time)
+		count++;
+	*candidates = entry->candidates;
+	return count;
 }
 
 static inline struct max_fragment_size_result {
 	uint32_t max_fragment_size;
-	uint32_t payload_capacity;
+	uint64_t payload_capacity;
 } router_get_max_reasonable_fragment_size(
-	struct associated_contact_list *contacts, uint32_t full_size,
+	const struct router_candidate *candidates, uint8_t candidate_count,
+	uint32_t full_size,
 	uint32_t max_fragment_min_size, uint32_t payload_size,
 	enum bundle_routing_priority priority, uint64_t exp_time)
 {
-	uint32_t payload_capacity = 0;
+	uint64_t payload_capacity = 0;
 	uint32_t max_frag_size = UINT32_MAX;
-	uint32_t min_capacity, c_capacity;
-	int32_t c_pay_capacity;
+	uint32_t min_capacity;
+	int64_t c_capacity, c_pay_capacity;
 	struct contact *c;
 	float conf, p;
+	uint8_t i;
 
 	(void)exp_time;
 	min_capacity = payload_size / ROUTER_MAX_FRAGMENTS;
 	min_capacity += max_fragment_min_size;
-	while (contacts != NULL && payload_capacity < payload_size) {
-		c = contacts->data;
-		p = contacts->p;
-		contacts = contacts->next;
+	for (i = 0; i < candidate_count && payload_capacity < payload_size;
+			i++) {
+		c = candidates[i].contact;
+		p = candidates[i].p;
 		//if (c->to > exp_time)
 		//	break;
 		c_capacity = ROUTER_CONTACT_CAPACITY(c, priority);
@@ -150,8 +277,9 @@ static inline struct max_fragment_size_result {
 			continue;
 		const size_t c_mbs = MIN(
 			MIN(
-				(size_t)c_capacity,
-				cla_config->vtable->cla_mbs_get(cla_config)
+				(uint64_t)c_capacity,
+				(uint64_t)cla_config->vtable->cla_mbs_get(
+					cla_config)
 			),
 			RC.global_mbs
 		);
@@ -170,7 +298,7 @@ static inline struct max_fragment_size_result {
 			if (c_pay_capacity > RC.fragment_min_payload) {
 				/* Reasonable? */
 				payload_capacity
-					+= (uint32_t)(conf * c_pay_capacity);
+					+= (uint64_t)(conf * c_pay_capacity);
 				max_frag_size = MIN(max_frag_size, c_mbs);
 			}
 		}
@@ -183,13 +311,14 @@ static inline struct max_fragment_size_result {
 
 uint8_t router_calculate_fragment_route(
 	struct fragment_route *res, uint32_t size,
-	struct associated_contact_list *contacts, uint32_t preprocessed_size,
-	enum bundle_routing_priority priority, uint64_t exp_time,
-	struct contact **excluded_contacts, uint8_t excluded_contacts_count)
+	const struct router_candidate *candidates, uint8_t candidate_count,
+	uint32_t preprocessed_size, enum bundle_routing_priority priority,
+	uint64_t exp_time, struct contact **excluded_contacts,
+	uint8_t excluded_contacts_count)
 {
-	uint64_t time = hal_time_get_timestamp_s();
-	uint32_t cap;
-	uint8_t d, i;
+	uint64_t time = hal_time_get_timestamp_s_coarse();
+	int64_t cap;
+	uint8_t d, i, n;
 	float conf, p;
 	struct contact *c;
 
@@ -197,13 +326,12 @@ uint8_t router_calculate_fragment_route(
 	res->contact_count = 0;
 	res->probability = 0;
 	res->preemption_improved = 0;
-	while (contacts != NULL
+	for (n = 0; n < candidate_count
 		&& res->probability < RC.min_probability
-		&& res->contact_count != ROUTER_MAX_CONTACTS
+		&& res->contact_count != ROUTER_MAX_CONTACTS; n++
 	) {
-		c = contacts->data;
-		p = contacts->p;
-		contacts = contacts->next;
+		c = candidates[n].contact;
+		p = candidates[n].p;
 		d = 0;
 		for (i = 0; i < excluded_contacts_count; i++)
 			if (c == excluded_contacts[i])
@@ -252,16 +380,17 @@ uint8_t router_calculate_fragment_route(
 }
 
 static inline void router_get_first_route_nonfrag(
-	struct router_result *res, struct associated_contact_list *contacts,
-	struct bundle *bundle, uint32_t bundle_size, uint64_t expiration_time)
+	struct router_result *res, const struct router_candidate *candidates,
+	uint8_t candidate_count, struct bundle *bundle, uint32_t bundle_size,
+	uint64_t expiration_time)
 {
 	res->fragment_results[0].payload_size
 		= bundle->payload_block->length;
 	/* Determine route */
 	if (router_calculate_fragment_route(
 		&res->fragment_results[0], bundle_size,
-		contacts, 0, ROUTER_BUNDLE_PRIORITY(bundle), expiration_time,
-		NULL, 0)
+		candidates, candidate_count, 0, ROUTER_BUNDLE_PRIORITY(bundle),
+		expiration_time, NULL, 0)
 	) {
 		res->fragments = 1;
 		res->probability
@@ -272,9 +401,10 @@ static inline void router_get_first_route_nonfrag(
 }
 
 static inline void router_get_first_route_frag(
-	struct router_result *res, struct associated_contact_list *contacts,
-	struct bundle *bundle, uint32_t bundle_size, uint64_t expiration_time,
-	uint32_t max_frag_sz, uint32_t first_frag_sz, uint32_t last_frag_sz)
+	struct router_result *res, const struct router_candidate *candidates,
+	uint8_t candidate_count, struct bundle *bundle, uint32_t bundle_size,
+	uint64_t expiration_time, uint32_t max_frag_sz, uint32_t first_frag_sz,
+	uint32_t last_frag_sz)
 {
 	uint32_t mid_frag_sz, next_frag_sz, remaining_pay, processed_sz;
 	int32_t min_pay, max_pay;
@@ -332,8 +462,9 @@ static inline void router_get_first_route_frag(
 			bundle_size += mid_frag_sz;
 		success += router_calculate_fragment_route(
 			&res->fragment_results[index], bundle_size,
-			contacts, processed_sz, ROUTER_BUNDLE_PRIORITY(bundle),
-			expiration_time, NULL, 0);
+			candidates, candidate_count, processed_sz,
+			ROUTER_BUNDLE_PRIORITY(bundle), expiration_time,
+			NULL, 0);
 		res->probability *= res->fragment_results[index].probability;
 		res->preemption_improved
 			+= res->fragment_results[index].preemption_improved;
@@ -350,12 +481,13 @@ struct router_result router_get_first_route(struct bundle *bundle)
 {
 	const uint64_t expiration_time = bundle_get_expiration_time(bundle);
 	struct router_result res;
-	struct associated_contact_list *contacts
-		= router_lookup_destination(bundle->destination);
+	const struct router_candidate *candidates;
+	const uint8_t candidate_count = router_lookup_destination(
+		bundle->destination, expiration_time, &candidates);
 
 	res.fragments = 0;
 	res.probability = 0.0f;
-	if (contacts == NULL) {
+	if (candidate_count == 0) {
 		LOGF("Router: Could not determine a node over which the destination \"%s\" is reachable",
 		     bundle->destination);
 		return res;
@@ -369,7 +501,8 @@ struct router_result router_get_first_route(struct bundle *bundle)
 
 	const struct max_fragment_size_result mrfs =
 		router_get_max_reasonable_fragment_size(
-			contacts,
+			candidates,
+			candidate_count,
 			bundle_size,
 			MAX(first_frag_sz, last_frag_sz),
 			bundle->payload_block->length,
@@ -378,11 +511,11 @@ struct router_result router_get_first_route(struct bundle *bundle)
 		);
 
 	if (mrfs.max_fragment_size == 0) {
-		LOGF("Router: Contact payload capacity (%lu bytes) too low for bundle of size %lu bytes (min. frag. sz. = %lu, payload sz. = %lu)",
-		     mrfs.payload_capacity, bundle_size,
+		LOGF("Router: Contact payload capacity (%llu bytes) too low for bundle of size %lu bytes (min. frag. sz. = %lu, payload sz. = %lu)",
+		     (unsigned long long)mrfs.payload_capacity, bundle_size,
 		     MAX(first_frag_sz, last_frag_sz),
 		     bundle->payload_block->length);
-		goto finish;
+		return res;
 	} else if (mrfs.max_fragment_size != UINT32_MAX) {
 		LOGF("Router: Determined max. frag size of %lu bytes for bundle of size %lu bytes (payload sz. = %lu)",
 		     mrfs.max_fragment_size, bundle_size,
@@ -392,18 +525,18 @@ struct router_result router_get_first_route(struct bundle *bundle)
 	if (bundle_must_not_fragment(bundle) ||
 			bundle_size <= mrfs.max_fragment_size)
 		router_get_first_route_nonfrag(&res,
-			contacts, bundle, bundle_size, expiration_time);
+			candidates, candidate_count, bundle, bundle_size,
+			expiration_time);
 	else
 		router_get_first_route_frag(&res,
-			contacts, bundle, bundle_size, expiration_time,
-			mrfs.max_fragment_size, first_frag_sz, last_frag_sz);
+			candidates, candidate_count, bundle, bundle_size,
+			expiration_time, mrfs.max_fragment_size,
+			first_frag_sz, last_frag_sz);
 
 	if (!res.fragments)
 		LOGF("Router: No feasible route found for bundle to \"%s\" with size of %lu bytes",
 		     bundle->destination, bundle_size);
 
-finish:
-	list_free(contacts);
 	return res;
 }
 
@@ -411,7 +544,7 @@ finish:
 struct router_result router_try_reuse(
 	struct router_result route, struct bundle *bundle)
 {
-	uint64_t time = hal_time_get_timestamp_s();
+	uint64_t time = hal_time_get_timestamp_s_coarse();
 	uint64_t expiration_time = bundle_get_expiration_time(bundle);
 	uint32_t remaining_pay = bundle->payload_block->length;
 	uint32_t size, min_cap;
@@ -430,7 +563,7 @@ struct router_result router_try_reuse(
 			if (fr->contacts[c]->to <= time
 				|| fr->contacts[c]->to > expiration_time
 				|| ROUTER_CONTACT_CAPACITY(fr->contacts[c], 0)
-					< (int32_t)size
+					< (int64_t)size
 			) {
 				route.fragments = 0;
 				route.probability = 0;
@@ -454,7 +587,7 @@ struct router_result router_try_reuse(
 			if (fr->contacts[c]->to <= time
 				|| fr->contacts[c]->to > expiration_time
 				|| ROUTER_CONTACT_CAPACITY(fr->contacts[c], 0)
-					< (int32_t)(size
+					< (int64_t)(size
 						+ RC.fragment_min_payload)
 			) {
 				route.fragments = 0;
@@ -484,28 +617,19 @@ struct router_result router_try_reuse(
 enum upcn_result router_add_bundle_to_contact(
 	struct contact *contact, struct routed_bundle *rb)
 {
-	struct routed_bundle_list *new_entry, **cur_entry;
-
 	ASSERT(contact != NULL);
 	ASSERT(rb != NULL);
 	ASSERT(contact->remaining_capacity_p0 > 0);
-	new_entry = malloc(sizeof(struct routed_bundle_list));
-	if (new_entry == NULL)
+	if (contact_enqueue_bundle(contact, rb) != UPCN_OK)
 		return UPCN_FAIL;
-	new_entry->data = rb;
-	new_entry->next = NULL;
-	cur_entry = &contact->contact_bundles;
-	/* Go to end of list (=> FIFO) */
-	while (*cur_entry != NULL)
-		cur_entry = &(*cur_entry)->next;
-	*cur_entry = new_entry;
-	contact->bundle_count++;
 	contact->remaining_capacity_p0 -= rb->size;
 	if (rb->prio > BUNDLE_RPRIO_LOW) {
 		contact->remaining_capacity_p1 -= rb->size;
 		if (rb->prio != BUNDLE_RPRIO_NORMAL)
 			contact->remaining_capacity_p2 -= rb->size;
 	}
+	if (rb->preemption_improvement != 0)
+		router_optimizer_mark_dirty(contact);
 	return UPCN_OK;
 }
 
@@ -513,31 +637,18 @@ struct routed_bundle *router_remove_bundle_from_contact(
 	struct contact *contact, bundleid_t id)
 {
 	struct routed_bundle *rb;
-	struct routed_bundle_list **cur_entry, *tmp;
 
 	ASSERT(contact != NULL);
-	cur_entry = &contact->contact_bundles;
-	/* Find rb */
-	while (*cur_entry != NULL) {
-		ASSERT((*cur_entry)->data != NULL);
-		if ((*cur_entry)->data->id == id) {
-			rb = (*cur_entry)->data;
-			tmp = *cur_entry;
-			*cur_entry = (*cur_entry)->next;
-			free(tmp);
-			contact->bundle_count--;
-			contact->remaining_capacity_p0 += rb->size;
-			if (rb->prio > BUNDLE_RPRIO_LOW) {
-				contact->remaining_capacity_p1 += rb->size;
-				if (rb->prio != BUNDLE_RPRIO_NORMAL)
-					contact->remaining_capacity_p2
-						+= rb->size;
-			}
-			return rb;
-		}
-		cur_entry = &(*cur_entry)->next;
+	rb = contact_dequeue_bundle(contact, id);
+	if (rb == NULL)
+		return NULL;
+	contact->remaining_capacity_p0 += rb->size;
+	if (rb->prio > BUNDLE_RPRIO_LOW) {
+		contact->remaining_capacity_p1 += rb->size;
+		if (rb->prio != BUNDLE_RPRIO_NORMAL)
+			contact->remaining_capacity_p2 += rb->size;
 	}
-	return NULL;
+	return rb;
 }
 
 uint8_t router_add_bundle_to_route(struct fragment_route *r, struct bundle *b)
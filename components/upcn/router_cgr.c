@@ -0,0 +1,809 @@
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/config.h"
+#include "upcn/eid_index.h"
+#include "upcn/node.h"
+#include "upcn/router_cgr.h"
+#include "upcn/routing_table.h"
+
+#include "util/htab_hash.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SLOT_COUNT 16
+#define LOCAL_VERTEX 0
+#define NO_VERTEX UINT32_MAX
+#define NO_EDGE UINT32_MAX
+
+struct cgr_edge {
+	uint32_t target;
+	// The contact defining the edge, NULL for persistent links
+	struct contact *contact;
+	uint64_t from;
+	uint64_t to;
+};
+
+// A vertex via which the destination can be reached in the given interval
+struct cgr_terminal {
+	uint32_t vertex;
+	const struct contact *contact;
+	uint64_t from;
+	uint64_t to;
+};
+
+struct cgr_heap_item {
+	uint64_t arrival;
+	uint32_t vertex;
+};
+
+// A node or contact some cached route depends on
+struct cgr_dependency {
+	const struct node *node;
+	const struct contact *contact;
+};
+
+struct cgr_cache_entry {
+	char *destination;
+	uint32_t hash;
+
+	struct router_cgr_route routes[ROUTER_CGR_MAX_ROUTES];
+	uint8_t route_count;
+
+	struct cgr_dependency *deps;
+	uint32_t dep_count;
+	uint32_t dep_capacity;
+
+	struct cgr_cache_entry *next;
+};
+
+/*
+ * Snapshot of the contact graph, edges are stored in compressed sparse row
+ * form. It is rebuilt lazily after every routing table change, which does
+ * not necessarily invalidate the cached routes.
+ */
+static struct {
+	bool valid;
+
+	struct node **nodes; // NULL for the local vertex
+	uint32_t vertex_count;
+	uint32_t *first_edge;
+	struct cgr_edge *edges;
+
+	// Maps node EIDs to vertices (open addressing)
+	uint32_t *index;
+	uint32_t index_mask;
+
+	// Scratch space for the route search
+	uint64_t *arrival;
+	uint32_t *via;
+	uint32_t *prev;
+	uint32_t *hops;
+	bool *done;
+	struct cgr_heap_item *heap;
+	uint32_t heap_count;
+} graph;
+
+// Route cache, slot_count is always a power of two
+static struct cgr_cache_entry **slots;
+static uint32_t slot_count;
+static uint32_t entry_count;
+
+// During bulk updates, the cache is invalidated once at the end
+static bool bulk_update, bulk_changed;
+
+static uint32_t eid_hash(const char *eid)
+{
+	return hashlittle(eid, strlen(eid), 0);
+}
+
+static bool endpoint_list_contains(const struct endpoint_list *list,
+				   const char *eid)
+{
+	for (; list != NULL; list = list->next) {
+		if (eid_matches(list->eid, eid))
+			return true;
+	}
+	return false;
+}
+
+/* GRAPH */
+
+static void graph_free(void)
+{
+	free(graph.nodes);
+	free(graph.first_edge);
+	free(graph.edges);
+	free(graph.index);
+	free(graph.arrival);
+	free(graph.via);
+	free(graph.prev);
+	free(graph.hops);
+	free(graph.done);
+	free(graph.heap);
+	memset(&graph, 0, sizeof(graph));
+}
+
+static uint32_t vertex_lookup(const char *eid)
+{
+	uint32_t i = eid_hash(eid) & graph.index_mask;
+
+	while (graph.index[i] != NO_VERTEX) {
+		if (strcmp(graph.nodes[graph.index[i]]->eid, eid) == 0)
+			return graph.index[i];
+		i = (i + 1) & graph.index_mask;
+	}
+	return NO_VERTEX;
+}
+
+static void vertex_insert(const uint32_t vertex)
+{
+	uint32_t i = eid_hash(graph.nodes[vertex]->eid) & graph.index_mask;
+
+	while (graph.index[i] != NO_VERTEX)
+		i = (i + 1) & graph.index_mask;
+	graph.index[i] = vertex;
+}
+
+// Counts the edges per vertex or, if fill is set, stores them
+static void emit_edge(const uint32_t vertex, const struct cgr_edge edge,
+		      const bool fill)
+{
+	if (fill)
+		graph.edges[graph.via[vertex]++] = edge;
+	else
+		graph.first_edge[vertex + 1]++;
+}
+
+// Emits edges from the vertex to all nodes named by the endpoint
+static void emit_endpoint_edges(const uint32_t vertex, const char *endpoint,
+				struct cgr_edge edge, const bool fill)
+{
+	uint32_t target;
+
+	if (!eid_is_pattern(endpoint)) {
+		edge.target = vertex_lookup(endpoint);
+		if (edge.target != NO_VERTEX && edge.target != vertex)
+			emit_edge(vertex, edge, fill);
+		return;
+	}
+	for (target = LOCAL_VERTEX + 1; target < graph.vertex_count; target++) {
+		const char *const eid = graph.nodes[target]->eid;
+
+		if (target == vertex || !eid_matches(endpoint, eid))
+			continue;
+		edge.target = target;
+		emit_edge(vertex, edge, fill);
+	}
+}
+
+static void emit_edges(const bool fill)
+{
+	struct contact_list *cl = *routing_table_get_raw_contact_list_ptr();
+	struct endpoint_list *el;
+	uint32_t v;
+
+	for (; cl != NULL; cl = cl->next) {
+		struct contact *const c = cl->data;
+
+		if (c->node == NULL)
+			continue;
+		v = vertex_lookup(c->node->eid);
+		if (v == NO_VERTEX)
+			continue;
+		emit_edge(LOCAL_VERTEX, (struct cgr_edge){
+			v, c, c->from, c->to }, fill);
+		for (el = c->contact_endpoints; el != NULL; el = el->next)
+			emit_endpoint_edges(v, el->eid, (struct cgr_edge){
+				NO_VERTEX, c, c->from, c->to }, fill);
+	}
+	for (v = LOCAL_VERTEX + 1; v < graph.vertex_count; v++) {
+		for (el = graph.nodes[v]->endpoints; el != NULL;
+				el = el->next)
+			emit_endpoint_edges(v, el->eid, (struct cgr_edge){
+				NO_VERTEX, NULL, 0, UINT64_MAX }, fill);
+	}
+}
+
+static enum upcn_result graph_build(void)
+{
+	struct node_list *nl;
+	uint32_t count = 1, index_size = 2, edge_count, v;
+
+	graph_free();
+	for (nl = routing_table_get_node_list(); nl != NULL; nl = nl->next)
+		count++;
+	while (index_size < count * 2)
+		index_size *= 2;
+
+	graph.nodes = malloc(sizeof(struct node *) * count);
+	graph.first_edge = calloc(count + 1, sizeof(uint32_t));
+	graph.index = malloc(sizeof(uint32_t) * index_size);
+	graph.arrival = malloc(sizeof(uint64_t) * count);
+	graph.via = malloc(sizeof(uint32_t) * count);
+	graph.prev = malloc(sizeof(uint32_t) * count);
+	graph.hops = malloc(sizeof(uint32_t) * count);
+	graph.done = malloc(sizeof(bool) * count);
+	if (!graph.nodes || !graph.first_edge || !graph.index ||
+			!graph.arrival || !graph.via || !graph.prev ||
+			!graph.hops || !graph.done)
+		goto fail;
+
+	memset(graph.index, 0xFF, sizeof(uint32_t) * index_size);
+	graph.index_mask = index_size - 1;
+	graph.vertex_count = count;
+	graph.nodes[LOCAL_VERTEX] = NULL;
+	v = LOCAL_VERTEX + 1;
+	for (nl = routing_table_get_node_list(); nl != NULL; nl = nl->next) {
+		graph.nodes[v] = nl->node;
+		vertex_insert(v++);
+	}
+
+	emit_edges(false);
+	for (v = 0; v < count; v++)
+		graph.first_edge[v + 1] += graph.first_edge[v];
+	edge_count = graph.first_edge[count];
+	// Every edge is relaxed at most once, plus the start vertex
+	graph.edges = malloc(sizeof(struct cgr_edge) * (edge_count + 1));
+	graph.heap = malloc(sizeof(struct cgr_heap_item) * (edge_count + 1));
+	if (!graph.edges || !graph.heap)
+		goto fail;
+	for (v = 0; v < count; v++)
+		graph.via[v] = graph.first_edge[v];
+	emit_edges(true);
+
+	graph.valid = true;
+	return UPCN_OK;
+
+fail:
+	graph_free();
+	return UPCN_FAIL;
+}
+
+/* ROUTE SEARCH */
+
+static void heap_push(const uint64_t arrival, const uint32_t vertex)
+{
+	uint32_t i = graph.heap_count++;
+
+	while (i > 0) {
+		const uint32_t parent = (i - 1) / 2;
+
+		if (graph.heap[parent].arrival <= arrival)
+			break;
+		graph.heap[i] = graph.heap[parent];
+		i = parent;
+	}
+	graph.heap[i] = (struct cgr_heap_item){ arrival, vertex };
+}
+
+static struct cgr_heap_item heap_pop(void)
+{
+	const struct cgr_heap_item result = graph.heap[0];
+	const struct cgr_heap_item last = graph.heap[--graph.heap_count];
+	uint32_t i = 0, child;
+
+	while ((child = 2 * i + 1) < graph.heap_count) {
+		if (child + 1 < graph.heap_count &&
+				graph.heap[child + 1].arrival <
+				graph.heap[child].arrival)
+			child++;
+		if (last.arrival <= graph.heap[child].arrival)
+			break;
+		graph.heap[i] = graph.heap[child];
+		i = child;
+	}
+	graph.heap[i] = last;
+	return result;
+}
+
+static bool is_first_hop(const struct cgr_cache_entry *entry,
+			 const struct contact *contact)
+{
+	uint8_t i;
+
+	for (i = 0; i < entry->route_count; i++) {
+		if (entry->routes[i].first_hop == contact)
+			return true;
+	}
+	return false;
+}
+
+static enum upcn_result add_dependency(struct cgr_cache_entry *entry,
+				       const struct node *node,
+				       const struct contact *contact)
+{
+	if (entry->dep_count == entry->dep_capacity) {
+		const uint32_t new_capacity = entry->dep_capacity
+			? entry->dep_capacity * 2 : 8;
+		struct cgr_dependency *const new_deps = realloc(
+			entry->deps,
+			sizeof(struct cgr_dependency) * new_capacity
+		);
+
+		if (!new_deps)
+			return UPCN_FAIL;
+		entry->deps = new_deps;
+		entry->dep_capacity = new_capacity;
+	}
+	entry->deps[entry->dep_count++] = (struct cgr_dependency){
+		node, contact
+	};
+	return UPCN_OK;
+}
+
+// Determines the route arriving first which does not begin with the first
+// hop of a route already contained in the entry and appends it.
+static bool find_route(struct cgr_cache_entry *entry,
+		       const struct cgr_terminal *terminals,
+		       const uint32_t terminal_count, const uint64_t cur_time)
+{
+	struct router_cgr_route *const route =
+		&entry->routes[entry->route_count];
+	uint64_t best = UINT64_MAX;
+	uint32_t best_terminal = 0, v, e, t;
+
+	for (v = 0; v < graph.vertex_count; v++) {
+		graph.arrival[v] = UINT64_MAX;
+		graph.via[v] = NO_EDGE;
+		graph.prev[v] = NO_VERTEX;
+		graph.hops[v] = 0;
+		graph.done[v] = false;
+	}
+	graph.arrival[LOCAL_VERTEX] = cur_time;
+	graph.heap_count = 0;
+	heap_push(cur_time, LOCAL_VERTEX);
+
+	while (graph.heap_count != 0) {
+		const struct cgr_heap_item item = heap_pop();
+		const uint32_t u = item.vertex;
+
+		if (graph.done[u] || item.arrival != graph.arrival[u])
+			continue;
+		if (item.arrival >= best)
+			break;
+		graph.done[u] = true;
+
+		for (t = 0; t < terminal_count; t++) {
+			const uint64_t a = MAX(item.arrival,
+					       terminals[t].from);
+
+			if (terminals[t].vertex == u &&
+					a < terminals[t].to && a < best) {
+				best = a;
+				best_terminal = t;
+			}
+		}
+
+		for (e = graph.first_edge[u]; e < graph.first_edge[u + 1];
+				e++) {
+			const struct cgr_edge *const edge = &graph.edges[e];
+			const uint32_t target = edge->target;
+			const uint64_t depart = MAX(item.arrival, edge->from);
+
+			if (graph.done[target] || depart >= edge->to)
+				continue;
+			if (u == LOCAL_VERTEX &&
+					is_first_hop(entry, edge->contact))
+				continue;
+			if (depart < graph.arrival[target] ||
+					(depart == graph.arrival[target] &&
+					 graph.hops[u] + 1 < graph.hops[target])) {
+				graph.arrival[target] = depart;
+				graph.via[target] = e;
+				graph.prev[target] = u;
+				graph.hops[target] = graph.hops[u] + 1;
+				heap_push(depart, target);
+			}
+		}
+	}
+	if (best == UINT64_MAX)
+		return false;
+
+	// Walk back to the local vertex, the last edge is the first hop
+	v = terminals[best_terminal].vertex;
+	route->arrival = best;
+	route->expiry = terminals[best_terminal].to;
+	route->hop_count = MIN(graph.hops[v], (uint32_t)UINT8_MAX);
+	if (add_dependency(entry, graph.nodes[v],
+			   terminals[best_terminal].contact) != UPCN_OK)
+		return false;
+	while (v != LOCAL_VERTEX) {
+		const struct cgr_edge *const edge = &graph.edges[graph.via[v]];
+
+		route->expiry = MIN(route->expiry, edge->to);
+		route->first_hop = edge->contact;
+		if (add_dependency(entry, graph.nodes[v],
+				   edge->contact) != UPCN_OK)
+			return false;
+		v = graph.prev[v];
+	}
+	entry->route_count++;
+	return true;
+}
+
+static struct cgr_terminal *get_terminals(const char *destination,
+					  uint32_t *count)
+{
+	struct node_table_entry *entries[ROUTER_MAX_EID_MATCHES];
+	const uint8_t match_count = routing_table_lookup_eid_matches(
+		destination, entries, ROUTER_MAX_EID_MATCHES);
+	const struct associated_contact_list *ac;
+	struct cgr_terminal *terminals;
+	uint32_t max = graph.vertex_count, v;
+	uint8_t i;
+
+	for (i = 0; i < match_count; i++) {
+		for (ac = entries[i]->contacts; ac != NULL; ac = ac->next)
+			max++;
+	}
+	terminals = malloc(sizeof(struct cgr_terminal) * max);
+	if (!terminals)
+		return NULL;
+	*count = 0;
+	// Nodes which can always reach the destination
+	for (v = LOCAL_VERTEX + 1; v < graph.vertex_count; v++) {
+		const struct node *const node = graph.nodes[v];
+
+		if (strcmp(node->eid, destination) == 0 ||
+				endpoint_list_contains(node->endpoints,
+						       destination))
+			terminals[(*count)++] = (struct cgr_terminal){
+				v, NULL, 0, UINT64_MAX
+			};
+	}
+	// Nodes which can reach the destination during a contact
+	for (i = 0; i < match_count; i++) {
+		for (ac = entries[i]->contacts; ac != NULL; ac = ac->next) {
+			const struct contact *const c = ac->data;
+
+			if (c->node == NULL || !endpoint_list_contains(
+					c->contact_endpoints, destination))
+				continue;
+			v = vertex_lookup(c->node->eid);
+			if (v != NO_VERTEX)
+				terminals[(*count)++] = (struct cgr_terminal){
+					v, c, c->from, c->to
+				};
+		}
+	}
+	return terminals;
+}
+
+static enum upcn_result compute_routes(struct cgr_cache_entry *entry,
+				       const uint64_t cur_time)
+{
+	struct cgr_terminal *terminals;
+	uint32_t terminal_count;
+
+	if (!graph.valid && graph_build() != UPCN_OK)
+		return UPCN_FAIL;
+	terminals = get_terminals(entry->destination, &terminal_count);
+	if (!terminals)
+		return UPCN_FAIL;
+	while (entry->route_count < ROUTER_CGR_MAX_ROUTES &&
+			find_route(entry, terminals, terminal_count, cur_time))
+		;
+	free(terminals);
+	return UPCN_OK;
+}
+
+/* CACHE */
+
+static void cache_insert(struct cgr_cache_entry *entry)
+{
+	struct cgr_cache_entry **slot =
+		&slots[entry->hash & (slot_count - 1)];
+
+	entry->next = *slot;
+	*slot = entry;
+	entry_count++;
+}
+
+static void cache_grow(void)
+{
+	const uint32_t old_count = slot_count;
+	struct cgr_cache_entry **const old_slots = slots;
+	struct cgr_cache_entry **new_slots;
+	uint32_t i;
+
+	new_slots = calloc(old_count * 2, sizeof(struct cgr_cache_entry *));
+	// Keep the old table, the chains just get longer
+	if (!new_slots)
+		return;
+
+	slots = new_slots;
+	slot_count = old_count * 2;
+	entry_count = 0;
+	for (i = 0; i < old_count; i++) {
+		while (old_slots[i] != NULL) {
+			struct cgr_cache_entry *const e = old_slots[i];
+
+			old_slots[i] = e->next;
+			cache_insert(e);
+		}
+	}
+	free(old_slots);
+}
+
+static void entry_free(struct cgr_cache_entry *entry)
+{
+	free(entry->destination);
+	free(entry->deps);
+	free(entry);
+}
+
+// Removes all entries for which the predicate is true
+static void cache_remove_if(
+	bool (*predicate)(const struct cgr_cache_entry *entry,
+			  const void *param),
+	const void *param)
+{
+	struct cgr_cache_entry **cur;
+	uint32_t i;
+
+	for (i = 0; i < slot_count; i++) {
+		cur = &slots[i];
+		while (*cur != NULL) {
+			struct cgr_cache_entry *const e = *cur;
+
+			if (predicate(e, param)) {
+				*cur = e->next;
+				entry_free(e);
+				entry_count--;
+			} else {
+				cur = &e->next;
+			}
+		}
+	}
+}
+
+static bool always(const struct cgr_cache_entry *entry, const void *param)
+{
+	(void)entry;
+	(void)param;
+	return true;
+}
+
+static bool destination_matches(const struct cgr_cache_entry *entry,
+				const void *pattern)
+{
+	return eid_matches(pattern, entry->destination);
+}
+
+static struct cgr_cache_entry **cache_find(const char *destination,
+					   const uint32_t hash)
+{
+	struct cgr_cache_entry **cur = &slots[hash & (slot_count - 1)];
+
+	while (*cur != NULL && ((*cur)->hash != hash ||
+			strcmp((*cur)->destination, destination) != 0))
+		cur = &(*cur)->next;
+	return cur;
+}
+
+static void cache_remove_destination(const char *destination)
+{
+	struct cgr_cache_entry **slot;
+	struct cgr_cache_entry *e;
+
+	if (slots == NULL)
+		return;
+	slot = cache_find(destination, eid_hash(destination));
+	e = *slot;
+	if (e == NULL)
+		return;
+	*slot = e->next;
+	entry_free(e);
+	entry_count--;
+}
+
+static struct cgr_cache_entry *cache_create(const char *destination,
+					    const uint32_t hash)
+{
+	struct cgr_cache_entry *entry;
+
+	if (slots == NULL) {
+		slots = calloc(INITIAL_SLOT_COUNT,
+			       sizeof(struct cgr_cache_entry *));
+		if (!slots)
+			return NULL;
+		slot_count = INITIAL_SLOT_COUNT;
+	}
+	// Start over if too many destinations are known
+	if (entry_count >= ROUTER_CGR_CACHE_SIZE)
+		cache_remove_if(always, NULL);
+	else if (entry_count >= slot_count)
+		cache_grow();
+
+	entry = malloc(sizeof(struct cgr_cache_entry));
+	if (!entry)
+		return NULL;
+	entry->destination = strdup(destination);
+	if (!entry->destination) {
+		free(entry);
+		return NULL;
+	}
+	entry->hash = hash;
+	entry->route_count = 0;
+	entry->deps = NULL;
+	entry->dep_count = 0;
+	entry->dep_capacity = 0;
+	cache_insert(entry);
+	return entry;
+}
+
+static bool routes_valid(const struct cgr_cache_entry *entry,
+			 const uint64_t cur_time)
+{
+	uint8_t i;
+
+	for (i = 0; i < entry->route_count; i++) {
+		if (entry->routes[i].expiry <= cur_time)
+			return false;
+	}
+	return true;
+}
+
+/* INVALIDATION */
+
+static bool depends_on_node(const struct cgr_cache_entry *entry,
+			    const void *node)
+{
+	uint32_t i;
+
+	for (i = 0; i < entry->dep_count; i++) {
+		if (entry->deps[i].node == node)
+			return true;
+	}
+	return false;
+}
+
+static bool depends_on_contact(const struct cgr_cache_entry *entry,
+			       const void *contact)
+{
+	uint32_t i;
+
+	for (i = 0; i < entry->dep_count; i++) {
+		if (entry->deps[i].contact == contact)
+			return true;
+	}
+	return false;
+}
+
+// New routes cannot arrive before the threshold, so only entries with
+// less than the maximum amount of routes or a later last arrival change.
+static bool may_improve(const struct cgr_cache_entry *entry,
+			const void *threshold)
+{
+	return (
+		entry->route_count < ROUTER_CGR_MAX_ROUTES ||
+		entry->routes[entry->route_count - 1].arrival >=
+			*(const uint64_t *)threshold
+	);
+}
+
+static bool pattern_names_node(const char *pattern)
+{
+	const struct node_list *nl;
+
+	for (nl = routing_table_get_node_list(); nl != NULL; nl = nl->next) {
+		if (eid_matches(pattern, nl->node->eid))
+			return true;
+	}
+	return false;
+}
+
+void router_cgr_plan_extended(
+	const struct node *node, const struct endpoint_list *endpoints,
+	const struct contact_list *contacts)
+{
+	uint64_t threshold = UINT64_MAX;
+
+	graph.valid = false;
+	if (slots == NULL)
+		return;
+	if (bulk_update) {
+		bulk_changed = true;
+		return;
+	}
+	cache_remove_destination(node->eid);
+	for (; endpoints != NULL; endpoints = endpoints->next) {
+		if (eid_is_pattern(endpoints->eid)) {
+			if (pattern_names_node(endpoints->eid)) {
+				cache_remove_if(always, NULL);
+				return;
+			}
+			cache_remove_if(destination_matches, endpoints->eid);
+			continue;
+		}
+		// A new persistent link can be used at any time
+		if (routing_table_lookup_node(endpoints->eid) != NULL) {
+			cache_remove_if(always, NULL);
+			return;
+		}
+		cache_remove_destination(endpoints->eid);
+	}
+	for (; contacts != NULL; contacts = contacts->next)
+		threshold = MIN(threshold, contacts->data->from);
+	if (threshold != UINT64_MAX)
+		cache_remove_if(may_improve, &threshold);
+}
+
+void router_cgr_node_changed(const struct node *node)
+{
+	graph.valid = false;
+	if (bulk_update)
+		bulk_changed = true;
+	else if (slots != NULL)
+		cache_remove_if(depends_on_node, node);
+}
+
+void router_cgr_contact_removed(const struct contact *contact)
+{
+	graph.valid = false;
+	if (bulk_update)
+		bulk_changed = true;
+	else if (slots != NULL)
+		cache_remove_if(depends_on_contact, contact);
+}
+
+void router_cgr_begin_bulk_update(void)
+{
+	bulk_update = true;
+}
+
+void router_cgr_end_bulk_update(void)
+{
+	if (bulk_changed && slots != NULL)
+		cache_remove_if(always, NULL);
+	bulk_update = false;
+	bulk_changed = false;
+}
+
+/* LOOKUP */
+
+uint8_t router_cgr_get_routes(
+	const char *destination, uint64_t cur_time,
+	const struct router_cgr_route **routes)
+{
+	const uint32_t hash = eid_hash(destination);
+	struct cgr_cache_entry *entry = NULL, **slot;
+
+	if (slots != NULL) {
+		slot = cache_find(destination, hash);
+		entry = *slot;
+		// Search again if a route expired, there may be a new one
+		if (entry != NULL && !routes_valid(entry, cur_time)) {
+			*slot = entry->next;
+			entry_free(entry);
+			entry_count--;
+			entry = NULL;
+		}
+	}
+	if (entry == NULL) {
+		entry = cache_create(destination, hash);
+		if (!entry)
+			return 0;
+		if (compute_routes(entry, cur_time) != UPCN_OK) {
+			cache_remove_destination(destination);
+			return 0;
+		}
+	}
+	*routes = entry->routes;
+	return entry->route_count;
+}
+
+void router_cgr_free(void)
+{
+	if (slots != NULL)
+		cache_remove_if(always, NULL);
+	free(slots);
+	slots = NULL;
+	slot_count = 0;
+	entry_count = 0;
+	graph_free();
+}
@@ -13,46 +13,178 @@
 #include "platform/hal_queue.h"
 #include "platform/hal_semaphore.h"
 #include "platform/hal_task.h"
+#include "platform/hal_time.h"
 
 #include "util/llsort.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 static struct router_config RC;
 
-static struct routed_bundle **popt, **preempted;
+static struct routed_bundle **preempted;
 
 void router_optimizer_update_config_int(struct router_config conf)
 {
 	RC = conf;
-	if (popt == NULL)
-		popt = malloc(RC.opt_max_bundles * sizeof(void *));
 	if (preempted == NULL)
 		preempted = malloc(RC.opt_max_pre_bundles * sizeof(void *));
-	ASSERT(popt != NULL);
 	ASSERT(preempted != NULL);
 }
 
+/*
+ * Contacts which received bundles that may be routed better via preemption
+ * or whose capacity changed. The set is only modified while holding the
+ * semaphore of the contact list.
+ */
+static struct contact **dirty_contacts;
+static uint32_t dirty_count, dirty_capacity;
+
+#define DIRTY_INITIAL_CAPACITY 16
+
+void router_optimizer_mark_dirty(struct contact *contact)
+{
+	struct contact **new_contacts;
+	uint32_t new_capacity;
+
+	if (contact->optimizer_dirty)
+		return;
+	if (dirty_count == dirty_capacity) {
+		new_capacity = dirty_capacity
+			? dirty_capacity * 2 : DIRTY_INITIAL_CAPACITY;
+		new_contacts = realloc(dirty_contacts,
+				       new_capacity * sizeof(struct contact *));
+		if (new_contacts == NULL) {
+			LOG("RouterOptimizer: Cannot track contact changes");
+			return;
+		}
+		dirty_contacts = new_contacts;
+		dirty_capacity = new_capacity;
+	}
+	contact->optimizer_index = dirty_count;
+	contact->optimizer_dirty = 1;
+	dirty_contacts[dirty_count++] = contact;
+}
+
+void router_optimizer_contact_removed(struct contact *contact)
+{
+	struct contact *last;
+
+	if (!contact->optimizer_dirty)
+		return;
+	ASSERT(dirty_contacts[contact->optimizer_index] == contact);
+	last = dirty_contacts[--dirty_count];
+	dirty_contacts[contact->optimizer_index] = last;
+	last->optimizer_index = contact->optimizer_index;
+	contact->optimizer_dirty = 0;
+}
+
+/*
+ * Bounded binary min-heap of the best preemption candidates found in the
+ * dirty contacts, i.e. the root is the candidate evicted first.
+ */
+struct optimizer_candidate {
+	struct routed_bundle *rb;
+	struct contact *contact;
+};
+
+static struct optimizer_candidate queue[ROUTER_OPTIMIZER_QUEUE_SIZE];
+static uint32_t queue_length;
+
+static inline bool candidate_less(const struct optimizer_candidate *a,
+				  const struct optimizer_candidate *b)
+{
+	if (a->rb->preemption_improvement != b->rb->preemption_improvement)
+		return a->rb->preemption_improvement <
+			b->rb->preemption_improvement;
+	return a->rb->prio < b->rb->prio;
+}
+
+static void queue_sift_down(uint32_t pos)
+{
+	struct optimizer_candidate tmp;
+	uint32_t child;
+
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= queue_length)
+			break;
+		if (child + 1 < queue_length && candidate_less(
+				&queue[child + 1], &queue[child]))
+			child++;
+		if (!candidate_less(&queue[child], &queue[pos]))
+			break;
+		tmp = queue[pos];
+		queue[pos] = queue[child];
+		queue[child] = tmp;
+		pos = child;
+	}
+}
+
+/* Returns the contact of the evicted candidate if the queue was full */
+static struct contact *queue_push(struct routed_bundle *rb,
+				  struct contact *contact)
+{
+	const struct optimizer_candidate c = { .rb = rb, .contact = contact };
+	struct optimizer_candidate tmp;
+	struct contact *evicted;
+	uint32_t pos, parent;
+
+	if (queue_length == ROUTER_OPTIMIZER_QUEUE_SIZE) {
+		if (!candidate_less(&queue[0], &c))
+			return contact;
+		evicted = queue[0].contact;
+		queue[0] = c;
+		queue_sift_down(0);
+		return evicted;
+	}
+	pos = queue_length++;
+	queue[pos] = c;
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (!candidate_less(&queue[pos], &queue[parent]))
+			break;
+		tmp = queue[pos];
+		queue[pos] = queue[parent];
+		queue[parent] = tmp;
+		pos = parent;
+	}
+	return NULL;
+}
+
+/* Orders the queue by descending rank, destroying the heap property */
+static void queue_sort(void)
+{
+	struct optimizer_candidate tmp;
+	const uint32_t length = queue_length;
+
+	while (queue_length > 1) {
+		tmp = queue[0];
+		queue[0] = queue[--queue_length];
+		queue[queue_length] = tmp;
+		queue_sift_down(0);
+	}
+	queue_length = length;
+}
+
 struct router_optimizer_task_params {
 	QueueIdentifier_t router_queue;
 	Semaphore_t clist_semaphore;
 	Semaphore_t opt_semaphore;
-	struct contact_list **clist_ptr;
 };
 
 static void router_optimizer_task(void *param);
 
 Semaphore_t router_start_optimizer_task(
 	QueueIdentifier_t router_signaling_queue,
-	Semaphore_t clist_semaphore, struct contact_list **clistptr)
+	Semaphore_t clist_semaphore)
 {
 	struct router_optimizer_task_params *p;
 
 	ASSERT(router_signaling_queue != NULL);
 	ASSERT(clist_semaphore != NULL);
-	ASSERT(clistptr != NULL);
 	p = malloc(sizeof(struct router_optimizer_task_params));
 	if (p == NULL)
 		return NULL;
@@ -63,7 +195,6 @@ Semaphore_t router_start_optimizer_task(
 		free(p);
 		return NULL;
 	}
-	p->clist_ptr = clistptr;
 	router_optimizer_update_config_int(router_get_config());
 	if (hal_task_create(router_optimizer_task,
 			    "rout_opt_t",
@@ -78,46 +209,43 @@ Semaphore_t router_start_optimizer_task(
 	return NULL;
 }
 
-static int router_optimization_affordable(struct contact_list **clistptr);
-static uint8_t router_run_optimization(
-	struct contact_list *global_clist, QueueIdentifier_t router_queue);
+static int router_optimization_affordable(void);
+uint8_t router_run_optimization_int(QueueIdentifier_t router_queue,
+				    uint32_t budget);
 
 static void router_optimizer_task(void *param)
 {
 	struct router_optimizer_task_params *p
 		= (struct router_optimizer_task_params *)param;
-	uint8_t res, opt;
+	uint8_t opt;
+	uint32_t pending;
 
 	for (;;) {
+		/* Sleep until bundles were routed or contacts changed */
 		hal_semaphore_take_blocking(p->opt_semaphore);
-		hal_semaphore_release(p->opt_semaphore);
-		if (router_optimization_affordable(p->clist_ptr)) {
-			hal_semaphore_take_blocking(p->clist_semaphore);
-
-			/* TODO: Do nothing if no new routed bundles => CM */
-			res = router_run_optimization(
-				*(p->clist_ptr), p->router_queue);
-			opt = res & 0x7F;
-			if ((res & 0x80) != 0)
-				LOG("RouterOptimizer: Sorted list.");
+		hal_semaphore_take_blocking(p->clist_semaphore);
+		if (dirty_count != 0 && router_optimization_affordable()) {
+			opt = router_run_optimization_int(
+				p->router_queue, ROUTER_OPTIMIZER_BUDGET);
 			if (opt != 0)
 				LOGF("RouterOptimizer: Optimized %d bundle(s).",
 				     opt);
-			hal_semaphore_release(p->clist_semaphore);
-			if (res == 0)
-				hal_semaphore_poll(p->opt_semaphore);
 		}
-		if (ROUTER_OPTIMIZER_DELAY != 0)
+		pending = dirty_count;
+		hal_semaphore_release(p->clist_semaphore);
+		/* Continue later if the budget or the time did not suffice */
+		if (pending != 0) {
 			hal_task_delay(ROUTER_OPTIMIZER_DELAY);
+			hal_semaphore_release(p->opt_semaphore);
+		}
 	}
 }
 
-static int router_optimization_affordable(struct contact_list **clistptr)
+static int router_optimization_affordable(void)
 {
-	int64_t cur_time = hal_time_get_timestamp_s();
+	int64_t cur_time = hal_time_get_timestamp_s_coarse();
 	int64_t nxt_time = contact_manager_get_next_contact_time();
 
-	(void)clistptr;
 	return !contact_manager_in_contact() &&
 		(nxt_time - cur_time) >= RC.opt_min_time;
 }
@@ -125,86 +253,110 @@ static int router_optimization_affordable(struct contact_list **clistptr)
 static void try_optimize_decision_preempt(
 	struct routed_bundle *rb, QueueIdentifier_t router_queue);
 
-static uint8_t router_run_optimization(
-	struct contact_list *global_clist, QueueIdentifier_t router_queue)
+/* Ranks the candidates of all dirty contacts, which become clean */
+static void collect_candidates(void)
 {
-	struct contact_list *cur_elem;
-	struct contact *c;
-	enum bundle_routing_priority last_prio;
+	struct contact **const contacts = dirty_contacts;
+	const uint32_t count = dirty_count, capacity = dirty_capacity;
+	struct contact *c, *evicted;
 	struct routed_bundle_list *rbl;
 	struct routed_bundle *r;
-	uint8_t popt_c, sort, i, opt = 0;
+	uint32_t i;
+	int prio;
 
-	ASSERT(popt != NULL);
-	cur_elem = global_clist;
-	while (cur_elem != NULL) {
-		c = cur_elem->data;
-		ASSERT(c != NULL);
-		rbl = c->contact_bundles;
-		last_prio = BUNDLE_RPRIO_MAX;
-		sort = 0;
-		popt_c = 0;
-		while (rbl != NULL) {
-			r = rbl->data;
-			ASSERT(r != NULL);
-			if (r->prio > last_prio)
-				sort = 1;
-			/* Maybe sort by that value? */
-			if (r->preemption_improvement != 0 && !r->serialized) {
-				if (popt_c != RC.opt_max_bundles)
-					popt[popt_c++] = r;
+	/* Detach the set as evicted contacts have to be marked again */
+	dirty_contacts = NULL;
+	dirty_count = dirty_capacity = 0;
+	for (i = 0; i < count; i++)
+		contacts[i]->optimizer_dirty = 0;
+	queue_length = 0;
+	for (i = 0; i < count; i++) {
+		c = contacts[i];
+		for (prio = BUNDLE_RPRIO_MAX - 1; prio >= 0; prio--) {
+			rbl = c->contact_bundles[prio].head;
+			for (; rbl != NULL; rbl = rbl->next) {
+				r = rbl->data;
+				ASSERT(r != NULL);
+				if (r->preemption_improvement == 0 ||
+						r->serialized)
+					continue;
+				/* The contact has to be revisited later */
+				evicted = queue_push(r, c);
+				if (evicted != NULL)
+					router_optimizer_mark_dirty(evicted);
 			}
-			last_prio = r->prio;
-			rbl = rbl->next;
-		}
-		if (popt_c != 0) {
-			for (i = 0; i < popt_c; i++)
-				try_optimize_decision_preempt(
-					popt[i], router_queue);
-			opt += popt_c;
 		}
-		if (sort) {
-			opt |= 0x80;
-			LLSORT_DESC(struct routed_bundle_list, data->prio,
-				c->contact_bundles);
+	}
+	if (dirty_contacts == NULL) {
+		dirty_contacts = contacts;
+		dirty_capacity = capacity;
+	} else {
+		free(contacts);
+	}
+}
+
+/*
+ * Tries to re-route the best candidates of the dirty contacts in batches of
+ * opt_max_bundles bundles until the time budget (in ms) is exhausted.
+ * Contacts of remaining candidates stay dirty.
+ */
+uint8_t router_run_optimization_int(QueueIdentifier_t router_queue,
+				    uint32_t budget)
+{
+	const uint64_t start = hal_time_get_timestamp_ms();
+	struct routed_bundle *r;
+	uint32_t i;
+	uint8_t opt = 0, batch = 0;
+
+	collect_candidates();
+	queue_sort();
+	for (i = 0; i < queue_length; i++) {
+		if (batch == RC.opt_max_bundles) {
+			if (hal_time_get_timestamp_ms() - start >= budget)
+				break;
+			batch = 0;
 		}
-		if (popt_c != 0)
-			break;
-		cur_elem = cur_elem->next;
+		r = queue[i].rb;
+		/* May have been handled via another contact already */
+		if (r->preemption_improvement == 0 || r->serialized)
+			continue;
+		try_optimize_decision_preempt(r, router_queue);
+		batch++;
+		if (opt != UINT8_MAX)
+			opt++;
 	}
+	for (; i < queue_length; i++)
+		router_optimizer_mark_dirty(queue[i].contact);
+	queue_length = 0;
 	return opt;
 }
 
-static inline struct routed_bundle_list *get_less_prio_bundle_list(
-	struct routed_bundle_list *cur_list, enum bundle_routing_priority prio)
+static inline struct routed_bundle_list *copy_bundle_queue(
+	const struct routed_bundle_queue *queue)
 {
 	struct routed_bundle_list *all_list = NULL;
 	struct routed_bundle_list **all_list_e = &all_list;
-	struct routed_bundle_list *next;
-
-	while (cur_list != NULL) {
-		if (cur_list->data->prio < prio) {
-			*all_list_e = malloc(sizeof(struct routed_bundle_list));
-			if (*all_list_e == NULL) {
-				while (all_list != NULL) {
-					next = all_list->next;
-					free(all_list);
-					all_list = next;
-				}
-				ASSERT(all_list != NULL);
-				continue;
+	struct routed_bundle_list *cur_list, *next;
+
+	for (cur_list = queue->head; cur_list; cur_list = cur_list->next) {
+		*all_list_e = malloc(sizeof(struct routed_bundle_list));
+		if (*all_list_e == NULL) {
+			while (all_list != NULL) {
+				next = all_list->next;
+				free(all_list);
+				all_list = next;
 			}
-			(*all_list_e)->data = cur_list->data;
-			(*all_list_e)->next = NULL;
-			all_list_e = &(*all_list_e)->next;
+			return NULL;
 		}
-		cur_list = cur_list->next;
+		(*all_list_e)->data = cur_list->data;
+		(*all_list_e)->next = NULL;
+		all_list_e = &(*all_list_e)->next;
 	}
 	return all_list;
 }
 
 static float try_calculate_new_decision(
-	struct associated_contact_list *contacts,
+	const struct router_candidate *candidates, uint8_t candidate_count,
 	enum bundle_routing_priority prio, uint32_t size,
 	struct contact **newc, uint8_t *newc_c,
 	struct routed_bundle **preempted, uint8_t *preempted_count);
@@ -227,24 +379,26 @@ static void try_optimize_decision_preempt(
 	struct routed_bundle *rb, QueueIdentifier_t router_queue)
 {
 	static struct contact *newc[ROUTER_MAX_CONTACTS];
-	struct associated_contact_list *dest_contacts;
-	uint8_t i, newc_c = 0;
+	const struct router_candidate *candidates;
+	uint8_t candidate_count, i, newc_c = 0;
 	uint8_t preempted_count = 0;
 
 	ASSERT(rb != NULL);
 	if (preempted == NULL) /* If buffer failed to initialize */
 		return;
+	/* Disable optimizing this bundle again, also if it fails */
+	rb->preemption_improvement = 0;
 	for (i = 0; i < rb->contact_count; i++)
 		router_remove_bundle_from_contact(rb->contacts[i], rb->id);
-	dest_contacts = router_lookup_destination(rb->destination);
-	if (dest_contacts == NULL)
+	candidate_count = router_lookup_destination(rb->destination,
+						    rb->exp_time, &candidates);
+	if (candidate_count == 0)
 		goto finalize;
-	/* Disable optimizing this bundle again */
-	rb->preemption_improvement = 0;
 	/* Calculate a new decision, check decision and try to assign bundles */
 	if (
-		try_calculate_new_decision(dest_contacts, rb->prio, rb->size,
-			newc, &newc_c, preempted, &preempted_count)
+		try_calculate_new_decision(candidates, candidate_count,
+			rb->prio, rb->size, newc, &newc_c,
+			preempted, &preempted_count)
 			>= RC.min_probability &&
 		re_route_preempted_fragments(preempted, preempted_count,
 			newc, newc_c, router_queue)
@@ -255,38 +409,38 @@ static void try_optimize_decision_preempt(
 		memcpy(rb->contacts, newc, sizeof(void *) * newc_c);
 		rb->contact_count = newc_c;
 	}
-	list_free(dest_contacts);
 finalize:
 	for (i = 0; i < rb->contact_count; i++)
 		router_add_bundle_to_contact(rb->contacts[i], rb);
 }
 
 static float try_calculate_new_decision(
-	struct associated_contact_list *contacts,
+	const struct router_candidate *candidates, uint8_t candidate_count,
 	enum bundle_routing_priority prio, uint32_t size,
 	struct contact **newc, uint8_t *newc_c,
 	struct routed_bundle **preempted, uint8_t *preempted_count)
 {
-	uint8_t preempted_contact_count;
+	uint8_t preempted_contact_count, i;
 	struct contact *c;
 	float probability = 0.0f, conf, assoc_node_prob;
-	uint64_t time = hal_time_get_timestamp_s();
+	uint64_t time = hal_time_get_timestamp_s_coarse();
 
 	*preempted_count = 0;
 	*newc_c = 0;
-	while (
-		contacts != NULL && probability < RC.min_probability &&
-		*newc_c != ROUTER_MAX_CONTACTS
+	for (
+		i = 0;
+		i < candidate_count && probability < RC.min_probability &&
+		*newc_c != ROUTER_MAX_CONTACTS;
+		i++
 	) {
-		c = contacts->data;
-		assoc_node_prob = contacts->p;
+		c = candidates[i].contact;
+		assoc_node_prob = candidates[i].p;
 		ASSERT(c != NULL);
-		contacts = contacts->next;
 		preempted_contact_count = 0;
-		if (ROUTER_CONTACT_CAPACITY(c, prio) < (int32_t)size
+		if (ROUTER_CONTACT_CAPACITY(c, prio) < (int64_t)size
 				|| c->to <= time) {
 			continue;
-		} else if (ROUTER_CONTACT_CAPACITY(c, 0) < (int32_t)size) {
+		} else if (ROUTER_CONTACT_CAPACITY(c, 0) < (int64_t)size) {
 			/* Preemption case */
 			if (!do_preemption(c, prio, size, preempted,
 					preempted_count,
@@ -317,35 +471,39 @@ static uint8_t do_preemption(
 	struct routed_bundle **preempted, uint8_t *preempted_count,
 	uint8_t *preempted_contact_count)
 {
-	int32_t target_size;
-	struct routed_bundle_list *cur_list, *all_list, *next;
-
-	/* 1. Get list of all bundles with less prio */
-	cur_list = contact->contact_bundles;
-	all_list = get_less_prio_bundle_list(
-		cur_list, prio);
-	/* 2. Sort by size desc and the prio (mergesort is stable) */
-	LLSORT_DESC(struct routed_bundle_list, data->size, all_list);
-	LLSORT(struct routed_bundle_list, data->prio, all_list);
-	/* 3. Get bundles to be replaced */
-	target_size = size - ROUTER_CONTACT_CAPACITY(contact, 0);
-	while (
-		target_size > 0 &&
-		*preempted_contact_count < RC.opt_max_pre_bundles_contact &&
-		*preempted_count < RC.opt_max_pre_bundles &&
-		all_list != NULL
-	) {
-		target_size -= all_list->data->size;
-		preempted[(*preempted_count)++] = all_list->data;
-		(*preempted_contact_count)++;
-		next = all_list->next;
-		free(all_list);
-		all_list = next;
-	}
-	while (all_list != NULL) {
-		next = all_list->next;
-		free(all_list);
-		all_list = next;
+	int64_t target_size;
+	struct routed_bundle_list *all_list, *next;
+	int cur_prio;
+
+	target_size = (int64_t)size - ROUTER_CONTACT_CAPACITY(contact, 0);
+	/* Bundles with the lowest prio are replaced first */
+	for (cur_prio = BUNDLE_RPRIO_LOW;
+	     cur_prio < (int)prio && target_size > 0; cur_prio++) {
+		/* 1. Get list of all bundles with the current prio */
+		all_list = copy_bundle_queue(
+			&contact->contact_bundles[cur_prio]);
+		/* 2. Sort by size desc */
+		LLSORT_DESC(struct routed_bundle_list, data->size, all_list);
+		/* 3. Get bundles to be replaced */
+		while (
+			target_size > 0 &&
+			*preempted_contact_count <
+				RC.opt_max_pre_bundles_contact &&
+			*preempted_count < RC.opt_max_pre_bundles &&
+			all_list != NULL
+		) {
+			target_size -= all_list->data->size;
+			preempted[(*preempted_count)++] = all_list->data;
+			(*preempted_contact_count)++;
+			next = all_list->next;
+			free(all_list);
+			all_list = next;
+		}
+		while (all_list != NULL) {
+			next = all_list->next;
+			free(all_list);
+			all_list = next;
+		}
 	}
 	/* 4.a If failed, continue */
 	if (target_size > 0) {
@@ -362,7 +520,8 @@ static uint8_t re_route_preempted_fragments(
 {
 	uint8_t i, j, success = 1;
 	struct fragment_route *froutes;
-	struct associated_contact_list *pre_contacts;
+	const struct router_candidate *candidates;
+	uint8_t candidate_count;
 
 	ASSERT(preempted_count > 0);
 
@@ -372,18 +531,18 @@ static uint8_t re_route_preempted_fragments(
 		return 0;
 	for (i = 0; i < preempted_count; i++) {
 		froutes[i].payload_size = 0; /* Not needed here */
-		pre_contacts = router_lookup_destination(
-			preempted[i]->destination);
-		if (pre_contacts == NULL) {
+		candidate_count = router_lookup_destination(
+			preempted[i]->destination, preempted[i]->exp_time,
+			&candidates);
+		if (candidate_count == 0) {
 			success = 0;
 			goto finalize;
 		}
 		if (!router_calculate_fragment_route(&froutes[i],
-				preempted[i]->size, pre_contacts, 0,
-				preempted[i]->prio, preempted[i]->exp_time,
-				ignored, ignored_count))
+				preempted[i]->size, candidates,
+				candidate_count, 0, preempted[i]->prio,
+				preempted[i]->exp_time, ignored, ignored_count))
 			success = 0;
-		list_free(pre_contacts)
 		if (success == 0)
 			goto finalize;
 	}
@@ -1,4 +1,5 @@
 #include "upcn/bundle.h"
+#include "upcn/bundle_backlog.h"
 #include "upcn/bundle_fragmenter.h"
 #include "upcn/bundle_processor.h"
 #include "upcn/bundle_storage_manager.h"
@@ -16,7 +17,9 @@
 #include "platform/hal_queue.h"
 #include "platform/hal_semaphore.h"
 #include "platform/hal_task.h"
+#include "platform/hal_time.h"
 
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,9 +32,16 @@ static bool process_signal(
 	QueueIdentifier_t cm_queue,
 	Semaphore_t ro_sem);
 
+static void expire_backlog(QueueIdentifier_t bp_signaling_queue);
 static bool process_router_command(
 	struct router_command *router_cmd,
 	QueueIdentifier_t bp_signaling_queue);
+static bool apply_router_command(
+	struct router_command *router_cmd,
+	QueueIdentifier_t bp_signaling_queue);
+bool router_process_plan_int(
+	struct router_plan *plan,
+	QueueIdentifier_t bp_signaling_queue);
 
 struct bundle_processing_result {
 	int8_t status_or_fragments;
@@ -45,40 +55,58 @@ struct bundle_processing_result {
 
 static struct bundle_processing_result process_bundle(struct bundle *bundle);
 
+// Bundles for which no route could be found, re-routed on topology changes
+static struct bundle_backlog *backlog;
+
+struct backlog_retry_context {
+	QueueIdentifier_t bp_signaling_queue;
+	Semaphore_t cm_semaphore;
+	uint32_t routed;
+};
+
 void router_task(void *rt_parameters)
 {
 	struct router_task_parameters *parameters;
 	struct contact_manager_params cm_param;
 	Semaphore_t ro_sem;
 	struct router_signal signal;
+	uint64_t now, next_expiry;
 
 	ASSERT(rt_parameters != NULL);
 	parameters = (struct router_task_parameters *)rt_parameters;
 
 	/* Init routing tables */
 	ASSERT(routing_table_init() == UPCN_OK);
+	backlog = bundle_backlog_create(ROUTER_BACKLOG_MAX_BUNDLES);
+	ASSERT(backlog != NULL);
 	/* Start contact manager */
-	cm_param = contact_manager_start(
-		parameters->router_signaling_queue,
-		routing_table_get_raw_contact_list_ptr());
+	cm_param = contact_manager_start(parameters->router_signaling_queue);
 	ASSERT(cm_param.control_queue != NULL);
 	/* Start optimizer */
 	ro_sem = router_start_optimizer_task(
-		parameters->router_signaling_queue, cm_param.semaphore,
-		routing_table_get_raw_contact_list_ptr());
+		parameters->router_signaling_queue, cm_param.semaphore);
 	ASSERT(ro_sem != NULL);
 
+	next_expiry = hal_time_get_timestamp_ms() +
+		ROUTER_BACKLOG_EXPIRY_INTERVAL_MS;
 	for (;;) {
+		now = hal_time_get_timestamp_ms();
 		if (hal_queue_receive(
 			parameters->router_signaling_queue, &signal,
-			-1) == UPCN_OK
-		) {
+			next_expiry > now ? (int)(next_expiry - now) : 0
+		) == UPCN_OK) {
 			process_signal(signal,
 				parameters->bundle_processor_signaling_queue,
 				parameters->router_signaling_queue,
 				cm_param.semaphore, cm_param.control_queue,
 			  ro_sem);
 		}
+		now = hal_time_get_timestamp_ms();
+		if (now >= next_expiry) {
+			expire_backlog(
+				parameters->bundle_processor_signaling_queue);
+			next_expiry = now + ROUTER_BACKLOG_EXPIRY_INTERVAL_MS;
+		}
 	}
 }
 
@@ -108,6 +136,143 @@ static void wake_up_contact_manager(QueueIdentifier_t cm_queue,
 	}
 }
 
+static bool backlog_bundle(bundleid_t b_id, int8_t bh_result)
+{
+	struct bundle *b;
+	uint64_t exp_time;
+
+	if (bh_result != BUNDLE_RESULT_NO_ROUTE &&
+			bh_result != BUNDLE_RESULT_NO_TIMELY_CONTACTS)
+		return false;
+	b = bundle_storage_get(b_id);
+	if (b == NULL)
+		return false;
+	exp_time = bundle_get_expiration_time(b);
+	if (exp_time <= hal_time_get_timestamp_s())
+		return false;
+	return bundle_backlog_add(backlog, b->destination, b_id, exp_time)
+		== UPCN_OK;
+}
+
+/*
+ * Routes the bundle and informs the bundle processor about the result.
+ * Bundles for which no route exists (yet) are added to the backlog if
+ * possible. Returns true if the bundle has been routed.
+ */
+static bool route_bundle(bundleid_t b_id,
+			 QueueIdentifier_t bp_signaling_queue,
+			 Semaphore_t cm_semaphore)
+{
+	struct bundle *b = bundle_storage_get(b_id);
+	struct bundle_processing_result proc_result = {
+		.status_or_fragments = BUNDLE_RESULT_INVALID
+	};
+
+	hal_semaphore_take_blocking(cm_semaphore);
+	if (b != NULL)
+		proc_result = process_bundle(b);
+	b = NULL; /* b may be invalid or free'd now */
+	hal_semaphore_release(cm_semaphore);
+	if (IS_DEBUG_BUILD)
+		LOGF(
+			"RouterTask: Bundle #%d [ %s ] [ frag = %d ]",
+			b_id,
+			(proc_result.status_or_fragments < 1)
+				? "ERR" : "OK",
+			proc_result.status_or_fragments
+		);
+	if (proc_result.status_or_fragments < 1) {
+		if (backlog_bundle(b_id, proc_result.status_or_fragments))
+			return false;
+		bundle_processor_inform(
+			bp_signaling_queue, b_id,
+			BP_SIGNAL_FORWARDING_CONTRAINDICATED,
+			get_reason(proc_result.status_or_fragments)
+		);
+		return false;
+	}
+	for (int8_t i = 0; i < proc_result.status_or_fragments; i++) {
+		bundle_processor_inform(
+			bp_signaling_queue,
+			proc_result.fragment_ids[i],
+			BP_SIGNAL_BUNDLE_ROUTED,
+			BUNDLE_SR_REASON_NO_INFO
+		);
+	}
+	return true;
+}
+
+static void retry_backlogged_bundle(bundleid_t b_id, uint64_t exp_time,
+				    void *param)
+{
+	struct backlog_retry_context *const ctx = param;
+
+	if (exp_time <= hal_time_get_timestamp_s()) {
+		bundle_processor_inform(
+			ctx->bp_signaling_queue, b_id,
+			BP_SIGNAL_FORWARDING_CONTRAINDICATED,
+			BUNDLE_SR_REASON_NO_TIMELY_CONTACT
+		);
+		return;
+	}
+	if (route_bundle(b_id, ctx->bp_signaling_queue, ctx->cm_semaphore))
+		ctx->routed++;
+}
+
+/*
+ * Re-routes the backlogged bundles for the node with the given EID or all
+ * backlogged bundles if it is NULL. Returns the number of routed bundles.
+ */
+static uint32_t retry_backlog(const char *eid,
+			      QueueIdentifier_t bp_signaling_queue,
+			      Semaphore_t cm_semaphore)
+{
+	struct backlog_retry_context ctx = {
+		.bp_signaling_queue = bp_signaling_queue,
+		.cm_semaphore = cm_semaphore,
+		.routed = 0,
+	};
+
+	if (bundle_backlog_count(backlog) == 0)
+		return 0;
+	bundle_backlog_take(backlog, eid, retry_backlogged_bundle, &ctx);
+	if (ctx.routed != 0)
+		LOGF("RouterTask: Routed %"PRIu32" backlogged bundle(s), %"
+		     PRIu32" left", ctx.routed, bundle_backlog_count(backlog));
+	return ctx.routed;
+}
+
+static void drop_expired_bundle(bundleid_t b_id, uint64_t exp_time,
+				void *param)
+{
+	QueueIdentifier_t *const bp_signaling_queue = param;
+
+	(void)exp_time;
+	bundle_processor_inform(
+		*bp_signaling_queue, b_id,
+		BP_SIGNAL_FORWARDING_CONTRAINDICATED,
+		BUNDLE_SR_REASON_NO_TIMELY_CONTACT
+	);
+}
+
+/*
+ * Drops the backlogged bundles which expired in the meantime, so that
+ * bundles for nodes which never become reachable again release their storage.
+ */
+static void expire_backlog(QueueIdentifier_t bp_signaling_queue)
+{
+	uint32_t expired;
+
+	if (bundle_backlog_count(backlog) == 0)
+		return;
+	expired = bundle_backlog_expire(backlog, hal_time_get_timestamp_s(),
+					drop_expired_bundle,
+					&bp_signaling_queue);
+	if (expired != 0)
+		LOGF("RouterTask: Dropped %"PRIu32" expired backlogged bundle(s), %"
+		     PRIu32" left", expired, bundle_backlog_count(backlog));
+}
+
 static bool process_signal(
 	struct router_signal signal,
 	QueueIdentifier_t bp_signaling_queue,
@@ -118,11 +283,12 @@ static bool process_signal(
 {
 	bool success = true;
 	bundleid_t b_id;
-	struct bundle *b;
 	struct routed_bundle *rb;
 	struct contact *contact;
 	struct router_command *command;
+	struct router_plan *plan;
 	struct node *node;
+	char *eid;
 
 	switch (signal.type) {
 	case ROUTER_SIGNAL_PROCESS_COMMAND:
@@ -145,57 +311,47 @@ static bool process_signal(
 			LOGF("RouterTask: Processing command (T = %c) failed!",
 			     command->type);
 		}
+		// New contacts may also enable multi-hop routes to other nodes
+		if (success && command->type != ROUTER_COMMAND_DELETE &&
+				retry_backlog(NULL, bp_signaling_queue,
+					      cm_semaphore) != 0)
+			wake_up_contact_manager(
+				cm_queue,
+				CM_SIGNAL_PROCESS_CURRENT_BUNDLES
+			);
 		free(command);
 		hal_semaphore_release(ro_sem); /* Allow optimizer to run */
 		break;
-	case ROUTER_SIGNAL_ROUTE_BUNDLE:
-		b_id = (bundleid_t)(uintptr_t)signal.data;
-		b = bundle_storage_get(b_id);
+	case ROUTER_SIGNAL_PROCESS_PLAN:
+		plan = (struct router_plan *)signal.data;
 		hal_semaphore_take_blocking(cm_semaphore);
-		/*
-		 * TODO: Check bundle expiration time
-		 * => no timely contact signal
-		 */
-
-		struct bundle_processing_result proc_result = {
-			.status_or_fragments = BUNDLE_RESULT_INVALID
-		};
-
-		if (b != NULL)
-			proc_result = process_bundle(b);
-		b = NULL; /* b may be invalid or free'd now */
+		routing_table_begin_update();
+		success = router_process_plan_int(plan, bp_signaling_queue);
+		routing_table_end_update();
 		hal_semaphore_release(cm_semaphore);
-		if (IS_DEBUG_BUILD)
-			LOGF(
-				"RouterTask: Bundle #%d [ %s ] [ frag = %d ]",
-				b_id,
-				(proc_result.status_or_fragments < 1)
-					? "ERR" : "OK",
-				proc_result.status_or_fragments
+		wake_up_contact_manager(
+			cm_queue,
+			CM_SIGNAL_UPDATE_CONTACT_LIST
+		);
+		LOGF("RouterTask: Plan with %u node(s) %s.",
+		     plan->command_count,
+		     success ? "applied" : "not applied completely");
+		if (retry_backlog(NULL, bp_signaling_queue, cm_semaphore) != 0)
+			wake_up_contact_manager(
+				cm_queue,
+				CM_SIGNAL_PROCESS_CURRENT_BUNDLES
 			);
-		if (proc_result.status_or_fragments < 1) {
-			enum bundle_status_report_reason reason
-				= get_reason(proc_result.status_or_fragments);
-			bundle_processor_inform(
-				bp_signaling_queue, b_id,
-				BP_SIGNAL_FORWARDING_CONTRAINDICATED,
-				reason);
-			success = false;
-		} else {
-			for (int8_t i = 0; i < proc_result.status_or_fragments;
-			     i++) {
-				bundle_processor_inform(
-					bp_signaling_queue,
-					proc_result.fragment_ids[i],
-					BP_SIGNAL_BUNDLE_ROUTED,
-					BUNDLE_SR_REASON_NO_INFO
-				);
-			}
+		router_plan_free(plan);
+		hal_semaphore_release(ro_sem); /* Allow optimizer to run */
+		break;
+	case ROUTER_SIGNAL_ROUTE_BUNDLE:
+		b_id = (bundleid_t)(uintptr_t)signal.data;
+		success = route_bundle(b_id, bp_signaling_queue, cm_semaphore);
+		if (success)
 			wake_up_contact_manager(
 				cm_queue,
 				CM_SIGNAL_PROCESS_CURRENT_BUNDLES
 			);
-		}
 		hal_semaphore_release(ro_sem); /* Allow optimizer to run */
 		break;
 	case ROUTER_SIGNAL_CONTACT_OVER:
@@ -249,8 +405,11 @@ static bool process_signal(
 		LOGF("RouterTask: Node withdrawn (%p)!", node);
 		break;
 	case ROUTER_SIGNAL_NEW_LINK_ESTABLISHED:
-		// NOTE: When we implement a "bundle backlog", we will attempt
-		// to route the bundles here.
+		// Re-route the bundles for the peer, if it is known
+		eid = (char *)signal.data;
+		if (retry_backlog(eid, bp_signaling_queue, cm_semaphore) != 0)
+			hal_semaphore_release(ro_sem);
+		free(eid);
 		wake_up_contact_manager(
 			cm_queue,
 			CM_SIGNAL_PROCESS_CURRENT_BUNDLES
@@ -273,6 +432,14 @@ static bool process_router_command(
 		free_node(router_cmd->data);
 		return false;
 	}
+	return apply_router_command(router_cmd, bp_signaling_queue);
+}
+
+/* Requires the node of the command to be verified */
+static bool apply_router_command(
+	struct router_command *router_cmd,
+	QueueIdentifier_t bp_signaling_queue)
+{
 	switch (router_cmd->type) {
 	case ROUTER_COMMAND_ADD:
 		routing_table_add_node(
@@ -300,6 +467,93 @@ static bool process_router_command(
 	return true;
 }
 
+static int compare_eids(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Removes all nodes which are not contained in the plan */
+static void remove_other_nodes(
+	struct router_plan *plan, QueueIdentifier_t bp_signaling_queue)
+{
+	struct node_list *cur;
+	char **plan_eids, **remove_eids;
+	uint32_t i, node_count = 0, remove_count = 0;
+
+	for (cur = routing_table_get_node_list(); cur; cur = cur->next)
+		node_count++;
+	plan_eids = malloc(sizeof(char *) * (plan->command_count + 1));
+	remove_eids = malloc(sizeof(char *) * (node_count + 1));
+	if (plan_eids == NULL || remove_eids == NULL) {
+		LOG("RouterTask: Cannot remove nodes not in plan");
+		goto finalize;
+	}
+	for (i = 0; i < plan->command_count; i++)
+		plan_eids[i] = plan->commands[i].data->eid;
+	qsort(plan_eids, plan->command_count, sizeof(char *), compare_eids);
+	for (cur = routing_table_get_node_list(); cur; cur = cur->next) {
+		if (bsearch(&cur->node->eid, plan_eids, plan->command_count,
+			    sizeof(char *), compare_eids) == NULL)
+			remove_eids[remove_count++] = cur->node->eid;
+	}
+	/* The EID is owned by the node, it is not accessed after freeing */
+	for (i = 0; i < remove_count; i++)
+		routing_table_delete_node_by_eid(remove_eids[i],
+						 bp_signaling_queue);
+finalize:
+	free(plan_eids);
+	free(remove_eids);
+}
+
+/*
+ * All nodes of the plan are verified before the routing table is changed,
+ * a single invalid node rejects the whole plan. Afterwards, only deleting
+ * unknown nodes or contacts can fail, which does not change anything.
+ */
+bool router_process_plan_int(
+	struct router_plan *plan,
+	QueueIdentifier_t bp_signaling_queue)
+{
+	struct router_command command;
+	uint32_t i, failed = 0;
+
+	/* This sorts and removes duplicates */
+	for (i = 0; i < plan->command_count; i++) {
+		if (!node_prepare_and_verify(plan->commands[i].data)) {
+			LOGF("RouterTask: Rejecting plan, node \"%s\" is invalid",
+			     plan->commands[i].data->eid);
+			return false;
+		}
+	}
+	if (plan->full)
+		remove_other_nodes(plan, bp_signaling_queue);
+	for (i = 0; i < plan->command_count; i++) {
+		command = plan->commands[i];
+		/* The node is passed to the routing table or freed */
+		plan->commands[i].data = NULL;
+		/* Nodes of a full plan replace the existing ones */
+		if (plan->full && command.type == ROUTER_COMMAND_ADD)
+			command.type = ROUTER_COMMAND_UPDATE;
+		if (!apply_router_command(&command, bp_signaling_queue))
+			failed++;
+	}
+	return failed == 0;
+}
+
+void router_plan_free(struct router_plan *plan)
+{
+	uint32_t i;
+
+	if (plan == NULL)
+		return;
+	for (i = 0; i < plan->command_count; i++) {
+		if (plan->commands[i].data != NULL)
+			free_node(plan->commands[i].data);
+	}
+	free(plan->commands);
+	free(plan);
+}
+
 static struct bundle_processing_result apply_fragmentation(
 	struct bundle *bundle, struct router_result route);
 
@@ -312,8 +566,9 @@ static struct bundle_processing_result process_bundle(struct bundle *bundle)
 
 	ASSERT(bundle != NULL);
 	route = router_get_first_route(bundle);
-	/* TODO: Add to list if no route but own OR priority > X */
-	if (route.fragments == 1) {
+	if (route.fragments == 0) {
+		return result;
+	} else if (route.fragments == 1) {
 		result.fragment_ids[0] = bundle->id;
 		if (router_add_bundle_to_route(&route.fragment_results[0],
 					       bundle))
@@ -2,10 +2,16 @@
 #include "upcn/bundle_processor.h"
 #include "upcn/bundle_storage_manager.h"
 #include "upcn/common.h"
+#include "upcn/contact_schedule.h"
+#include "upcn/eid_index.h"
+#include "upcn/nbf.h"
 #include "upcn/node.h"
 #include "upcn/router.h"
+#include "upcn/router_cgr.h"
+#include "upcn/router_optimizer.h"
 #include "upcn/routing_table.h"
-#include "upcn/simplehtab.h"
+
+#include "platform/hal_io.h"
 
 #include <stdbool.h>
 #include <stdlib.h>
@@ -14,21 +20,20 @@
 static struct node_list *node_list;
 static struct contact_list *contact_list;
 
-static struct htab_entrylist *htab_elem[NODE_HTAB_SLOT_COUNT];
-static struct htab eid_table;
-static uint8_t eid_table_initialized;
+// Maps EIDs and EID patterns to their node_table_entry
+static struct eid_index *eid_index;
+static uint32_t version;
 
 /* INIT */
 
 enum upcn_result routing_table_init(void)
 {
-	if (eid_table_initialized != 0)
+	if (eid_index != NULL)
 		return UPCN_OK;
 	node_list = NULL;
 	contact_list = NULL;
-	htab_init(&eid_table, NODE_HTAB_SLOT_COUNT, htab_elem);
-	eid_table_initialized = 1;
-	return UPCN_OK;
+	eid_index = eid_index_create();
+	return (eid_index != NULL) ? UPCN_OK : UPCN_FAIL;
 }
 
 void routing_table_free(void)
@@ -43,6 +48,8 @@ void routing_table_free(void)
 		free(node_list);
 		node_list = next;
 	}
+	contact_schedule_free();
+	router_cgr_free();
 }
 
 /* LOOKUP */
@@ -87,10 +94,36 @@ struct node *routing_table_lookup_node(const char *eid)
 
 struct node_table_entry *routing_table_lookup_eid(const char *eid)
 {
-	return (struct node_table_entry *)htab_get(&eid_table, eid);
+	return (struct node_table_entry *)eid_index_get(eid_index, eid);
+}
+
+uint8_t routing_table_lookup_eid_matches(
+	const char *eid, struct node_table_entry **entries, uint8_t max)
+{
+	return eid_index_lookup(eid_index, eid, (void **)entries, max);
+}
+
+uint32_t routing_table_get_version(void)
+{
+	return version;
 }
 
 
+uint8_t routing_table_lookup_eid_in_nbf(
+	const char *eid, struct node **target, uint8_t max)
+{
+	struct node_list *cur = node_list;
+	uint8_t c = 0;
+
+	while (cur != NULL && c < max) {
+		if (cur->node->nbf != NULL &&
+				nbf_contains(cur->node->nbf, eid))
+			target[c++] = cur->node;
+		cur = cur->next;
+	}
+	return c;
+}
+
 uint8_t routing_table_lookup_hot_node(
 	struct node **target, uint8_t max)
 {
@@ -146,9 +179,13 @@ void routing_table_add_node(
 	ASSERT(new_node != NULL);
 	entry = get_node_entry_by_eid(new_node->eid);
 	if (entry == NULL) {
+		router_cgr_plan_extended(new_node, new_node->endpoints,
+					 new_node->contacts);
 		add_new_node(new_node);
 	} else {
 		cur_node = entry->node;
+		router_cgr_plan_extended(cur_node, new_node->endpoints,
+					 new_node->contacts);
 		/* Should not be needed here because we only ADD */
 		/* remove_node_from_htab(cur_node); */
 		if (new_node->cla_addr[0] != '\0') {
@@ -158,6 +195,14 @@ void routing_table_add_node(
 		} else {
 			free(new_node->cla_addr);
 		}
+		// A filter with other parameters replaces the current one
+		if (new_node->nbf != NULL && (cur_node->nbf == NULL ||
+				nbf_merge(cur_node->nbf, new_node->nbf)
+					!= UPCN_OK)) {
+			nbf_free(cur_node->nbf);
+			cur_node->nbf = new_node->nbf;
+			new_node->nbf = NULL;
+		}
 		cur_node->endpoints = endpoint_list_union(
 			cur_node->endpoints, new_node->endpoints);
 		cur_node->contacts = contact_list_union(
@@ -188,6 +233,7 @@ void routing_table_add_node(
 			cap_modified = next;
 		}
 		add_node_to_tables(cur_node);
+		nbf_free(new_node->nbf);
 		free(new_node->eid);
 		free(new_node);
 	}
@@ -201,8 +247,13 @@ void routing_table_replace_node(
 	ASSERT(node != NULL);
 	entry = get_node_entry_by_eid(node->eid);
 	if (entry == NULL) {
+		router_cgr_plan_extended(node, node->endpoints,
+					 node->contacts);
 		add_new_node(node);
 	} else {
+		router_cgr_node_changed(entry->node);
+		router_cgr_plan_extended(node, node->endpoints,
+					 node->contacts);
 		remove_node_from_tables(entry->node, true,
 					bproc_signaling_queue);
 		free_node(entry->node);
@@ -222,6 +273,7 @@ int routing_table_delete_node_by_eid(
 		/* Delete whole node */
 		old_node_entry = *entry_ptr;
 		*entry_ptr = old_node_entry->next;
+		router_cgr_node_changed(old_node_entry->node);
 		remove_node_from_tables(old_node_entry->node, true,
 					bproc_signaling_queue);
 		free_node(old_node_entry->node);
@@ -242,6 +294,7 @@ int routing_table_delete_node(
 	entry_ptr = get_node_entry_ptr_by_eid(new_node->eid);
 	if (entry_ptr != NULL) {
 		cur_node = (*entry_ptr)->node;
+		router_cgr_node_changed(cur_node);
 		if (new_node->endpoints == NULL && new_node->contacts == NULL) {
 			/* Delete whole node */
 			old_node_entry = *entry_ptr;
@@ -280,6 +333,7 @@ int routing_table_delete_node(
 				}
 			}
 			add_node_to_tables(cur_node);
+			nbf_free(new_node->nbf);
 			free(new_node->eid);
 			free(new_node);
 		}
@@ -289,8 +343,8 @@ int routing_table_delete_node(
 	return 0;
 }
 
-static bool add_contact_to_node_in_htab(char *eid, struct contact *c, float p);
-static bool remove_contact_from_node_in_htab(char *eid, struct contact *c);
+static bool add_contact_to_eid_entry(char *eid, struct contact *c, float p);
+static bool remove_contact_from_eid_entry(char *eid, struct contact *c);
 static bool check_for_invalid_overlaps(struct contact *c);
 
 static void add_node_to_tables(struct node *node)
@@ -299,6 +353,7 @@ static void add_node_to_tables(struct node *node)
 	struct endpoint_list *cur_persistent_node, *cur_contact_node;
 
 	ASSERT(node != NULL);
+	version++;
 	cur_contact = node->contacts;
 	while (cur_contact != NULL) {
 		/* TODO: Try to add contact but reduce timespan */
@@ -306,24 +361,29 @@ static void add_node_to_tables(struct node *node)
 			cur_contact = cur_contact->next;
 			continue;
 		}
-		add_contact_to_node_in_htab(node->eid, cur_contact->data, 1.0f);
+		add_contact_to_eid_entry(node->eid, cur_contact->data, 1.0f);
 		cur_persistent_node = node->endpoints;
 		while (cur_persistent_node != NULL) {
-			add_contact_to_node_in_htab(
+			add_contact_to_eid_entry(
 				cur_persistent_node->eid, cur_contact->data,
 				1.0f);
 			cur_persistent_node = cur_persistent_node->next;
 		}
 		cur_contact_node = cur_contact->data->contact_endpoints;
 		while (cur_contact_node != NULL) {
-			add_contact_to_node_in_htab(
+			add_contact_to_eid_entry(
 				cur_contact_node->eid, cur_contact->data,
 				1.0f);
 			cur_contact_node = cur_contact_node->next;
 		}
 		add_contact_to_ordered_list(
 			&contact_list, cur_contact->data, 1);
+		if (contact_schedule_add(cur_contact->data) != UPCN_OK)
+			LOG("RoutingTable: Failed to schedule contact");
 		recalculate_contact_capacity(cur_contact->data);
+		// Capacities changed, bundles may be routed better now
+		if (cur_contact->data->bundle_count != 0)
+			router_optimizer_mark_dirty(cur_contact->data);
 		cur_contact = cur_contact->next;
 	}
 }
@@ -335,24 +395,27 @@ static void remove_node_from_tables(struct node *node, bool drop_contacts,
 	struct endpoint_list *cur_persistent_node, *cur_contact_node;
 
 	ASSERT(node != NULL);
+	version++;
 	cur_slot = &node->contacts;
 	while (*cur_slot != NULL) {
 		struct contact_list *const cur_contact = *cur_slot;
 
-		remove_contact_from_node_in_htab(node->eid, cur_contact->data);
+		remove_contact_from_eid_entry(node->eid, cur_contact->data);
 		cur_persistent_node = node->endpoints;
 		while (cur_persistent_node != NULL) {
-			remove_contact_from_node_in_htab(
+			remove_contact_from_eid_entry(
 				cur_persistent_node->eid, cur_contact->data);
 			cur_persistent_node = cur_persistent_node->next;
 		}
 		cur_contact_node = cur_contact->data->contact_endpoints;
 		while (cur_contact_node != NULL) {
-			remove_contact_from_node_in_htab(
+			remove_contact_from_eid_entry(
 				cur_contact_node->eid, cur_contact->data);
 			cur_contact_node = cur_contact_node->next;
 		}
 		remove_contact_from_list(&contact_list, cur_contact->data);
+		contact_schedule_remove(cur_contact->data);
+		router_optimizer_contact_removed(cur_contact->data);
 		if (drop_contacts) {
 			reschedule_bundles(cur_contact->data,
 					   bproc_signaling_queue);
@@ -371,21 +434,24 @@ static void remove_node_from_tables(struct node *node, bool drop_contacts,
 	}
 }
 
-static bool add_contact_to_node_in_htab(char *eid, struct contact *c, float p)
+static bool add_contact_to_eid_entry(char *eid, struct contact *c, float p)
 {
 	struct node_table_entry *entry;
 
 	ASSERT(eid != NULL);
 	ASSERT(p > 0.0f && p <= 1.0f);
 	ASSERT(c != NULL);
-	entry = (struct node_table_entry *)htab_get(&eid_table, eid);
+	entry = (struct node_table_entry *)eid_index_get(eid_index, eid);
 	if (entry == NULL) {
 		entry = malloc(sizeof(struct node_table_entry));
 		if (entry == NULL)
 			return false;
 		entry->ref_count = 0;
 		entry->contacts = NULL;
-		htab_add(&eid_table, eid, entry);
+		if (eid_index_add(eid_index, eid, entry) != UPCN_OK) {
+			free(entry);
+			return false;
+		}
 	}
 	if (add_contact_to_ordered_assoc_list(&(entry->contacts), c, p, 0)) {
 		entry->ref_count++;
@@ -394,19 +460,19 @@ static bool add_contact_to_node_in_htab(char *eid, struct contact *c, float p)
 	return false;
 }
 
-static bool remove_contact_from_node_in_htab(char *eid, struct contact *c)
+static bool remove_contact_from_eid_entry(char *eid, struct contact *c)
 {
 	struct node_table_entry *entry;
 
 	ASSERT(eid != NULL);
 	ASSERT(c != NULL);
-	entry = (struct node_table_entry *)htab_get(&eid_table, eid);
+	entry = (struct node_table_entry *)eid_index_get(eid_index, eid);
 	if (entry == NULL)
 		return false;
 	if (remove_contact_from_assoc_list(&(entry->contacts), c)) {
 		entry->ref_count--;
 		if (entry->ref_count <= 0) {
-			htab_remove(&eid_table, eid);
+			eid_index_remove(eid_index, eid);
 			free(entry);
 		}
 		return true;
@@ -439,6 +505,17 @@ static bool check_for_invalid_overlaps(struct contact *c)
 	return (bool)(overlaps >= MAX_CONCURRENT_CONTACTS);
 }
 
+void routing_table_begin_update(void)
+{
+	router_cgr_begin_bulk_update();
+}
+
+void routing_table_end_update(void)
+{
+	router_cgr_end_bulk_update();
+	version++;
+}
+
 /* CONTACT LIST */
 struct contact_list **routing_table_get_raw_contact_list_ptr(void)
 {
@@ -455,14 +532,16 @@ void routing_table_delete_contact(struct contact *contact)
 	struct endpoint_list *cur_eid;
 
 	ASSERT(contact != NULL);
-	ASSERT(contact->contact_bundles == NULL);
+	ASSERT(contact->bundle_count == 0);
+	router_cgr_contact_removed(contact);
+	version++;
 	if (contact->node != NULL) {
-		remove_contact_from_node_in_htab(
+		remove_contact_from_eid_entry(
 			contact->node->eid, contact);
 		/* Remove contact from reachable endpoints */
 		cur_eid = contact->node->endpoints;
 		while (cur_eid != NULL) {
-			remove_contact_from_node_in_htab(
+			remove_contact_from_eid_entry(
 				cur_eid->eid, contact);
 			cur_eid = cur_eid->next;
 		}
@@ -473,13 +552,15 @@ void routing_table_delete_contact(struct contact *contact)
 	/* Remove contact from contact nodes and free list */
 	cur_eid = contact->contact_endpoints;
 	while (cur_eid != NULL) {
-		remove_contact_from_node_in_htab(
+		remove_contact_from_eid_entry(
 			cur_eid->eid, contact);
 		cur_eid = endpoint_list_free(cur_eid);
 	}
 	contact->contact_endpoints = NULL;
 	/* Remove from global list */
 	remove_contact_from_list(&contact_list, contact);
+	contact_schedule_remove(contact);
+	router_optimizer_contact_removed(contact);
 	/* Free contact itself */
 	free_contact(contact);
 }
@@ -487,20 +568,21 @@ void routing_table_delete_contact(struct contact *contact)
 void routing_table_contact_passed(
 	struct contact *contact, QueueIdentifier_t bproc_signaling_queue)
 {
-	struct routed_bundle_list *tmp;
+	struct routed_bundle_list *bundles, *tmp;
 
 	if (contact->node != NULL) {
-		while (contact->contact_bundles != NULL) {
+		bundles = contact_take_bundles(contact);
+		while (bundles != NULL) {
 			/* TODO: Transmit struct routed_bundle? */
 			bundle_processor_inform(
 				bproc_signaling_queue,
-				contact->contact_bundles->data->id,
+				bundles->data->id,
 				BP_SIGNAL_RESCHEDULE_BUNDLE,
 				BUNDLE_SR_REASON_NO_INFO);
-			tmp = contact->contact_bundles->next;
-			free(contact->contact_bundles->data);
-			free(contact->contact_bundles);
-			contact->contact_bundles = tmp;
+			tmp = bundles->next;
+			free(bundles->data);
+			free(bundles);
+			bundles = tmp;
 		}
 	}
 	routing_table_delete_contact(contact);
@@ -518,8 +600,7 @@ static void reschedule_bundles(
 
 	ASSERT(contact != NULL);
 	/* Empty the bundle list and queue them in for re-scheduling */
-	while (contact->contact_bundles != NULL) {
-		rb = contact->contact_bundles->data;
+	while ((rb = contact_first_bundle(contact)) != NULL) {
 		ASSERT(rb->contact_count <= ROUTER_MAX_CONTACTS);
 		for (c = 0; c < rb->contact_count; c++)
 			fr.contacts[c] = rb->contacts[c];
@@ -24,6 +24,22 @@ void aap_serialize(const struct aap_message *msg,
 	void (*write)(void *param, const void *data, const size_t length),
 	void *param);
 
+/**
+ * Serializes the specified message without the payload bytes, which have to
+ * be written (`payload_length` bytes) by the caller afterwards. This allows
+ * to send payloads which are not available as a contiguous buffer.
+ * The message has to be valid according to `aap_message_is_valid`, except
+ * that `payload` is not accessed.
+ *
+ * @param msg The message to be serialized.
+ * @param write A function to write out / send the serialized message.
+ * @param param An arbitrary parameter passed to the write function as
+ *              first argument.
+ */
+void aap_serialize_header(const struct aap_message *msg,
+	void (*write)(void *param, const void *data, const size_t length),
+	void *param);
+
 /**
  * Serializes the specified message into the provided buffer.
  * The buffer size has to be equal or greater than what is returned by
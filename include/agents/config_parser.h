@@ -33,6 +33,11 @@ enum config_parser_stage {
 	RP_EXPECT_CONTACT_NODE_SEPARATOR,
 	RP_EXPECT_CONTACT_END_DELIMITER,
 	RP_EXPECT_CONTACT_SEPARATOR,
+	RP_EXPECT_CONTACTS_NBF_SEPARATOR,
+	RP_EXPECT_NBF_START_DELIMITER,
+	RP_EXPECT_NBF_BIT_COUNT,
+	RP_EXPECT_NBF_HASH_COUNT,
+	RP_EXPECT_NBF_DATA,
 	RP_EXPECT_COMMAND_END_MARKER
 };
 
@@ -46,6 +51,7 @@ struct config_parser {
 	char *current_int_data;
 	struct endpoint_list *current_eid;
 	struct contact_list *current_contact;
+	uint32_t nbf_bit_count;
 };
 
 struct parser *config_parser_init(
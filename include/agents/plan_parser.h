@@ -0,0 +1,29 @@
+#ifndef PLANPARSER_H_INCLUDED
+#define PLANPARSER_H_INCLUDED
+
+#include "upcn/router_task.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Flags of a binary contact plan */
+enum plan_flags {
+	PLAN_FLAG_NONE = 0x0,
+	/* The plan replaces all nodes instead of changing the given ones */
+	PLAN_FLAG_FULL = 0x1,
+};
+
+/*
+ * Returns true if the data is a binary (CBOR) contact plan as described in
+ * doc/contacts.cbor.format instead of a text command.
+ */
+bool plan_parser_is_plan(const uint8_t *buffer, size_t length);
+
+/*
+ * Parses a binary contact plan in one pass. Returns NULL if the plan is
+ * invalid or no memory is available.
+ */
+struct router_plan *plan_parser_parse(const uint8_t *buffer, size_t length);
+
+#endif /* PLANPARSER_H_INCLUDED */
@@ -29,6 +29,19 @@ struct bundle6_dict_descriptor {
 	struct bundle6_eid_info eid_references[];
 };
 
+/*
+ * Serialized primary block (including the dictionary) and the dictionary
+ * offsets of all EID references of the extension blocks, in block order.
+ * It is attached to the bundle and rebuilt only if the header changes, so
+ * retransmissions and size queries do not reconstruct the dictionary.
+ */
+struct bundle6_header_cache {
+	size_t primary_block_size;
+	uint8_t *primary_block;
+	size_t eid_reference_count;
+	struct bundle6_eid_reference eid_references[];
+};
+
 /**
  * Serializes the bundle dictionary into the given buffer
  */
@@ -41,7 +54,21 @@ void bundle6_serialize_dictionary(char *buf,
 
 size_t bundle6_get_dict_length(struct bundle *bundle);
 struct bundle6_dict_descriptor *bundle6_calculate_dict(struct bundle *bundle);
+
+/**
+ * Recalculates the primary block length and drops the header cache. Has to
+ * be called after any change to the primary block or EID references once
+ * the bundle has been serialized or its size has been queried.
+ */
 void bundle6_recalculate_header_length(struct bundle *bundle);
+
+/**
+ * Returns the header cache of the bundle, building it if necessary.
+ * Returns NULL if no memory is available.
+ */
+const struct bundle6_header_cache *bundle6_get_header_cache(
+	struct bundle *bundle);
+
 size_t bundle6_get_serialized_size(struct bundle *bundle);
 
 
@@ -0,0 +1,31 @@
+#ifndef BUNDLE6_CTEB_H_INCLUDED
+#define BUNDLE6_CTEB_H_INCLUDED
+
+#include "upcn/bundle.h"
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Custody Transfer Enhancement Block (CCSDS 734.2-B-1)
+ *
+ * The block contains the custody ID assigned by the current custodian
+ * (as SDNV) followed by the EID of that custodian. It allows the next
+ * custodian to acknowledge the bundle via an Aggregate Custody Signal.
+ */
+
+/**
+ * Returns the custody ID contained in the CTEB of the given bundle if the
+ * block exists and has been added by the current custodian of the bundle.
+ */
+bool bundle6_cteb_get_custody_id(const struct bundle *bundle,
+				 uint64_t *custody_id);
+
+/**
+ * Adds a CTEB to the given bundle or replaces the existing one.
+ */
+enum upcn_result bundle6_cteb_set(struct bundle *bundle, uint64_t custody_id,
+				  const char *custodian);
+
+#endif /* BUNDLE6_CTEB_H_INCLUDED */
@@ -28,6 +28,22 @@ struct bundle *bundle6_generate_custody_signal(
 	const char *local_eid);
 
 
+/**
+ * Generates an Aggregate Custody Signal (CCSDS 734.2-B-1) bundle
+ * acknowledging all custody IDs contained in the given sorted,
+ * non-overlapping fills that can be send to the specified custodian.
+ *
+ * The start of the first fill is encoded as absolute custody ID, the start
+ * of every further fill relative to the end of the preceding fill.
+ *
+ * @param lifetime The lifetime of the signal bundle, in seconds.
+ */
+struct bundle *bundle6_generate_aggregate_custody_signal(
+	const char *custodian, const struct bundle_custody_signal *signal,
+	const struct bundle_acs_fill *fills, const uint32_t fill_count,
+	const char *local_eid, const uint64_t lifetime);
+
+
 /**
  * Parses the payload block of the a RFC 5050 administrative record
  */
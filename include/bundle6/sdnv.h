@@ -1,6 +1,7 @@
 #ifndef SDNV_H_INCLUDED
 #define SDNV_H_INCLUDED
 
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -34,6 +35,22 @@ void sdnv_read_u16(struct sdnv_state *state, uint16_t *value, uint8_t byte);
 void sdnv_read_u32(struct sdnv_state *state, uint32_t *value, uint8_t byte);
 void sdnv_read_u64(struct sdnv_state *state, uint64_t *value, uint8_t byte);
 
+/**
+ * Decodes a complete SDNV from a contiguous buffer, a word at a time if
+ * eight bytes are available.
+ *
+ * @return The size of the SDNV in bytes, 0 if the buffer ends before the
+ *         SDNV, -1 if the value does not fit into the given type.
+ */
+int_fast8_t sdnv_decode_u8(const uint8_t *buffer, size_t length,
+	uint8_t *value);
+int_fast8_t sdnv_decode_u16(const uint8_t *buffer, size_t length,
+	uint16_t *value);
+int_fast8_t sdnv_decode_u32(const uint8_t *buffer, size_t length,
+	uint32_t *value);
+int_fast8_t sdnv_decode_u64(const uint8_t *buffer, size_t length,
+	uint64_t *value);
+
 int_fast8_t sdnv_get_size_u8(uint8_t value);
 int_fast8_t sdnv_get_size_u16(uint16_t value);
 int_fast8_t sdnv_get_size_u32(uint32_t value);
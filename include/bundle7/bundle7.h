@@ -1,5 +1,5 @@
-#ifndef BUNDLE_V7_PARSER_H_INCLUDED
-#define BUNDLE_V7_PARSER_H_INCLUDED
+#ifndef BUNDLE_V7_H_INCLUDED
+#define BUNDLE_V7_H_INCLUDED
 
 #include "upcn/bundle.h"
 #include "upcn/result.h"
@@ -62,4 +62,4 @@ size_t bundle7_get_first_fragment_min_size(struct bundle *bundle);
  */
 size_t bundle7_get_last_fragment_min_size(struct bundle *bundle);
 
-#endif // BUNDLE_V7_PARSER_H_INCLUDED
+#endif // BUNDLE_V7_H_INCLUDED
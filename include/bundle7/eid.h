@@ -1,6 +1,8 @@
 #ifndef BUNDLE7_EID_H_INCLUDED
 #define BUNDLE7_EID_H_INCLUDED
 
+#include "upcn/result.h"
+
 #include "cbor.h"
 
 #include <stddef.h>  // size_t
@@ -88,4 +90,29 @@ int bundle7_eid_serialize(const char *eid, uint8_t *buffer,
  */
 CborError bundle7_eid_serialize_cbor(const char *eid, CborEncoder *encoder);
 
+
+/**
+ * Creates the lock of the EID serializer cache. Has to be called once before
+ * "bundle7_eid_serialize_cached()" is used.
+ *
+ * @return UPCN_OK on success, UPCN_FAIL if the lock could not be created
+ */
+enum upcn_result bundle7_eid_cache_init(void);
+
+
+/**
+ * Like "bundle7_eid_serialize()" but takes the encoding from a cache of
+ * recently serialized EIDs. If the buffer is NULL, only the length of the
+ * encoding is returned.
+ *
+ * @param eid EID string
+ * @param buffer CBOR output buffer or NULL
+ * @param buffer_size length of the output buffer
+ *
+ * @return Number of CBOR bytes (written to buffer), 0 if the buffer is too
+ *         small and -1 in case of an error
+ */
+int bundle7_eid_serialize_cached(const char *eid, uint8_t *buffer,
+	size_t buffer_size);
+
 #endif // BUNDLE7_EID_H_INCLUDED
@@ -11,6 +11,7 @@
 #include "cbor.h"
 
 #include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 
@@ -23,6 +24,12 @@ enum bundle7_parser_flags {
 	 * the parsed CBOR element.
 	 */
 	BUNDLE_V7_PARSER_CRC_FEED = 0x01,
+
+	/**
+	 * The bundle is dropped. The data of all further blocks is skipped
+	 * by a "discard read" and the bundle is freed after parsing.
+	 */
+	BUNDLE_V7_PARSER_DISCARD = 0x02,
 };
 
 
@@ -68,6 +75,15 @@ struct bundle7_parser {
 	void (*send_callback)(struct bundle *, void *);
 	void *send_param;
 
+	/**
+	 * Optional callback after the header of the payload block was parsed,
+	 * before the payload gets read. Receives the bundle without payload
+	 * data, the payload length and the "send" parameter. If it returns
+	 * false, the payload is skipped without allocating memory for it and
+	 * the bundle is dropped.
+	 */
+	bool (*admit_callback)(const struct bundle *, size_t, void *);
+
 	struct bundle_block_list **current_block_entry;
 };
 
@@ -82,6 +98,21 @@ struct parser *bundle7_parser_init(
 size_t bundle7_parser_read(struct bundle7_parser *parser,
 	const uint8_t *buffer, size_t length);
 
+/**
+ * Parses a bundle that is completely contained in a contiguous buffer in a
+ * single pass, without the bookkeeping needed by the streaming parser.
+ * The optional "admit_callback" is used like the one of the streaming parser
+ * and gets "param" passed.
+ *
+ * @return The parsed bundle or NULL if the buffer does not contain exactly
+ *         one valid bundle of at most "bundle_quota" bytes or the bundle
+ *         was refused by "admit_callback".
+ */
+struct bundle *bundle7_parse_buffer(const uint8_t *buffer, size_t length,
+	size_t bundle_quota,
+	bool (*admit_callback)(const struct bundle *, size_t, void *),
+	void *param);
+
 enum upcn_result bundle7_parser_reset(struct bundle7_parser *state);
 enum upcn_result bundle7_parser_deinit(struct bundle7_parser *state);
 
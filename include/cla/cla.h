@@ -117,6 +117,8 @@ struct cla_vtable {
 	void (*cla_send_packet_data)(struct cla_link *,
 				     const void *,
 				     const size_t);
+	/* Sends data buffered by the CLA after a batch of bundles (optional) */
+	void (*cla_flush)(struct cla_link *);
 
 	// RX Task API
 
@@ -4,6 +4,9 @@
 #include "bundle6/parser.h"
 #include "bundle7/parser.h"
 
+#include "upcn/bundle.h"
+#include "upcn/config.h"
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -14,8 +17,6 @@ enum cla_payload_type {
 	PAYLOAD_BUNDLE7 = 7
 };
 
-#define CLA_RX_BUFFER_SIZE 64
-
 struct rx_task_data {
 	enum cla_payload_type payload_type;
 
@@ -31,6 +32,18 @@ struct rx_task_data {
 		uint8_t *end;
 	} input_buffer;
 
+	/**
+	 * Bundles parsed from the input buffer, handed over to the bundle
+	 * storage and the bundle processor together after parsing it.
+	 */
+	struct {
+		struct bundle *bundles[CLA_RX_BATCH_SIZE];
+		bundleid_t ids[CLA_RX_BATCH_SIZE];
+		uint16_t count;
+	} batch;
+
+	void *cla_config;
+
 	bool timeout_occured;
 };
 
@@ -40,6 +53,24 @@ size_t select_bundle_parser_version(struct rx_task_data *rx_data,
 				    const uint8_t *buffer,
 				    size_t length);
 
+/**
+ * Parses a BPv7 bundle that is completely contained in the buffer (e.g. a
+ * whole CLA frame) in one pass instead of using the streaming parser.
+ *
+ * @return The number of consumed bytes, zero if the buffer does not start
+ *         with a BPv7 bundle. Invalid bundles and bundles refused by the
+ *         admission callback of the BPv7 parser are consumed and dropped.
+ */
+size_t rx_task_parse_bundle_frame(struct rx_task_data *rx_data,
+				  const uint8_t *buffer,
+				  size_t length);
+
+/**
+ * Stores all bundles parsed since the last call and informs the bundle
+ * processor about them with a single signal.
+ */
+void rx_task_flush_bundles(struct rx_task_data *rx_data);
+
 enum upcn_result rx_task_data_init(struct rx_task_data *rx_data,
 				   void *cla_config);
 void rx_task_data_deinit(struct rx_task_data *rx_data);
@@ -19,6 +19,10 @@
 #define CLA_TCPSPP_USE_CRC (true)
 #endif
 
+#ifndef CLA_TCPSPP_TX_BUFFER_SIZE
+#define CLA_TCPSPP_TX_BUFFER_SIZE 4096
+#endif
+
 struct cla_config *tcpspp_create(
 	const char *const options[], const size_t option_count,
 	const struct bundle_agent_interface *bundle_agent_interface);
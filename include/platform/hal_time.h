@@ -17,6 +17,9 @@
  * @brief hal_TimeInit Initialize the clock of the underlying system with the
  *		       given initialTimestamp
  * @param initialTimestamp The current time (in seconds)
+ *
+ * Only the offset to the DTN epoch is changed, the timestamps are still
+ * derived from a monotonic clock of the system.
  */
 void hal_time_init(const uint64_t initial_timestamp);
 
@@ -38,9 +41,18 @@ uint64_t hal_time_get_timestamp_ms(void);
  */
 uint64_t hal_time_get_timestamp_us(void);
 
+/**
+ * @brief hal_time_get_timestamp_s_coarse Provides information about the
+ *					  current time, may lag behind
+ *					  hal_time_get_timestamp_s() by
+ *					  one tick of the system clock
+ * @return The current time in seconds
+ */
+uint64_t hal_time_get_timestamp_s_coarse(void);
+
 /**
  * @brief hal_time_get_system_time Provides the absolute system time (e.g.
- *				   uptime)
+ *				   uptime), not affected by hal_time_init()
  * @return The uptime in microseconds
  */
 uint64_t hal_time_get_system_time(void);
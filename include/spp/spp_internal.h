@@ -42,6 +42,8 @@ void spp_parse_ph_p2(const uint16_t word,
 					 struct spp_primary_header_t *header);
 void spp_parse_ph_len(const uint16_t word,
 					  struct spp_primary_header_t *header);
+/* Decodes a primary header of SPP_PRIMARY_HEADER_SIZE bytes without checks */
+void spp_parse_ph(const uint8_t *buf, struct spp_primary_header_t *header);
 int spp_parse_primary_header(
 		const uint8_t *buf,
 		const size_t length,
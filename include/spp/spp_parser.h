@@ -41,4 +41,31 @@ bool spp_parser_get_data_length(const struct spp_parser *parser,
 			 size_t *dest);
 void spp_parser_reset(struct spp_parser *parser);
 
+/**
+ * @brief Get the size of the space packet starting at the given buffer.
+ *
+ * @return The size of the whole packet including the primary header or 0 if
+ * the buffer does not contain the full primary header.
+ */
+size_t spp_get_packet_size(const uint8_t *buffer, size_t length);
+
+/**
+ * @brief Parse a space packet which is completely contained in the buffer.
+ *
+ * In contrast to the streaming parser, the headers are decoded in one pass
+ * over the contiguous buffer.
+ *
+ * @param ctx The context defining the secondary header.
+ * @param buffer The packet, starting with the primary header.
+ * @param length The packet size as returned by spp_get_packet_size().
+ * @param meta Receives the packet metadata.
+ * @param data Receives a pointer to the user data field in the buffer.
+ * @param data_length Receives the length of the user data field.
+ * @return Zero on success, -1 if the packet is invalid.
+ */
+int spp_parse_packet(const struct spp_context_t *ctx,
+		     const uint8_t *buffer, size_t length,
+		     struct spp_meta_t *meta,
+		     const uint8_t **data, size_t *data_length);
+
 #endif // SPP_PARSER_H
@@ -89,6 +89,22 @@ int spp_tc_parser_feed(
 		struct spp_tc_parser_t *parser,
 		const uint8_t byte);
 
+/**
+ * @brief Feed a contiguous buffer to the parser.
+ *
+ * Equivalent to calling spp_tc_parser_feed() for every byte until the parser
+ * status is no longer SPP_TC_PARSER_GOOD, but decodes the base unit of
+ * unsegmented timecodes without a per-byte dispatch.
+ *
+ * @param parser The parser to feed.
+ * @param buffer The input data.
+ * @param length Number of bytes available in the buffer.
+ * @return Number of bytes consumed. The result is provided in the parser
+ * status.
+ */
+size_t spp_tc_parser_read(struct spp_tc_parser_t *parser,
+			  const uint8_t *buffer, const size_t length);
+
 /**
  * @brief Get the number of octets used for the timestamp defined by the
  * context.
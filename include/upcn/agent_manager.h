@@ -3,6 +3,7 @@
 
 #include "upcn/bundle.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -10,6 +11,8 @@ struct agent {
 	const char *sink_identifier;
 	void (*callback)(struct bundle_adu data, void *param);
 	void *param;
+	// If set, the agent accepts ADUs with chunked payloads
+	bool chunked;
 };
 
 struct agent_list {
@@ -23,6 +26,16 @@ int agent_register(const char *sink_identifier,
 		   void (*callback)(struct bundle_adu data, void *param),
 		   void *param);
 
+/**
+ * Register an agent which handles chunked ADU payloads itself, e.g. by
+ * passing them to bundle_adu_iterate(). This prevents copying reassembled
+ * ADUs into a contiguous buffer before delivery.
+ */
+int agent_register_chunked(const char *sink_identifier,
+			   void (*callback)(struct bundle_adu data,
+					    void *param),
+			   void *param);
+
 int agent_deregister(char *sink_identifier);
 
 struct agent *agent_search(const char *sink_identifier);
@@ -77,6 +77,8 @@ enum bundle_block_type {
 	BUNDLE_BLOCK_TYPE_PREVIOUS_NODE     = 6,
 	BUNDLE_BLOCK_TYPE_BUNDLE_AGE        = 7,
 	BUNDLE_BLOCK_TYPE_HOP_COUNT         = 10,
+	// RFC 5050 (CCSDS 734.2-B-1): Custody Transfer Enhancement Block
+	BUNDLE_V6_BLOCK_TYPE_CTEB           = 10,
 	BUNDLE_BLOCK_TYPE_MAX               = 255,
 };
 
@@ -134,6 +136,9 @@ struct bundle_block_list {
 	struct bundle_block_list *next;
 };
 
+/* RFC 5050: Encoded primary block, see "bundle6/bundle6.h" */
+struct bundle6_header_cache;
+
 struct bundle {
 	bundleid_t id;
 
@@ -163,6 +168,8 @@ struct bundle {
 	 * Aggregate length of the serialized primary block fields.
 	 */
 	uint16_t primary_block_length;
+	// RFC 5050: Built on demand and dropped when the header changes
+	struct bundle6_header_cache *v6_header_cache;
 
 	struct bundle_block_list *blocks;
 	struct bundle_block *payload_block;
@@ -180,6 +187,8 @@ struct bundle_unique_identifier {
 enum bundle_administrative_record_type {
 	BUNDLE_AR_STATUS_REPORT  = 1,
 	BUNDLE_AR_CUSTODY_SIGNAL = 2,
+	// RFC 5050 (CCSDS 734.2-B-1)
+	BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL = 4,
 };
 
 enum bundle_administrative_record_flags {
@@ -269,13 +278,27 @@ struct bundle_custody_signal {
 	enum bundle_custody_signal_reason reason;
 };
 
+/**
+ * A range of consecutive custody IDs [start, start + length) that is
+ * acknowledged by an Aggregate Custody Signal.
+ */
+struct bundle_acs_fill {
+	uint64_t start;
+	uint64_t length;
+};
+
 struct bundle_administrative_record {
 	enum bundle_administrative_record_type type;
 	enum bundle_administrative_record_flags flags;
 
 	struct bundle_status_report *status_report;
+	// Also contains the status of Aggregate Custody Signals
 	struct bundle_custody_signal *custody_signal;
 
+	// Aggregate Custody Signals only, sorted and non-overlapping
+	struct bundle_acs_fill *acs_fills;
+	uint32_t acs_fill_count;
+
 	uint32_t fragment_offset;
 	uint32_t fragment_length;
 	uint64_t event_timestamp;
@@ -300,11 +323,25 @@ enum bundle_routing_priority {
 	BUNDLE_RPRIO_MAX
 };
 
+/**
+ * A part of the payload of an ADU, e.g. the payload of a received fragment.
+ * Chunks may overlap, the bytes at the same offset are identical.
+ */
+struct bundle_adu_chunk {
+	uint32_t offset;
+	uint32_t length;
+	uint8_t *data;
+};
+
 /**
  * A structure that can be leveraged to represent a bundle ADU for exchange
  * with connected bundle applications. The most important feature is that an
  * ADU cannot be fragmented. uPCN will perform fragmentation and reassembly for
  * an ADU.
+ *
+ * The payload is either provided contiguously in `payload` or, e.g. for
+ * reassembled ADUs, as an array of chunks sorted by offset (`payload` is
+ * NULL in that case). Use bundle_adu_iterate() to access it in both cases.
  */
 struct bundle_adu {
 	uint8_t protocol_version;
@@ -313,6 +350,8 @@ struct bundle_adu {
 	char *destination;
 	uint8_t *payload;
 	size_t length;
+	struct bundle_adu_chunk *chunks;
+	uint32_t chunk_count;
 };
 
 
@@ -408,4 +447,17 @@ struct bundle_adu bundle_to_adu(struct bundle *bundle);
  */
 void bundle_adu_free_members(struct bundle_adu adu);
 
+/**
+ * Pass the payload of the given ADU in ascending order and without overlaps
+ * to the provided function, chunk by chunk.
+ */
+void bundle_adu_iterate(const struct bundle_adu *adu,
+	void (*write)(void *param, const void *data, const size_t length),
+	void *param);
+
+/**
+ * Merge the chunks of the given ADU (if any) into a contiguous payload.
+ */
+enum upcn_result bundle_adu_make_contiguous(struct bundle_adu *adu);
+
 #endif /* BUNDLE_H_INCLUDED */
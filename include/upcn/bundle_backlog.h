@@ -0,0 +1,58 @@
+#ifndef BUNDLE_BACKLOG_H_INCLUDED
+#define BUNDLE_BACKLOG_H_INCLUDED
+
+#include "upcn/bundle.h"
+#include "upcn/result.h"
+
+#include <stdint.h>
+
+/**
+ * Stores bundles for which no route could be determined, indexed by the
+ * node EID of their destination, i.e. "dtn://node" for "dtn://node/app".
+ * Other EIDs are used as a whole.
+ *
+ * When a link to a node is established or the contact plan changes, the
+ * bundles for the affected nodes can be taken out of the backlog in bulk
+ * to be routed again.
+ */
+struct bundle_backlog;
+
+/**
+ * Creates a new backlog holding at most max_bundles bundles in total.
+ */
+struct bundle_backlog *bundle_backlog_create(uint32_t max_bundles);
+void bundle_backlog_free(struct bundle_backlog *backlog);
+
+/**
+ * Adds the bundle with the given destination EID and expiration time
+ * (in s) to the backlog. Fails if the backlog is full.
+ */
+enum upcn_result bundle_backlog_add(
+	struct bundle_backlog *backlog, const char *destination,
+	bundleid_t id, uint64_t exp_time);
+
+/**
+ * Removes all bundles destined for the node of the given EID (or all
+ * bundles if it is NULL) from the backlog and invokes the callback for
+ * each of them. Bundles for the same node are passed in the order in which
+ * they were added. All bundles are removed before the first callback is
+ * invoked, so the callback may add them to the backlog again.
+ */
+void bundle_backlog_take(
+	struct bundle_backlog *backlog, const char *eid,
+	void (*callback)(bundleid_t id, uint64_t exp_time, void *param),
+	void *param);
+
+/**
+ * Removes all bundles which expired at the given time (in s) from the
+ * backlog and invokes the callback for each of them. The callback must not
+ * modify the backlog. Returns the number of removed bundles.
+ */
+uint32_t bundle_backlog_expire(
+	struct bundle_backlog *backlog, uint64_t now,
+	void (*callback)(bundleid_t id, uint64_t exp_time, void *param),
+	void *param);
+
+uint32_t bundle_backlog_count(const struct bundle_backlog *backlog);
+
+#endif /* BUNDLE_BACKLOG_H_INCLUDED */
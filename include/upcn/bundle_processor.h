@@ -5,6 +5,9 @@
 
 #include "platform/hal_types.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+
 enum bundle_processor_signal_type {
 	BP_SIGNAL_BUNDLE_INCOMING,
 	BP_SIGNAL_BUNDLE_ROUTED,
@@ -13,13 +16,22 @@ enum bundle_processor_signal_type {
 	BP_SIGNAL_RESCHEDULE_BUNDLE,
 	BP_SIGNAL_TRANSMISSION_SUCCESS,
 	BP_SIGNAL_TRANSMISSION_FAILURE,
-	BP_SIGNAL_BUNDLE_LOCAL_DISPATCH
+	BP_SIGNAL_BUNDLE_LOCAL_DISPATCH,
+	BP_SIGNAL_BUNDLES_INCOMING
+};
+
+/* Bundles passed together with BP_SIGNAL_BUNDLES_INCOMING */
+struct bundle_batch {
+	uint16_t count;
+	bundleid_t ids[];
 };
 
 struct bundle_processor_signal {
 	enum bundle_processor_signal_type type;
 	enum bundle_status_report_reason reason;
 	bundleid_t bundle;
+	/* Only set for BP_SIGNAL_BUNDLES_INCOMING, freed by the receiver */
+	struct bundle_batch *batch;
 };
 
 struct bundle_processor_task_parameters {
@@ -33,6 +45,21 @@ void bundle_processor_inform(
 	QueueIdentifier_t signaling_queue, bundleid_t bundle,
 	enum bundle_processor_signal_type type,
 	enum bundle_status_report_reason reason);
+/*
+ * Signals the reception of multiple stored bundles at once. Falls back to one
+ * BP_SIGNAL_BUNDLE_INCOMING per bundle if no memory is available.
+ */
+void bundle_processor_inform_batch(
+	QueueIdentifier_t signaling_queue, const bundleid_t ids[],
+	uint16_t count);
 void bundle_processor_task(void *param);
 
+/*
+ * Returns true if a bundle with the given primary block and payload length was
+ * already delivered and would be dropped as a duplicate. Allows the CLAs to
+ * drop such bundles before reading their payload.
+ */
+bool bundle_processor_is_known(const struct bundle *bundle,
+	size_t payload_length);
+
 #endif /* BUNDLEPROCESSOR_H_INCLUDED */
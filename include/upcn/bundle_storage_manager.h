@@ -6,6 +6,13 @@
 #include <stdint.h>
 
 bundleid_t bundle_storage_add(struct bundle *bundle);
+/*
+ * Stores the given bundles taking the storage lock only once. The assigned
+ * IDs are written to "ids", BUNDLE_INVALID_ID for bundles that could not be
+ * stored. Returns the number of stored bundles.
+ */
+uint16_t bundle_storage_add_batch(struct bundle *const bundles[],
+	bundleid_t ids[], uint16_t count);
 int8_t bundle_storage_contains(bundleid_t id);
 struct bundle *bundle_storage_get(bundleid_t id);
 int8_t bundle_storage_delete(bundleid_t id);
@@ -41,6 +41,12 @@ static const int IS_DEBUG_BUILD;
  * BUNDLE_CRC_TYPE_32   = 2
  */
 #define DEFAULT_CRC_TYPE BUNDLE_CRC_TYPE_16
+/* Number of slots for BPv7 EID encodings in the serializer (power of two) */
+#ifdef PLATFORM_STM32
+#define BUNDLE7_EID_CACHE_SIZE 8
+#else // PLATFORM_STM32
+#define BUNDLE7_EID_CACHE_SIZE 64
+#endif // PLATFORM_STM32
 
 
 /*
@@ -81,10 +87,40 @@ enum failed_forwarding_policy {
 #define BUNDLE_QUOTA 1073741824
 #endif
 
-/* The maximum count of bundles for which we have custody at a time */
-#define CUSTODY_MAX_BUNDLE_COUNT 16
-/* The maximum size of a bundle for which custody will be accepted */
-#define CUSTODY_MAX_BUNDLE_SIZE 1024
+/* The maximum aggregate size of fragment payloads buffered for reassembly */
+#ifdef PLATFORM_STM32
+#define REASSEMBLY_BUFFER_QUOTA 16384
+#else
+#define REASSEMBLY_BUFFER_QUOTA BUNDLE_QUOTA
+#endif
+
+/* The maximum aggregate serialized size of bundles in custody */
+#ifdef PLATFORM_STM32
+#define CUSTODY_STORAGE_CAPACITY 16384
+#else
+#define CUSTODY_STORAGE_CAPACITY BUNDLE_QUOTA
+#endif
+
+/* Custody signals for bundles carrying a Custody Transfer Enhancement */
+/* Block are aggregated for the given time (ms) or until the given count */
+/* of custody ID ranges is reached. Lifetime of the signal bundles in s. */
+#define CUSTODY_ACS_DELAY 1000
+#define CUSTODY_ACS_MAX_FILLS 64
+#define CUSTODY_ACS_LIFETIME 86400
+
+/* Duplicate detection for delivered bundles: The given count of bundles */
+/* is recorded exactly (0 = no limit), further ones are recorded in a */
+/* counting Bloom filter with the given count of counters. If more than */
+/* MAX_RECORDS (0 = no limit) are known, the earliest-expiring is dropped. */
+#ifdef PLATFORM_STM32
+#define KNOWN_BUNDLE_MAX_EXACT_ENTRIES 32
+#define KNOWN_BUNDLE_MAX_RECORDS 512
+#define KNOWN_BUNDLE_BLOOM_COUNTERS 4096
+#else // PLATFORM_STM32
+#define KNOWN_BUNDLE_MAX_EXACT_ENTRIES 0
+#define KNOWN_BUNDLE_MAX_RECORDS 0
+#define KNOWN_BUNDLE_BLOOM_COUNTERS 0
+#endif // PLATFORM_STM32
 
 
 
@@ -106,6 +142,15 @@ enum failed_forwarding_policy {
 #define CLA_TCP_PARAM_HTAB_SLOT_COUNT 32
 // Whether or not to close active TCP connections after a contact
 #define CLA_MTCP_CLOSE_AFTER_CONTACT 0
+// Size of the per-link RX buffer; all bundles parsed from it are stored and
+// signaled to the bundle processor as one batch of up to the given size
+#ifdef PLATFORM_STM32
+#define CLA_RX_BUFFER_SIZE 64
+#define CLA_RX_BATCH_SIZE 4
+#else // PLATFORM_STM32
+#define CLA_RX_BUFFER_SIZE 4096
+#define CLA_RX_BATCH_SIZE 64
+#endif // PLATFORM_STM32
 
 
 
@@ -129,16 +174,52 @@ enum failed_forwarding_policy {
 #define OPTIMIZATION_MAX_BUNDLES 3
 #define OPTIMIZATION_MAX_PRE_BUNDLES 9
 #define OPTIMIZATION_MAX_PRE_BUNDLES_CONTACT 3
+/* Delay (in ms) before retrying if an optimization was not affordable */
 #define ROUTER_OPTIMIZER_DELAY 50
-/* Number of slots in the node hash table */
-#define NODE_HTAB_SLOT_COUNT 128
+/* Maximum time (in ms) the optimizer blocks the contact list per run */
+#define ROUTER_OPTIMIZER_BUDGET 10
+/* Number of preemption candidates ranked per optimizer run */
+#ifdef PLATFORM_STM32
+#define ROUTER_OPTIMIZER_QUEUE_SIZE 16
+#else // PLATFORM_STM32
+#define ROUTER_OPTIMIZER_QUEUE_SIZE 256
+#endif // PLATFORM_STM32
+/* Number of EID patterns considered for a single destination */
+#define ROUTER_MAX_EID_MATCHES 8
 /* Below this, NBFs will be consulted */
 #define ROUTER_MIN_CONTACTS_HTAB 10
 /* Below this, a default route will be used */
 #define ROUTER_MIN_CONTACTS_NBF 2
+/* Limits for NBFs received via the config agent */
+#define ROUTER_NBF_MAX_BIT_COUNT 65536
+#define ROUTER_NBF_MAX_HASH_COUNT 16
+/* The "reliability" of routes to nodes found via their NBF */
+#define ROUTER_NBF_BASE_RELIABILITY 0.5f
 /* The "reliability" of the default route */
 /* This makes sure to use the default route everytime and not fail */
 #define ROUTER_DEF_BASE_RELIABILITY MIN_PROBABILITY
+/* Number of routes (with distinct first hops) determined by CGR */
+#define ROUTER_CGR_MAX_ROUTES 8
+/* Number of destinations for which CGR routes are cached */
+#ifdef PLATFORM_STM32
+#define ROUTER_CGR_CACHE_SIZE 32
+#else // PLATFORM_STM32
+#define ROUTER_CGR_CACHE_SIZE 1024
+#endif // PLATFORM_STM32
+/* Number of slots for destination EIDs in the router (power of two) */
+#ifdef PLATFORM_STM32
+#define ROUTER_DESTINATION_CACHE_SIZE 16
+#else // PLATFORM_STM32
+#define ROUTER_DESTINATION_CACHE_SIZE 256
+#endif // PLATFORM_STM32
+/* Number of unroutable bundles kept for re-routing on topology changes */
+#ifdef PLATFORM_STM32
+#define ROUTER_BACKLOG_MAX_BUNDLES 32
+#else // PLATFORM_STM32
+#define ROUTER_BACKLOG_MAX_BUNDLES 4096
+#endif // PLATFORM_STM32
+/* Interval for dropping expired bundles from the backlog (in ms) */
+#define ROUTER_BACKLOG_EXPIRY_INTERVAL_MS 10000
 
 
 
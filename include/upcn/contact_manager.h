@@ -20,9 +20,12 @@ enum contact_manager_signal {
 	CM_SIGNAL_UNKNOWN = 0x3
 };
 
+/*
+ * Contacts are started and ended based on the contact schedule maintained
+ * by the routing table. The task wakes up at the next scheduled event.
+ */
 struct contact_manager_params contact_manager_start(
-	QueueIdentifier_t router_signaling_queue,
-	struct contact_list **clistptr);
+	QueueIdentifier_t router_signaling_queue);
 
 uint64_t contact_manager_get_next_contact_time(void);
 uint8_t contact_manager_in_contact(void);
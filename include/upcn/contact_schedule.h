@@ -0,0 +1,53 @@
+#ifndef CONTACT_SCHEDULE_H_INCLUDED
+#define CONTACT_SCHEDULE_H_INCLUDED
+
+#include "upcn/node.h"
+#include "upcn/result.h"
+
+#include <stdint.h>
+
+/**
+ * Time index of the contacts stored in the routing table.
+ *
+ * Contacts which did not start yet are kept in a min-heap ordered by their
+ * start time, contacts which started are moved to a second min-heap ordered
+ * by their end time. Both the next event and the contacts which are
+ * currently in progress can thus be determined without traversing the
+ * whole contact plan. Every contact stores its position in the heaps,
+ * which allows to remove it in O(log n).
+ */
+enum contact_schedule_state {
+	CONTACT_UNSCHEDULED,
+	CONTACT_UPCOMING,
+	CONTACT_STARTED,
+};
+
+void contact_schedule_free(void);
+
+/**
+ * Adds the contact as upcoming contact. Contacts already contained in the
+ * schedule are not modified.
+ */
+enum upcn_result contact_schedule_add(struct contact *contact);
+void contact_schedule_remove(struct contact *contact);
+
+/**
+ * Moves all contacts which started up to the given time (in s) to the set
+ * of started contacts and removes all contacts which ended.
+ */
+void contact_schedule_advance(uint64_t time);
+
+/**
+ * Returns the contacts which were in progress at the time of the last
+ * advance, in no particular order. The pointer is only valid until the
+ * schedule is modified.
+ */
+struct contact *const *contact_schedule_get_started(uint32_t *count);
+
+/**
+ * Returns the time (in s) at which the next contact starts or ends, or
+ * UINT64_MAX if the schedule is empty.
+ */
+uint64_t contact_schedule_next_event(void);
+
+#endif /* CONTACT_SCHEDULE_H_INCLUDED */
@@ -14,6 +14,7 @@ enum crc_version {
 };
 
 struct crc_stream {
+	enum crc_version version;
 	void (*feed)(struct crc_stream *crc, uint8_t byte);
 	void (*feed_eof)(struct crc_stream *crc);
 	union {
@@ -76,5 +77,19 @@ void crc_init(struct crc_stream *crc, enum crc_version version);
 
 void crc_feed_bytes(struct crc_stream *crc, const uint8_t *data, size_t len);
 
+/**
+ * @brief Copies a byte array and feeds it into a CRC stream in a single pass
+ *
+ * Equivalent to a memcpy() followed by crc_feed_bytes() on the destination,
+ * but reads every source byte only once.
+ *
+ * @param crc   CRC stream initialized by crc_init()
+ * @param dst   Destination buffer, must not overlap with the source
+ * @param src   Pointer to byte array to copy and perform CRC on
+ * @param len   Number of bytes (8-bit) to copy
+ */
+void crc_copy_bytes(struct crc_stream *crc, uint8_t *dst, const uint8_t *src,
+	size_t len);
+
 
 #endif /* CRC_H_INCLUDED */
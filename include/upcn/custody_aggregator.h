@@ -0,0 +1,65 @@
+#ifndef CUSTODY_AGGREGATOR_H_INCLUDED
+#define CUSTODY_AGGREGATOR_H_INCLUDED
+
+#include "upcn/bundle.h"
+#include "upcn/result.h"
+
+#include <stdint.h>
+
+/**
+ * Collects custody signals for bundles carrying a valid Custody Transfer
+ * Enhancement Block and aggregates them into Aggregate Custody Signals.
+ *
+ * One aggregate exists per combination of custodian and signal status,
+ * the custody IDs contained in it are stored as sorted, range-compressed
+ * fills. Custody IDs assigned by a single custodian are usually received
+ * in ascending order, which only extends the last fill.
+ */
+struct custody_aggregator;
+
+struct custody_aggregate {
+	char *custodian;
+	struct bundle_custody_signal signal;
+	// The time (in ms) at which the aggregate has to be sent
+	uint64_t deadline;
+
+	struct bundle_acs_fill *fills;
+	uint32_t fill_count;
+	uint32_t fill_capacity;
+
+	struct custody_aggregate *next;
+};
+
+/**
+ * Creates a new aggregator. An aggregate is due as soon as its deadline
+ * is reached or it contains max_fills fills.
+ */
+struct custody_aggregator *custody_aggregator_create(uint32_t max_fills);
+void custody_aggregator_free(struct custody_aggregator *aggregator);
+
+/**
+ * Records the given signal for the custody ID. If no aggregate exists for
+ * the custodian and signal status, a new one with the given deadline (in ms)
+ * is created.
+ */
+enum upcn_result custody_aggregator_add(
+	struct custody_aggregator *aggregator, const char *custodian,
+	const struct bundle_custody_signal *signal, uint64_t custody_id,
+	uint64_t deadline);
+
+/**
+ * Returns the earliest deadline of all aggregates or UINT64_MAX.
+ */
+uint64_t custody_aggregator_next_deadline(
+	const struct custody_aggregator *aggregator);
+
+/**
+ * Removes and returns an aggregate which is due at the given time (in ms),
+ * or NULL if there is none. It has to be freed by the caller.
+ */
+struct custody_aggregate *custody_aggregator_pop_due(
+	struct custody_aggregator *aggregator, uint64_t cur_time);
+
+void custody_aggregate_free(struct custody_aggregate *aggregate);
+
+#endif /* CUSTODY_AGGREGATOR_H_INCLUDED */
@@ -5,6 +5,7 @@
 #include "upcn/result.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 bool custody_manager_has_redundant_bundle(struct bundle *bundle);
 bool custody_manager_storage_is_acceptable(struct bundle *bundle);
@@ -12,6 +13,15 @@ bool custody_manager_has_accepted(struct bundle *bundle);
 struct bundle *custody_manager_get_by_record(
 	struct bundle_administrative_record *record);
 
+/**
+ * Calls the given function for every bundle in custody whose custody ID
+ * is contained in the given fill of an Aggregate Custody Signal.
+ * The function is allowed to release the bundle.
+ */
+void custody_manager_for_each_in_fill(
+	const struct bundle_acs_fill *fill,
+	void (*fn)(struct bundle *bundle, void *param), void *param);
+
 enum upcn_result custody_manager_accept(struct bundle *bundle);
 void custody_manager_release(struct bundle *bundle);
 
@@ -0,0 +1,64 @@
+#ifndef EID_INDEX_H_INCLUDED
+#define EID_INDEX_H_INCLUDED
+
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Maps EIDs and EID patterns to values.
+ *
+ * Three kinds of keys are supported:
+ * - Exact EIDs, e.g. "dtn://node" or "ipn:1.2"
+ * - Prefix patterns ending with '*', e.g. "dtn://region.dtn*", matching
+ *   all EIDs starting with the part before the '*'. If the '*' follows a
+ *   '/', the pattern also matches the EID without the '/', i.e. a node EID
+ *   followed by "/" and "*" matches the node EID itself. "*" matches every
+ *   EID.
+ * - ipn node patterns, e.g. "ipn:100.*" or "ipn:100-199.*", matching all
+ *   ipn EIDs with a node number in the given (inclusive) range
+ *
+ * Keys in the ipn scheme are stored in sorted integer maps, all other keys
+ * in a compressed trie, so a lookup only traverses the EID once.
+ */
+struct eid_index;
+
+struct eid_index *eid_index_create(void);
+void eid_index_free(struct eid_index *idx);
+
+/**
+ * Adds the key with the given (non-NULL) value. Fails if the key is
+ * already contained.
+ */
+enum upcn_result eid_index_add(struct eid_index *idx, const char *key,
+			       void *value);
+
+/**
+ * Returns the value stored for exactly the given key or NULL.
+ */
+void *eid_index_get(const struct eid_index *idx, const char *key);
+
+/**
+ * Removes the key and returns its value or NULL if it was not contained.
+ */
+void *eid_index_remove(struct eid_index *idx, const char *key);
+
+/**
+ * Stores the values of up to max keys matching the EID in values, the most
+ * specific (i.e. exact and longest) matches first. Returns their number.
+ */
+uint8_t eid_index_lookup(const struct eid_index *idx, const char *eid,
+			 void **values, uint8_t max);
+
+/**
+ * Returns true if the key is a pattern which can match other EIDs.
+ */
+bool eid_is_pattern(const char *key);
+
+/**
+ * Returns true if the EID matches the key, following the rules of the idx.
+ */
+bool eid_matches(const char *key, const char *eid);
+
+#endif /* EID_INDEX_H_INCLUDED */
@@ -0,0 +1,62 @@
+#ifndef KNOWN_BUNDLE_SET_H_INCLUDED
+#define KNOWN_BUNDLE_SET_H_INCLUDED
+
+#include "upcn/bundle.h"
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A set of bundle unique identifiers used for duplicate detection.
+ *
+ * Identifiers are indexed by a hash table and expire after their deadline,
+ * which is tracked by a min-heap. If the amount of exactly-tracked entries
+ * is limited, further identifiers are only recorded in a counting Bloom
+ * filter, which may lead to false positives ("known" bundles which have not
+ * been seen before). If the total amount of records is limited, the record
+ * expiring first is dropped to make room for a new one.
+ */
+struct known_bundle_set;
+
+/**
+ * Create a new set.
+ *
+ * @param max_exact_entries The maximum count of identifiers stored exactly,
+ *                          zero for no limit.
+ * @param max_records The maximum count of identifiers stored at all, zero for
+ *                    no limit.
+ * @param bloom_counters The size of the counting Bloom filter. If zero, no
+ *                       identifiers are recorded if the exact store is full.
+ */
+struct known_bundle_set *known_bundle_set_create(
+	uint32_t max_exact_entries, uint32_t max_records,
+	uint32_t bloom_counters);
+void known_bundle_set_free(struct known_bundle_set *set);
+
+/**
+ * Check whether the given identifier is contained in the set.
+ */
+bool known_bundle_set_contains(
+	const struct known_bundle_set *set,
+	const struct bundle_unique_identifier *id);
+
+/**
+ * Add the given identifier to the set, it will be removed as soon as the
+ * deadline passed. The identifier (and the source EID) are copied.
+ */
+enum upcn_result known_bundle_set_add(
+	struct known_bundle_set *set,
+	const struct bundle_unique_identifier *id, uint64_t deadline);
+
+/**
+ * Remove all identifiers with a deadline lower than the given time.
+ */
+void known_bundle_set_expire(struct known_bundle_set *set, uint64_t cur_time);
+
+/**
+ * Get the count of identifiers recorded (exact and in the Bloom filter).
+ */
+uint32_t known_bundle_set_count(const struct known_bundle_set *set);
+
+#endif /* KNOWN_BUNDLE_SET_H_INCLUDED */
@@ -0,0 +1,38 @@
+#ifndef NBF_H_INCLUDED
+#define NBF_H_INCLUDED
+
+#include "upcn/result.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Node Bloom Filter (NBF): A compact summary of the EIDs reachable via a
+ * node, which may yield false positives but never false negatives.
+ *
+ * An EID is represented by the bits (h1 + i * h2) mod bit_count for
+ * i = 0 .. hash_count - 1, with h1 = hashlittle(eid, strlen(eid), 0) and
+ * h2 = hashlittle(eid, strlen(eid), h1) | 1. Bit n is stored in byte n / 8
+ * with the mask 1 << (n % 8), so filters can be exchanged between nodes.
+ */
+struct nbf {
+	uint32_t bit_count;
+	uint8_t hash_count;
+	uint8_t *bits;
+};
+
+#define NBF_BYTE_COUNT(bit_count) (((bit_count) + 7) / 8)
+
+struct nbf *nbf_create(uint32_t bit_count, uint8_t hash_count);
+void nbf_free(struct nbf *nbf);
+
+void nbf_add(struct nbf *nbf, const char *eid);
+bool nbf_contains(const struct nbf *nbf, const char *eid);
+
+/**
+ * Adds all EIDs contained in source to target. Fails if the filters do not
+ * have the same parameters.
+ */
+enum upcn_result nbf_merge(struct nbf *target, const struct nbf *source);
+
+#endif /* NBF_H_INCLUDED */
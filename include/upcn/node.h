@@ -2,6 +2,7 @@
 #define NODE_H_INCLUDED
 
 #include "upcn/bundle.h"
+#include "upcn/nbf.h"
 #include "upcn/result.h"
 
 #include <stdint.h>
@@ -22,6 +23,16 @@ struct routed_bundle {
 struct routed_bundle_list {
 	struct routed_bundle *data;
 	struct routed_bundle_list *next;
+	/* Only valid while the entry is queued at a contact */
+	struct routed_bundle_list *prev;
+	struct routed_bundle_list *index_next;
+	struct contact *contact;
+};
+
+/* FIFO of the bundles with one priority routed via a contact */
+struct routed_bundle_queue {
+	struct routed_bundle_list *head;
+	struct routed_bundle_list *tail;
 };
 
 struct contact {
@@ -29,14 +40,21 @@ struct contact {
 	uint64_t from;
 	uint64_t to;
 	uint32_t bitrate;
-	uint32_t total_capacity;
-	int32_t remaining_capacity_p0;
-	int32_t remaining_capacity_p1;
-	int32_t remaining_capacity_p2;
+	/* Capacities in bytes, the bitrate is given in bytes per second */
+	uint64_t total_capacity;
+	int64_t remaining_capacity_p0;
+	int64_t remaining_capacity_p1;
+	int64_t remaining_capacity_p2;
 	struct endpoint_list *contact_endpoints;
-	struct routed_bundle_list *contact_bundles;
-	uint8_t bundle_count;
+	struct routed_bundle_queue contact_bundles[BUNDLE_RPRIO_MAX];
+	uint32_t bundle_count;
 	int8_t active;
+	// Position of the contact in the contact schedule
+	uint32_t schedule_index;
+	uint8_t schedule_state;
+	// Position of the contact in the set to be revisited by the optimizer
+	uint32_t optimizer_index;
+	uint8_t optimizer_dirty;
 };
 
 struct contact_list {
@@ -63,6 +81,8 @@ struct node {
 	float reliability;
 	struct endpoint_list *endpoints;
 	struct contact_list *contacts;
+	/* Summary of further EIDs reachable via the node, may be NULL */
+	struct nbf *nbf;
 };
 
 struct node_list {
@@ -100,7 +120,7 @@ struct contact_list *contact_list_difference(
 struct endpoint_list *endpoint_list_strip_and_sort(struct endpoint_list *el);
 int node_prepare_and_verify(struct node *node);
 void recalculate_contact_capacity(struct contact *contact);
-int32_t contact_get_cur_remaining_capacity(
+int64_t contact_get_cur_remaining_capacity(
 	struct contact *contact, enum bundle_routing_priority prio);
 int add_contact_to_ordered_list(
 	struct contact_list **list, struct contact *contact,
@@ -113,4 +133,18 @@ int add_contact_to_ordered_assoc_list(
 int remove_contact_from_assoc_list(
 	struct associated_contact_list **list, struct contact *contact);
 
+/*
+ * Every contact holds one FIFO per priority of the bundles routed via it.
+ * The queue entries are additionally indexed by contact and bundle ID,
+ * allowing to remove a bundle from a contact in constant time.
+ */
+enum upcn_result contact_enqueue_bundle(
+	struct contact *contact, struct routed_bundle *rb);
+struct routed_bundle *contact_dequeue_bundle(
+	struct contact *contact, bundleid_t id);
+/* Returns the first bundle of the highest non-empty priority, or NULL */
+struct routed_bundle *contact_first_bundle(const struct contact *contact);
+/* Removes all bundles, highest priority first, as list owned by the caller */
+struct routed_bundle_list *contact_take_bundles(struct contact *contact);
+
 #endif // NODE_H_INCLUDED
@@ -1,6 +1,8 @@
 #ifndef PARSER_H_INCLUDED
 #define PARSER_H_INCLUDED
 
+#include "upcn/crc.h"
+
 #include <stddef.h>
 
 enum parser_status {
@@ -39,11 +41,20 @@ struct parser {
 	/**
 	 * If a parser is operating in "bulk read" mode, this field states
 	 * how many bytes have to be read into the "next_buffer" until the
-	 * input processor forwards the data to the the parser.
+	 * input processor forwards the data to the the parser. If the
+	 * "next_buffer" is NULL, the bytes are skipped ("discard read").
 	 * If a parser is performing subparser forwarding, this field states
 	 * the amount of bytes to be forwarded.
 	 */
 	size_t next_bytes;
+
+	/**
+	 * Optional CRC stream the "bulk read" data has to be fed into. An
+	 * input processor copying the data via crc_copy_bytes() resets this
+	 * field to NULL. Otherwise, the parser feeds the data on its own
+	 * after the "bulk read" operation.
+	 */
+	struct crc_stream *next_crc;
 };
 
 #endif /* PARSER_H_INCLUDED */
@@ -0,0 +1,62 @@
+#ifndef REASSEMBLY_TABLE_H_INCLUDED
+#define REASSEMBLY_TABLE_H_INCLUDED
+
+#include "upcn/bundle.h"
+
+#include <stdint.h>
+
+/**
+ * A table of ADUs currently being reassembled from bundle fragments.
+ *
+ * Entries are indexed by a hash over the identifier of the original bundle
+ * (source, creation timestamp and sequence number). The payload of every
+ * fragment carrying new data is taken over as a chunk of the ADU, i.e. it is
+ * neither copied nor is a buffer of the ADU size allocated. The received byte
+ * ranges are tracked by a sorted set of disjoint intervals, thus, the check
+ * for completeness is a single comparison.
+ *
+ * The aggregate size of the buffered chunks is limited. If a fragment would
+ * exceed the limit, the incomplete ADUs expiring first are dropped to make
+ * room for it.
+ */
+struct reassembly_table;
+
+enum reassembly_result {
+	// The fragment has been recorded, the ADU is not complete yet
+	REASSEMBLY_PENDING,
+	// The ADU is complete and has been handed over to the caller
+	REASSEMBLY_COMPLETE,
+	// The fragment is invalid or memory could not be allocated
+	REASSEMBLY_FAILED,
+};
+
+struct reassembly_table *reassembly_table_create(void);
+void reassembly_table_free(struct reassembly_table *table);
+
+/**
+ * Add the payload of the given fragment to the corresponding ADU. If the
+ * payload is used, it is moved out of the fragment (leaving an empty payload
+ * block), in any case the fragment can be discarded afterwards.
+ *
+ * @param adu Receives the chunked ADU (the ownership of which is transferred
+ *            to the caller) if REASSEMBLY_COMPLETE is returned.
+ */
+enum reassembly_result reassembly_table_add(
+	struct reassembly_table *table, struct bundle *fragment,
+	struct bundle_adu *adu);
+
+/**
+ * Drop all incomplete ADUs of which the original bundle expired at the given
+ * time (in s) and release their buffered payload chunks.
+ *
+ * @return The count of dropped ADUs.
+ */
+uint32_t reassembly_table_expire(struct reassembly_table *table,
+				 uint64_t now);
+
+/**
+ * Get the count of ADUs that are currently being reassembled.
+ */
+uint32_t reassembly_table_count(const struct reassembly_table *table);
+
+#endif /* REASSEMBLY_TABLE_H_INCLUDED */
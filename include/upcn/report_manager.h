@@ -19,6 +19,16 @@ struct bundle_list *generate_custody_signal(
 	const char *local_eid);
 
 
+/**
+ * Generates an Aggregate Custody Signal for the given custody ID fills.
+ * Only supported for RFC 5050 bundles.
+ */
+struct bundle *generate_aggregate_custody_signal(
+	const char *custodian, const struct bundle_custody_signal *signal,
+	const struct bundle_acs_fill *fills, const uint32_t fill_count,
+	const char *local_eid);
+
+
 /**
  * Parses the payload block of an administrative record bundle.
  * If case of error, NULL will be returned.
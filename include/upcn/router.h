@@ -27,6 +27,13 @@ struct router_config {
 	float router_def_base_reliability;
 };
 
+struct router_candidate {
+	struct contact *contact;
+	float p;
+	// The earliest time (in s) the destination can be reached via it
+	uint64_t arrival;
+};
+
 struct fragment_route {
 	uint32_t payload_size;
 	float probability;
@@ -58,12 +65,20 @@ struct router_result {
 struct router_config router_get_config(void);
 enum upcn_result router_update_config(struct router_config config);
 
-struct associated_contact_list *router_lookup_destination(char *dest);
+/*
+ * Determines the candidate contacts via which the destination can be reached
+ * before the expiration time, ordered by arrival. The returned array is owned
+ * by the router and valid until the next lookup.
+ */
+uint8_t router_lookup_destination(
+	const char *dest, uint64_t exp_time,
+	const struct router_candidate **candidates);
 uint8_t router_calculate_fragment_route(
 	struct fragment_route *res, uint32_t size,
-	struct associated_contact_list *contacts, uint32_t preprocessed_size,
-	enum bundle_routing_priority priority, uint64_t exp_time,
-	struct contact **excluded_contacts, uint8_t excluded_contacts_count);
+	const struct router_candidate *candidates, uint8_t candidate_count,
+	uint32_t preprocessed_size, enum bundle_routing_priority priority,
+	uint64_t exp_time, struct contact **excluded_contacts,
+	uint8_t excluded_contacts_count);
 
 struct router_result router_get_first_route(struct bundle *bundle);
 struct router_result router_try_reuse(
@@ -0,0 +1,74 @@
+#ifndef ROUTER_CGR_H_INCLUDED
+#define ROUTER_CGR_H_INCLUDED
+
+#include "upcn/node.h"
+#include "upcn/result.h"
+
+#include <stdint.h>
+
+/**
+ * Contact Graph Routing over the contacts stored in the routing table.
+ *
+ * The graph contains the local node and all nodes of the routing table.
+ * Every contact of a node is an edge from the local node to that node.
+ * If the contact endpoints of a contact name another known node, that node
+ * can be reached via the contact's node during the contact. If the
+ * endpoints of a node name another known node, that node can always be
+ * reached via the first one.
+ *
+ * Routes are determined by Dijkstra's algorithm with the earliest arrival
+ * time as metric. Alternative routes are found by excluding the first hops
+ * of all routes already determined. Routes are cached per destination and
+ * only invalidated if a routing table change could affect them.
+ */
+struct router_cgr_route {
+	// The contact with the local node the route begins with
+	struct contact *first_hop;
+	// The earliest time (in s) the destination can be reached
+	uint64_t arrival;
+	// The time (in s) after which the route can no longer be used
+	uint64_t expiry;
+	uint8_t hop_count;
+};
+
+void router_cgr_free(void);
+
+/**
+ * Returns the routes to the given destination node, ordered by their
+ * arrival time. The pointer is only valid until the next call. The
+ * remaining capacity of the contacts is not considered, as it changes with
+ * every routed bundle.
+ */
+uint8_t router_cgr_get_routes(
+	const char *destination, uint64_t cur_time,
+	const struct router_cgr_route **routes);
+
+/**
+ * Has to be called before the given endpoints and contacts are added to
+ * the (possibly new) node. Only cached routes which could be improved by
+ * the additions are invalidated.
+ */
+void router_cgr_plan_extended(
+	const struct node *node, const struct endpoint_list *endpoints,
+	const struct contact_list *contacts);
+
+/**
+ * Has to be called before contacts or endpoints of the given node are
+ * removed. Invalidates all cached routes via the node.
+ */
+void router_cgr_node_changed(const struct node *node);
+
+/**
+ * Has to be called before the given contact is removed.
+ */
+void router_cgr_contact_removed(const struct contact *contact);
+
+/**
+ * Between these calls, changes are only recorded and the whole cache is
+ * invalidated at the end, which is cheaper for many changes at once.
+ * Routes must not be requested in between.
+ */
+void router_cgr_begin_bulk_update(void);
+void router_cgr_end_bulk_update(void);
+
+#endif /* ROUTER_CGR_H_INCLUDED */
@@ -5,8 +5,18 @@
 
 #include "platform/hal_types.h"
 
+/*
+ * The optimizer only revisits contacts which were marked as dirty since its
+ * last run. The returned semaphore has to be released to wake it up after
+ * contacts have been marked.
+ */
 Semaphore_t router_start_optimizer_task(
 	QueueIdentifier_t router_signaling_queue,
-	Semaphore_t clist_semaphore, struct contact_list **clistptr);
+	Semaphore_t clist_semaphore);
+
+/* Marks the contact to be revisited, e.g. after bundles were added to it */
+void router_optimizer_mark_dirty(struct contact *contact);
+/* Has to be called before a contact is removed from the routing table */
+void router_optimizer_contact_removed(struct contact *contact);
 
 #endif /* ROUTEROPTIMIZER_H_INCLUDED */
@@ -6,6 +6,9 @@
 
 #include "platform/hal_types.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+
 enum router_command_type {
 	ROUTER_COMMAND_UNDEFINED,
 	ROUTER_COMMAND_ADD = 0x31,    /* ASCII 1 */
@@ -19,6 +22,14 @@ struct router_command {
 	struct node *data;
 };
 
+/* Multiple commands which are applied to the routing table at once */
+struct router_plan {
+	/* If set, all nodes not contained in the plan are removed */
+	bool full;
+	struct router_command *commands;
+	uint32_t command_count;
+};
+
 enum router_signal_type {
 	ROUTER_SIGNAL_UNKNOWN = 0,
 	ROUTER_SIGNAL_PROCESS_COMMAND,
@@ -28,13 +39,15 @@ enum router_signal_type {
 	ROUTER_SIGNAL_TRANSMISSION_FAILURE,
 	ROUTER_SIGNAL_WITHDRAW_NODE,
 	ROUTER_SIGNAL_OPTIMIZATION_DROP,
-	ROUTER_SIGNAL_NEW_LINK_ESTABLISHED
+	ROUTER_SIGNAL_NEW_LINK_ESTABLISHED,
+	ROUTER_SIGNAL_PROCESS_PLAN
 };
 
 struct router_signal {
 	enum router_signal_type type;
 	/* struct routed_bundle OR struct router_command */
-	/* OR struct contact OR (void *)bundleid_t OR NULL */
+	/* OR struct router_plan */
+	/* OR struct contact OR (void *)bundleid_t OR char * (EID) OR NULL */
 	void *data;
 };
 
@@ -45,4 +58,7 @@ struct router_task_parameters {
 
 void router_task(void *args);
 
+/* Frees the plan including the nodes of all commands */
+void router_plan_free(struct router_plan *plan);
+
 #endif /* ROUTERTASK_H_INCLUDED */
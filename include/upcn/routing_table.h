@@ -19,8 +19,13 @@ void routing_table_free(void);
 
 struct node *routing_table_lookup_node(const char *eid);
 struct node_table_entry *routing_table_lookup_eid(const char *eid);
+/* Returns the entries of all EIDs and patterns matching, most specific first */
+uint8_t routing_table_lookup_eid_matches(
+	const char *eid, struct node_table_entry **entries, uint8_t max);
+/* Changes whenever nodes or contacts are added or removed */
+uint32_t routing_table_get_version(void);
 uint8_t routing_table_lookup_eid_in_nbf(
-	char *eid, struct node **target, uint8_t max);
+	const char *eid, struct node **target, uint8_t max);
 uint8_t routing_table_lookup_hot_node(
 	struct node **target, uint8_t max);
 
@@ -33,6 +38,13 @@ int routing_table_delete_node(
 int routing_table_delete_node_by_eid(
 	char *eid, QueueIdentifier_t bproc_signaling_queue);
 
+/*
+ * Changes made between these calls are applied as one transaction, i.e.
+ * cached routes are only invalidated once at the end.
+ */
+void routing_table_begin_update(void);
+void routing_table_end_update(void);
+
 struct contact_list **routing_table_get_raw_contact_list_ptr(void);
 struct node_list *routing_table_get_node_list(void);
 void routing_table_delete_contact(struct contact *contact);
@@ -60,6 +60,7 @@ endif
 
 $(eval $(call generateComponentRules,components/daemon))
 $(eval $(call generateComponentRules,test/unit))
+$(eval $(call generateComponentRules,test/bench))
 
 build/$(PLATFORM)/libupcn.so: LDFLAGS += $(LDFLAGS_LIB)
 build/$(PLATFORM)/libupcn.so: | build/$(PLATFORM)
@@ -90,6 +91,14 @@ build/$(PLATFORM)/testupcn: LDFLAGS += -Wl,-wrap,putchar \
 build/$(PLATFORM)/testupcn: | build/$(PLATFORM)
 	$(call cmd,link)
 
+# BENCHMARK EXECUTABLE
+
+$(eval $(call addComponent,benchupcn,test/bench))
+
+build/$(PLATFORM)/benchupcn: LDFLAGS += $(LDFLAGS_EXECUTABLE)
+build/$(PLATFORM)/benchupcn: | build/$(PLATFORM)
+	$(call cmd,link)
+
 # GENERAL RULES
 
 build/$(PLATFORM): | build
@@ -141,6 +141,7 @@ $(call generateComponentRules,$(1),$(2),$(3),$(4))
 $(call addComponent,libupcn.so,$(1))
 $(call addComponent,upcn,$(1))
 $(call addComponent,testupcn,$(1))
+$(call addComponent,benchupcn,$(1))
 
 endef
 
@@ -57,15 +57,19 @@ class ConfigMessage(object):
         contacts (List[Contact], optional): List of contacts with the node
         type (RouterCommand, optional): Type of the configuration message (add,
             remove, ...)
+        nbf (Tuple[int, int, bytes], optional): Bloom filter summarizing
+            further EIDs reachable via the node as (bit count, hash count,
+            filter bits)
     """
 
     def __init__(self, eid, cla_address, reachable_eids=None, contacts=None,
-                 type=RouterCommand.ADD):
+                 type=RouterCommand.ADD, nbf=None):
         self.eid = eid
         self.cla_address = cla_address
         self.reachable_eids = reachable_eids or []
         self.contacts = contacts or []
         self.type = type
+        self.nbf = nbf
 
     def __repr__(self):
         return "<ConfigMessage {!r} {} reachable={} contacts={}>".format(
@@ -97,6 +101,14 @@ class ConfigMessage(object):
         else:
             contact_list = ""
 
+        if self.nbf:
+            bit_count, hash_count, bits = self.nbf
+            assert len(bits) == (bit_count + 7) // 8
+            # the NBF has to follow an (empty) contact list
+            contact_list = (contact_list or "[]") + ":{{{},{},{}}}".format(
+                bit_count, hash_count, bits.hex()
+            )
+
         return "{}({}):({}):{}:{};".format(
             self.type,
             self.eid,
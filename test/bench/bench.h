@@ -0,0 +1,27 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+#include <stddef.h>
+
+struct bench_case {
+	/* Unique, stable name which is used for filtering and baselines */
+	const char *name;
+	/* Size class or other parameter passed to "setup" */
+	size_t param;
+	/* Prepares the input data, returns NULL on failure */
+	void *(*setup)(size_t param);
+	/* Performs one operation, returns the bytes processed or 0 on error */
+	size_t (*run)(void *ctx);
+	void (*teardown)(void *ctx);
+};
+
+struct bench_group {
+	const struct bench_case *cases;
+	size_t count;
+};
+
+extern const struct bench_group bench_bundle_group;
+extern const struct bench_group bench_codec_group;
+extern const struct bench_group bench_framing_group;
+
+#endif /* BENCH_H_INCLUDED */
@@ -0,0 +1,244 @@
+#include "bench.h"
+
+#include "bundle6/create.h"
+#include "bundle6/parser.h"
+#include "bundle7/create.h"
+#include "bundle7/parser.h"
+
+#include "upcn/bundle.h"
+#include "upcn/common.h"
+#include "upcn/crc.h"
+#include "upcn/parser.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SOURCE_EID "dtn://bench-source.dtn/sink"
+#define BENCH_DESTINATION_EID "dtn://bench-destination.dtn/sink"
+#define BENCH_LIFETIME 3600
+
+struct bundle_bench {
+	struct bundle *bundle;
+	uint8_t *serialized;
+	size_t serialized_size;
+	size_t position;
+	struct bundle6_parser parser6;
+	struct bundle7_parser parser7;
+	struct parser *parser;
+	size_t parsed_bundles;
+};
+
+static struct bundle *create_bundle(int version, size_t payload_length)
+{
+	uint8_t *payload = malloc(payload_length);
+
+	if (payload == NULL)
+		return NULL;
+	memset(payload, 0x5A, payload_length);
+	if (version == 6)
+		return bundle6_create_local(payload, payload_length,
+			BENCH_SOURCE_EID, BENCH_DESTINATION_EID,
+			0, BENCH_LIFETIME, BUNDLE_FLAG_NONE);
+	return bundle7_create_local(payload, payload_length,
+		BENCH_SOURCE_EID, BENCH_DESTINATION_EID,
+		0, BENCH_LIFETIME, BUNDLE_FLAG_NONE);
+}
+
+static void write_into_buffer(void *cla_obj, const void *data,
+			      const size_t length)
+{
+	struct bundle_bench *bb = cla_obj;
+
+	memcpy(&bb->serialized[bb->position], data, length);
+	bb->position += length;
+}
+
+static void free_bundle(struct bundle *bundle, void *param)
+{
+	struct bundle_bench *bb = param;
+
+	bb->parsed_bundles++;
+	bundle_free(bundle);
+}
+
+static void *setup_bundle(int version, size_t payload_length)
+{
+	struct bundle_bench *bb = malloc(sizeof(struct bundle_bench));
+
+	if (bb == NULL)
+		return NULL;
+	bb->bundle = create_bundle(version, payload_length);
+	if (bb->bundle == NULL)
+		goto fail_bundle;
+	bb->serialized_size = bundle_get_serialized_size(bb->bundle);
+	bb->serialized = malloc(bb->serialized_size);
+	if (bb->serialized == NULL)
+		goto fail_buffer;
+	bb->position = 0;
+	if (bundle_serialize(bb->bundle, write_into_buffer, bb) != UPCN_OK ||
+			bb->position != bb->serialized_size)
+		goto fail_serialize;
+	if (version == 6)
+		bb->parser = bundle6_parser_init(&bb->parser6,
+						 free_bundle, bb);
+	else
+		bb->parser = bundle7_parser_init(&bb->parser7,
+						 free_bundle, bb);
+	if (bb->parser == NULL)
+		goto fail_serialize;
+	return bb;
+
+fail_serialize:
+	free(bb->serialized);
+fail_buffer:
+	bundle_free(bb->bundle);
+fail_bundle:
+	free(bb);
+	return NULL;
+}
+
+static void *setup_bundle6(size_t param)
+{
+	return setup_bundle(6, param);
+}
+
+static void *setup_bundle7(size_t param)
+{
+	return setup_bundle(7, param);
+}
+
+static void teardown_bundle6(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+
+	bundle6_parser_deinit(&bb->parser6);
+	bundle_free(bb->bundle);
+	free(bb->serialized);
+	free(bb);
+}
+
+static void teardown_bundle7(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+
+	bundle7_parser_deinit(&bb->parser7);
+	bundle_free(bb->bundle);
+	free(bb->serialized);
+	free(bb);
+}
+
+static size_t run_serialize(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+
+	bb->position = 0;
+	bundle_serialize(bb->bundle, write_into_buffer, bb);
+	return bb->position;
+}
+
+/*
+ * Feeds the serialized bundle to a streaming parser in one piece, performing
+ * "bulk reads" the same way the CLA input processor does. Returns zero if
+ * the bundle was not parsed successfully.
+ */
+static size_t parse_stream(struct bundle_bench *bb,
+	size_t (*read)(struct bundle_bench *, const uint8_t *, size_t))
+{
+	struct parser *parser = bb->parser;
+	size_t position = 0, length;
+
+	bb->parsed_bundles = 0;
+	while (position < bb->serialized_size &&
+			parser->status == PARSER_STATUS_GOOD) {
+		position += read(bb, &bb->serialized[position],
+				 bb->serialized_size - position);
+		if (!HAS_FLAG(parser->flags, PARSER_FLAG_BULK_READ))
+			continue;
+		length = parser->next_bytes;
+		if (parser->next_buffer == NULL)
+			; /* Discard read, nothing to copy */
+		else if (parser->next_crc != NULL)
+			crc_copy_bytes(parser->next_crc, parser->next_buffer,
+				       &bb->serialized[position], length);
+		else
+			memcpy(parser->next_buffer,
+			       &bb->serialized[position], length);
+		parser->next_crc = NULL;
+		parser->flags &= ~PARSER_FLAG_BULK_READ;
+		read(bb, NULL, 0);
+		position += length;
+	}
+	if (parser->status != PARSER_STATUS_DONE || bb->parsed_bundles != 1)
+		return 0;
+	return position;
+}
+
+static size_t read_bundle6(struct bundle_bench *bb, const uint8_t *buffer,
+			   size_t length)
+{
+	return bundle6_parser_read(&bb->parser6, buffer, length);
+}
+
+static size_t read_bundle7(struct bundle_bench *bb, const uint8_t *buffer,
+			   size_t length)
+{
+	return bundle7_parser_read(&bb->parser7, buffer, length);
+}
+
+static size_t run_parse6(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+	size_t parsed = parse_stream(bb, read_bundle6);
+
+	bundle6_parser_reset(&bb->parser6);
+	return parsed;
+}
+
+static size_t run_parse7(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+	size_t parsed = parse_stream(bb, read_bundle7);
+
+	bundle7_parser_reset(&bb->parser7);
+	return parsed;
+}
+
+static size_t run_parse7_buffer(void *ctx)
+{
+	struct bundle_bench *bb = ctx;
+	struct bundle *bundle = bundle7_parse_buffer(
+		bb->serialized, bb->serialized_size, bb->serialized_size,
+		NULL, NULL);
+
+	if (bundle == NULL)
+		return 0;
+	bundle_free(bundle);
+	return bb->serialized_size;
+}
+
+#define BUNDLE_BENCH(label, version, operation, size) { \
+	.name = label "/" #size, \
+	.param = size, \
+	.setup = setup_bundle ## version, \
+	.run = run_ ## operation, \
+	.teardown = teardown_bundle ## version, \
+}
+
+#define BUNDLE_BENCH_SIZES(label, version, operation) \
+	BUNDLE_BENCH(label, version, operation, 64), \
+	BUNDLE_BENCH(label, version, operation, 1024), \
+	BUNDLE_BENCH(label, version, operation, 65536)
+
+static const struct bench_case cases[] = {
+	BUNDLE_BENCH_SIZES("bundle6_serialize", 6, serialize),
+	BUNDLE_BENCH_SIZES("bundle6_parse", 6, parse6),
+	BUNDLE_BENCH_SIZES("bundle7_serialize", 7, serialize),
+	BUNDLE_BENCH_SIZES("bundle7_parse", 7, parse7),
+	BUNDLE_BENCH_SIZES("bundle7_parse_buffer", 7, parse7_buffer),
+};
+
+const struct bench_group bench_bundle_group = {
+	.cases = cases,
+	.count = ARRAY_SIZE(cases),
+};
@@ -0,0 +1,276 @@
+#include "bench.h"
+
+#include "bundle6/sdnv.h"
+#include "bundle7/eid.h"
+
+#include "upcn/common.h"
+#include "upcn/crc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDNV_VALUE_COUNT 256
+#define EID_BUFFER_SIZE 64
+
+static const char *const eids[] = {
+	"dtn:none",
+	"dtn://bench-source.dtn/sink",
+	"dtn://bench-destination.dtn/a/longer/demux/path",
+	"ipn:1.0",
+	"ipn:4294967295.18446744073709551615",
+};
+
+static void *setup_data(size_t length)
+{
+	uint8_t *data = malloc(length);
+	size_t i;
+
+	if (data == NULL)
+		return NULL;
+	for (i = 0; i < length; i++)
+		data[i] = (uint8_t)(i * 31 + 7);
+	return data;
+}
+
+static void teardown_free(void *ctx)
+{
+	free(ctx);
+}
+
+struct crc_bench {
+	size_t length;
+	uint8_t *data;
+	uint8_t *copy;
+};
+
+static void *setup_crc(size_t length)
+{
+	struct crc_bench *cb = malloc(sizeof(struct crc_bench));
+
+	if (cb == NULL)
+		return NULL;
+	cb->length = length;
+	cb->data = setup_data(length);
+	cb->copy = malloc(length);
+	if (cb->data == NULL || cb->copy == NULL) {
+		free(cb->data);
+		free(cb->copy);
+		free(cb);
+		return NULL;
+	}
+	return cb;
+}
+
+static void teardown_crc(void *ctx)
+{
+	struct crc_bench *cb = ctx;
+
+	free(cb->data);
+	free(cb->copy);
+	free(cb);
+}
+
+/* Prevents the compiler from discarding otherwise unused results */
+uint32_t bench_codec_sink;
+
+static size_t run_crc16_x25(void *ctx)
+{
+	struct crc_bench *cb = ctx;
+
+	bench_codec_sink = crc16_x25(cb->data, cb->length);
+	return cb->length;
+}
+
+static size_t run_crc16_ccitt_false(void *ctx)
+{
+	struct crc_bench *cb = ctx;
+
+	bench_codec_sink = crc16_ccitt_false(cb->data, cb->length);
+	return cb->length;
+}
+
+static size_t run_crc32(void *ctx)
+{
+	struct crc_bench *cb = ctx;
+
+	bench_codec_sink = crc32(cb->data, cb->length);
+	return cb->length;
+}
+
+static size_t run_crc32_copy(void *ctx)
+{
+	struct crc_bench *cb = ctx;
+	struct crc_stream crc;
+
+	crc_init(&crc, CRC32);
+	crc_copy_bytes(&crc, cb->copy, cb->data, cb->length);
+	crc.feed_eof(&crc);
+	bench_codec_sink = crc.checksum;
+	return cb->length;
+}
+
+static void *setup_sdnv(size_t param)
+{
+	uint64_t *values = malloc(SDNV_VALUE_COUNT * sizeof(uint64_t));
+	size_t i;
+
+	(void)param;
+	if (values == NULL)
+		return NULL;
+	/* Spread the values over all encoded lengths */
+	for (i = 0; i < SDNV_VALUE_COUNT; i++)
+		values[i] = (UINT64_C(0x9E3779B97F4A7C15) * (i + 1))
+			>> (i % 64);
+	return values;
+}
+
+static size_t run_sdnv(void *ctx)
+{
+	const uint64_t *values = ctx;
+	uint8_t buffer[MAX_SDNV_SIZE];
+	uint64_t decoded;
+	size_t i, bytes = 0;
+	int_fast8_t length;
+
+	for (i = 0; i < SDNV_VALUE_COUNT; i++) {
+		length = sdnv_write_u64(buffer, values[i]);
+		sdnv_decode_u64(buffer, length, &decoded);
+		bench_codec_sink = (uint32_t)decoded;
+		bytes += length;
+	}
+	return bytes;
+}
+
+static void *setup_eid(size_t param)
+{
+	(void)param;
+	return malloc(EID_BUFFER_SIZE);
+}
+
+static size_t run_eid_serialize(void *ctx)
+{
+	uint8_t *buffer = ctx;
+	size_t i, bytes = 0;
+	int length;
+
+	for (i = 0; i < ARRAY_SIZE(eids); i++) {
+		length = bundle7_eid_serialize(eids[i], buffer,
+					       EID_BUFFER_SIZE);
+		if (length > 0)
+			bytes += length;
+	}
+	return bytes;
+}
+
+static size_t run_eid_serialize_cached(void *ctx)
+{
+	uint8_t *buffer = ctx;
+	size_t i, bytes = 0;
+	int length;
+
+	for (i = 0; i < ARRAY_SIZE(eids); i++) {
+		length = bundle7_eid_serialize_cached(eids[i], buffer,
+						      EID_BUFFER_SIZE);
+		if (length > 0)
+			bytes += length;
+	}
+	return bytes;
+}
+
+struct eid_parse_bench {
+	uint8_t *encoded[ARRAY_SIZE(eids)];
+	size_t lengths[ARRAY_SIZE(eids)];
+};
+
+static void *setup_eid_parse(size_t param)
+{
+	struct eid_parse_bench *eb = calloc(1, sizeof(struct eid_parse_bench));
+	size_t i;
+
+	(void)param;
+	if (eb == NULL)
+		return NULL;
+	for (i = 0; i < ARRAY_SIZE(eids); i++) {
+		eb->encoded[i] = bundle7_eid_serialize_alloc(eids[i],
+							     &eb->lengths[i]);
+		if (eb->encoded[i] == NULL) {
+			while (i--)
+				free(eb->encoded[i]);
+			free(eb);
+			return NULL;
+		}
+	}
+	return eb;
+}
+
+static void teardown_eid_parse(void *ctx)
+{
+	struct eid_parse_bench *eb = ctx;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(eids); i++)
+		free(eb->encoded[i]);
+	free(eb);
+}
+
+static size_t run_eid_parse(void *ctx)
+{
+	struct eid_parse_bench *eb = ctx;
+	size_t i, bytes = 0;
+
+	for (i = 0; i < ARRAY_SIZE(eids); i++) {
+		free(bundle7_eid_parse(eb->encoded[i], eb->lengths[i]));
+		bytes += eb->lengths[i];
+	}
+	return bytes;
+}
+
+#define CRC_BENCH(label, operation, size) { \
+	.name = label "/" #size, \
+	.param = size, \
+	.setup = setup_crc, \
+	.run = run_ ## operation, \
+	.teardown = teardown_crc, \
+}
+
+#define CRC_BENCH_SIZES(label, operation) \
+	CRC_BENCH(label, operation, 64), \
+	CRC_BENCH(label, operation, 1024), \
+	CRC_BENCH(label, operation, 65536)
+
+static const struct bench_case cases[] = {
+	CRC_BENCH_SIZES("crc16_x25", crc16_x25),
+	CRC_BENCH_SIZES("crc16_ccitt_false", crc16_ccitt_false),
+	CRC_BENCH_SIZES("crc32", crc32),
+	CRC_BENCH_SIZES("crc32_copy", crc32_copy),
+	{
+		.name = "sdnv_u64",
+		.setup = setup_sdnv,
+		.run = run_sdnv,
+		.teardown = teardown_free,
+	},
+	{
+		.name = "bundle7_eid_serialize",
+		.setup = setup_eid,
+		.run = run_eid_serialize,
+		.teardown = teardown_free,
+	},
+	{
+		.name = "bundle7_eid_serialize_cached",
+		.setup = setup_eid,
+		.run = run_eid_serialize_cached,
+		.teardown = teardown_free,
+	},
+	{
+		.name = "bundle7_eid_parse",
+		.setup = setup_eid_parse,
+		.run = run_eid_parse,
+		.teardown = teardown_eid_parse,
+	},
+};
+
+const struct bench_group bench_codec_group = {
+	.cases = cases,
+	.count = ARRAY_SIZE(cases),
+};
@@ -0,0 +1,182 @@
+#include "bench.h"
+
+#include "aap/aap.h"
+#include "aap/aap_parser.h"
+#include "aap/aap_serializer.h"
+
+#include "spp/spp.h"
+#include "spp/spp_parser.h"
+
+#include "upcn/common.h"
+#include "upcn/parser.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_APID 0x123
+#define BENCH_AAP_EID "bench"
+
+struct spp_bench {
+	struct spp_context_t *ctx;
+	struct spp_parser parser;
+	uint8_t *payload;
+	size_t payload_length;
+	uint8_t *packet;
+};
+
+static void *setup_spp(size_t payload_length)
+{
+	struct spp_bench *sb = calloc(1, sizeof(struct spp_bench));
+
+	if (sb == NULL)
+		return NULL;
+	sb->ctx = spp_new_context();
+	if (sb->ctx == NULL) {
+		free(sb);
+		return NULL;
+	}
+	sb->payload = malloc(payload_length);
+	sb->packet = malloc(spp_get_size(sb->ctx, payload_length));
+	if (sb->payload == NULL || sb->packet == NULL) {
+		spp_free_context(sb->ctx);
+		free(sb->payload);
+		free(sb->packet);
+		free(sb);
+		return NULL;
+	}
+	memset(sb->payload, 0x5A, payload_length);
+	sb->payload_length = payload_length;
+	spp_parser_init(&sb->parser, sb->ctx);
+	return sb;
+}
+
+static void teardown_spp(void *ctx)
+{
+	struct spp_bench *sb = ctx;
+
+	spp_free_context(sb->ctx);
+	free(sb->payload);
+	free(sb->packet);
+	free(sb);
+}
+
+/* Frames the payload into a space packet and parses the header back */
+static size_t run_spp(void *ctx)
+{
+	struct spp_bench *sb = ctx;
+	const struct spp_meta_t metadata = {
+		.apid = BENCH_APID,
+		.is_request = false,
+		.segment_number = 0,
+		.segment_status = SPP_SEGMENT_UNSEGMENTED,
+	};
+	uint8_t *out = sb->packet;
+	size_t packet_length, header_length, data_length;
+
+	if (spp_serialize_header(sb->ctx, &metadata, sb->payload_length,
+				 &out) != 0)
+		return 0;
+	memcpy(out, sb->payload, sb->payload_length);
+	header_length = out - sb->packet;
+	packet_length = header_length + sb->payload_length;
+	spp_parser_reset(&sb->parser);
+	/* The parser stops in front of the data */
+	if (spp_parser_read(&sb->parser, sb->packet, packet_length) !=
+			header_length ||
+			sb->parser.state != SPP_PARSER_STATE_DATA_SUBPARSER ||
+			!spp_parser_get_data_length(&sb->parser,
+						    &data_length) ||
+			data_length != sb->payload_length)
+		return 0;
+	return packet_length;
+}
+
+struct aap_bench {
+	struct aap_parser parser;
+	uint8_t *serialized;
+	size_t serialized_size;
+};
+
+static void *setup_aap(size_t payload_length)
+{
+	struct aap_bench *ab = malloc(sizeof(struct aap_bench));
+	struct aap_message msg = {
+		.type = AAP_MESSAGE_SENDBUNDLE,
+		.eid = BENCH_AAP_EID,
+		.eid_length = sizeof(BENCH_AAP_EID) - 1,
+		.payload_length = payload_length,
+	};
+
+	if (ab == NULL)
+		return NULL;
+	msg.payload = malloc(payload_length);
+	if (msg.payload == NULL) {
+		free(ab);
+		return NULL;
+	}
+	memset(msg.payload, 0x5A, payload_length);
+	ab->serialized_size = aap_get_serialized_size(&msg);
+	ab->serialized = malloc(ab->serialized_size);
+	if (ab->serialized == NULL) {
+		free(msg.payload);
+		free(ab);
+		return NULL;
+	}
+	aap_serialize_into(ab->serialized, &msg);
+	free(msg.payload);
+	aap_parser_init(&ab->parser);
+	return ab;
+}
+
+static void teardown_aap(void *ctx)
+{
+	struct aap_bench *ab = ctx;
+
+	aap_parser_reset(&ab->parser);
+	free(ab->serialized);
+	free(ab);
+}
+
+static size_t run_aap(void *ctx)
+{
+	struct aap_bench *ab = ctx;
+	struct aap_parser *parser = &ab->parser;
+	size_t consumed = 0, delta;
+
+	while (parser->status == PARSER_STATUS_GOOD &&
+			consumed < ab->serialized_size) {
+		delta = parser->parse(parser, &ab->serialized[consumed],
+				      ab->serialized_size - consumed);
+		if (!delta)
+			break;
+		consumed += delta;
+	}
+	if (parser->status != PARSER_STATUS_DONE)
+		consumed = 0;
+	aap_parser_reset(parser);
+	return consumed;
+}
+
+#define FRAMING_BENCH(label, operation, size) { \
+	.name = label "/" #size, \
+	.param = size, \
+	.setup = setup_ ## operation, \
+	.run = run_ ## operation, \
+	.teardown = teardown_ ## operation, \
+}
+
+#define FRAMING_BENCH_SIZES(label, operation) \
+	FRAMING_BENCH(label, operation, 64), \
+	FRAMING_BENCH(label, operation, 1024), \
+	FRAMING_BENCH(label, operation, 65536)
+
+static const struct bench_case cases[] = {
+	FRAMING_BENCH_SIZES("spp_frame", spp),
+	FRAMING_BENCH_SIZES("aap_parse_sendbundle", aap),
+};
+
+const struct bench_group bench_framing_group = {
+	.cases = cases,
+	.count = ARRAY_SIZE(cases),
+};
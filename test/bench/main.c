@@ -0,0 +1,213 @@
+#include "bench.h"
+
+#include "bundle7/eid.h"
+
+#include "platform/hal_time.h"
+
+#include "upcn/common.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_MIN_TIME_S 0.5
+#define DEFAULT_THRESHOLD_PERCENT 10.0
+#define BASELINE_LINE_LENGTH 256
+#define BASELINE_NAME_LENGTH 64
+
+static const struct bench_group *const groups[] = {
+	&bench_bundle_group,
+	&bench_codec_group,
+	&bench_framing_group,
+};
+
+struct bench_result {
+	uint64_t iterations;
+	double seconds;
+	double ops_per_s;
+	double bytes_per_s;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool run_case(const struct bench_case *bc, double min_time,
+		     struct bench_result *result)
+{
+	uint64_t batch = 1, i, iterations = 0, bytes = 0;
+	double start, elapsed = 0.0;
+	bool failed = false;
+	size_t processed;
+	void *ctx = bc->setup(bc->param);
+
+	if (ctx == NULL) {
+		fprintf(stderr, "%s: setup failed\n", bc->name);
+		return false;
+	}
+	/* Warm up caches and allocators before taking measurements */
+	failed = bc->run(ctx) == 0;
+	/* Double the batch size until the minimum time has been spent */
+	while (!failed && elapsed < min_time) {
+		start = now_s();
+		for (i = 0; i < batch; i++) {
+			processed = bc->run(ctx);
+			failed |= processed == 0;
+			bytes += processed;
+		}
+		elapsed += now_s() - start;
+		iterations += batch;
+		if (batch < UINT32_MAX)
+			batch *= 2;
+	}
+	bc->teardown(ctx);
+	if (failed) {
+		fprintf(stderr, "%s: operation failed\n", bc->name);
+		return false;
+	}
+	result->iterations = iterations;
+	result->seconds = elapsed;
+	result->ops_per_s = (double)iterations / elapsed;
+	result->bytes_per_s = (double)bytes / elapsed;
+	return true;
+}
+
+/*
+ * Looks up the "ops_per_s" value of the named benchmark in a file written
+ * by a previous run. The output contains exactly one result per line.
+ */
+static bool baseline_lookup(FILE *baseline, const char *name,
+			    double *ops_per_s)
+{
+	char line[BASELINE_LINE_LENGTH];
+	char line_name[BASELINE_NAME_LENGTH];
+	const char *ops;
+
+	rewind(baseline);
+	while (fgets(line, sizeof(line), baseline) != NULL) {
+		if (sscanf(line, " {\"name\": \"%63[^\"]\"", line_name) != 1 ||
+				strcmp(line_name, name) != 0)
+			continue;
+		ops = strstr(line, "\"ops_per_s\": ");
+		return ops != NULL &&
+			sscanf(ops, "\"ops_per_s\": %lf", ops_per_s) == 1;
+	}
+	return false;
+}
+
+static void print_result(const char *name, const struct bench_result *result,
+			 bool first)
+{
+	printf("%s  {\"name\": \"%s\", \"iterations\": %llu, \"seconds\": %.6f, \"ops_per_s\": %.1f, \"bytes_per_s\": %.1f}",
+	       first ? "" : ",\n", name,
+	       (unsigned long long)result->iterations, result->seconds,
+	       result->ops_per_s, result->bytes_per_s);
+	fflush(stdout);
+}
+
+static bool parse_double(const char *str, double *result)
+{
+	char *end;
+
+	errno = 0;
+	*result = strtod(str, &end);
+	return errno == 0 && end != str && *end == '\0' && *result >= 0.0;
+}
+
+static bool parse_positive_double(const char *str, double *result)
+{
+	return parse_double(str, result) && *result > 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = NULL;
+	FILE *baseline = NULL;
+	double min_time = DEFAULT_MIN_TIME_S;
+	double threshold = DEFAULT_THRESHOLD_PERCENT;
+	double baseline_ops;
+	struct bench_result result;
+	const struct bench_case *bc;
+	bool first = true;
+	int opt, regressions = 0, failures = 0;
+	size_t g, c;
+
+	while ((opt = getopt(argc, argv, "f:t:b:r:")) != -1) {
+		switch (opt) {
+		case 'f':
+			filter = optarg;
+			break;
+		case 't':
+			if (!parse_positive_double(optarg, &min_time)) {
+				fprintf(stderr, "Invalid minimum time!\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'b':
+			baseline = fopen(optarg, "r");
+			if (baseline == NULL) {
+				fprintf(stderr, "Cannot open baseline!\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			if (!parse_double(optarg, &threshold)) {
+				fprintf(stderr, "Invalid threshold!\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		default: /* '?' */
+			fprintf(stderr,
+				"Usage: %s [-f name filter] [-t minimum time per benchmark (seconds)] [-b baseline file] [-r regression threshold (percent)]\n",
+				argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	hal_time_init(0);
+	if (bundle7_eid_cache_init() != UPCN_OK) {
+		fprintf(stderr, "Cannot initialize the EID cache!\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("{\"benchmarks\": [\n");
+	for (g = 0; g < ARRAY_SIZE(groups); g++) {
+		for (c = 0; c < groups[g]->count; c++) {
+			bc = &groups[g]->cases[c];
+			if (filter != NULL && strstr(bc->name, filter) == NULL)
+				continue;
+			if (!run_case(bc, min_time, &result)) {
+				failures++;
+				continue;
+			}
+			print_result(bc->name, &result, first);
+			first = false;
+			if (baseline == NULL ||
+					!baseline_lookup(baseline, bc->name,
+							 &baseline_ops))
+				continue;
+			if (result.ops_per_s < baseline_ops *
+					(1.0 - threshold / 100.0)) {
+				fprintf(stderr,
+					"%s: regression, %.1f ops/s (baseline %.1f ops/s)\n",
+					bc->name, result.ops_per_s,
+					baseline_ops);
+				regressions++;
+			}
+		}
+	}
+	printf("%s]}\n", first ? "" : "\n");
+
+	if (baseline != NULL)
+		fclose(baseline);
+	return (regressions || failures) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
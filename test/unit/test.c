@@ -4,9 +4,19 @@ void testupcn(void)
 {
 	RUN_TEST_GROUP(upcn);
 	RUN_TEST_GROUP(simplehtab);
+	RUN_TEST_GROUP(knownBundleSet);
+	RUN_TEST_GROUP(reassemblyTable);
+	RUN_TEST_GROUP(custodyAggregator);
 	RUN_TEST_GROUP(sdnv);
 	RUN_TEST_GROUP(node);
 	RUN_TEST_GROUP(routingTable);
+	RUN_TEST_GROUP(routerCgr);
+	RUN_TEST_GROUP(routerOptimizer);
+	RUN_TEST_GROUP(contactSchedule);
+	RUN_TEST_GROUP(bundleBacklog);
+	RUN_TEST_GROUP(eidIndex);
+	RUN_TEST_GROUP(nbf);
+	RUN_TEST_GROUP(planParser);
 	RUN_TEST_GROUP(bundleStorageManager);
 	RUN_TEST_GROUP(eidList);
 	RUN_TEST_GROUP(random);
@@ -119,8 +119,44 @@ TEST(aap_serializer, serialize_into)
 	}
 }
 
+struct write_context {
+	uint8_t *buffer;
+	size_t position;
+};
+
+static void write_to_buffer(void *param, const void *data, const size_t length)
+{
+	struct write_context *ctx = (struct write_context *)param;
+
+	memcpy(&ctx->buffer[ctx->position], data, length);
+	ctx->position += length;
+}
+
+TEST(aap_serializer, serialize_header)
+{
+	uint8_t buffer[MSG_MAX_LENGTH];
+
+	for (size_t c = 0; c < ARRAY_SIZE(valid_messages); c++) {
+		const size_t payload_length = (
+			valid_messages[c].type == AAP_MESSAGE_SENDBUNDLE ||
+			valid_messages[c].type == AAP_MESSAGE_RECVBUNDLE
+		) ? valid_messages[c].payload_length : 0;
+		struct write_context ctx = {.buffer = buffer, .position = 0};
+
+		aap_serialize_header(&valid_messages[c], write_to_buffer, &ctx);
+		TEST_ASSERT_EQUAL(valid_message_lengths[c] - payload_length,
+				  ctx.position);
+		TEST_ASSERT_EQUAL_MEMORY(
+			valid_message_bytes[c],
+			buffer,
+			ctx.position
+		);
+	}
+}
+
 TEST_GROUP_RUNNER(aap_serializer)
 {
 	RUN_TEST_CASE(aap_serializer, get_serialized_size);
 	RUN_TEST_CASE(aap_serializer, serialize_into);
+	RUN_TEST_CASE(aap_serializer, serialize_header);
 }
@@ -1,3 +1,4 @@
+#include "bundle6/bundle6.h"
 #include "bundle6/create.h"
 #include "bundle6/serializer.h"
 #include "bundle6/parser.h"
@@ -137,6 +138,23 @@ static void verify_and_free_bundle(struct bundle *b, void *param)
 	bundle_free(b);
 }
 
+static void verify_fragment_and_free_bundle(struct bundle *b, void *param)
+{
+	(void)param;
+	TEST_ASSERT_NOT_NULL(b);
+	TEST_ASSERT_EQUAL_STRING("dtn:othercustodian", b->current_custodian);
+	TEST_ASSERT_EQUAL_STRING("dtn:sourceeid", b->source);
+	TEST_ASSERT_TRUE(HAS_FLAG(b->proc_flags, BUNDLE_FLAG_IS_FRAGMENT));
+	TEST_ASSERT_EQUAL(300, b->fragment_offset);
+	TEST_ASSERT_EQUAL(1000, b->total_adu_length);
+	TEST_ASSERT_EQUAL_STRING(
+		"dtn:eidref1",
+		b->blocks->next->data->eid_refs->eid
+	);
+	bundle_free(b);
+	verify_ok = true;
+}
+
 struct buf_info {
 	uint8_t *buf;
 	size_t pos;
@@ -183,7 +201,104 @@ TEST(bundle6ParserSerializer, parse_and_serialize)
 	free(serializebuffer);
 }
 
+TEST(bundle6ParserSerializer, parse_chunked)
+{
+	const size_t size = bundle_get_serialized_size(b);
+	uint8_t *serializebuffer = malloc(size);
+	struct buf_info bi = {
+		.buf = serializebuffer,
+		.pos = 0,
+	};
+	struct bundle6_parser p;
+	size_t chunk, pos, length, consumed;
+
+	TEST_ASSERT_NOT_NULL(serializebuffer);
+	bundle6_serialize(b, _write, &bi);
+	bundle6_parser_init(&p, verify_and_free_bundle, NULL);
+
+	// Headers split at every possible position use the byte-wise parser
+	for (chunk = 1; chunk <= size; chunk++) {
+		verify_ok = false;
+		pos = 0;
+		while (pos < size && p.basedata->status == PARSER_STATUS_GOOD) {
+			length = MIN(chunk, size - pos);
+			consumed = bundle6_parser_read(
+				&p, &serializebuffer[pos], length);
+			if (consumed == 0) {
+				// Bulk read not satisfiable from this chunk
+				TEST_ASSERT_TRUE(HAS_FLAG(p.basedata->flags,
+					PARSER_FLAG_BULK_READ));
+				consumed = p.basedata->next_bytes;
+				TEST_ASSERT_TRUE(pos + consumed <= size);
+				memcpy(p.basedata->next_buffer,
+				       &serializebuffer[pos], consumed);
+				p.basedata->flags &= ~PARSER_FLAG_BULK_READ;
+				bundle6_parser_read(&p, NULL, 0);
+			}
+			pos += consumed;
+		}
+		TEST_ASSERT_EQUAL(size, pos);
+		TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, p.basedata->status);
+		TEST_ASSERT_TRUE(verify_ok);
+		bundle6_parser_reset(&p);
+	}
+
+	free(serializebuffer);
+}
+
+static void _count(void *count, const void *data, const size_t len)
+{
+	(void)data;
+	*(size_t *)count += len;
+}
+
+TEST(bundle6ParserSerializer, header_cache)
+{
+	const struct bundle6_header_cache *cache;
+	struct bundle6_parser p;
+	size_t size, count;
+	uint8_t *serializebuffer;
+	struct buf_info bi;
+
+	// The cache is reused by size queries and serialization
+	size = bundle_get_serialized_size(b);
+	cache = b->v6_header_cache;
+	TEST_ASSERT_NOT_NULL(cache);
+	TEST_ASSERT_EQUAL(1, cache->eid_reference_count);
+	count = 0;
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle6_serialize(b, _count, &count));
+	TEST_ASSERT_EQUAL(size, count);
+	TEST_ASSERT_EQUAL_PTR(cache, b->v6_header_cache);
+
+	// Changing the header requires recalculating it
+	free(b->current_custodian);
+	b->current_custodian = strdup("dtn:othercustodian");
+	b->proc_flags |= BUNDLE_FLAG_IS_FRAGMENT;
+	b->fragment_offset = 300;
+	b->total_adu_length = 1000;
+	bundle_recalculate_header_length(b);
+	size = bundle_get_serialized_size(b);
+
+	serializebuffer = malloc(size);
+	TEST_ASSERT_NOT_NULL(serializebuffer);
+	bi.buf = serializebuffer;
+	bi.pos = 0;
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle6_serialize(b, _write, &bi));
+	TEST_ASSERT_EQUAL(size, bi.pos);
+
+	bundle6_parser_init(&p, verify_fragment_and_free_bundle, NULL);
+	verify_ok = false;
+	bundle6_parser_read(&p, serializebuffer, size);
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, p.basedata->status);
+	TEST_ASSERT_TRUE(verify_ok);
+	bundle6_parser_deinit(&p);
+
+	free(serializebuffer);
+}
+
 TEST_GROUP_RUNNER(bundle6ParserSerializer)
 {
 	RUN_TEST_CASE(bundle6ParserSerializer, parse_and_serialize);
+	RUN_TEST_CASE(bundle6ParserSerializer, parse_chunked);
+	RUN_TEST_CASE(bundle6ParserSerializer, header_cache);
 }
@@ -14,6 +14,7 @@
 
 #include "unity_fixture.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -379,6 +380,171 @@ TEST(bundle7Parser, invalid_crc_handling)
 	TEST_ASSERT_NULL(bundle);
 }
 
+// -----------------
+// Payload Admission
+// -----------------
+
+static size_t admitted_payload_length;
+
+static bool refuse_payload(const struct bundle *_bundle,
+	size_t payload_length, void *param)
+{
+	(void)param;
+	TEST_ASSERT_EQUAL_STRING("dtn:GS2", _bundle->destination);
+	admitted_payload_length = payload_length;
+	return false;
+}
+
+TEST(bundle7Parser, payload_admission)
+{
+	struct bundle7_parser state;
+	struct parser *parser = bundle7_parser_init(
+		&state,
+		&send_callback,
+		NULL
+	);
+
+	TEST_ASSERT_NOT_NULL(parser);
+
+	// Refused bundles are parsed completely but dropped, the CRC of the
+	// skipped payload is not verified
+	state.admit_callback = &refuse_payload;
+	admitted_payload_length = 0;
+
+	size_t parsed = bundle7_parser_read(&state, cbor_crc32_payload_block,
+		len_crc32_payload_block);
+
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_EQUAL(len_crc32_payload_block, parsed);
+	TEST_ASSERT_FALSE(state.basedata->flags & PARSER_FLAG_CRC_INVALID);
+	TEST_ASSERT_EQUAL(12, admitted_payload_length);
+	TEST_ASSERT_NULL(state.bundle);
+	TEST_ASSERT_NULL(bundle);
+
+	// The payload is skipped by a "discard read" without a buffer
+	bundle7_parser_reset(&state);
+	parsed = bundle7_parser_read(&state, cbor_simple_bundle,
+		len_simple_bundle - 13);
+	TEST_ASSERT_EQUAL(len_simple_bundle - 13, parsed);
+	TEST_ASSERT_TRUE(state.basedata->flags & PARSER_FLAG_BULK_READ);
+	TEST_ASSERT_NULL(state.basedata->next_buffer);
+	TEST_ASSERT_EQUAL(12, state.basedata->next_bytes);
+	state.basedata->flags &= ~PARSER_FLAG_BULK_READ;
+	bundle7_parser_read(&state, NULL, 0);
+	parsed = bundle7_parser_read(&state,
+		cbor_simple_bundle + len_simple_bundle - 1, 1);
+	TEST_ASSERT_EQUAL(1, parsed);
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_NULL(bundle);
+
+	// Bundles whose payload exceeds the quota are dropped the same way
+	bundle7_parser_reset(&state);
+	state.admit_callback = NULL;
+	state.bundle_quota = len_simple_bundle - 3;
+	parsed = bundle7_parser_read(&state, cbor_simple_bundle,
+		len_simple_bundle);
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_EQUAL(len_simple_bundle, parsed);
+	TEST_ASSERT_NULL(bundle);
+
+	// Admitted bundles are passed on
+	bundle7_parser_reset(&state);
+	state.bundle_quota = len_simple_bundle;
+	parsed = bundle7_parser_read(&state, cbor_simple_bundle,
+		len_simple_bundle);
+	TEST_ASSERT_EQUAL(PARSER_STATUS_DONE, state.basedata->status);
+	TEST_ASSERT_NOT_NULL(bundle);
+	TEST_ASSERT_EQUAL_MEMORY("Hello world!", bundle->payload_block->data,
+		12);
+
+	bundle7_parser_deinit(&state);
+}
+
+// ---------------
+// One-shot Parser
+// ---------------
+
+TEST(bundle7Parser, parse_buffer)
+{
+	struct bundle *chunked;
+	struct bundle_block_list *a, *b;
+	uint8_t *buffer;
+
+	parse_bundle_chunked(len_simple_bundle);
+	chunked = bundle;
+
+	bundle = bundle7_parse_buffer(cbor_simple_bundle, len_simple_bundle,
+		BUNDLE7_DEFAULT_BUNDLE_QUOTA, NULL, NULL);
+	TEST_ASSERT_NOT_NULL(bundle);
+
+	// Same result as the streaming parser
+	TEST_ASSERT_EQUAL(chunked->proc_flags, bundle->proc_flags);
+	TEST_ASSERT_EQUAL_STRING(chunked->destination, bundle->destination);
+	TEST_ASSERT_EQUAL_STRING(chunked->source, bundle->source);
+	TEST_ASSERT_EQUAL_STRING(chunked->report_to, bundle->report_to);
+	TEST_ASSERT_EQUAL(chunked->creation_timestamp,
+		bundle->creation_timestamp);
+	TEST_ASSERT_EQUAL(chunked->sequence_number, bundle->sequence_number);
+	TEST_ASSERT_EQUAL(chunked->lifetime, bundle->lifetime);
+	TEST_ASSERT_EQUAL(chunked->primary_block_length,
+		bundle->primary_block_length);
+	for (a = chunked->blocks, b = bundle->blocks;
+			a != NULL && b != NULL; a = a->next, b = b->next) {
+		TEST_ASSERT_EQUAL(a->data->type, b->data->type);
+		TEST_ASSERT_EQUAL(a->data->number, b->data->number);
+		TEST_ASSERT_EQUAL(a->data->flags, b->data->flags);
+		TEST_ASSERT_EQUAL(a->data->length, b->data->length);
+		TEST_ASSERT_EQUAL_INT8_ARRAY(a->data->data, b->data->data,
+			a->data->length);
+	}
+	TEST_ASSERT_NULL(a);
+	TEST_ASSERT_NULL(b);
+	TEST_ASSERT_NOT_NULL(bundle->payload_block);
+	TEST_ASSERT_EQUAL(len_simple_bundle,
+			  bundle_get_serialized_size(bundle));
+	bundle_free(chunked);
+	bundle_free(bundle);
+
+	// CRCs
+	bundle = bundle7_parse_buffer(cbor_crc16_primary_block,
+		len_crc16_primary_block, BUNDLE7_DEFAULT_BUNDLE_QUOTA,
+		NULL, NULL);
+	TEST_ASSERT_NOT_NULL(bundle);
+	TEST_ASSERT_EQUAL(bundle->crc.checksum, 0x7123);
+	bundle_free(bundle);
+
+	bundle = bundle7_parse_buffer(cbor_crc32_payload_block,
+		len_crc32_payload_block, BUNDLE7_DEFAULT_BUNDLE_QUOTA,
+		NULL, NULL);
+	TEST_ASSERT_NOT_NULL(bundle);
+	TEST_ASSERT_EQUAL(bundle->payload_block->crc.checksum, 0xc3aec552);
+	bundle_free(bundle);
+
+	bundle = bundle7_parse_buffer(cbor_invalid_crc16, len_invalid_crc16,
+		BUNDLE7_DEFAULT_BUNDLE_QUOTA, NULL, NULL);
+	TEST_ASSERT_NULL(bundle);
+
+	// Truncated bundles, trailing data and exceeded quotas
+	TEST_ASSERT_NULL(bundle7_parse_buffer(cbor_simple_bundle,
+		len_simple_bundle - 1, BUNDLE7_DEFAULT_BUNDLE_QUOTA,
+		NULL, NULL));
+	buffer = malloc(len_simple_bundle + 1);
+	memcpy(buffer, cbor_simple_bundle, len_simple_bundle);
+	buffer[len_simple_bundle] = 0x00;
+	TEST_ASSERT_NULL(bundle7_parse_buffer(buffer, len_simple_bundle + 1,
+		BUNDLE7_DEFAULT_BUNDLE_QUOTA, NULL, NULL));
+	free(buffer);
+	TEST_ASSERT_NULL(bundle7_parse_buffer(cbor_simple_bundle,
+		len_simple_bundle, len_simple_bundle - 1, NULL, NULL));
+
+	// Bundles refused by the admission callback are dropped
+	admitted_payload_length = 0;
+	TEST_ASSERT_NULL(bundle7_parse_buffer(cbor_crc32_payload_block,
+		len_crc32_payload_block, BUNDLE7_DEFAULT_BUNDLE_QUOTA,
+		&refuse_payload, NULL));
+	TEST_ASSERT_EQUAL(12, admitted_payload_length);
+}
+
 static const uint8_t cbor_status_report[] = {
 	// [
 	//   1,                   // Record type code
@@ -482,6 +648,8 @@ TEST_GROUP_RUNNER(bundle7Parser)
 	RUN_TEST_CASE(bundle7Parser, crc16_verification);
 	RUN_TEST_CASE(bundle7Parser, crc32_verification);
 	RUN_TEST_CASE(bundle7Parser, invalid_crc_handling);
+	RUN_TEST_CASE(bundle7Parser, payload_admission);
+	RUN_TEST_CASE(bundle7Parser, parse_buffer);
 	RUN_TEST_CASE(bundle7Parser, status_report_parser);
 	RUN_TEST_CASE(bundle7Parser, hop_count);
 }
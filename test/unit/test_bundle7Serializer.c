@@ -5,8 +5,10 @@
  */
 
 #include "bundle7/serializer.h"
+#include "bundle7/create.h"
 #include "bundle7/eid.h"
 #include "bundle7/hopcount.h"
+#include "bundle7/parser.h"
 
 #include "platform/hal_io.h"
 
@@ -390,6 +392,74 @@ TEST(bundle7Serializer, crc32_generation)
 }
 
 
+struct collected_output {
+	uint8_t *buffer;
+	size_t length;
+	size_t capacity;
+	unsigned int writes;
+};
+
+static void write_collect(void *cla_obj, const void *data, const size_t len)
+{
+	struct collected_output *out = cla_obj;
+
+	TEST_ASSERT_TRUE(out->length + len <= out->capacity);
+	memcpy(&out->buffer[out->length], data, len);
+	out->length += len;
+	out->writes++;
+}
+
+TEST(bundle7Serializer, large_fields)
+{
+	const size_t payload_length = 1000;
+	char source[120], destination[120];
+	uint8_t *payload = malloc(payload_length);
+	struct bundle *bundle, *parsed;
+	struct collected_output out = { 0 };
+	size_t i;
+
+	TEST_ASSERT_NOT_NULL(payload);
+	for (i = 0; i < payload_length; i++)
+		payload[i] = (uint8_t)i;
+	// EIDs that do not fit into the buffer behind each other
+	memset(source, 's', sizeof(source));
+	memcpy(source, "dtn:", 4);
+	source[sizeof(source) - 1] = '\0';
+	memset(destination, 'd', sizeof(destination));
+	memcpy(destination, "dtn:", 4);
+	destination[sizeof(destination) - 1] = '\0';
+
+	bundle = bundle7_create_local(payload, payload_length, source,
+		destination, 1000, 86400, BUNDLE_FLAG_NONE);
+	TEST_ASSERT_NOT_NULL(bundle);
+	bundle->crc_type = BUNDLE_CRC_TYPE_32;
+	bundle->payload_block->crc_type = BUNDLE_CRC_TYPE_16;
+	bundle_recalculate_header_length(bundle);
+
+	out.capacity = bundle_get_serialized_size(bundle);
+	out.buffer = malloc(out.capacity);
+	TEST_ASSERT_NOT_NULL(out.buffer);
+	TEST_ASSERT_EQUAL(UPCN_OK,
+		bundle7_serialize(bundle, write_collect, &out));
+	TEST_ASSERT_EQUAL(out.capacity, out.length);
+	// Primary block, block header, payload and CRC with trailer
+	TEST_ASSERT_TRUE(out.writes <= 6);
+
+	parsed = bundle7_parse_buffer(out.buffer, out.length, out.length,
+		NULL, NULL);
+	TEST_ASSERT_NOT_NULL(parsed);
+	TEST_ASSERT_EQUAL_STRING(source, parsed->source);
+	TEST_ASSERT_EQUAL_STRING(destination, parsed->destination);
+	TEST_ASSERT_EQUAL(payload_length, parsed->payload_block->length);
+	TEST_ASSERT_EQUAL_MEMORY(bundle->payload_block->data,
+		parsed->payload_block->data, payload_length);
+
+	bundle_free(parsed);
+	bundle_free(bundle);
+	free(out.buffer);
+}
+
+
 static uint8_t cbor_dtn_text[6] = { 0x82, 0x01, 0x63, 0x47, 0x53, 0x31 };
 
 TEST(bundle7Serializer, dtn_text)
@@ -438,6 +508,42 @@ TEST(bundle7Serializer, dtn_ipn)
 }
 
 
+TEST(bundle7Serializer, eid_cached)
+{
+	uint8_t buffer[16];
+	int i;
+
+	// Repeated lookups return the encoding of the uncached serializer
+	for (i = 0; i < 2; i++) {
+		TEST_ASSERT_EQUAL(sizeof(cbor_dtn_text),
+			bundle7_eid_serialize_cached("dtn:GS1",
+				buffer, sizeof(buffer)));
+		TEST_ASSERT_EQUAL_INT8_ARRAY(cbor_dtn_text, buffer,
+			sizeof(cbor_dtn_text));
+		TEST_ASSERT_EQUAL(sizeof(dtn_ipn),
+			bundle7_eid_serialize_cached("ipn:12.123",
+				buffer, sizeof(buffer)));
+		TEST_ASSERT_EQUAL_INT8_ARRAY(dtn_ipn, buffer,
+			sizeof(dtn_ipn));
+		TEST_ASSERT_EQUAL(sizeof(dtn_none),
+			bundle7_eid_serialize_cached("dtn:none",
+				buffer, sizeof(buffer)));
+		TEST_ASSERT_EQUAL_INT8_ARRAY(dtn_none, buffer,
+			sizeof(dtn_none));
+	}
+
+	// Size queries, too small buffers and invalid EIDs
+	TEST_ASSERT_EQUAL(sizeof(cbor_dtn_text),
+		bundle7_eid_serialize_cached("dtn:GS1", NULL, 0));
+	TEST_ASSERT_EQUAL(0, bundle7_eid_serialize_cached("dtn:GS1",
+		buffer, sizeof(cbor_dtn_text) - 1));
+	TEST_ASSERT_EQUAL(-1, bundle7_eid_serialize_cached("foo:bar",
+		buffer, sizeof(buffer)));
+	TEST_ASSERT_EQUAL(-1, bundle7_eid_serialize_cached("ipn:x",
+		NULL, 0));
+}
+
+
 // [40, 10]
 static const uint8_t cbor_hop_count[] = { 0x82, 0x18, 0x28, 0x0a };
 
@@ -465,8 +571,10 @@ TEST_GROUP_RUNNER(bundle7Serializer)
 	RUN_TEST_CASE(bundle7Serializer, dtn_text);
 	RUN_TEST_CASE(bundle7Serializer, dtn_none);
 	RUN_TEST_CASE(bundle7Serializer, dtn_ipn);
+	RUN_TEST_CASE(bundle7Serializer, eid_cached);
 	RUN_TEST_CASE(bundle7Serializer, hop_count);
 	RUN_TEST_CASE(bundle7Serializer, simple_bundle);
 	RUN_TEST_CASE(bundle7Serializer, crc16_generation);
 	RUN_TEST_CASE(bundle7Serializer, crc32_generation);
+	RUN_TEST_CASE(bundle7Serializer, large_fields);
 }
@@ -0,0 +1,116 @@
+#include "upcn/bundle.h"
+#include "upcn/bundle_backlog.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+TEST_GROUP(bundleBacklog);
+
+#define MAX_TAKEN 8
+
+static struct bundle_backlog *backlog;
+static bundleid_t taken[MAX_TAKEN];
+static uint32_t taken_count;
+
+static void collect(bundleid_t id, uint64_t exp_time, void *param)
+{
+	TEST_ASSERT_EQUAL_UINT64((uint64_t)id * 10, exp_time);
+	TEST_ASSERT_TRUE(taken_count < MAX_TAKEN);
+	taken[taken_count++] = id;
+	// Re-adding is possible while taking bundles
+	if (param != NULL)
+		bundle_backlog_add(backlog, "dtn://r.dtn/app", id, exp_time);
+}
+
+TEST_SETUP(bundleBacklog)
+{
+	backlog = bundle_backlog_create(5);
+	taken_count = 0;
+	TEST_ASSERT_NOT_NULL(backlog);
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_backlog_add(
+		backlog, "dtn://a.dtn/app1", 1, 10));
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_backlog_add(
+		backlog, "dtn://b.dtn/app", 2, 20));
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_backlog_add(
+		backlog, "dtn://a.dtn/app2", 3, 30));
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_backlog_add(
+		backlog, "ipn:4.1", 4, 40));
+}
+
+TEST_TEAR_DOWN(bundleBacklog)
+{
+	bundle_backlog_free(backlog);
+}
+
+TEST(bundleBacklog, take_node)
+{
+	TEST_ASSERT_EQUAL_UINT32(4, bundle_backlog_count(backlog));
+
+	// Bundles are indexed by the node EID of their destination
+	bundle_backlog_take(backlog, "dtn://a.dtn", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(2, taken_count);
+	TEST_ASSERT_EQUAL_UINT16(1, taken[0]);
+	TEST_ASSERT_EQUAL_UINT16(3, taken[1]);
+	TEST_ASSERT_EQUAL_UINT32(2, bundle_backlog_count(backlog));
+
+	bundle_backlog_take(backlog, "dtn://a.dtn/", collect, NULL);
+	bundle_backlog_take(backlog, "dtn://unknown.dtn", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(2, taken_count);
+
+	bundle_backlog_take(backlog, "ipn:4.1", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(3, taken_count);
+	TEST_ASSERT_EQUAL_UINT16(4, taken[2]);
+	TEST_ASSERT_EQUAL_UINT32(1, bundle_backlog_count(backlog));
+}
+
+TEST(bundleBacklog, take_all)
+{
+	// The backlog is bounded
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_backlog_add(
+		backlog, "dtn://c.dtn/app", 5, 50));
+	TEST_ASSERT_EQUAL(UPCN_FAIL, bundle_backlog_add(
+		backlog, "dtn://c.dtn/app", 6, 60));
+
+	bundle_backlog_take(backlog, NULL, collect, backlog);
+	TEST_ASSERT_EQUAL_UINT32(5, taken_count);
+	TEST_ASSERT_EQUAL_UINT32(5, bundle_backlog_count(backlog));
+
+	taken_count = 0;
+	bundle_backlog_take(backlog, "dtn://r.dtn", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(5, taken_count);
+	TEST_ASSERT_EQUAL_UINT32(0, bundle_backlog_count(backlog));
+}
+
+TEST(bundleBacklog, expire)
+{
+	TEST_ASSERT_EQUAL_UINT32(0, bundle_backlog_expire(
+		backlog, 9, collect, NULL));
+	TEST_ASSERT_EQUAL_UINT32(0, taken_count);
+
+	// Bundles expiring at the given time are removed as well
+	TEST_ASSERT_EQUAL_UINT32(2, bundle_backlog_expire(
+		backlog, 20, collect, NULL));
+	TEST_ASSERT_EQUAL_UINT32(2, taken_count);
+	TEST_ASSERT_EQUAL_UINT32(2, bundle_backlog_count(backlog));
+
+	// The remaining bundles of a node are kept in order
+	bundle_backlog_take(backlog, "dtn://a.dtn", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(3, taken_count);
+	TEST_ASSERT_EQUAL_UINT16(3, taken[2]);
+	bundle_backlog_take(backlog, "dtn://b.dtn", collect, NULL);
+	TEST_ASSERT_EQUAL_UINT32(3, taken_count);
+
+	TEST_ASSERT_EQUAL_UINT32(1, bundle_backlog_expire(
+		backlog, 100, collect, NULL));
+	TEST_ASSERT_EQUAL_UINT32(4, taken_count);
+	TEST_ASSERT_EQUAL_UINT32(0, bundle_backlog_count(backlog));
+}
+
+TEST_GROUP_RUNNER(bundleBacklog)
+{
+	RUN_TEST_CASE(bundleBacklog, take_node);
+	RUN_TEST_CASE(bundleBacklog, take_all);
+	RUN_TEST_CASE(bundleBacklog, expire);
+}
@@ -54,6 +54,24 @@ TEST(bundleStorageManager, add)
 		TEST_ASSERT_TRUE(bundle_storage_delete(test_bundles[i]->id));
 }
 
+TEST(bundleStorageManager, add_batch)
+{
+	bundleid_t *ids = malloc(sizeof(bundleid_t) * BCNT);
+	uint16_t i;
+
+	TEST_ASSERT_EQUAL_UINT16(BCNT, bundle_storage_add_batch(
+		test_bundles, ids, BCNT));
+	for (i = 0; i < BCNT; i++) {
+		TEST_ASSERT_NOT_EQUAL(BUNDLE_INVALID_ID, ids[i]);
+		TEST_ASSERT_EQUAL(ids[i], test_bundles[i]->id);
+		TEST_ASSERT_EQUAL_PTR(test_bundles[i],
+			bundle_storage_get(ids[i]));
+	}
+	for (i = 0; i < BCNT; i++)
+		TEST_ASSERT_TRUE(bundle_storage_delete(ids[i]));
+	free(ids);
+}
+
 /* XXX Currently unused (planned FS component) */
 TEST(bundleStorageManager, add_persistent)
 {
@@ -150,6 +168,7 @@ TEST(bundleStorageManager, rand)
 TEST_GROUP_RUNNER(bundleStorageManager)
 {
 	RUN_TEST_CASE(bundleStorageManager, add);
+	RUN_TEST_CASE(bundleStorageManager, add_batch);
 	/*RUN_TEST_CASE(bundleStorageManager, add_persistent);*/
 	RUN_TEST_CASE(bundleStorageManager, rand);
 }
@@ -0,0 +1,115 @@
+#include "upcn/contact_schedule.h"
+#include "upcn/node.h"
+
+#include "unity_fixture.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+TEST_GROUP(contactSchedule);
+
+#define CONTACT_COUNT 6
+
+static struct contact *contacts[CONTACT_COUNT];
+
+static const uint64_t windows[CONTACT_COUNT][2] = {
+	{ 50, 60 }, { 10, 20 }, { 30, 70 }, { 15, 40 }, { 80, 90 }, { 5, 6 },
+};
+
+static bool is_started(const struct contact *contact)
+{
+	struct contact *const *started;
+	uint32_t count, i;
+
+	started = contact_schedule_get_started(&count);
+	for (i = 0; i < count; i++) {
+		if (started[i] == contact)
+			return true;
+	}
+	return false;
+}
+
+TEST_SETUP(contactSchedule)
+{
+	int i;
+
+	for (i = 0; i < CONTACT_COUNT; i++) {
+		contacts[i] = contact_create(NULL);
+		contacts[i]->from = windows[i][0];
+		contacts[i]->to = windows[i][1];
+		TEST_ASSERT_EQUAL(UPCN_OK, contact_schedule_add(contacts[i]));
+	}
+}
+
+TEST_TEAR_DOWN(contactSchedule)
+{
+	int i;
+
+	contact_schedule_free();
+	for (i = 0; i < CONTACT_COUNT; i++)
+		free_contact(contacts[i]);
+}
+
+TEST(contactSchedule, advance)
+{
+	uint32_t count;
+
+	TEST_ASSERT_EQUAL_UINT64(5, contact_schedule_next_event());
+	contact_schedule_advance(0);
+	contact_schedule_get_started(&count);
+	TEST_ASSERT_EQUAL_UINT32(0, count);
+
+	// Contacts which already ended are never reported
+	contact_schedule_advance(16);
+	contact_schedule_get_started(&count);
+	TEST_ASSERT_EQUAL_UINT32(2, count);
+	TEST_ASSERT_TRUE(is_started(contacts[1]));
+	TEST_ASSERT_TRUE(is_started(contacts[3]));
+	TEST_ASSERT_EQUAL(CONTACT_UNSCHEDULED, contacts[5]->schedule_state);
+	TEST_ASSERT_EQUAL_UINT64(20, contact_schedule_next_event());
+
+	contact_schedule_advance(55);
+	contact_schedule_get_started(&count);
+	TEST_ASSERT_EQUAL_UINT32(2, count);
+	TEST_ASSERT_TRUE(is_started(contacts[0]));
+	TEST_ASSERT_TRUE(is_started(contacts[2]));
+	TEST_ASSERT_EQUAL_UINT64(60, contact_schedule_next_event());
+
+	contact_schedule_advance(100);
+	contact_schedule_get_started(&count);
+	TEST_ASSERT_EQUAL_UINT32(0, count);
+	TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, contact_schedule_next_event());
+}
+
+TEST(contactSchedule, remove)
+{
+	uint32_t count;
+
+	contact_schedule_advance(16);
+	contact_schedule_remove(contacts[3]);
+	contact_schedule_remove(contacts[5]);
+	contact_schedule_get_started(&count);
+	TEST_ASSERT_EQUAL_UINT32(1, count);
+	TEST_ASSERT_TRUE(is_started(contacts[1]));
+
+	// Upcoming contacts can be removed at any position
+	contact_schedule_remove(contacts[2]);
+	contact_schedule_remove(contacts[1]);
+	TEST_ASSERT_EQUAL_UINT64(50, contact_schedule_next_event());
+	contact_schedule_remove(contacts[0]);
+	TEST_ASSERT_EQUAL_UINT64(80, contact_schedule_next_event());
+
+	// Re-adding a removed contact makes it upcoming again
+	TEST_ASSERT_EQUAL(UPCN_OK, contact_schedule_add(contacts[2]));
+	TEST_ASSERT_EQUAL(UPCN_OK, contact_schedule_add(contacts[2]));
+	TEST_ASSERT_EQUAL_UINT64(30, contact_schedule_next_event());
+	contact_schedule_advance(30);
+	TEST_ASSERT_TRUE(is_started(contacts[2]));
+}
+
+TEST_GROUP_RUNNER(contactSchedule)
+{
+	RUN_TEST_CASE(contactSchedule, advance);
+	RUN_TEST_CASE(contactSchedule, remove);
+}
@@ -3,6 +3,7 @@
 #include "unity_fixture.h"
 
 #include <stdio.h>
+#include <string.h>
 
 
 const uint8_t m1[] = "";
@@ -87,9 +88,44 @@ TEST(crc, crc32)
 	TEST_ASSERT_EQUAL_HEX32(0xee7f4af1, crc.checksum);
 }
 
+TEST(crc, crc_copy_bytes)
+{
+	const enum crc_version versions[] = {
+		CRC16_X25, CRC16_CCITT_FALSE, CRC32,
+	};
+	const uint32_t expected[] = { 0xffce, 0x3b8b, 0xee7f4af1 };
+	const size_t len = sizeof(m4) - 1;
+	uint8_t buffer[sizeof(m4)];
+	struct crc_stream crc;
+	size_t split;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		// Copying in two parts of all possible sizes must yield the
+		// same checksum as feeding the data at once
+		for (split = 0; split <= len; split++) {
+			memset(buffer, 0, sizeof(buffer));
+			crc_init(&crc, versions[i]);
+			crc_copy_bytes(&crc, buffer, m4, split);
+			crc_copy_bytes(&crc, buffer + split, m4 + split,
+				len - split);
+			crc.feed_eof(&crc);
+
+			TEST_ASSERT_EQUAL_HEX32(expected[i], crc.checksum);
+			TEST_ASSERT_EQUAL_MEMORY(m4, buffer, len);
+		}
+
+		crc_init(&crc, versions[i]);
+		crc_feed_bytes(&crc, m4, len);
+		crc.feed_eof(&crc);
+		TEST_ASSERT_EQUAL_HEX32(expected[i], crc.checksum);
+	}
+}
+
 TEST_GROUP_RUNNER(crc)
 {
 	RUN_TEST_CASE(crc, crc16_x25);
 	RUN_TEST_CASE(crc, crc16_ccitt_false);
 	RUN_TEST_CASE(crc, crc32);
+	RUN_TEST_CASE(crc, crc_copy_bytes);
 }
@@ -0,0 +1,161 @@
+#include "bundle6/create.h"
+#include "bundle6/cteb.h"
+#include "bundle6/reports.h"
+
+#include "upcn/bundle.h"
+#include "upcn/custody_aggregator.h"
+#include "upcn/report_manager.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+TEST_GROUP(custodyAggregator);
+
+static struct custody_aggregator *aggregator;
+
+static const struct bundle_custody_signal acceptance = {
+	.type = BUNDLE_CS_TYPE_ACCEPTANCE,
+	.reason = BUNDLE_CS_REASON_NO_INFO,
+};
+
+static void add(const char *custodian, uint64_t custody_id)
+{
+	TEST_ASSERT_EQUAL(UPCN_OK, custody_aggregator_add(
+		aggregator, custodian, &acceptance, custody_id, 1000));
+}
+
+TEST_SETUP(custodyAggregator)
+{
+	aggregator = custody_aggregator_create(4);
+	TEST_ASSERT_NOT_NULL(aggregator);
+}
+
+TEST_TEAR_DOWN(custodyAggregator)
+{
+	custody_aggregator_free(aggregator);
+}
+
+TEST(custodyAggregator, fills)
+{
+	struct custody_aggregate *a;
+
+	// In order, out of order, duplicate and closing a gap
+	add("dtn://a.dtn", 1);
+	add("dtn://a.dtn", 2);
+	add("dtn://a.dtn", 3);
+	add("dtn://a.dtn", 10);
+	add("dtn://a.dtn", 5);
+	add("dtn://a.dtn", 2);
+	add("dtn://a.dtn", 4);
+	add("dtn://a.dtn", 9);
+
+	TEST_ASSERT_EQUAL_UINT64(1000,
+				 custody_aggregator_next_deadline(aggregator));
+	TEST_ASSERT_NULL(custody_aggregator_pop_due(aggregator, 999));
+	a = custody_aggregator_pop_due(aggregator, 1000);
+	TEST_ASSERT_NOT_NULL(a);
+	TEST_ASSERT_EQUAL_STRING("dtn://a.dtn", a->custodian);
+	TEST_ASSERT_EQUAL_UINT32(2, a->fill_count);
+	TEST_ASSERT_EQUAL_UINT64(1, a->fills[0].start);
+	TEST_ASSERT_EQUAL_UINT64(5, a->fills[0].length);
+	TEST_ASSERT_EQUAL_UINT64(9, a->fills[1].start);
+	TEST_ASSERT_EQUAL_UINT64(2, a->fills[1].length);
+	custody_aggregate_free(a);
+	TEST_ASSERT_EQUAL_UINT64(UINT64_MAX,
+				 custody_aggregator_next_deadline(aggregator));
+}
+
+TEST(custodyAggregator, max_fills)
+{
+	struct custody_aggregate *a;
+	uint64_t i;
+
+	for (i = 0; i < 3; i++) {
+		add("dtn://a.dtn", i * 2);
+		add("dtn://b.dtn", i);
+	}
+	TEST_ASSERT_NULL(custody_aggregator_pop_due(aggregator, 0));
+
+	// The fourth fill makes the aggregate for a due
+	add("dtn://a.dtn", 6);
+	a = custody_aggregator_pop_due(aggregator, 0);
+	TEST_ASSERT_NOT_NULL(a);
+	TEST_ASSERT_EQUAL_STRING("dtn://a.dtn", a->custodian);
+	TEST_ASSERT_EQUAL_UINT32(4, a->fill_count);
+	custody_aggregate_free(a);
+	TEST_ASSERT_NULL(custody_aggregator_pop_due(aggregator, 0));
+}
+
+TEST(custodyAggregator, acs_roundtrip)
+{
+	const struct bundle_acs_fill fills[] = {
+		{ .start = 3, .length = 2 },
+		{ .start = 200, .length = 1 },
+		{ .start = 1000000, .length = 300 },
+	};
+	struct bundle *b = bundle6_generate_aggregate_custody_signal(
+		"dtn://custodian.dtn", &acceptance, fills, 3,
+		"dtn://upcn.dtn", 100);
+	struct bundle_administrative_record *record;
+
+	TEST_ASSERT_NOT_NULL(b);
+	TEST_ASSERT_EQUAL_STRING("dtn://custodian.dtn", b->destination);
+	record = bundle6_parse_administrative_record(
+		b->payload_block->data, b->payload_block->length);
+	TEST_ASSERT_NOT_NULL(record);
+	TEST_ASSERT_EQUAL(BUNDLE_AR_AGGREGATE_CUSTODY_SIGNAL, record->type);
+	TEST_ASSERT_EQUAL(BUNDLE_CS_TYPE_ACCEPTANCE,
+			  record->custody_signal->type);
+	TEST_ASSERT_EQUAL_UINT32(3, record->acs_fill_count);
+	TEST_ASSERT_EQUAL_MEMORY(fills, record->acs_fills, sizeof(fills));
+	free_administrative_record(record);
+
+	// Truncated in the middle of a fill
+	record = bundle6_parse_administrative_record(
+		b->payload_block->data, b->payload_block->length - 1);
+	TEST_ASSERT_NULL(record);
+	bundle_free(b);
+}
+
+TEST(custodyAggregator, cteb)
+{
+	struct bundle *b = bundle6_create_local(
+		NULL, 0, "dtn://source.dtn", "dtn://sink.dtn", 1, 100, 0);
+	uint64_t custody_id;
+
+	TEST_ASSERT_NOT_NULL(b);
+	TEST_ASSERT_FALSE(bundle6_cteb_get_custody_id(b, &custody_id));
+	free(b->current_custodian);
+	b->current_custodian = strdup("dtn://custodian.dtn");
+
+	TEST_ASSERT_EQUAL(UPCN_OK,
+			  bundle6_cteb_set(b, 1234, "dtn://custodian.dtn"));
+	TEST_ASSERT_TRUE(bundle6_cteb_get_custody_id(b, &custody_id));
+	TEST_ASSERT_EQUAL_UINT64(1234, custody_id);
+	// The payload block stays the last block
+	TEST_ASSERT_EQUAL_PTR(b->payload_block, b->blocks->next->data);
+
+	// Replaced, not added
+	TEST_ASSERT_EQUAL(UPCN_OK,
+			  bundle6_cteb_set(b, 5678, "dtn://custodian.dtn"));
+	TEST_ASSERT_TRUE(bundle6_cteb_get_custody_id(b, &custody_id));
+	TEST_ASSERT_EQUAL_UINT64(5678, custody_id);
+	TEST_ASSERT_EQUAL_PTR(b->payload_block, b->blocks->next->data);
+
+	// Not valid if added by another custodian
+	TEST_ASSERT_EQUAL(UPCN_OK,
+			  bundle6_cteb_set(b, 5678, "dtn://other.dtn"));
+	TEST_ASSERT_FALSE(bundle6_cteb_get_custody_id(b, &custody_id));
+	bundle_free(b);
+}
+
+TEST_GROUP_RUNNER(custodyAggregator)
+{
+	RUN_TEST_CASE(custodyAggregator, fills);
+	RUN_TEST_CASE(custodyAggregator, max_fills);
+	RUN_TEST_CASE(custodyAggregator, acs_roundtrip);
+	RUN_TEST_CASE(custodyAggregator, cteb);
+}
@@ -0,0 +1,130 @@
+#include "upcn/eid_index.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+TEST_GROUP(eidIndex);
+
+#define MAX_MATCHES 8
+
+static struct eid_index *idx;
+static int values[8];
+static void *matches[MAX_MATCHES];
+
+static const char *const keys[] = {
+	"dtn://a.dtn",
+	"dtn://a.dtn/*",
+	"dtn://ab.dtn",
+	"dtn://*",
+	"ipn:100.1",
+	"ipn:100.*",
+	"ipn:50-150.*",
+	"*",
+};
+
+TEST_SETUP(eidIndex)
+{
+	int i;
+
+	idx = eid_index_create();
+	TEST_ASSERT_NOT_NULL(idx);
+	for (i = 0; i < 8; i++)
+		TEST_ASSERT_EQUAL(UPCN_OK,
+				  eid_index_add(idx, keys[i], &values[i]));
+}
+
+TEST_TEAR_DOWN(eidIndex)
+{
+	eid_index_free(idx);
+}
+
+TEST(eidIndex, add_get_remove)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		TEST_ASSERT_EQUAL_PTR(&values[i], eid_index_get(idx, keys[i]));
+	TEST_ASSERT_EQUAL(UPCN_FAIL, eid_index_add(idx, "ipn:100.*", idx));
+	TEST_ASSERT_EQUAL(UPCN_FAIL, eid_index_add(idx, "dtn://*", idx));
+	TEST_ASSERT_NULL(eid_index_get(idx, "dtn://"));
+	TEST_ASSERT_NULL(eid_index_get(idx, "dtn://a"));
+	TEST_ASSERT_NULL(eid_index_get(idx, "ipn:100.2"));
+
+	// Removing keys merges the trie nodes again
+	TEST_ASSERT_EQUAL_PTR(&values[0], eid_index_remove(idx, keys[0]));
+	TEST_ASSERT_NULL(eid_index_remove(idx, keys[0]));
+	TEST_ASSERT_EQUAL_PTR(&values[2], eid_index_remove(idx, keys[2]));
+	TEST_ASSERT_EQUAL_PTR(&values[1], eid_index_get(idx, keys[1]));
+	TEST_ASSERT_EQUAL_PTR(&values[6], eid_index_remove(idx, keys[6]));
+	TEST_ASSERT_NULL(eid_index_get(idx, keys[6]));
+	TEST_ASSERT_EQUAL_PTR(&values[5], eid_index_get(idx, keys[5]));
+	TEST_ASSERT_EQUAL(UPCN_OK, eid_index_add(idx, keys[2], &values[2]));
+	TEST_ASSERT_EQUAL_PTR(&values[2], eid_index_get(idx, keys[2]));
+}
+
+TEST(eidIndex, lookup)
+{
+	// The most specific matches come first
+	TEST_ASSERT_EQUAL_UINT8(4, eid_index_lookup(
+		idx, "dtn://a.dtn", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(&values[0], matches[0]);
+	TEST_ASSERT_EQUAL_PTR(&values[1], matches[1]);
+	TEST_ASSERT_EQUAL_PTR(&values[3], matches[2]);
+	TEST_ASSERT_EQUAL_PTR(&values[7], matches[3]);
+
+	TEST_ASSERT_EQUAL_UINT8(3, eid_index_lookup(
+		idx, "dtn://a.dtn/app", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(&values[1], matches[0]);
+
+	TEST_ASSERT_EQUAL_UINT8(2, eid_index_lookup(
+		idx, "dtn://abc.dtn", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(&values[3], matches[0]);
+
+	// Also if no trie node ends with the node EID
+	TEST_ASSERT_EQUAL(UPCN_OK, eid_index_add(idx, "dtn://b.dtn/*", idx));
+	TEST_ASSERT_EQUAL_UINT8(3, eid_index_lookup(
+		idx, "dtn://b.dtn", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(idx, matches[0]);
+
+	TEST_ASSERT_EQUAL_UINT8(4, eid_index_lookup(
+		idx, "ipn:100.1", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(&values[4], matches[0]);
+	TEST_ASSERT_EQUAL_PTR(&values[5], matches[1]);
+	TEST_ASSERT_EQUAL_PTR(&values[6], matches[2]);
+	TEST_ASSERT_EQUAL_PTR(&values[7], matches[3]);
+
+	TEST_ASSERT_EQUAL_UINT8(2, eid_index_lookup(
+		idx, "ipn:150.3", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_PTR(&values[6], matches[0]);
+	TEST_ASSERT_EQUAL_UINT8(1, eid_index_lookup(
+		idx, "ipn:151.3", matches, MAX_MATCHES));
+	TEST_ASSERT_EQUAL_UINT8(1, eid_index_lookup(
+		idx, "ipn:100.*", matches, 1));
+}
+
+TEST(eidIndex, matches)
+{
+	TEST_ASSERT_TRUE(eid_is_pattern("dtn://a.dtn/*"));
+	TEST_ASSERT_TRUE(eid_is_pattern("ipn:1-2.*"));
+	TEST_ASSERT_FALSE(eid_is_pattern("ipn:1.2"));
+	TEST_ASSERT_FALSE(eid_is_pattern("dtn://a.dtn"));
+
+	TEST_ASSERT_TRUE(eid_matches("dtn://a.dtn/*", "dtn://a.dtn"));
+	TEST_ASSERT_TRUE(eid_matches("dtn://a.dtn/*", "dtn://a.dtn/x"));
+	TEST_ASSERT_FALSE(eid_matches("dtn://a.dtn/*", "dtn://a.dtnx"));
+	TEST_ASSERT_TRUE(eid_matches("ipn:1-2.*", "ipn:2.7"));
+	TEST_ASSERT_FALSE(eid_matches("ipn:1-2.*", "ipn:3.7"));
+	TEST_ASSERT_FALSE(eid_matches("ipn:2-1.*", "ipn:2.7"));
+	TEST_ASSERT_TRUE(eid_matches("ipn:1.2", "ipn:01.2"));
+	TEST_ASSERT_TRUE(eid_matches("*", "ipn:3.7"));
+	TEST_ASSERT_FALSE(eid_matches("dtn://a.dtn", "dtn://a.dtn/x"));
+}
+
+TEST_GROUP_RUNNER(eidIndex)
+{
+	RUN_TEST_CASE(eidIndex, add_get_remove);
+	RUN_TEST_CASE(eidIndex, lookup);
+	RUN_TEST_CASE(eidIndex, matches);
+}
@@ -0,0 +1,118 @@
+#include "upcn/bundle.h"
+#include "upcn/known_bundle_set.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+TEST_GROUP(knownBundleSet);
+
+static struct known_bundle_set *set;
+
+static struct bundle_unique_identifier make_id(uint64_t seqnum)
+{
+	return (struct bundle_unique_identifier){
+		.protocol_version = 7,
+		.source = "dtn://source.dtn",
+		.creation_timestamp = 42,
+		.sequence_number = seqnum,
+		.fragment_offset = 0,
+		.payload_length = 100,
+	};
+}
+
+TEST_SETUP(knownBundleSet)
+{
+	set = known_bundle_set_create(0, 0, 0);
+	TEST_ASSERT_NOT_NULL(set);
+}
+
+TEST_TEAR_DOWN(knownBundleSet)
+{
+	known_bundle_set_free(set);
+}
+
+TEST(knownBundleSet, add_contains)
+{
+	struct bundle_unique_identifier id = make_id(1);
+	char source[] = "dtn://source.dtn";
+
+	TEST_ASSERT_FALSE(known_bundle_set_contains(set, &id));
+	TEST_ASSERT_EQUAL(UPCN_OK, known_bundle_set_add(set, &id, 100));
+	TEST_ASSERT_TRUE(known_bundle_set_contains(set, &id));
+
+	// The source EID is compared by value
+	id.source = source;
+	TEST_ASSERT_TRUE(known_bundle_set_contains(set, &id));
+
+	id.fragment_offset = 10;
+	TEST_ASSERT_FALSE(known_bundle_set_contains(set, &id));
+	id = make_id(2);
+	TEST_ASSERT_FALSE(known_bundle_set_contains(set, &id));
+}
+
+TEST(knownBundleSet, expire)
+{
+	struct bundle_unique_identifier id;
+	uint64_t i;
+
+	// Insert in non-ascending order of deadlines
+	for (i = 0; i < 1000; i++) {
+		id = make_id(i);
+		known_bundle_set_add(set, &id, (i * 7) % 1000);
+	}
+	TEST_ASSERT_EQUAL_UINT32(1000, known_bundle_set_count(set));
+
+	known_bundle_set_expire(set, 500);
+	TEST_ASSERT_EQUAL_UINT32(500, known_bundle_set_count(set));
+	for (i = 0; i < 1000; i++) {
+		id = make_id(i);
+		TEST_ASSERT_EQUAL((i * 7) % 1000 >= 500,
+				  known_bundle_set_contains(set, &id));
+	}
+
+	known_bundle_set_expire(set, 1000);
+	TEST_ASSERT_EQUAL_UINT32(0, known_bundle_set_count(set));
+}
+
+TEST(knownBundleSet, bounded)
+{
+	struct known_bundle_set *bset = known_bundle_set_create(4, 8, 1024);
+	struct bundle_unique_identifier id;
+	uint64_t i;
+
+	TEST_ASSERT_NOT_NULL(bset);
+	for (i = 0; i < 8; i++) {
+		id = make_id(i);
+		known_bundle_set_add(bset, &id, 100 + i);
+	}
+	// Four stored exactly, four in the Bloom filter
+	for (i = 0; i < 8; i++) {
+		id = make_id(i);
+		TEST_ASSERT_TRUE(known_bundle_set_contains(bset, &id));
+	}
+
+	// The record with the earliest deadline is dropped
+	id = make_id(8);
+	known_bundle_set_add(bset, &id, 200);
+	TEST_ASSERT_EQUAL_UINT32(8, known_bundle_set_count(bset));
+	TEST_ASSERT_TRUE(known_bundle_set_contains(bset, &id));
+	id = make_id(0);
+	TEST_ASSERT_FALSE(known_bundle_set_contains(bset, &id));
+
+	known_bundle_set_expire(bset, 1000);
+	TEST_ASSERT_EQUAL_UINT32(0, known_bundle_set_count(bset));
+	for (i = 0; i < 9; i++) {
+		id = make_id(i);
+		TEST_ASSERT_FALSE(known_bundle_set_contains(bset, &id));
+	}
+	known_bundle_set_free(bset);
+}
+
+TEST_GROUP_RUNNER(knownBundleSet)
+{
+	RUN_TEST_CASE(knownBundleSet, add_contains);
+	RUN_TEST_CASE(knownBundleSet, expire);
+	RUN_TEST_CASE(knownBundleSet, bounded);
+}
@@ -0,0 +1,151 @@
+#include "upcn/common.h"
+#include "upcn/nbf.h"
+#include "upcn/node.h"
+#include "upcn/routing_table.h"
+
+#include "platform/hal_queue.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+TEST_GROUP(nbf);
+
+#define BIT_COUNT 256
+#define HASH_COUNT 4
+
+static const char *const eids[] = {
+	"dtn://a.dtn",
+	"dtn://b.dtn/app",
+	"ipn:100.1",
+	"ipn:100.2",
+};
+
+#define EID_COUNT ARRAY_SIZE(eids)
+
+static struct nbf *a, *b;
+
+static uint32_t count_bits(const struct nbf *nbf)
+{
+	uint32_t i, count = 0;
+
+	for (i = 0; i < nbf->bit_count; i++)
+		count += (nbf->bits[i / 8] >> (i % 8)) & 1;
+	return count;
+}
+
+TEST_SETUP(nbf)
+{
+	a = nbf_create(BIT_COUNT, HASH_COUNT);
+	b = nbf_create(BIT_COUNT, HASH_COUNT);
+	TEST_ASSERT_NOT_NULL(a);
+	TEST_ASSERT_NOT_NULL(b);
+}
+
+TEST_TEAR_DOWN(nbf)
+{
+	nbf_free(a);
+	nbf_free(b);
+}
+
+TEST(nbf, create)
+{
+	TEST_ASSERT_NULL(nbf_create(0, HASH_COUNT));
+	TEST_ASSERT_NULL(nbf_create(BIT_COUNT, 0));
+	TEST_ASSERT_EQUAL_UINT32(0, count_bits(a));
+	TEST_ASSERT_EQUAL_UINT32(2, NBF_BYTE_COUNT(9));
+}
+
+TEST(nbf, add_contains)
+{
+	unsigned int i;
+
+	for (i = 0; i < EID_COUNT; i++)
+		TEST_ASSERT_FALSE(nbf_contains(a, eids[i]));
+	nbf_add(a, eids[0]);
+	TEST_ASSERT_TRUE(count_bits(a) >= 1);
+	TEST_ASSERT_TRUE(count_bits(a) <= HASH_COUNT);
+	TEST_ASSERT_TRUE(nbf_contains(a, eids[0]));
+	for (i = 1; i < EID_COUNT; i++)
+		nbf_add(a, eids[i]);
+	for (i = 0; i < EID_COUNT; i++)
+		TEST_ASSERT_TRUE(nbf_contains(a, eids[i]));
+	TEST_ASSERT_FALSE(nbf_contains(a, "dtn://c.dtn"));
+}
+
+TEST(nbf, merge)
+{
+	struct nbf *const other = nbf_create(BIT_COUNT, HASH_COUNT + 1);
+
+	nbf_add(a, eids[0]);
+	nbf_add(b, eids[1]);
+	TEST_ASSERT_EQUAL(UPCN_OK, nbf_merge(a, b));
+	TEST_ASSERT_TRUE(nbf_contains(a, eids[0]));
+	TEST_ASSERT_TRUE(nbf_contains(a, eids[1]));
+	TEST_ASSERT_FALSE(nbf_contains(b, eids[0]));
+
+	// Filters with other parameters cannot be merged
+	TEST_ASSERT_EQUAL(UPCN_FAIL, nbf_merge(a, other));
+	nbf_free(other);
+}
+
+TEST(nbf, routing_table_lookup)
+{
+	QueueIdentifier_t sig_queue = hal_queue_create(10, 6);
+	struct node *n1 = node_create("dtn://n1.dtn");
+	struct node *n2 = node_create("dtn://n2.dtn");
+	struct node *n1_update = node_create("dtn://n1.dtn");
+	struct node *n1_delete = node_create("dtn://n1.dtn");
+	struct node *found[2];
+
+	routing_table_init();
+	n1->cla_addr = strdup("cla:addr1");
+	n2->cla_addr = strdup("cla:addr2");
+	n1_update->cla_addr = strdup("");
+	nbf_add(a, eids[0]);
+	nbf_add(b, eids[1]);
+	n1->nbf = a;
+	n2->nbf = b;
+	n1_update->nbf = nbf_create(BIT_COUNT, HASH_COUNT);
+	nbf_add(n1_update->nbf, eids[2]);
+	a = b = NULL;
+
+	routing_table_add_node(n1, sig_queue);
+	routing_table_add_node(n2, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(1, routing_table_lookup_eid_in_nbf(
+		eids[0], found, 2));
+	TEST_ASSERT_EQUAL_PTR(n1, found[0]);
+	TEST_ASSERT_EQUAL_UINT8(1, routing_table_lookup_eid_in_nbf(
+		eids[1], found, 2));
+	TEST_ASSERT_EQUAL_PTR(n2, found[0]);
+	TEST_ASSERT_EQUAL_UINT8(0, routing_table_lookup_eid_in_nbf(
+		eids[2], found, 2));
+
+	// Adding to an existing node merges the filters
+	routing_table_add_node(n1_update, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(1, routing_table_lookup_eid_in_nbf(
+		eids[2], found, 2));
+	TEST_ASSERT_EQUAL_PTR(n1, found[0]);
+	TEST_ASSERT_TRUE(nbf_contains(n1->nbf, eids[0]));
+
+	// Partial deletions carrying a filter release it
+	n1_delete->endpoints = malloc(sizeof(struct endpoint_list));
+	n1_delete->endpoints->eid = strdup("dtn://ep.dtn");
+	n1_delete->endpoints->next = NULL;
+	n1_delete->nbf = nbf_create(BIT_COUNT, HASH_COUNT);
+	TEST_ASSERT_EQUAL_INT(1, routing_table_delete_node(n1_delete,
+							   sig_queue));
+
+	routing_table_free();
+	hal_queue_delete(sig_queue);
+}
+
+TEST_GROUP_RUNNER(nbf)
+{
+	RUN_TEST_CASE(nbf, create);
+	RUN_TEST_CASE(nbf, add_contains);
+	RUN_TEST_CASE(nbf, merge);
+	RUN_TEST_CASE(nbf, routing_table_lookup);
+}
@@ -14,7 +14,7 @@ static struct endpoint_list *some_eids2;
 static struct contact_list *some_ct1;
 static struct contact_list *some_ct2;
 
-static struct contact *createct(uint64_t from, uint64_t to, uint16_t bitrate)
+static struct contact *createct(uint64_t from, uint64_t to, uint32_t bitrate)
 {
 	struct contact *c = contact_create(NULL);
 
@@ -77,27 +77,44 @@ TEST_TEAR_DOWN(node)
 TEST(node, contact)
 {
 	/* capacity */
-	TEST_ASSERT_EQUAL_UINT32(500, some_ct1->next->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(500,
+	TEST_ASSERT_EQUAL_UINT64(500, some_ct1->next->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(500,
 		some_ct1->next->data->remaining_capacity_p0);
 	/* re-calculation accuracy */
 	recalculate_contact_capacity(some_ct1->next->data);
 	recalculate_contact_capacity(some_ct1->next->data);
-	TEST_ASSERT_EQUAL_UINT32(500, some_ct1->next->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(500,
+	TEST_ASSERT_EQUAL_UINT64(500, some_ct1->next->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(500,
 		some_ct1->next->data->remaining_capacity_p0);
 	/* remaining cap */
 	hal_time_init(0);
-	TEST_ASSERT_EQUAL_INT32(600,
+	TEST_ASSERT_EQUAL_INT64(600,
 		contact_get_cur_remaining_capacity(some_ct1->data, 0));
+	/* The capacity is determined with a resolution of milliseconds */
 	hal_time_init(2);
-	TEST_ASSERT_EQUAL_INT32(300,
+	TEST_ASSERT_EQUAL_INT64(300,
 		contact_get_cur_remaining_capacity(some_ct1->data, 0));
 	hal_time_init(3);
-	TEST_ASSERT_EQUAL_INT32(0,
+	TEST_ASSERT_EQUAL_INT64(0,
 		contact_get_cur_remaining_capacity(some_ct1->data, 0));
 }
 
+TEST(node, contact_capacity_64bit)
+{
+	/* 20 s at 1 Gbit/s */
+	struct contact *c = createct(10, 30, 125000000);
+
+	TEST_ASSERT_EQUAL_UINT64(2500000000, c->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(2500000000, c->remaining_capacity_p2);
+	hal_time_init(0);
+	TEST_ASSERT_EQUAL_INT64(2500000000,
+		contact_get_cur_remaining_capacity(c, 2));
+	hal_time_init(20);
+	TEST_ASSERT_UINT64_WITHIN(1000000, 1250000000,
+		contact_get_cur_remaining_capacity(c, 2));
+	free_contact(c);
+}
+
 static void assert_in_eidlist(char *eid, struct endpoint_list *l)
 {
 	int r = 0;
@@ -144,14 +161,14 @@ TEST(node, contact_list_union)
 	TEST_ASSERT_EQUAL_UINT64(1, some_ct1->data->from);
 	TEST_ASSERT_EQUAL_UINT64(3, some_ct1->data->to);
 	TEST_ASSERT_EQUAL_UINT16(300, some_ct1->data->bitrate);
-	TEST_ASSERT_EQUAL_UINT32(600, some_ct1->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(
+	TEST_ASSERT_EQUAL_UINT64(600, some_ct1->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(
 		600, some_ct1->data->remaining_capacity_p0);
 	TEST_ASSERT_EQUAL_HEX64(0x100000000, some_ct1->next->data->from);
 	TEST_ASSERT_EQUAL_HEX64(0x100000001, some_ct1->next->data->to);
 	TEST_ASSERT_EQUAL_UINT16(600, some_ct1->next->data->bitrate);
-	TEST_ASSERT_EQUAL_UINT32(600, some_ct1->next->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(600,
+	TEST_ASSERT_EQUAL_UINT64(600, some_ct1->next->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(600,
 		some_ct1->next->data->remaining_capacity_p0);
 	TEST_ASSERT_NOT_NULL(mod);
 	TEST_ASSERT_NULL(mod->next);
@@ -171,16 +188,16 @@ TEST(node, contact_list_difference)
 	TEST_ASSERT_EQUAL_UINT64(1, some_ct1->data->from);
 	TEST_ASSERT_EQUAL_UINT64(3, some_ct1->data->to);
 	TEST_ASSERT_EQUAL_UINT16(300, some_ct1->data->bitrate);
-	TEST_ASSERT_EQUAL_UINT32(600, some_ct1->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(600, some_ct1->data->remaining_capacity_p0);
+	TEST_ASSERT_EQUAL_UINT64(600, some_ct1->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(600, some_ct1->data->remaining_capacity_p0);
 	TEST_ASSERT_NULL(mod);
 	TEST_ASSERT_NOT_NULL(del);
 	TEST_ASSERT_NULL(del->next);
 	TEST_ASSERT_EQUAL_HEX64(0x100000000, del->data->from);
 	TEST_ASSERT_EQUAL_HEX64(0x100000001, del->data->to);
 	TEST_ASSERT_EQUAL_UINT16(500, del->data->bitrate);
-	TEST_ASSERT_EQUAL_UINT32(500, del->data->total_capacity);
-	TEST_ASSERT_EQUAL_INT32(500, del->data->remaining_capacity_p0);
+	TEST_ASSERT_EQUAL_UINT64(500, del->data->total_capacity);
+	TEST_ASSERT_EQUAL_INT64(500, del->data->remaining_capacity_p0);
 	del = contact_list_free(del);
 	TEST_ASSERT_NULL(del);
 }
@@ -229,12 +246,56 @@ TEST(node, add_contact_to_ordered_list)
 	free_contact(c3);
 }
 
+TEST(node, contact_bundle_queues)
+{
+	struct contact *c1 = createct(100, 500, 1);
+	struct contact *c2 = createct(200, 600, 1);
+	struct routed_bundle rbs[200];
+	struct routed_bundle_list *l, *next;
+	int i;
+
+	for (i = 0; i < 200; i++) {
+		rbs[i].id = i;
+		rbs[i].prio = i % BUNDLE_RPRIO_MAX;
+		TEST_ASSERT_EQUAL(UPCN_OK, contact_enqueue_bundle(c1, &rbs[i]));
+	}
+	TEST_ASSERT_EQUAL(UPCN_OK, contact_enqueue_bundle(c2, &rbs[0]));
+	TEST_ASSERT_EQUAL_UINT32(200, c1->bundle_count);
+	TEST_ASSERT_EQUAL_PTR(&rbs[2], contact_first_bundle(c1));
+	/* Removal is per contact */
+	TEST_ASSERT_EQUAL_PTR(&rbs[0], contact_dequeue_bundle(c2, 0));
+	TEST_ASSERT_NULL(contact_dequeue_bundle(c2, 0));
+	TEST_ASSERT_NULL(contact_first_bundle(c2));
+	for (i = 2; i < 200; i += 3)
+		TEST_ASSERT_EQUAL_PTR(&rbs[i], contact_dequeue_bundle(c1, i));
+	TEST_ASSERT_NULL(contact_dequeue_bundle(c1, 2));
+	TEST_ASSERT_EQUAL_PTR(&rbs[1], contact_first_bundle(c1));
+	/* Taken in the order of priority, FIFO within a priority */
+	l = contact_take_bundles(c1);
+	TEST_ASSERT_EQUAL_UINT32(0, c1->bundle_count);
+	TEST_ASSERT_NULL(contact_dequeue_bundle(c1, 1));
+	for (i = 0; l != NULL; i++, l = next) {
+		if (i < 67) {
+			TEST_ASSERT_EQUAL_PTR(&rbs[1 + 3 * i], l->data);
+		} else {
+			TEST_ASSERT_EQUAL_PTR(&rbs[3 * (i - 67)], l->data);
+		}
+		next = l->next;
+		free(l);
+	}
+	TEST_ASSERT_EQUAL_INT(134, i);
+	free_contact(c1);
+	free_contact(c2);
+}
+
 TEST_GROUP_RUNNER(node)
 {
 	RUN_TEST_CASE(node, contact);
+	RUN_TEST_CASE(node, contact_capacity_64bit);
 	RUN_TEST_CASE(node, endpoint_list_difference);
 	RUN_TEST_CASE(node, endpoint_list_union);
 	RUN_TEST_CASE(node, contact_list_union);
 	RUN_TEST_CASE(node, contact_list_difference);
 	RUN_TEST_CASE(node, add_contact_to_ordered_list);
+	RUN_TEST_CASE(node, contact_bundle_queues);
 }
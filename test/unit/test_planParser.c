@@ -0,0 +1,155 @@
+#include "agents/plan_parser.h"
+
+#include "upcn/nbf.h"
+#include "upcn/node.h"
+#include "upcn/router_task.h"
+
+#include "platform/hal_time.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+TEST_GROUP(planParser);
+
+/*
+ * [0, [
+ *   [1, "dtn://a", 500, "tcp:1", ["dtn://x"],
+ *    [[10, 20, 100, ["dtn://y"]], [30, 40, 200, []]]],
+ *   [3, "dtn://b", 0, "", [], []]
+ * ]]
+ */
+static const uint8_t delta_plan[] = {
+	0x82, 0x00, 0x82, 0x86, 0x01, 0x67, 0x64, 0x74,
+	0x6e, 0x3a, 0x2f, 0x2f, 0x61, 0x19, 0x01, 0xf4,
+	0x65, 0x74, 0x63, 0x70, 0x3a, 0x31, 0x81, 0x67,
+	0x64, 0x74, 0x6e, 0x3a, 0x2f, 0x2f, 0x78, 0x82,
+	0x84, 0x0a, 0x14, 0x18, 0x64, 0x81, 0x67, 0x64,
+	0x74, 0x6e, 0x3a, 0x2f, 0x2f, 0x79, 0x84, 0x18,
+	0x1e, 0x18, 0x28, 0x18, 0xc8, 0x80, 0x86, 0x03,
+	0x67, 0x64, 0x74, 0x6e, 0x3a, 0x2f, 0x2f, 0x62,
+	0x00, 0x60, 0x80, 0x80,
+};
+
+/* [1, [[2, "dtn://c", 0, "tcp:2", [], [], [16, 2, h'8102']]]] */
+static const uint8_t full_plan[] = {
+	0x82, 0x01, 0x81, 0x87, 0x02, 0x67, 0x64, 0x74,
+	0x6e, 0x3a, 0x2f, 0x2f, 0x63, 0x00, 0x65, 0x74,
+	0x63, 0x70, 0x3a, 0x32, 0x80, 0x80, 0x83, 0x10,
+	0x02, 0x42, 0x81, 0x02,
+};
+
+static struct router_plan *plan;
+
+TEST_SETUP(planParser)
+{
+	hal_time_init(0);
+	plan = NULL;
+}
+
+TEST_TEAR_DOWN(planParser)
+{
+	router_plan_free(plan);
+}
+
+TEST(planParser, is_plan)
+{
+	const uint8_t text_command[] = "1(dtn://a):(tcp:1)::;";
+
+	TEST_ASSERT_TRUE(plan_parser_is_plan(delta_plan, sizeof(delta_plan)));
+	TEST_ASSERT_FALSE(plan_parser_is_plan(text_command,
+					      sizeof(text_command) - 1));
+	TEST_ASSERT_FALSE(plan_parser_is_plan(delta_plan, 0));
+}
+
+TEST(planParser, parse_delta)
+{
+	struct node *node;
+	struct contact *contact;
+
+	plan = plan_parser_parse(delta_plan, sizeof(delta_plan));
+	TEST_ASSERT_NOT_NULL(plan);
+	TEST_ASSERT_FALSE(plan->full);
+	TEST_ASSERT_EQUAL_UINT32(2, plan->command_count);
+
+	TEST_ASSERT_EQUAL(ROUTER_COMMAND_ADD, plan->commands[0].type);
+	node = plan->commands[0].data;
+	TEST_ASSERT_EQUAL_STRING("dtn://a", node->eid);
+	TEST_ASSERT_EQUAL_STRING("tcp:1", node->cla_addr);
+	TEST_ASSERT_TRUE(node->reliability == 0.5f);
+	TEST_ASSERT_EQUAL_STRING("dtn://x", node->endpoints->eid);
+	TEST_ASSERT_NULL(node->endpoints->next);
+	TEST_ASSERT_NULL(node->nbf);
+	TEST_ASSERT_TRUE(node_prepare_and_verify(node));
+	contact = node->contacts->data;
+	TEST_ASSERT_EQUAL_PTR(node, contact->node);
+	TEST_ASSERT_EQUAL_UINT64(10, contact->from);
+	TEST_ASSERT_EQUAL_UINT64(20, contact->to);
+	TEST_ASSERT_EQUAL_UINT32(100, contact->bitrate);
+	TEST_ASSERT_EQUAL_STRING("dtn://y", contact->contact_endpoints->eid);
+	contact = node->contacts->next->data;
+	TEST_ASSERT_EQUAL_UINT64(30, contact->from);
+	TEST_ASSERT_NULL(contact->contact_endpoints);
+	TEST_ASSERT_NULL(node->contacts->next->next);
+
+	TEST_ASSERT_EQUAL(ROUTER_COMMAND_DELETE, plan->commands[1].type);
+	node = plan->commands[1].data;
+	TEST_ASSERT_EQUAL_STRING("dtn://b", node->eid);
+	TEST_ASSERT_EQUAL_STRING("", node->cla_addr);
+	TEST_ASSERT_TRUE(node->reliability == 1.0f);
+	TEST_ASSERT_NULL(node->endpoints);
+	TEST_ASSERT_NULL(node->contacts);
+}
+
+TEST(planParser, parse_full_with_nbf)
+{
+	struct node *node;
+
+	plan = plan_parser_parse(full_plan, sizeof(full_plan));
+	TEST_ASSERT_NOT_NULL(plan);
+	TEST_ASSERT_TRUE(plan->full);
+	TEST_ASSERT_EQUAL_UINT32(1, plan->command_count);
+	TEST_ASSERT_EQUAL(ROUTER_COMMAND_UPDATE, plan->commands[0].type);
+	node = plan->commands[0].data;
+	TEST_ASSERT_NOT_NULL(node->nbf);
+	TEST_ASSERT_EQUAL_UINT32(16, node->nbf->bit_count);
+	TEST_ASSERT_EQUAL_UINT8(2, node->nbf->hash_count);
+	TEST_ASSERT_EQUAL_HEX8(0x81, node->nbf->bits[0]);
+	TEST_ASSERT_EQUAL_HEX8(0x02, node->nbf->bits[1]);
+}
+
+TEST(planParser, parse_invalid)
+{
+	uint8_t buffer[sizeof(delta_plan) + 1];
+
+	// Truncated plans and trailing data are rejected
+	TEST_ASSERT_NULL(plan_parser_parse(delta_plan, sizeof(delta_plan) - 1));
+	memcpy(buffer, delta_plan, sizeof(delta_plan));
+	buffer[sizeof(delta_plan)] = 0x00;
+	TEST_ASSERT_NULL(plan_parser_parse(buffer, sizeof(buffer)));
+
+	// Reliability of 4 per mille
+	memcpy(buffer, delta_plan, sizeof(delta_plan));
+	buffer[64] = 0x04;
+	TEST_ASSERT_NULL(plan_parser_parse(buffer, sizeof(delta_plan)));
+
+	// Unknown command type
+	memcpy(buffer, delta_plan, sizeof(delta_plan));
+	buffer[55] = 0x04;
+	TEST_ASSERT_NULL(plan_parser_parse(buffer, sizeof(delta_plan)));
+
+	// Contact ending before it starts
+	memcpy(buffer, delta_plan, sizeof(delta_plan));
+	buffer[34] = 0x09;
+	TEST_ASSERT_NULL(plan_parser_parse(buffer, sizeof(delta_plan)));
+}
+
+TEST_GROUP_RUNNER(planParser)
+{
+	RUN_TEST_CASE(planParser, is_plan);
+	RUN_TEST_CASE(planParser, parse_delta);
+	RUN_TEST_CASE(planParser, parse_full_with_nbf);
+	RUN_TEST_CASE(planParser, parse_invalid);
+}
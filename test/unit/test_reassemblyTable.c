@@ -0,0 +1,229 @@
+#include "upcn/bundle.h"
+#include "upcn/config.h"
+#include "upcn/reassembly_table.h"
+#include "upcn/result.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ADU_LENGTH 64
+
+TEST_GROUP(reassemblyTable);
+
+static struct reassembly_table *table;
+static uint8_t adu_data[ADU_LENGTH];
+
+static struct bundle *create_fragment(uint64_t seqnum, uint32_t offset,
+				      uint32_t length)
+{
+	struct bundle *b = bundle_init();
+
+	b->protocol_version = 7;
+	b->proc_flags = BUNDLE_FLAG_IS_FRAGMENT;
+	b->source = strdup("dtn://source.dtn");
+	b->destination = strdup("dtn://upcn.dtn/sink");
+	b->creation_timestamp = 42;
+	b->sequence_number = seqnum;
+	b->fragment_offset = offset;
+	b->total_adu_length = ADU_LENGTH;
+	b->payload_block = bundle_block_create(BUNDLE_BLOCK_TYPE_PAYLOAD);
+	b->payload_block->length = length;
+	b->payload_block->data = malloc(length);
+	memcpy(b->payload_block->data, &adu_data[offset], length);
+	b->blocks = bundle_block_entry_create(b->payload_block);
+	return b;
+}
+
+static enum reassembly_result add_fragment(uint64_t seqnum, uint32_t offset,
+					   uint32_t length,
+					   struct bundle_adu *adu)
+{
+	struct bundle *b = create_fragment(seqnum, offset, length);
+	enum reassembly_result result = reassembly_table_add(table, b, adu);
+
+	bundle_free(b);
+	return result;
+}
+
+/*
+ * Creates a fragment claiming to carry the given amount of bytes, which is
+ * not backed by data. The table takes over payloads without accessing them.
+ */
+static struct bundle *create_large_fragment(uint64_t seqnum, uint32_t length,
+					    uint64_t lifetime_s)
+{
+	struct bundle *b = create_fragment(seqnum, 0, 0);
+
+	b->total_adu_length = (uint32_t)REASSEMBLY_BUFFER_QUOTA + ADU_LENGTH;
+	b->payload_block->length = length;
+	b->lifetime = lifetime_s * 1000000;
+	return b;
+}
+
+static enum reassembly_result add_large_fragment(uint64_t seqnum,
+						 uint32_t length,
+						 uint64_t lifetime_s)
+{
+	struct bundle_adu adu;
+	struct bundle *b = create_large_fragment(seqnum, length, lifetime_s);
+	enum reassembly_result result = reassembly_table_add(table, b, &adu);
+
+	bundle_free(b);
+	return result;
+}
+
+TEST_SETUP(reassemblyTable)
+{
+	int i;
+
+	for (i = 0; i < ADU_LENGTH; i++)
+		adu_data[i] = (uint8_t)(i * 3);
+	table = reassembly_table_create();
+	TEST_ASSERT_NOT_NULL(table);
+}
+
+TEST_TEAR_DOWN(reassemblyTable)
+{
+	reassembly_table_free(table);
+}
+
+TEST(reassemblyTable, in_order)
+{
+	struct bundle_adu adu;
+
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 0, 16, &adu));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 16, 16, &adu));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 32, 16, &adu));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_count(table));
+	TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, add_fragment(1, 48, 16, &adu));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_count(table));
+
+	TEST_ASSERT_EQUAL(ADU_LENGTH, adu.length);
+	// The fragment payloads are handed over without copying
+	TEST_ASSERT_NULL(adu.payload);
+	TEST_ASSERT_EQUAL_UINT32(4, adu.chunk_count);
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_adu_make_contiguous(&adu));
+	TEST_ASSERT_NULL(adu.chunks);
+	TEST_ASSERT_EQUAL_MEMORY(adu_data, adu.payload, ADU_LENGTH);
+	TEST_ASSERT_EQUAL_STRING("dtn://source.dtn", adu.source);
+	TEST_ASSERT_FALSE(HAS_FLAG(adu.proc_flags, BUNDLE_FLAG_IS_FRAGMENT));
+	bundle_adu_free_members(adu);
+}
+
+TEST(reassemblyTable, out_of_order_overlapping)
+{
+	struct bundle_adu adu;
+
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 40, 24, &adu));
+	// Another ADU is reassembled in parallel
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(2, 0, 8, &adu));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 0, 10, &adu));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 20, 10, &adu));
+	TEST_ASSERT_EQUAL_UINT32(2, reassembly_table_count(table));
+	// Duplicates do not complete the ADU
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 20, 10, &adu));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_fragment(1, 0, 30, &adu));
+	// Overlaps all three received ranges
+	TEST_ASSERT_EQUAL(REASSEMBLY_COMPLETE, add_fragment(1, 5, 50, &adu));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_count(table));
+
+	TEST_ASSERT_EQUAL(ADU_LENGTH, adu.length);
+	// Only the exact duplicate has not been taken over
+	TEST_ASSERT_EQUAL_UINT32(5, adu.chunk_count);
+	TEST_ASSERT_EQUAL(UPCN_OK, bundle_adu_make_contiguous(&adu));
+	TEST_ASSERT_EQUAL_MEMORY(adu_data, adu.payload, ADU_LENGTH);
+	bundle_adu_free_members(adu);
+}
+
+TEST(reassemblyTable, invalid_fragment)
+{
+	struct bundle_adu adu;
+	struct bundle *b = create_fragment(3, 32, 32);
+
+	// Exceeds the ADU length
+	b->fragment_offset = 48;
+	TEST_ASSERT_EQUAL(REASSEMBLY_FAILED,
+			  reassembly_table_add(table, b, &adu));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_count(table));
+
+	// Does not match the ADU length of the first fragment
+	b->fragment_offset = 0;
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  reassembly_table_add(table, b, &adu));
+	b->total_adu_length = ADU_LENGTH * 2;
+	TEST_ASSERT_EQUAL(REASSEMBLY_FAILED,
+			  reassembly_table_add(table, b, &adu));
+	bundle_free(b);
+}
+
+TEST(reassemblyTable, large_adu)
+{
+	struct bundle_adu adu;
+	struct bundle *b = create_fragment(4, 0, 16);
+
+	// Only the received chunks are buffered, not the whole ADU
+	b->total_adu_length = (uint32_t)BUNDLE_QUOTA + ADU_LENGTH;
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  reassembly_table_add(table, b, &adu));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_count(table));
+	bundle_free(b);
+}
+
+TEST(reassemblyTable, expire)
+{
+	const uint32_t quota = REASSEMBLY_BUFFER_QUOTA;
+
+	// Expires at 52 s, its last fragment is never received
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(5, quota / 2, 10));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING, add_large_fragment(6, 16, 100));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_expire(table, 51));
+	TEST_ASSERT_EQUAL_UINT32(2, reassembly_table_count(table));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_expire(table, 52));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_count(table));
+
+	// Its buffered bytes are available again without evicting other ADUs
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(7, quota - 16, 100));
+	TEST_ASSERT_EQUAL_UINT32(2, reassembly_table_count(table));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_expire(table, 141));
+	TEST_ASSERT_EQUAL_UINT32(2, reassembly_table_expire(table, 142));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_count(table));
+}
+
+TEST(reassemblyTable, evict)
+{
+	const uint32_t quota = REASSEMBLY_BUFFER_QUOTA;
+
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(5, quota / 4, 100));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(6, quota / 2, 10));
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(7, quota / 4, 1000));
+
+	// The quota is exhausted, the ADU expiring first is dropped
+	TEST_ASSERT_EQUAL(REASSEMBLY_PENDING,
+			  add_large_fragment(8, quota / 2, 1000));
+	TEST_ASSERT_EQUAL_UINT32(3, reassembly_table_count(table));
+	TEST_ASSERT_EQUAL_UINT32(0, reassembly_table_expire(table, 52));
+	TEST_ASSERT_EQUAL_UINT32(1, reassembly_table_expire(table, 142));
+
+	// Fragments exceeding the quota on their own are rejected
+	TEST_ASSERT_EQUAL(REASSEMBLY_FAILED,
+			  add_large_fragment(9, quota + 1, 1000));
+	TEST_ASSERT_EQUAL_UINT32(2, reassembly_table_count(table));
+}
+
+TEST_GROUP_RUNNER(reassemblyTable)
+{
+	RUN_TEST_CASE(reassemblyTable, in_order);
+	RUN_TEST_CASE(reassemblyTable, out_of_order_overlapping);
+	RUN_TEST_CASE(reassemblyTable, invalid_fragment);
+	RUN_TEST_CASE(reassemblyTable, large_adu);
+	RUN_TEST_CASE(reassemblyTable, expire);
+	RUN_TEST_CASE(reassemblyTable, evict);
+}
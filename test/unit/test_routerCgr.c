@@ -0,0 +1,215 @@
+#include "upcn/node.h"
+#include "upcn/router.h"
+#include "upcn/router_cgr.h"
+#include "upcn/routing_table.h"
+
+#include "platform/hal_queue.h"
+#include "platform/hal_time.h"
+
+#include "unity_fixture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TEST_GROUP(routerCgr);
+
+static QueueIdentifier_t sig_queue;
+
+static struct contact *addct(struct node *node, uint64_t from, uint64_t to,
+			     const char *contact_endpoint)
+{
+	struct contact *c = contact_create(node);
+
+	c->from = from;
+	c->to = to;
+	c->bitrate = 1000;
+	recalculate_contact_capacity(c);
+	if (contact_endpoint) {
+		c->contact_endpoints = malloc(sizeof(struct endpoint_list));
+		c->contact_endpoints->eid = strdup(contact_endpoint);
+		c->contact_endpoints->next = NULL;
+	}
+	add_contact_to_ordered_list(&node->contacts, c, 1);
+	return c;
+}
+
+static void add_endpoint_to_contact(struct contact *c, const char *eid)
+{
+	struct endpoint_list *el = malloc(sizeof(struct endpoint_list));
+
+	el->eid = strdup(eid);
+	el->next = c->contact_endpoints;
+	c->contact_endpoints = el;
+}
+
+static struct node *mknode(const char *eid, const char *endpoint)
+{
+	struct node *n = node_create((char *)eid);
+
+	n->cla_addr = strdup("cla:addr");
+	if (endpoint) {
+		n->endpoints = malloc(sizeof(struct endpoint_list));
+		n->endpoints->eid = strdup(endpoint);
+		n->endpoints->next = NULL;
+	}
+	return n;
+}
+
+static struct contact *c1, *c2;
+
+TEST_SETUP(routerCgr)
+{
+	struct node *r1, *r2;
+
+	sig_queue = hal_queue_create(60, 6);
+	routing_table_init();
+	hal_time_init(0);
+
+	// dtn://d.dtn can be reached directly via r2 at 100 or via r1 at 10
+	r1 = mknode("dtn://r1.dtn", NULL);
+	c1 = addct(r1, 10, 20, "dtn://r2.dtn");
+	r2 = mknode("dtn://r2.dtn", "dtn://d.dtn");
+	c2 = addct(r2, 100, 110, NULL);
+	routing_table_add_node(r1, sig_queue);
+	routing_table_add_node(r2, sig_queue);
+}
+
+TEST_TEAR_DOWN(routerCgr)
+{
+	routing_table_free();
+	hal_queue_delete(sig_queue);
+}
+
+TEST(routerCgr, earliest_arrival)
+{
+	const struct router_cgr_route *routes;
+
+	TEST_ASSERT_EQUAL_UINT8(2, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c1, routes[0].first_hop);
+	TEST_ASSERT_EQUAL_UINT64(10, routes[0].arrival);
+	TEST_ASSERT_EQUAL_UINT64(20, routes[0].expiry);
+	TEST_ASSERT_EQUAL_UINT8(2, routes[0].hop_count);
+	TEST_ASSERT_EQUAL_PTR(c2, routes[1].first_hop);
+	TEST_ASSERT_EQUAL_UINT64(100, routes[1].arrival);
+	TEST_ASSERT_EQUAL_UINT8(1, routes[1].hop_count);
+
+	// The relay contact is over
+	TEST_ASSERT_EQUAL_UINT8(1, router_cgr_get_routes(
+		"dtn://d.dtn", 20, &routes));
+	TEST_ASSERT_EQUAL_PTR(c2, routes[0].first_hop);
+
+	TEST_ASSERT_EQUAL_UINT8(0, router_cgr_get_routes(
+		"dtn://unknown.dtn", 0, &routes));
+}
+
+TEST(routerCgr, invalidation)
+{
+	const struct router_cgr_route *routes;
+	struct node *r3 = mknode("dtn://r3.dtn", NULL);
+	struct contact *c3 = addct(r3, 5, 8, "dtn://d.dtn");
+
+	TEST_ASSERT_EQUAL_UINT8(2, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+
+	// A new earlier contact becomes the first route
+	routing_table_add_node(r3, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(3, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c3, routes[0].first_hop);
+	TEST_ASSERT_EQUAL_UINT64(5, routes[0].arrival);
+
+	// Routes via a deleted node are dropped
+	TEST_ASSERT_EQUAL_INT(1, routing_table_delete_node(
+		node_create("dtn://r1.dtn"), sig_queue));
+	TEST_ASSERT_EQUAL_UINT8(2, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c3, routes[0].first_hop);
+	TEST_ASSERT_EQUAL_PTR(c2, routes[1].first_hop);
+
+	// ...as well as routes via a passed contact
+	routing_table_contact_passed(c3, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(1, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c2, routes[0].first_hop);
+}
+
+TEST(routerCgr, bulk_update)
+{
+	const struct router_cgr_route *routes;
+	struct node *r3 = mknode("dtn://r3.dtn", NULL);
+	struct contact *c3 = addct(r3, 5, 8, "dtn://d.dtn");
+
+	TEST_ASSERT_EQUAL_UINT8(2, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+
+	// All changes become visible at once at the end
+	routing_table_begin_update();
+	routing_table_delete_node_by_eid("dtn://r2.dtn", sig_queue);
+	routing_table_add_node(r3, sig_queue);
+	routing_table_end_update();
+	TEST_ASSERT_EQUAL_UINT8(1, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c3, routes[0].first_hop);
+}
+
+TEST(routerCgr, lookup_destination)
+{
+	const struct router_candidate *candidates;
+
+	TEST_ASSERT_EQUAL_UINT8(2, router_lookup_destination(
+		"dtn://d.dtn/app", UINT64_MAX, &candidates));
+	TEST_ASSERT_EQUAL_PTR(c1, candidates[0].contact);
+	TEST_ASSERT_EQUAL_PTR(c2, candidates[1].contact);
+
+	// Only the relay route arrives before the bundle expires
+	TEST_ASSERT_EQUAL_UINT8(1, router_lookup_destination(
+		"dtn://d.dtn/app", 50, &candidates));
+	TEST_ASSERT_EQUAL_PTR(c1, candidates[0].contact);
+
+	// Cached entries are updated with the routing table
+	TEST_ASSERT_EQUAL_INT(1, routing_table_delete_node(
+		node_create("dtn://r1.dtn"), sig_queue));
+	TEST_ASSERT_EQUAL_UINT8(1, router_lookup_destination(
+		"dtn://d.dtn/app", UINT64_MAX, &candidates));
+	TEST_ASSERT_EQUAL_PTR(c2, candidates[0].contact);
+}
+
+TEST(routerCgr, endpoint_patterns)
+{
+	const struct router_cgr_route *routes;
+	const struct router_candidate *candidates;
+	struct node *r3 = mknode("dtn://r3.dtn", NULL);
+	struct contact *c3 = addct(r3, 30, 40, "ipn:100-199.*");
+	struct node *r4;
+	struct contact *c4;
+
+	add_endpoint_to_contact(c3, "dtn://e.dtn/*");
+	routing_table_add_node(r3, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(1, router_cgr_get_routes(
+		"ipn:150.1", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c3, routes[0].first_hop);
+	TEST_ASSERT_EQUAL_UINT8(0, router_cgr_get_routes(
+		"ipn:200.1", 0, &routes));
+	TEST_ASSERT_EQUAL_UINT8(1, router_lookup_destination(
+		"dtn://e.dtn/app", UINT64_MAX, &candidates));
+	TEST_ASSERT_EQUAL_PTR(c3, candidates[0].contact);
+
+	// Patterns naming known nodes allow relaying via these nodes
+	r4 = mknode("dtn://r4.dtn", NULL);
+	c4 = addct(r4, 50, 60, "dtn://r2*");
+	routing_table_add_node(r4, sig_queue);
+	TEST_ASSERT_EQUAL_UINT8(3, router_cgr_get_routes(
+		"dtn://d.dtn", 0, &routes));
+	TEST_ASSERT_EQUAL_PTR(c4, routes[1].first_hop);
+	TEST_ASSERT_EQUAL_UINT64(50, routes[1].arrival);
+}
+
+TEST_GROUP_RUNNER(routerCgr)
+{
+	RUN_TEST_CASE(routerCgr, earliest_arrival);
+	RUN_TEST_CASE(routerCgr, invalidation);
+	RUN_TEST_CASE(routerCgr, bulk_update);
+	RUN_TEST_CASE(routerCgr, lookup_destination);
+	RUN_TEST_CASE(routerCgr, endpoint_patterns);
+}
@@ -0,0 +1,174 @@
+#include "upcn/bundle.h"
+#include "upcn/config.h"
+#include "upcn/node.h"
+#include "upcn/router.h"
+#include "upcn/router_optimizer.h"
+#include "upcn/router_task.h"
+#include "upcn/routing_table.h"
+
+#include "platform/hal_queue.h"
+#include "platform/hal_time.h"
+
+#include "unity_fixture.h"
+
+#include <stdint.h>
+
+uint8_t router_run_optimization_int(QueueIdentifier_t router_queue,
+				    uint32_t budget);
+
+TEST_GROUP(routerOptimizer);
+
+#define CONTACT_COUNT 4
+#define BUNDLE_COUNT (ROUTER_OPTIMIZER_QUEUE_SIZE + 1)
+
+// No routes exist, so all bundles stay at their contacts when optimized
+static const char destination[] = "dtn://unknown.dtn/app";
+
+static QueueIdentifier_t sig_queue;
+static struct router_config config;
+static struct contact *contacts[CONTACT_COUNT];
+static struct routed_bundle bundles[BUNDLE_COUNT];
+
+static void add_bundle(struct routed_bundle *rb, bundleid_t id,
+		       uint8_t improvement, struct contact **contact)
+{
+	*rb = (struct routed_bundle){
+		.id = id,
+		.destination = (char *)destination,
+		.preemption_improvement = improvement,
+		.prio = BUNDLE_RPRIO_NORMAL,
+		.size = 10,
+		.exp_time = UINT64_MAX,
+		.contacts = contact,
+		.contact_count = 1,
+	};
+	TEST_ASSERT_EQUAL(UPCN_OK, router_add_bundle_to_contact(*contact, rb));
+}
+
+TEST_SETUP(routerOptimizer)
+{
+	struct router_config small_batches;
+	int i;
+
+	sig_queue = hal_queue_create(10, sizeof(struct router_signal));
+	routing_table_init();
+	hal_time_init(0);
+	config = router_get_config();
+	small_batches = config;
+	small_batches.opt_max_bundles = 2;
+	TEST_ASSERT_EQUAL(UPCN_OK, router_update_config(small_batches));
+	for (i = 0; i < CONTACT_COUNT; i++) {
+		contacts[i] = contact_create(NULL);
+		contacts[i]->to = 1000;
+		contacts[i]->bitrate = 1000;
+		recalculate_contact_capacity(contacts[i]);
+	}
+}
+
+TEST_TEAR_DOWN(routerOptimizer)
+{
+	int i;
+
+	for (i = 0; i < CONTACT_COUNT; i++) {
+		router_optimizer_contact_removed(contacts[i]);
+		free_contact(contacts[i]);
+	}
+	router_update_config(config);
+	routing_table_free();
+	hal_queue_delete(sig_queue);
+}
+
+TEST(routerOptimizer, mark_dirty)
+{
+	add_bundle(&bundles[0], 1, 1, &contacts[0]);
+	TEST_ASSERT_EQUAL_UINT8(1, contacts[0]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[1]->optimizer_dirty);
+
+	// Contacts are only revisited once
+	router_optimizer_mark_dirty(contacts[0]);
+	router_optimizer_mark_dirty(contacts[1]);
+	router_optimizer_mark_dirty(contacts[1]);
+	TEST_ASSERT_EQUAL_UINT8(1,
+		router_run_optimization_int(sig_queue, UINT32_MAX));
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[0].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[0]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[1]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT32(1, contacts[0]->bundle_count);
+}
+
+TEST(routerOptimizer, queue_overflow)
+{
+	int i;
+
+	// The worst candidate is evicted as soon as the queue is full
+	add_bundle(&bundles[0], 1, 1, &contacts[1]);
+	for (i = 1; i < BUNDLE_COUNT; i++)
+		add_bundle(&bundles[i], i + 1, 2, &contacts[0]);
+	router_run_optimization_int(sig_queue, UINT32_MAX);
+	for (i = 1; i < BUNDLE_COUNT; i++)
+		TEST_ASSERT_EQUAL_UINT8(0, bundles[i].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[0]->optimizer_dirty);
+
+	// Its contact is revisited during the next run
+	TEST_ASSERT_EQUAL_UINT8(1, bundles[0].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(1, contacts[1]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(1,
+		router_run_optimization_int(sig_queue, UINT32_MAX));
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[0].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[1]->optimizer_dirty);
+}
+
+TEST(routerOptimizer, budget)
+{
+	int i;
+
+	for (i = 0; i < CONTACT_COUNT; i++)
+		add_bundle(&bundles[i], i + 1, i + 1, &contacts[i]);
+
+	// Without budget, only the first batch of the best candidates is run
+	TEST_ASSERT_EQUAL_UINT8(2, router_run_optimization_int(sig_queue, 0));
+	TEST_ASSERT_EQUAL_UINT8(1, bundles[0].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(2, bundles[1].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[2].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[3].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(1, contacts[0]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(1, contacts[1]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[2]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[3]->optimizer_dirty);
+
+	// The remaining candidates are carried over to the next run
+	TEST_ASSERT_EQUAL_UINT8(2, router_run_optimization_int(sig_queue, 0));
+	for (i = 0; i < CONTACT_COUNT; i++) {
+		TEST_ASSERT_EQUAL_UINT8(0, bundles[i].preemption_improvement);
+		TEST_ASSERT_EQUAL_UINT8(0, contacts[i]->optimizer_dirty);
+	}
+	TEST_ASSERT_EQUAL_UINT8(0, router_run_optimization_int(sig_queue, 0));
+}
+
+TEST(routerOptimizer, contact_removed)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+		add_bundle(&bundles[i], i + 1, 1, &contacts[i]);
+
+	// Removed contacts are not revisited anymore
+	router_optimizer_contact_removed(contacts[1]);
+	router_optimizer_contact_removed(contacts[3]);
+	TEST_ASSERT_EQUAL_UINT8(0, contacts[1]->optimizer_dirty);
+	TEST_ASSERT_EQUAL_UINT8(2,
+		router_run_optimization_int(sig_queue, UINT32_MAX));
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[0].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(1, bundles[1].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0, bundles[2].preemption_improvement);
+	TEST_ASSERT_EQUAL_UINT8(0,
+		router_run_optimization_int(sig_queue, UINT32_MAX));
+}
+
+TEST_GROUP_RUNNER(routerOptimizer)
+{
+	RUN_TEST_CASE(routerOptimizer, mark_dirty);
+	RUN_TEST_CASE(routerOptimizer, queue_overflow);
+	RUN_TEST_CASE(routerOptimizer, budget);
+	RUN_TEST_CASE(routerOptimizer, contact_removed);
+}
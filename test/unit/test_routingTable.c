@@ -1,5 +1,6 @@
 #include "upcn/bundle_processor.h"
 #include "upcn/node.h"
+#include "upcn/router_task.h"
 #include "upcn/routing_table.h"
 
 #include "platform/hal_queue.h"
@@ -9,9 +10,14 @@
 
 #include "unity_fixture.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+bool router_process_plan_int(
+	struct router_plan *plan,
+	QueueIdentifier_t bp_signaling_queue);
+
 TEST_GROUP(routingTable);
 
 static struct contact *createct(struct node *node,
@@ -219,8 +225,55 @@ TEST(routingTable, routing_table_replace)
 	free_node(node3);
 }
 
+static struct router_plan *create_full_plan(struct node *a, struct node *b)
+{
+	struct router_plan *plan = malloc(sizeof(struct router_plan));
+
+	plan->full = true;
+	plan->command_count = b ? 2 : 1;
+	plan->commands = malloc(sizeof(struct router_command) * 2);
+	plan->commands[0] = (struct router_command){ ROUTER_COMMAND_ADD, a };
+	plan->commands[1] = (struct router_command){ ROUTER_COMMAND_ADD, b };
+	return plan;
+}
+
+TEST(routingTable, routing_table_plan)
+{
+	struct router_plan *plan;
+	struct node *node4;
+
+	routing_table_add_node(node11, sig_queue);
+	routing_table_add_node(node3, sig_queue);
+
+	/* node1-3 has overlapping contacts, the plan is rejected as a whole */
+	node4 = node_create("node4");
+	node4->cla_addr = strdup("cla:addr6");
+	plan = create_full_plan(node4, node13);
+	TEST_ASSERT_FALSE(router_process_plan_int(plan, sig_queue));
+	router_plan_free(plan);
+	TEST_ASSERT_EQUAL_PTR(node11, routing_table_lookup_node("node1"));
+	TEST_ASSERT_EQUAL_PTR(node3, routing_table_lookup_node("node3"));
+	TEST_ASSERT_NULL(routing_table_lookup_node("node4"));
+	TEST_ASSERT_EQUAL_PTR(c1, routing_table_lookup_eid("node2")
+		->contacts->data);
+
+	/* A valid full plan replaces all nodes */
+	node4 = node_create("node4");
+	node4->cla_addr = strdup("cla:addr6");
+	plan = create_full_plan(node4, NULL);
+	TEST_ASSERT_TRUE(router_process_plan_int(plan, sig_queue));
+	router_plan_free(plan);
+	TEST_ASSERT_EQUAL_PTR(node4, routing_table_lookup_node("node4"));
+	TEST_ASSERT_NULL(routing_table_lookup_node("node1"));
+	TEST_ASSERT_NULL(routing_table_lookup_node("node3"));
+	TEST_ASSERT_NULL(routing_table_lookup_eid("node2"));
+	free_node(node12);
+	free_node(node2);
+}
+
 TEST_GROUP_RUNNER(routingTable)
 {
 	RUN_TEST_CASE(routingTable, routing_table_add_delete);
 	RUN_TEST_CASE(routingTable, routing_table_replace);
+	RUN_TEST_CASE(routingTable, routing_table_plan);
 }
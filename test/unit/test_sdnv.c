@@ -4,6 +4,8 @@
 
 #include "unity_fixture.h"
 
+#include <string.h>
+
 TEST_GROUP(sdnv);
 
 TEST_SETUP(sdnv)
@@ -193,9 +195,68 @@ TEST(sdnv, sdnv_read)
 	TEST_ASSERT_EQUAL_INT(10, i);
 }
 
+TEST(sdnv, sdnv_decode)
+{
+	uint8_t buffer[MAX_SDNV_SIZE + 8];
+	uint16_t t16;
+	uint32_t t32;
+	uint64_t t64, value;
+	int_fast8_t size;
+	int shift;
+
+	/* Word-wise (trailing bytes available) and byte-wise decoding */
+	for (shift = 0; shift < 64; shift++) {
+		value = (VAL_MAX64 >> shift) ^ ((uint64_t)shift << 3);
+		memset(buffer, 0xFF, sizeof(buffer));
+		size = sdnv_write_u64(buffer, value);
+		t64 = 0;
+		TEST_ASSERT_EQUAL_INT(size, sdnv_decode_u64(buffer,
+			sizeof(buffer), &t64));
+		TEST_ASSERT_EQUAL_HEX64(value, t64);
+		t64 = 0;
+		TEST_ASSERT_EQUAL_INT(size, sdnv_decode_u64(buffer, size,
+			&t64));
+		TEST_ASSERT_EQUAL_HEX64(value, t64);
+		/* Incomplete */
+		TEST_ASSERT_EQUAL_INT(0, sdnv_decode_u64(buffer, size - 1,
+			&t64));
+	}
+
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, ARR_MAX16, sizeof(ARR_MAX16));
+	TEST_ASSERT_EQUAL_INT(3, sdnv_decode_u16(buffer, sizeof(buffer),
+		&t16));
+	TEST_ASSERT_EQUAL_HEX16(VAL_MAX16, t16);
+	memcpy(buffer, ARR_MAX32, sizeof(ARR_MAX32));
+	TEST_ASSERT_EQUAL_INT(5, sdnv_decode_u32(buffer, sizeof(buffer),
+		&t32));
+	TEST_ASSERT_EQUAL_HEX32(VAL_MAX32, t32);
+
+	/* Overflows */
+	memcpy(buffer, ARR_ERR16, sizeof(ARR_ERR16));
+	TEST_ASSERT_EQUAL_INT(-1, sdnv_decode_u16(buffer, sizeof(buffer),
+		&t16));
+	TEST_ASSERT_EQUAL_INT(-1, sdnv_decode_u16(buffer, sizeof(ARR_ERR16),
+		&t16));
+	memcpy(buffer, ARR_ERR32, sizeof(ARR_ERR32));
+	TEST_ASSERT_EQUAL_INT(-1, sdnv_decode_u32(buffer, sizeof(buffer),
+		&t32));
+	memcpy(buffer, ARR_ERR64, sizeof(ARR_ERR64));
+	TEST_ASSERT_EQUAL_INT(-1, sdnv_decode_u64(buffer, sizeof(buffer),
+		&t64));
+	/* Leading zero groups exceeding the maximum length */
+	memcpy(buffer, (uint8_t[]){ 0x80, 0x80, 0x80, 0x01 }, 4);
+	TEST_ASSERT_EQUAL_INT(-1, sdnv_decode_u16(buffer, sizeof(buffer),
+		&t16));
+	TEST_ASSERT_EQUAL_INT(4, sdnv_decode_u32(buffer, sizeof(buffer),
+		&t32));
+	TEST_ASSERT_EQUAL_HEX32(1, t32);
+}
+
 TEST_GROUP_RUNNER(sdnv)
 {
 	RUN_TEST_CASE(sdnv, sdnv_get_size);
 	RUN_TEST_CASE(sdnv, sdnv_write);
 	RUN_TEST_CASE(sdnv, sdnv_read);
+	RUN_TEST_CASE(sdnv, sdnv_decode);
 }
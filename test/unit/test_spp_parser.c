@@ -203,10 +203,102 @@ TEST(spp_parser, parse_header_with_timestamp_segmentwise)
 			  parser_instance.state);
 }
 
+TEST(spp_parser, parse_header_with_timestamp_split)
+{
+	const uint8_t packet[] = {
+		0x08, 0x01,
+		0x80, 0x03,
+		0x00, 0x09,
+		0x71, 0x68, 0x37, 0x0d, 0x00, 0x06, 0x76, 0xab,
+		0x23, 0x42,
+	};
+
+	struct spp_tc_context_t timecode;
+	size_t split, read, data_length;
+
+	timecode.with_p_field = false;
+	timecode.defaults.type = SPP_TC_UNSEGMENTED_CCSDS_EPOCH;
+	timecode.defaults.unsegmented.base_unit_octets = 4;
+	timecode.defaults.unsegmented.fractional_octets = 4;
+
+	TEST_ASSERT_TRUE(spp_configure_timecode(ctx, &timecode));
+
+	// The headers are split at every possible position
+	for (split = 1; split < 14; split++) {
+		spp_parser_reset(&parser_instance);
+		read = spp_parser_read(&parser_instance, &packet[0], split);
+		TEST_ASSERT_EQUAL(split, read);
+		read = spp_parser_read(&parser_instance, &packet[split],
+				       ARRAY_SIZE(packet) - split);
+		TEST_ASSERT_EQUAL(14 - split, read);
+		TEST_ASSERT_EQUAL(SPP_PARSER_STATE_DATA_SUBPARSER,
+				  parser_instance.state);
+		TEST_ASSERT_TRUE(spp_parser_get_data_length(&parser_instance,
+							    &data_length));
+		TEST_ASSERT_EQUAL(2, data_length);
+		TEST_ASSERT_EQUAL_UINT64(577279245,
+					 parser_instance.dtn_timestamp);
+	}
+}
+
+TEST(spp_parser, parse_packet)
+{
+	uint8_t packet[] = {
+		0x08, 0x01,
+		0x80, 0x03,
+		0x00, 0x09,
+		0x71, 0x68, 0x37, 0x0d, 0x00, 0x06, 0x76, 0xab,
+		0x23, 0x42,
+	};
+
+	struct spp_tc_context_t timecode;
+	struct spp_meta_t meta;
+	const uint8_t *data;
+	size_t data_length;
+
+	timecode.with_p_field = false;
+	timecode.defaults.type = SPP_TC_UNSEGMENTED_CCSDS_EPOCH;
+	timecode.defaults.unsegmented.base_unit_octets = 4;
+	timecode.defaults.unsegmented.fractional_octets = 4;
+
+	TEST_ASSERT_TRUE(spp_configure_timecode(ctx, &timecode));
+
+	TEST_ASSERT_EQUAL(0, spp_get_packet_size(packet, 5));
+	TEST_ASSERT_EQUAL(ARRAY_SIZE(packet),
+			  spp_get_packet_size(packet, 6));
+
+	TEST_ASSERT_EQUAL(0, spp_parse_packet(ctx, packet, ARRAY_SIZE(packet),
+					      &meta, &data, &data_length));
+	TEST_ASSERT_EQUAL(1, meta.apid);
+	TEST_ASSERT_EQUAL(SPP_SEGMENT_LAST, meta.segment_status);
+	TEST_ASSERT_EQUAL(3, meta.segment_number);
+	TEST_ASSERT_EQUAL_UINT64(577279245, meta.dtn_timestamp);
+	TEST_ASSERT_EQUAL_PTR(&packet[14], data);
+	TEST_ASSERT_EQUAL(2, data_length);
+
+	// Truncated packet
+	TEST_ASSERT_EQUAL(-1, spp_parse_packet(ctx, packet,
+					       ARRAY_SIZE(packet) - 1,
+					       &meta, &data, &data_length));
+
+	// Timecode longer than the packet
+	packet[5] = 0x04;
+	TEST_ASSERT_EQUAL(-1, spp_parse_packet(ctx, packet, 11,
+					       &meta, &data, &data_length));
+	packet[5] = 0x09;
+
+	// Invalid version
+	packet[0] |= 0x20;
+	TEST_ASSERT_EQUAL(-1, spp_parse_packet(ctx, packet, ARRAY_SIZE(packet),
+					       &meta, &data, &data_length));
+}
+
 TEST_GROUP_RUNNER(spp_parser)
 {
 	RUN_TEST_CASE(spp_parser, parse_header);
 	RUN_TEST_CASE(spp_parser, parse_header_bytewise);
 	RUN_TEST_CASE(spp_parser, parse_header_with_timestamp);
 	RUN_TEST_CASE(spp_parser, parse_header_with_timestamp_segmentwise);
+	RUN_TEST_CASE(spp_parser, parse_header_with_timestamp_split);
+	RUN_TEST_CASE(spp_parser, parse_packet);
 }
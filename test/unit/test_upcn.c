@@ -20,7 +20,24 @@ TEST(upcn, hal_time)
 	TEST_ASSERT_EQUAL_UINT64(0, hal_time_get_timestamp_s());
 }
 
+TEST(upcn, hal_time_resolutions)
+{
+	uint64_t s, ms, us, coarse;
+
+	hal_time_init(1234);
+	coarse = hal_time_get_timestamp_s_coarse();
+	s = hal_time_get_timestamp_s();
+	ms = hal_time_get_timestamp_ms();
+	us = hal_time_get_timestamp_us();
+	TEST_ASSERT(coarse >= 1234 && coarse <= s);
+	TEST_ASSERT(ms >= s * 1000 && ms / 1000 <= s + 1);
+	TEST_ASSERT(us >= ms * 1000 && us / 1000 <= ms + 1);
+	TEST_ASSERT(hal_time_get_timestamp_us() >= us);
+	hal_time_init(0);
+}
+
 TEST_GROUP_RUNNER(upcn)
 {
 	RUN_TEST_CASE(upcn, hal_time);
+	RUN_TEST_CASE(upcn, hal_time_resolutions);
 }